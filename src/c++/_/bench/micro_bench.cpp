@@ -0,0 +1,532 @@
+// Micro-benchmarks for collections::list, collections::vector and
+// collections::array, with the matching std:: containers as baselines, and
+// for lru_cache against its sharded concurrent form.
+//
+// Build (from the repository root):
+//   g++ -std=c++20 -O2 -DNDEBUG src/c++/_/bench/micro_bench.cpp -o micro_bench
+//
+// Usage:
+//   micro_bench [--counts 1000,100000] [--elem-sizes 8,64,256] [--reps 7]
+//               [--filter list] [--out results.json]
+//
+// Every (container, operation, element size, count) case is run --reps times;
+// the JSON report carries the min and median wall time of the runs.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../collections/array.h"
+#include "../../collections/list.h"
+#include "../../collections/lru_cache.h"
+#include "../../collections/vector.h"
+
+namespace bench
+{
+    /**
+     * @brief Element of @a _Bytes bytes; ordering and equality only look at
+     *        the key so every payload size does the same logical work.
+     */
+    template <size_t _Bytes>
+    struct Payload
+    {
+        static_assert(_Bytes >= sizeof(uint64_t));
+
+        uint64_t key;
+        unsigned char pad[_Bytes - sizeof(uint64_t)];
+
+        Payload() noexcept
+            : key(0)
+        {
+        }
+
+        explicit Payload(uint64_t k) noexcept
+            : key(k)
+        {
+            std::memset(pad, int(k), sizeof(pad));
+        }
+
+        friend bool operator<(const Payload &x, const Payload &y) noexcept { return x.key < y.key; }
+        friend bool operator==(const Payload &x, const Payload &y) noexcept { return x.key == y.key; }
+        friend bool operator!=(const Payload &x, const Payload &y) noexcept { return x.key != y.key; }
+    };
+
+    template <>
+    struct Payload<sizeof(uint64_t)>
+    {
+        uint64_t key;
+
+        Payload() noexcept
+            : key(0)
+        {
+        }
+
+        explicit Payload(uint64_t k) noexcept
+            : key(k)
+        {
+        }
+
+        friend bool operator<(const Payload &x, const Payload &y) noexcept { return x.key < y.key; }
+        friend bool operator==(const Payload &x, const Payload &y) noexcept { return x.key == y.key; }
+        friend bool operator!=(const Payload &x, const Payload &y) noexcept { return x.key != y.key; }
+    };
+
+    /**
+     * @brief Keeps the optimizer from discarding a computed value.
+     */
+    template <class _Ty>
+    inline void do_not_optimize(const _Ty &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Options
+    {
+        std::vector<size_t> counts{1000, 100000};
+        std::vector<size_t> elem_sizes{8, 64, 256};
+        size_t reps = 7;
+        std::string filter;
+        std::string out;
+    };
+
+    struct Result
+    {
+        std::string container;
+        std::string op;
+        bool baseline;
+        size_t elem_size;
+        size_t count;
+        double min_ns;
+        double median_ns;
+    };
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options &opts)
+            : _Opts(opts)
+        {
+        }
+
+        /**
+         * @brief Times @a body @a reps times. @a setup runs before every
+         *        repetition and is not timed.
+         */
+        template <class _Setup, class _Body>
+        void run(const char *container, const char *op, bool baseline, size_t elem_size, size_t count,
+                 _Setup setup, _Body body)
+        {
+            std::string name = std::string(container) + "/" + op;
+            if (!_Opts.filter.empty() && name.find(_Opts.filter) == std::string::npos)
+                return;
+
+            std::vector<double> samples;
+            samples.reserve(_Opts.reps);
+            for (size_t r = 0; r < _Opts.reps; ++r)
+            {
+                setup();
+                const auto start = std::chrono::steady_clock::now();
+                body();
+                const auto stop = std::chrono::steady_clock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+            }
+            std::sort(samples.begin(), samples.end());
+            _Results.push_back({container, op, baseline, elem_size, count, samples.front(), samples[samples.size() / 2]});
+            std::fprintf(stderr, "%-22s %-22s %4zuB x %-9zu %12.0f ns\n", container, op, elem_size, count,
+                         samples[samples.size() / 2]);
+        }
+
+        void write_json(std::FILE *out) const
+        {
+            std::fprintf(out, "{\n  \"benchmark\": \"micro\",\n  \"repetitions\": %zu,\n  \"results\": [", _Opts.reps);
+            for (size_t i = 0; i < _Results.size(); ++i)
+            {
+                const Result &r = _Results[i];
+                std::fprintf(out,
+                             "%s\n    {\"container\": \"%s\", \"op\": \"%s\", \"baseline\": %s, \"elem_size\": %zu, "
+                             "\"count\": %zu, \"min_ns\": %.0f, \"median_ns\": %.0f, \"ns_per_elem\": %.3f}",
+                             i ? "," : "", r.container.c_str(), r.op.c_str(), r.baseline ? "true" : "false",
+                             r.elem_size, r.count, r.min_ns, r.median_ns, r.count ? r.median_ns / double(r.count) : 0.0);
+            }
+            std::fprintf(out, "\n  ]\n}\n");
+        }
+
+    private:
+        const Options &_Opts;
+        std::vector<Result> _Results;
+    };
+
+    inline std::vector<uint64_t> random_keys(size_t count, uint64_t range, uint64_t seed)
+    {
+        std::mt19937_64 rng(seed);
+        std::vector<uint64_t> keys(count);
+        for (uint64_t &k : keys)
+            k = rng() % range;
+        return keys;
+    }
+
+    /**
+     * @brief list benchmarks, shared by collections::list and std::list
+     */
+    template <class _List, size_t _Bytes>
+    void bench_list(Runner &runner, const char *name, bool baseline, size_t count)
+    {
+        using T = Payload<_Bytes>;
+        const std::vector<uint64_t> keys = random_keys(count, count, 42);
+        const std::vector<uint64_t> dups = random_keys(count, count / 8 + 1, 7);
+
+        runner.run(name, "emplace_back", baseline, _Bytes, count, [] {}, [&]
+                   {
+                       _List l;
+                       for (size_t i = 0; i < count; ++i)
+                           l.emplace_back(keys[i]);
+                       do_not_optimize(l.back());
+                   });
+
+        runner.run(name, "emplace_front", baseline, _Bytes, count, [] {}, [&]
+                   {
+                       _List l;
+                       for (size_t i = 0; i < count; ++i)
+                           l.emplace_front(keys[i]);
+                       do_not_optimize(l.front());
+                   });
+
+        _List work;
+        auto fill = [&](const std::vector<uint64_t> &src)
+        {
+            return [&work, &src]
+            {
+                work.clear();
+                for (uint64_t k : src)
+                    work.emplace_back(k);
+            };
+        };
+
+        runner.run(name, "erase", baseline, _Bytes, count, fill(keys), [&]
+                   {
+                       // erase every other element
+                       auto it = work.begin();
+                       while (it != work.end())
+                       {
+                           it = work.erase(it);
+                           if (it != work.end())
+                               ++it;
+                       }
+                       do_not_optimize(work.size());
+                   });
+
+        _List other;
+        runner.run(name, "splice", baseline, _Bytes, count, [&]
+                   {
+                       fill(keys)();
+                       other.clear();
+                       for (size_t i = 0; i < count; ++i)
+                           other.emplace_back(keys[i]);
+                   },
+                   [&]
+                   {
+                       // move single elements across, then the whole list back
+                       for (size_t i = 0; i < count / 2; ++i)
+                           work.splice(work.end(), other, other.begin());
+                       other.splice(other.begin(), work);
+                       do_not_optimize(other.size());
+                   });
+
+        runner.run(name, "sort", baseline, _Bytes, count, fill(keys), [&]
+                   {
+                       work.sort();
+                       do_not_optimize(work.front());
+                   });
+
+        runner.run(name, "merge", baseline, _Bytes, count, [&]
+                   {
+                       fill(keys)();
+                       work.sort();
+                       other.clear();
+                       for (size_t i = 0; i < count; ++i)
+                           other.emplace_back(dups[i]);
+                       other.sort();
+                   },
+                   [&]
+                   {
+                       work.merge(other);
+                       do_not_optimize(work.size());
+                   });
+
+        runner.run(name, "operator==", baseline, _Bytes, count, [&]
+                   {
+                       fill(keys)();
+                       other.clear();
+                       for (size_t i = 0; i < count; ++i)
+                           other.emplace_back(keys[i]);
+                       // Payload equality only looks at the key: flip the
+                       // padding so comparing bytes would get it wrong
+                       if constexpr (_Bytes > sizeof(uint64_t))
+                           for (T &x : other)
+                               for (unsigned char &b : x.pad)
+                                   b = static_cast<unsigned char>(~b);
+                   },
+                   [&]
+                   {
+                       if (!(work == other))
+                       {
+                           std::fprintf(stderr, "%s: operator== ignored the element's operator==\n", name);
+                           std::abort();
+                       }
+                   });
+
+        runner.run(name, "unique", baseline, _Bytes, count, [&]
+                   {
+                       fill(dups)();
+                       work.sort();
+                   },
+                   [&]
+                   {
+                       work.unique();
+                       do_not_optimize(work.size());
+                   });
+
+        runner.run(name, "remove_if", baseline, _Bytes, count, fill(keys), [&]
+                   {
+                       work.remove_if([](const T &x)
+                                      { return x.key & 1; });
+                       do_not_optimize(work.size());
+                   });
+    }
+
+    /**
+     * @brief vector construction and fill benchmarks
+     */
+    template <class _Vector, size_t _Bytes>
+    void bench_vector(Runner &runner, const char *name, bool baseline, size_t count)
+    {
+        using T = Payload<_Bytes>;
+        const std::vector<uint64_t> keys = random_keys(count, count, 42);
+        std::vector<T> source;
+        source.reserve(count);
+        for (uint64_t k : keys)
+            source.emplace_back(k);
+
+        runner.run(name, "construct_n", baseline, _Bytes, count, [] {}, [&]
+                   {
+                       _Vector v(count, T(1));
+                       do_not_optimize(v.data());
+                   });
+
+        runner.run(name, "construct_range", baseline, _Bytes, count, [] {}, [&]
+                   {
+                       _Vector v(source.begin(), source.end());
+                       do_not_optimize(v.data());
+                   });
+
+        runner.run(name, "push_back", baseline, _Bytes, count, [] {}, [&]
+                   {
+                       _Vector v;
+                       for (size_t i = 0; i < count; ++i)
+                           v.push_back(T(keys[i]));
+                       do_not_optimize(v.data());
+                   });
+
+        runner.run(name, "emplace_back_reserved", baseline, _Bytes, count, [] {}, [&]
+                   {
+                       _Vector v;
+                       v.reserve(count);
+                       for (size_t i = 0; i < count; ++i)
+                           v.emplace_back(keys[i]);
+                       do_not_optimize(v.data());
+                   });
+    }
+
+    /**
+     * @brief array fill and map benchmarks; the arrays live on the heap since
+     *        the larger sizes do not fit a default stack.
+     */
+    template <size_t _Bytes, size_t _Count>
+    void bench_array(Runner &runner)
+    {
+        using T = Payload<_Bytes>;
+
+        auto mine = std::make_unique<collections::array<T, _Count>>();
+        runner.run("collections::array", "fill", false, _Bytes, _Count, [] {}, [&]
+                   {
+                       mine->fill(T(3));
+                       do_not_optimize(mine->data());
+                   });
+        runner.run("collections::array", "map", false, _Bytes, _Count, [] {}, [&]
+                   {
+                       mine->map([](T x)
+                                 { x.key = x.key * 3 + 1; return x; });
+                       do_not_optimize(mine->data());
+                   });
+
+        auto theirs = std::make_unique<std::array<T, _Count>>();
+        runner.run("std::array", "fill", true, _Bytes, _Count, [] {}, [&]
+                   {
+                       theirs->fill(T(3));
+                       do_not_optimize(theirs->data());
+                   });
+        runner.run("std::array", "map", true, _Bytes, _Count, [] {}, [&]
+                   {
+                       std::transform(theirs->begin(), theirs->end(), theirs->begin(), [](T x)
+                                      { x.key = x.key * 3 + 1; return x; });
+                       do_not_optimize(theirs->data());
+                   });
+    }
+
+    /**
+     * @brief put then get of distinct keys, all of which fit. The sharded
+     *        cache should stay within a small factor of the plain one on a
+     *        single thread; a large gap means the shard choice and the
+     *        probing inside a shard are correlated.
+     */
+    template <class _Cache>
+    void bench_cache(Runner &runner, const char *name, size_t shards, size_t count)
+    {
+        const std::vector<uint64_t> keys = random_keys(count, uint64_t(-1), 42);
+        std::unique_ptr<_Cache> cache;
+        auto make = [&]
+        {
+            if constexpr (std::is_constructible_v<_Cache, size_t, size_t>)
+                cache = std::make_unique<_Cache>(count, shards);
+            else
+                cache = std::make_unique<_Cache>(count);
+        };
+
+        runner.run(name, "put", false, sizeof(uint64_t), count, make, [&]
+                   {
+                       for (uint64_t k : keys)
+                           cache->put(k, k);
+                       do_not_optimize(cache->size());
+                   });
+
+        runner.run(name, "get", false, sizeof(uint64_t), count, [&]
+                   {
+                       make();
+                       for (uint64_t k : keys)
+                           cache->put(k, k);
+                   },
+                   [&]
+                   {
+                       uint64_t sum = 0;
+                       for (uint64_t k : keys)
+                           if (auto v = cache->get(k))
+                               sum += *v;
+                       do_not_optimize(sum);
+                   });
+    }
+
+    template <size_t _Bytes>
+    void bench_size(Runner &runner, const Options &opts)
+    {
+        using T = Payload<_Bytes>;
+        for (size_t count : opts.counts)
+        {
+            bench_list<collections::list<T>, _Bytes>(runner, "collections::list", false, count);
+            bench_list<std::list<T>, _Bytes>(runner, "std::list", true, count);
+            bench_vector<collections::vector<T>, _Bytes>(runner, "collections::vector", false, count);
+            bench_vector<std::vector<T>, _Bytes>(runner, "std::vector", true, count);
+            if constexpr (_Bytes == sizeof(uint64_t))
+            {
+                using lru = collections::lru_cache<uint64_t, uint64_t>;
+                using sharded = collections::concurrent_lru_cache<uint64_t, uint64_t>;
+                bench_cache<lru>(runner, "collections::lru_cache", 1, count);
+                bench_cache<sharded>(runner, "concurrent_lru_cache/16", 16, count);
+                bench_cache<sharded>(runner, "concurrent_lru_cache/64", 64, count);
+            }
+        }
+        // array extents are part of the type, so they are fixed here
+        bench_array<_Bytes, 1024>(runner);
+        bench_array<_Bytes, 65536>(runner);
+    }
+
+    inline std::vector<size_t> parse_list(const char *arg)
+    {
+        std::vector<size_t> values;
+        for (const char *p = arg; *p;)
+        {
+            char *end = nullptr;
+            values.push_back(std::strtoull(p, &end, 10));
+            p = *end == ',' ? end + 1 : end;
+            if (end == p && *p)
+                break;
+        }
+        return values;
+    }
+
+    inline bool parse_options(int argc, char **argv, Options &opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (!value)
+                return false;
+            if (arg == "--counts")
+                opts.counts = parse_list(value);
+            else if (arg == "--elem-sizes")
+                opts.elem_sizes = parse_list(value);
+            else if (arg == "--reps")
+                opts.reps = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+            else if (arg == "--filter")
+                opts.filter = value;
+            else if (arg == "--out")
+                opts.out = value;
+            else
+                return false;
+            ++i;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::Options opts;
+    if (!bench::parse_options(argc, argv, opts))
+    {
+        std::fprintf(stderr, "usage: %s [--counts N,N] [--elem-sizes 8,64,256] [--reps N] [--filter S] [--out FILE]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    bench::Runner runner(opts);
+    for (size_t size : opts.elem_sizes)
+    {
+        switch (size)
+        {
+        case 8:
+            bench::bench_size<8>(runner, opts);
+            break;
+        case 64:
+            bench::bench_size<64>(runner, opts);
+            break;
+        case 256:
+            bench::bench_size<256>(runner, opts);
+            break;
+        default:
+            std::fprintf(stderr, "unsupported element size %zu (8, 64 or 256)\n", size);
+            return 2;
+        }
+    }
+
+    std::FILE *out = opts.out.empty() ? stdout : std::fopen(opts.out.c_str(), "w");
+    if (!out)
+    {
+        std::perror(opts.out.c_str());
+        return 1;
+    }
+    runner.write_json(out);
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+// Binary trace of container operations, shared by the recorder that runs in
+// production and by trace_replay.
+//
+// Layout (all integers little endian):
+//   header : magic "CTRC" (u32), version (u16), reserved (u16)
+//   record : op (u8), key (LEB128 varint), size (LEB128 varint)
+//
+// The meaning of size depends on the op: the payload bytes of an insert, the
+// number of elements visited by an iterate, unused (0) for erase and find.
+// Records run to the end of the file, so a recorder that is killed mid-run
+// still leaves a readable trace.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace bench
+{
+    enum class Trace_op : uint8_t
+    {
+        insert = 0,
+        erase = 1,
+        find = 2,
+        iterate = 3
+    };
+
+    constexpr size_t trace_op_count = 4;
+
+    inline const char *trace_op_name(Trace_op op) noexcept
+    {
+        switch (op)
+        {
+        case Trace_op::insert:
+            return "insert";
+        case Trace_op::erase:
+            return "erase";
+        case Trace_op::find:
+            return "find";
+        default:
+            return "iterate";
+        }
+    }
+
+    struct Trace_record
+    {
+        Trace_op op;
+        uint32_t size;
+        uint64_t key;
+    };
+
+    constexpr uint32_t trace_magic = 0x43525443; // "CTRC"
+    constexpr uint16_t trace_version = 1;
+
+    /**
+     * @brief Appends records to a trace file. Output is buffered by stdio;
+     *        call flush() to make the records durable.
+     */
+    class Trace_writer
+    {
+    public:
+        explicit Trace_writer(const char *path)
+            : _File(std::fopen(path, "wb"))
+        {
+            if (!_File)
+                throw std::runtime_error("trace: cannot open output file");
+            uint8_t header[8];
+            _Put_u32(header, trace_magic);
+            header[4] = uint8_t(trace_version);
+            header[5] = uint8_t(trace_version >> 8);
+            header[6] = header[7] = 0;
+            std::fwrite(header, 1, sizeof(header), _File);
+        }
+
+        Trace_writer(const Trace_writer &) = delete;
+        Trace_writer &operator=(const Trace_writer &) = delete;
+
+        ~Trace_writer()
+        {
+            if (_File)
+                std::fclose(_File);
+        }
+
+        void write(Trace_op op, uint64_t key, uint32_t size = 0)
+        {
+            uint8_t buffer[1 + 10 + 5];
+            uint8_t *out = buffer;
+            *out++ = uint8_t(op);
+            out = _Put_varint(out, key);
+            out = _Put_varint(out, size);
+            std::fwrite(buffer, 1, size_t(out - buffer), _File);
+        }
+
+        void flush()
+        {
+            std::fflush(_File);
+        }
+
+    private:
+        static void _Put_u32(uint8_t *out, uint32_t v) noexcept
+        {
+            for (int i = 0; i < 4; ++i)
+                out[i] = uint8_t(v >> (8 * i));
+        }
+
+        static uint8_t *_Put_varint(uint8_t *out, uint64_t v) noexcept
+        {
+            while (v >= 0x80)
+            {
+                *out++ = uint8_t(v) | 0x80;
+                v >>= 7;
+            }
+            *out++ = uint8_t(v);
+            return out;
+        }
+
+        std::FILE *_File;
+    };
+
+    /**
+     * @brief Reads a whole trace into memory, so decoding stays out of the
+     *        timed replay loop.
+     *
+     * @throws std::runtime_error on a missing file or a malformed header.
+     *         A truncated final record is dropped.
+     */
+    inline std::vector<Trace_record> read_trace(const char *path)
+    {
+        std::FILE *file = std::fopen(path, "rb");
+        if (!file)
+            throw std::runtime_error("trace: cannot open input file");
+
+        std::vector<uint8_t> bytes;
+        uint8_t chunk[1 << 16];
+        size_t n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+            bytes.insert(bytes.end(), chunk, chunk + n);
+        std::fclose(file);
+
+        if (bytes.size() < 8)
+            throw std::runtime_error("trace: file too short");
+        const uint32_t magic = uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 |
+                               uint32_t(bytes[3]) << 24;
+        const uint16_t version = uint16_t(bytes[4] | bytes[5] << 8);
+        if (magic != trace_magic)
+            throw std::runtime_error("trace: bad magic");
+        if (version != trace_version)
+            throw std::runtime_error("trace: unsupported version");
+
+        const uint8_t *in = bytes.data() + 8;
+        const uint8_t *const end = bytes.data() + bytes.size();
+        auto varint = [&in, end](uint64_t &v) -> bool
+        {
+            v = 0;
+            for (unsigned shift = 0; in != end && shift < 64; shift += 7)
+            {
+                const uint8_t byte = *in++;
+                v |= uint64_t(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        };
+
+        std::vector<Trace_record> records;
+        while (in != end)
+        {
+            const uint8_t op = *in++;
+            uint64_t key;
+            uint64_t size;
+            if (op >= trace_op_count)
+                throw std::runtime_error("trace: bad op code");
+            if (!varint(key) || !varint(size))
+                break;
+            records.push_back({Trace_op(op), uint32_t(size), key});
+        }
+        return records;
+    }
+}
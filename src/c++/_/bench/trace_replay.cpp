@@ -0,0 +1,495 @@
+// Replays a recorded trace of container operations (see trace_format.h)
+// against several containers and reports throughput, per-op latency
+// percentiles and peak RSS for each.
+//
+// Build (from the repository root, Linux):
+//   g++ -std=c++20 -O2 -DNDEBUG src/c++/_/bench/trace_replay.cpp -o trace_replay
+//
+// Usage:
+//   trace_replay <trace> [--targets collections::list,std::map] [--out results.json]
+//   trace_replay --generate <ops> <trace> [--keys N] [--seed S]
+//
+// Each target is replayed in a forked child so that its peak RSS is not
+// polluted by the targets replayed before it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "trace_format.h"
+#include "../../collections/btree_map.h"
+#include "../../collections/flat_map.h"
+#include "../../collections/list.h"
+#include "../../collections/vector.h"
+
+namespace bench
+{
+    /**
+     * @brief Log-linear latency histogram: 16 sub-buckets per power of two,
+     *        so percentiles are within ~6% of the true value while memory
+     *        stays fixed whatever the trace length.
+     */
+    class Latency_histogram
+    {
+    public:
+        void add(uint64_t ns) noexcept
+        {
+            ++_Counts[_Bucket(ns)];
+            ++_Total;
+            _Max = std::max(_Max, ns);
+        }
+
+        uint64_t count() const noexcept
+        {
+            return _Total;
+        }
+
+        uint64_t max() const noexcept
+        {
+            return _Max;
+        }
+
+        /**
+         * @brief Upper bound of the bucket holding the @a p quantile
+         */
+        uint64_t percentile(double p) const noexcept
+        {
+            if (!_Total)
+                return 0;
+            const uint64_t target = std::max<uint64_t>(1, uint64_t(p * double(_Total) + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < _Buckets; ++i)
+            {
+                seen += _Counts[i];
+                if (seen >= target)
+                    return std::min(_Upper(i), _Max);
+            }
+            return _Max;
+        }
+
+    private:
+        static constexpr unsigned _Sub_bits = 4;
+        static constexpr size_t _Buckets = 64 << _Sub_bits;
+
+        static size_t _Bucket(uint64_t ns) noexcept
+        {
+            if (ns < (1u << _Sub_bits))
+                return size_t(ns);
+            const unsigned msb = 63 - unsigned(__builtin_clzll(ns));
+            return size_t(msb - _Sub_bits + 1) << _Sub_bits | size_t((ns >> (msb - _Sub_bits)) & ((1u << _Sub_bits) - 1));
+        }
+
+        static uint64_t _Upper(size_t i) noexcept
+        {
+            if (i < (1u << _Sub_bits))
+                return i;
+            const unsigned shift = unsigned(i >> _Sub_bits) - 1;
+            const uint64_t lower = (uint64_t((1u << _Sub_bits) | (i & ((1u << _Sub_bits) - 1)))) << shift;
+            return lower + (uint64_t(1) << shift) - 1;
+        }
+
+        uint64_t _Counts[_Buckets] = {};
+        uint64_t _Total = 0;
+        uint64_t _Max = 0;
+    };
+
+    /**
+     * @brief Plain data result, passed from the replay child over a pipe.
+     */
+    struct Replay_result
+    {
+        struct Op
+        {
+            uint64_t count;
+            uint64_t p50_ns;
+            uint64_t p99_ns;
+            uint64_t p999_ns;
+            uint64_t max_ns;
+        };
+
+        uint64_t ops;
+        uint64_t total_ns;
+        uint64_t rss_before_kb;
+        uint64_t peak_rss_kb;
+        uint64_t checksum;
+        Op all;
+        Op per_op[trace_op_count];
+    };
+
+    /**
+     * @brief Reads a "Vm...:   1234 kB" field of /proc/self/status
+     */
+    inline uint64_t proc_status_kb(const char *field)
+    {
+        std::FILE *file = std::fopen("/proc/self/status", "r");
+        if (!file)
+            return 0;
+        char line[256];
+        uint64_t kb = 0;
+        const size_t len = std::strlen(field);
+        while (std::fgets(line, sizeof(line), file))
+            if (std::strncmp(line, field, len) == 0 && line[len] == ':')
+            {
+                kb = std::strtoull(line + len + 1, nullptr, 10);
+                break;
+            }
+        std::fclose(file);
+        return kb;
+    }
+
+    /**
+     * @brief Element stored by the sequence targets
+     */
+    struct Trace_element
+    {
+        uint64_t key;
+        std::string value;
+    };
+
+    /**
+     * @brief Sequence containers keep elements in insertion order, so find
+     *        and erase are linear searches by key; that cost is what the
+     *        replay is meant to expose.
+     */
+    template <class _Seq>
+    class Sequence_target
+    {
+    public:
+        void insert(uint64_t key, uint32_t size)
+        {
+            _Items.push_back(Trace_element{key, std::string(size, char(key))});
+        }
+
+        bool erase(uint64_t key)
+        {
+            auto it = _Find(key);
+            if (it == _Items.end())
+                return false;
+            _Items.erase(it);
+            return true;
+        }
+
+        bool find(uint64_t key)
+        {
+            return _Find(key) != _Items.end();
+        }
+
+        uint64_t iterate(uint32_t n)
+        {
+            uint64_t sum = 0;
+            for (auto it = _Items.begin(); n && it != _Items.end(); ++it, --n)
+                sum += it->key + it->value.size();
+            return sum;
+        }
+
+    private:
+        auto _Find(uint64_t key)
+        {
+            return std::find_if(_Items.begin(), _Items.end(), [key](const Trace_element &e)
+                                { return e.key == key; });
+        }
+
+        _Seq _Items;
+    };
+
+    /**
+     * @brief Associative containers keyed by the trace key; a repeated
+     *        insert of a present key is a no-op, as try_emplace.
+     */
+    template <class _Map>
+    class Map_target
+    {
+    public:
+        void insert(uint64_t key, uint32_t size)
+        {
+            _Items.try_emplace(key, size_t(size), char(key));
+        }
+
+        bool erase(uint64_t key)
+        {
+            return _Items.erase(key) != 0;
+        }
+
+        bool find(uint64_t key)
+        {
+            return _Items.find(key) != _Items.end();
+        }
+
+        uint64_t iterate(uint32_t n)
+        {
+            uint64_t sum = 0;
+            for (auto it = _Items.begin(); n && it != _Items.end(); ++it, --n)
+                sum += it->first + it->second.size();
+            return sum;
+        }
+
+    private:
+        _Map _Items;
+    };
+
+    template <class _Target>
+    Replay_result replay(const std::vector<Trace_record> &trace)
+    {
+        using clock = std::chrono::steady_clock;
+
+        Replay_result result{};
+        result.rss_before_kb = proc_status_kb("VmRSS");
+
+        Latency_histogram all;
+        Latency_histogram per_op[trace_op_count];
+        uint64_t checksum = 0;
+        {
+            _Target target;
+            const auto start = clock::now();
+            for (const Trace_record &r : trace)
+            {
+                const auto op_start = clock::now();
+                switch (r.op)
+                {
+                case Trace_op::insert:
+                    target.insert(r.key, r.size);
+                    break;
+                case Trace_op::erase:
+                    checksum += target.erase(r.key);
+                    break;
+                case Trace_op::find:
+                    checksum += target.find(r.key);
+                    break;
+                case Trace_op::iterate:
+                    checksum += target.iterate(r.size);
+                    break;
+                }
+                const auto op_stop = clock::now();
+                const uint64_t ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(op_stop - op_start).count());
+                all.add(ns);
+                per_op[size_t(r.op)].add(ns);
+            }
+            result.total_ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+            result.peak_rss_kb = proc_status_kb("VmHWM");
+        }
+
+        auto summarize = [](const Latency_histogram &h)
+        {
+            return Replay_result::Op{h.count(), h.percentile(0.50), h.percentile(0.99), h.percentile(0.999), h.max()};
+        };
+        result.ops = trace.size();
+        result.checksum = checksum;
+        result.all = summarize(all);
+        for (size_t i = 0; i < trace_op_count; ++i)
+            result.per_op[i] = summarize(per_op[i]);
+        return result;
+    }
+
+    struct Target
+    {
+        const char *name;
+        Replay_result (*run)(const std::vector<Trace_record> &);
+    };
+
+    using Blob = std::string;
+
+    // new containers are added here
+    const Target targets[] = {
+        {"collections::list", &replay<Sequence_target<collections::list<Trace_element>>>},
+        {"collections::vector", &replay<Sequence_target<collections::vector<Trace_element>>>},
+        {"collections::flat_map", &replay<Map_target<collections::flat_map<uint64_t, Blob>>>},
+        {"collections::btree_map", &replay<Map_target<collections::btree_map<uint64_t, Blob>>>},
+        {"std::list", &replay<Sequence_target<std::list<Trace_element>>>},
+        {"std::vector", &replay<Sequence_target<std::vector<Trace_element>>>},
+        {"std::map", &replay<Map_target<std::map<uint64_t, Blob>>>},
+    };
+
+    /**
+     * @brief Runs @a target in a child process and returns its result;
+     *        falls back to an in-process run if fork is unavailable.
+     */
+    inline bool run_isolated(const Target &target, const std::vector<Trace_record> &trace, Replay_result &out)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            out = target.run(trace);
+            return true;
+        }
+        const pid_t pid = fork();
+        if (pid < 0)
+        {
+            close(fds[0]);
+            close(fds[1]);
+            out = target.run(trace);
+            return true;
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            const Replay_result r = target.run(trace);
+            const ssize_t written = write(fds[1], &r, sizeof(r));
+            _exit(written == ssize_t(sizeof(r)) ? 0 : 1);
+        }
+
+        close(fds[1]);
+        size_t got = 0;
+        while (got < sizeof(out))
+        {
+            const ssize_t n = read(fds[0], reinterpret_cast<char *>(&out) + got, sizeof(out) - got);
+            if (n <= 0)
+                break;
+            got += size_t(n);
+        }
+        close(fds[0]);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return got == sizeof(out) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    inline void write_op_json(std::FILE *out, const Replay_result::Op &op)
+    {
+        std::fprintf(out, "{\"count\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}",
+                     (unsigned long long)op.count, (unsigned long long)op.p50_ns, (unsigned long long)op.p99_ns,
+                     (unsigned long long)op.p999_ns, (unsigned long long)op.max_ns);
+    }
+
+    inline void write_result_json(std::FILE *out, const char *name, const Replay_result &r)
+    {
+        const double seconds = double(r.total_ns) / 1e9;
+        std::fprintf(out,
+                     "    {\"container\": \"%s\", \"ops\": %llu, \"total_ns\": %llu, \"ops_per_sec\": %.0f, "
+                     "\"rss_before_kb\": %llu, \"peak_rss_kb\": %llu, \"checksum\": %llu,\n     \"latency\": ",
+                     name, (unsigned long long)r.ops, (unsigned long long)r.total_ns,
+                     seconds > 0 ? double(r.ops) / seconds : 0.0, (unsigned long long)r.rss_before_kb,
+                     (unsigned long long)r.peak_rss_kb, (unsigned long long)r.checksum);
+        write_op_json(out, r.all);
+        for (size_t i = 0; i < trace_op_count; ++i)
+        {
+            std::fprintf(out, ",\n     \"%s\": ", trace_op_name(Trace_op(i)));
+            write_op_json(out, r.per_op[i]);
+        }
+        std::fprintf(out, "}");
+    }
+
+    /**
+     * @brief Writes a synthetic trace: 50% insert, 30% find, 15% erase and
+     *        5% short iterations over uniformly drawn keys.
+     */
+    inline void generate(const char *path, uint64_t ops, uint64_t keys, uint64_t seed)
+    {
+        std::mt19937_64 rng(seed);
+        Trace_writer writer(path);
+        for (uint64_t i = 0; i < ops; ++i)
+        {
+            const unsigned pick = unsigned(rng() % 100);
+            const uint64_t key = rng() % keys;
+            if (pick < 50)
+                writer.write(Trace_op::insert, key, uint32_t(16 + rng() % 240));
+            else if (pick < 80)
+                writer.write(Trace_op::find, key);
+            else if (pick < 95)
+                writer.write(Trace_op::erase, key);
+            else
+                writer.write(Trace_op::iterate, 0, 64);
+        }
+        writer.flush();
+    }
+}
+
+static int usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s <trace> [--targets NAME,NAME] [--out FILE]\n"
+                 "       %s --generate <ops> <trace> [--keys N] [--seed S]\n",
+                 argv0, argv0);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+        return usage(argv[0]);
+
+    try
+    {
+        if (std::strcmp(argv[1], "--generate") == 0)
+        {
+            if (argc < 4)
+                return usage(argv[0]);
+            uint64_t keys = 10000;
+            uint64_t seed = 1;
+            for (int i = 4; i + 1 < argc; i += 2)
+            {
+                if (std::strcmp(argv[i], "--keys") == 0)
+                    keys = std::max<uint64_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+                else if (std::strcmp(argv[i], "--seed") == 0)
+                    seed = std::strtoull(argv[i + 1], nullptr, 10);
+                else
+                    return usage(argv[0]);
+            }
+            bench::generate(argv[3], std::strtoull(argv[2], nullptr, 10), keys, seed);
+            return 0;
+        }
+
+        std::string selected;
+        const char *out_path = nullptr;
+        for (int i = 2; i < argc; i += 2)
+        {
+            if (i + 1 >= argc)
+                return usage(argv[0]);
+            if (std::strcmp(argv[i], "--targets") == 0)
+                selected = std::string(",") + argv[i + 1] + ",";
+            else if (std::strcmp(argv[i], "--out") == 0)
+                out_path = argv[i + 1];
+            else
+                return usage(argv[0]);
+        }
+
+        const std::vector<bench::Trace_record> trace = bench::read_trace(argv[1]);
+        std::fprintf(stderr, "%zu records\n", trace.size());
+
+        std::FILE *out = out_path ? std::fopen(out_path, "w") : stdout;
+        if (!out)
+        {
+            std::perror(out_path);
+            return 1;
+        }
+        std::fprintf(out, "{\n  \"benchmark\": \"trace_replay\",\n  \"trace\": \"%s\",\n  \"results\": [\n", argv[1]);
+        bool first = true;
+        for (const bench::Target &target : bench::targets)
+        {
+            if (!selected.empty() && selected.find(std::string(",") + target.name + ",") == std::string::npos)
+                continue;
+            bench::Replay_result r;
+            if (!bench::run_isolated(target, trace, r))
+            {
+                std::fprintf(stderr, "%s: replay failed\n", target.name);
+                continue;
+            }
+            std::fprintf(stderr, "%-24s %12.0f ops/s  p50 %6llu ns  p99 %8llu ns  p999 %8llu ns  peak %8llu kB\n",
+                         target.name, r.total_ns ? double(r.ops) * 1e9 / double(r.total_ns) : 0.0,
+                         (unsigned long long)r.all.p50_ns, (unsigned long long)r.all.p99_ns,
+                         (unsigned long long)r.all.p999_ns, (unsigned long long)r.peak_rss_kb);
+            if (!first)
+                std::fprintf(out, ",\n");
+            first = false;
+            bench::write_result_json(out, target.name, r);
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+        if (out != stdout)
+            std::fclose(out);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,391 @@
+// Regression tests for the collections headers. Each test is a function
+// registered in main(); a failed check prints its location and the run
+// exits non-zero.
+//
+// Build (from the repository root):
+//   g++ -std=c++20 -O1 -g -pthread -fsanitize=address,undefined src/c++/_/test/collections_test.cpp -o collections_test
+//
+// Usage:
+//   collections_test [--filter vector]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../../collections/flat_map.h"
+#include "../../collections/list.h"
+#include "../../collections/serialization.h"
+#include "../../collections/snapshot.h"
+#include "../../collections/tracking_allocator.h"
+#include "../../collections/vector.h"
+
+namespace
+{
+    int failures = 0;
+
+#define CHECK(cond)                                                               \
+    do                                                                            \
+    {                                                                             \
+        if (!(cond))                                                              \
+        {                                                                         \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                         #cond);                                                  \
+            ++failures;                                                           \
+        }                                                                         \
+    } while (0)
+
+    /**
+     * @brief Allocator tagged with an arena id; memory must go back to the
+     *        arena it came from, so allocators of different arenas compare
+     *        unequal. @a _Pocma selects whether move assignment propagates it.
+     */
+    template <class _Ty, bool _Pocma>
+    struct Arena_allocator
+    {
+        using value_type = _Ty;
+        using propagate_on_container_move_assignment = std::bool_constant<_Pocma>;
+        using propagate_on_container_swap = std::bool_constant<_Pocma>;
+        using is_always_equal = std::false_type;
+
+        template <class _Other>
+        struct rebind
+        {
+            using other = Arena_allocator<_Other, _Pocma>;
+        };
+
+        static inline long live[4];
+        static inline long allocations;
+
+        int arena = 0;
+
+        Arena_allocator() noexcept = default;
+
+        explicit Arena_allocator(int id) noexcept
+            : arena(id)
+        {
+        }
+
+        template <class _Other>
+        Arena_allocator(const Arena_allocator<_Other, _Pocma> &x) noexcept
+            : arena(x.arena)
+        {
+        }
+
+        _Ty *allocate(size_t n)
+        {
+            live[arena] += long(n * sizeof(_Ty));
+            ++allocations;
+            return std::allocator<_Ty>().allocate(n);
+        }
+
+        void deallocate(_Ty *p, size_t n) noexcept
+        {
+            live[arena] -= long(n * sizeof(_Ty));
+            std::allocator<_Ty>().deallocate(p, n);
+        }
+
+        template <class _Other>
+        friend bool operator==(const Arena_allocator &x, const Arena_allocator<_Other, _Pocma> &y) noexcept
+        {
+            return x.arena == y.arena;
+        }
+
+        template <class _Other>
+        friend bool operator!=(const Arena_allocator &x, const Arena_allocator<_Other, _Pocma> &y) noexcept
+        {
+            return x.arena != y.arena;
+        }
+    };
+
+    template <bool _Pocma>
+    void vector_move_keeps_allocator()
+    {
+        using alloc = Arena_allocator<std::string, _Pocma>;
+        using vec = collections::vector<std::string, alloc>;
+        std::memset(alloc::live, 0, sizeof(alloc::live));
+        {
+            vec a(alloc(1));
+            for (int i = 0; i < 100; ++i)
+                a.push_back(std::to_string(i));
+
+            vec b(std::move(a));
+            CHECK(b.get_allocator().arena == 1);
+            CHECK(b.size() == 100 && b[99] == "99");
+            CHECK(a.empty());
+
+            vec c(alloc(2));
+            c.push_back("x");
+            c = std::move(b);
+            CHECK(c.size() == 100 && c[42] == "42");
+            CHECK(c.get_allocator().arena == (_Pocma ? 1 : 2));
+            CHECK(b.empty());
+
+            vec d(alloc(1));
+            d = std::move(c);
+            CHECK(d.size() == 100 && d[7] == "7");
+            CHECK(d.get_allocator().arena == 1);
+
+            // swapping unequal allocators that do not propagate is undefined
+            vec e(alloc(_Pocma ? 3 : 1));
+            e.swap(d);
+            CHECK(e.size() == 100 && d.empty());
+            CHECK(e.get_allocator().arena == 1);
+        }
+        for (long bytes : alloc::live)
+            CHECK(bytes == 0);
+    }
+
+    void vector_move()
+    {
+        vector_move_keeps_allocator<true>();
+        vector_move_keeps_allocator<false>();
+    }
+
+    void vector_resize_grows_geometrically()
+    {
+        using alloc = Arena_allocator<int, true>;
+        alloc::allocations = 0;
+        collections::vector<int, alloc> v;
+        for (int i = 0; i < 4096; ++i)
+        {
+            v.resize(v.size() + 64);
+            v.back() = i;
+        }
+        CHECK(v.size() == 4096 * 64);
+        CHECK(alloc::allocations < 32);
+        CHECK(v[64 * 100 + 63] == 100 && v[64 * 100] == 0);
+    }
+
+    /**
+     * @brief Reads a string a few bytes at a time and cannot seek, like a
+     *        pipe or a socket.
+     */
+    class Pipe_streambuf : public std::streambuf
+    {
+    public:
+        explicit Pipe_streambuf(std::string data)
+            : _Data(std::move(data))
+        {
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            if (_Pos == _Data.size())
+                return traits_type::eof();
+            const size_t k = std::min<size_t>(4093, _Data.size() - _Pos);
+            char *p = _Data.data() + _Pos;
+            setg(p, p, p + k);
+            _Pos += k;
+            return traits_type::to_int_type(*p);
+        }
+
+    private:
+        std::string _Data;
+        size_t _Pos = 0;
+    };
+
+    void deserialize_from_pipe()
+    {
+        using alloc = Arena_allocator<uint64_t, true>;
+        collections::vector<uint64_t, alloc> v;
+        for (uint64_t i = 0; i < (1u << 20); ++i)
+            v.push_back(i * 0x9E3779B97F4A7C15ull);
+        std::ostringstream out;
+        collections::serialize(out, v);
+
+        Pipe_streambuf pipe(out.str());
+        std::istream in(&pipe);
+        collections::vector<uint64_t, alloc> w;
+        alloc::allocations = 0;
+        collections::deserialize(in, w);
+        CHECK(w == v);
+        CHECK(w.capacity() == w.size());
+        CHECK(alloc::allocations < 16);
+    }
+
+    /**
+     * @brief Value whose copy throws once the countdown reaches zero
+     */
+    struct Throwing_value
+    {
+        static inline int countdown = -1;
+
+        int value = 0;
+
+        Throwing_value() = default;
+
+        explicit Throwing_value(int v)
+            : value(v)
+        {
+        }
+
+        Throwing_value(const Throwing_value &x)
+            : value(x.value)
+        {
+            if (countdown >= 0 && countdown-- == 0)
+                throw std::runtime_error("copy");
+        }
+
+        Throwing_value &operator=(const Throwing_value &) = default;
+        Throwing_value(Throwing_value &&) noexcept = default;
+        Throwing_value &operator=(Throwing_value &&) noexcept = default;
+    };
+
+    void flat_map_insert_range_throws()
+    {
+        collections::flat_map<int, Throwing_value> m;
+        for (int k = 0; k < 10; ++k)
+            m.emplace(k * 10, Throwing_value(k));
+
+        std::vector<std::pair<int, Throwing_value>> batch;
+        for (int k = 0; k < 50; ++k)
+            batch.emplace_back(99 - k, Throwing_value(k));
+
+        Throwing_value::countdown = 30;
+        bool thrown = false;
+        try
+        {
+            m.insert_range(batch.begin(), batch.end());
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        Throwing_value::countdown = -1;
+        CHECK(thrown);
+        CHECK(m.size() == 10);
+        CHECK(m.keys().size() == m.values().size());
+        for (int k = 0; k < 10; ++k)
+            CHECK(m.contains(k * 10) && m.at(k * 10).value == k);
+
+        m.insert_range(batch.begin(), batch.end());
+        CHECK(m.size() == 55);
+        CHECK(std::is_sorted(m.keys().begin(), m.keys().end()));
+    }
+
+    int64_t live_bytes_of(const char *label)
+    {
+        int64_t live = 0;
+        for (const collections::tracking_site_stats &s : collections::tracking_snapshot())
+            if (s.label == label)
+                live += s.live_bytes;
+        return live;
+    }
+
+    void tracking_follows_moves_and_splices()
+    {
+        using alloc = collections::tracking_allocator<std::allocator<int>>;
+        const alloc a("test.alpha"), b("test.beta");
+        CHECK(a != b && a == alloc(a));
+        {
+            collections::vector<int, alloc> x(a), y(b);
+            x.resize(128);
+            y.resize(1);
+            const int64_t alpha = live_bytes_of("test.alpha");
+            CHECK(alpha >= int64_t(128 * sizeof(int)));
+
+            collections::vector<int, alloc> z(std::move(x));
+            y = std::move(z);
+            CHECK(live_bytes_of("test.alpha") == alpha);
+            CHECK(live_bytes_of("test.beta") == 0);
+            CHECK(y.get_allocator() == a);
+        }
+        CHECK(live_bytes_of("test.alpha") == 0);
+        CHECK(live_bytes_of("test.beta") == 0);
+
+        {
+            collections::list<int, alloc> x(a), y(a), z(b);
+            for (int i = 0; i < 10; ++i)
+            {
+                x.push_back(i);
+                z.push_back(i);
+            }
+            y.splice(y.cend(), x, x.cbegin(), std::next(x.cbegin(), 4));
+            y.splice(y.cbegin(), x);
+            CHECK(x.empty() && y.size() == 10);
+
+            z = std::move(y);
+            CHECK(z.size() == 10);
+            CHECK(live_bytes_of("test.beta") == 0);
+            CHECK(live_bytes_of("test.alpha") > 0);
+        }
+        CHECK(live_bytes_of("test.alpha") == 0);
+        CHECK(live_bytes_of("test.beta") == 0);
+    }
+
+    void snapshot_save_copy_limit()
+    {
+        const std::string path = "collections_test_snapshot.bin";
+        collections::snapshot_writer writer(4096, 2, 1000 * sizeof(int));
+
+        collections::list<int> small;
+        for (int i = 0; i < 1000; ++i)
+            small.push_back(i);
+        writer.save(path, small).wait();
+        {
+            std::ifstream in(path, std::ios::binary);
+            collections::list<int> read;
+            collections::deserialize(in, read);
+            CHECK(read == small);
+        }
+        std::remove(path.c_str());
+
+        small.push_back(1000);
+        bool refused = false;
+        try
+        {
+            writer.save(path, small);
+        }
+        catch (const std::length_error &)
+        {
+            refused = true;
+        }
+        CHECK(refused);
+    }
+
+    struct Test
+    {
+        const char *name;
+        void (*run)();
+    };
+
+    const Test tests[] = {
+        {"vector_move", vector_move},
+        {"vector_resize_grows_geometrically", vector_resize_grows_geometrically},
+        {"deserialize_from_pipe", deserialize_from_pipe},
+        {"flat_map_insert_range_throws", flat_map_insert_range_throws},
+        {"tracking_follows_moves_and_splices", tracking_follows_moves_and_splices},
+        {"snapshot_save_copy_limit", snapshot_save_copy_limit},
+    };
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = nullptr;
+    for (int i = 1; i < argc; ++i)
+        if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+
+    for (const Test &t : tests)
+    {
+        if (filter && !std::strstr(t.name, filter))
+            continue;
+        const int before = failures;
+        t.run();
+        std::printf("%-40s %s\n", t.name, failures == before ? "ok" : "FAILED");
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,4 +1,6 @@
-#include "../../include/pch.h"
+#pragma once
+
+#include "../include/pch.h"
 
 namespace collections
 {
@@ -59,7 +61,7 @@ namespace collections
              */
             constexpr pointer operator->() const noexcept
             {
-                _ASSERT_EXPR(0 < _index, "cannot seek array iterator before begin");
+                _ASSERT_EXPR(_index < _size, "cannot dereference array iterator at end");
                 _ASSERT_EXPR(_data, "cannot seek value-initialized array iterator");
                 return _data + _index;
             }
@@ -72,7 +74,7 @@ namespace collections
             constexpr array_const_iterator operator++() noexcept
             {
                 _ASSERT_EXPR(_data, "cannot seek value-initialized array iterator");
-                _ASSERT_EXPR(_index >= _size, "cannot seek array iterator before begin");
+                _ASSERT_EXPR(_index < _size, "cannot seek array iterator after end");
 
                 ++_index;
                 return *this;
@@ -269,7 +271,7 @@ namespace collections
             using _MyBase = array_const_iterator<T, _size>;
 
 #ifdef __cpp_lib_concepts
-            using iterator_concept = contiguous_iterator_tag;
+            using iterator_concept = std::contiguous_iterator_tag;
 #endif // __cpp_lib_concepts
             using iterator_category = std::random_access_iterator_tag;
             using value_type = T;
@@ -520,6 +522,16 @@ namespace collections
             return static_cast<T *>(_data);
         }
 
+        /**
+         * @brief Gets constant pointer to data
+         * 
+         * @return constexpr const T* 
+         */
+        [[nodiscard]] constexpr const T *data() const noexcept
+        {
+            return static_cast<const T *>(_data);
+        }
+
         /**
          * @brief Alwaya returns false, because the array will never be decreased in size
          * 
@@ -618,7 +630,7 @@ namespace collections
          */
         void fill(T value) noexcept
         {
-            for (int i = 0; i < _size; i++)
+            for (size_t i = 0; i < _size; i++)
             {
                 if (_data[i] != value)
                     _data[i] = value;
@@ -636,7 +648,7 @@ namespace collections
         {
             _ASSERT_EXPR(starting_position < _size, "canot seek array after and");
 
-            for (int i = starting_position; i < final_position; i++)
+            for (size_t i = starting_position; i < final_position; i++)
             {
                 _data[i] = delegate(_data[i]);
             }
@@ -660,7 +672,7 @@ namespace collections
          * @param position 
          * @return constexpr reference 
          */
-        [[nodiscard]] constexpr T &operator[](size_t position) const noexcept
+        [[nodiscard]] constexpr const T &operator[](size_t position) const noexcept
         {
             _ASSERT_EXPR(position < _size, "canot seek array after and");
             return _data[position];
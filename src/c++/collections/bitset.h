@@ -0,0 +1,760 @@
+#pragma once
+
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "array.h"
+#include "vector.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        inline constexpr size_t _Bits_per_word = 64;
+
+        constexpr size_t _Bit_words(size_t bits) noexcept
+        {
+            return (bits + _Bits_per_word - 1) / _Bits_per_word;
+        }
+
+        struct Bits_and
+        {
+            static uint64_t _Word(uint64_t x, uint64_t y) noexcept { return x & y; }
+#if defined(__SSE2__)
+            static __m128i _Vec(__m128i x, __m128i y) noexcept { return _mm_and_si128(x, y); }
+#endif
+#if defined(__AVX2__)
+            static __m256i _Vec(__m256i x, __m256i y) noexcept { return _mm256_and_si256(x, y); }
+#endif
+        };
+
+        struct Bits_or
+        {
+            static uint64_t _Word(uint64_t x, uint64_t y) noexcept { return x | y; }
+#if defined(__SSE2__)
+            static __m128i _Vec(__m128i x, __m128i y) noexcept { return _mm_or_si128(x, y); }
+#endif
+#if defined(__AVX2__)
+            static __m256i _Vec(__m256i x, __m256i y) noexcept { return _mm256_or_si256(x, y); }
+#endif
+        };
+
+        struct Bits_xor
+        {
+            static uint64_t _Word(uint64_t x, uint64_t y) noexcept { return x ^ y; }
+#if defined(__SSE2__)
+            static __m128i _Vec(__m128i x, __m128i y) noexcept { return _mm_xor_si128(x, y); }
+#endif
+#if defined(__AVX2__)
+            static __m256i _Vec(__m256i x, __m256i y) noexcept { return _mm256_xor_si256(x, y); }
+#endif
+        };
+
+        /**
+         * @brief x & ~y
+         */
+        struct Bits_andnot
+        {
+            static uint64_t _Word(uint64_t x, uint64_t y) noexcept { return x & ~y; }
+#if defined(__SSE2__)
+            static __m128i _Vec(__m128i x, __m128i y) noexcept { return _mm_andnot_si128(y, x); }
+#endif
+#if defined(__AVX2__)
+            static __m256i _Vec(__m256i x, __m256i y) noexcept { return _mm256_andnot_si256(y, x); }
+#endif
+        };
+
+        /**
+         * @brief dst[i] = op(dst[i], src[i]) over @a n words, 256 or 128 bits
+         *        at a time where the target allows it.
+         */
+        template <class _Op>
+        void _Bits_apply(uint64_t *dst, const uint64_t *src, size_t n) noexcept
+        {
+            size_t i = 0;
+#if defined(__AVX2__)
+            for (const size_t end = n & ~size_t(3); i != end; i += 4)
+            {
+                const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+                const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _Op::_Vec(x, y));
+            }
+#elif defined(__SSE2__)
+            for (const size_t end = n & ~size_t(1); i != end; i += 2)
+            {
+                const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+                const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _Op::_Vec(x, y));
+            }
+#endif
+            for (; i < n; ++i)
+                dst[i] = _Op::_Word(dst[i], src[i]);
+        }
+
+#if defined(__AVX2__)
+        /**
+         * @brief Per-byte popcount through a nibble lookup, summed into four
+         *        64 bit lanes (Mula's method).
+         */
+        inline __m256i _Bits_popcount256(__m256i v) noexcept
+        {
+            const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m256i low_mask = _mm256_set1_epi8(0x0f);
+            const __m256i lo = _mm256_and_si256(v, low_mask);
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+            const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+            return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+        }
+
+        inline uint64_t _Bits_hsum256(__m256i v) noexcept
+        {
+            return uint64_t(_mm256_extract_epi64(v, 0)) + uint64_t(_mm256_extract_epi64(v, 1)) +
+                   uint64_t(_mm256_extract_epi64(v, 2)) + uint64_t(_mm256_extract_epi64(v, 3));
+        }
+#endif
+
+        /**
+         * @brief Number of set bits in @a n words
+         */
+        inline size_t _Bits_popcount(const uint64_t *words, size_t n) noexcept
+        {
+            size_t i = 0;
+            size_t count = 0;
+#if defined(__AVX2__) && !defined(__AVX512VPOPCNTDQ__)
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 4 <= n; i += 4)
+                acc = _mm256_add_epi64(acc, _Bits_popcount256(
+                                                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i))));
+            count = _Bits_hsum256(acc);
+#endif
+            for (; i < n; ++i)
+                count += __builtin_popcountll(words[i]);
+            return count;
+        }
+
+        /**
+         * @brief Number of set bits in x[i] & y[i] over @a n words, without
+         *        materializing the intersection.
+         */
+        inline size_t _Bits_and_popcount(const uint64_t *x, const uint64_t *y, size_t n) noexcept
+        {
+            size_t i = 0;
+            size_t count = 0;
+#if defined(__AVX2__) && !defined(__AVX512VPOPCNTDQ__)
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 4 <= n; i += 4)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i));
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + i));
+                acc = _mm256_add_epi64(acc, _Bits_popcount256(_mm256_and_si256(a, b)));
+            }
+            count = _Bits_hsum256(acc);
+#endif
+            for (; i < n; ++i)
+                count += __builtin_popcountll(x[i] & y[i]);
+            return count;
+        }
+
+        /**
+         * @brief Position of the @a k-th (from 0) set bit of @a word, which
+         *        must have more than @a k bits set.
+         */
+        inline size_t _Bits_select_in_word(uint64_t word, size_t k) noexcept
+        {
+#if defined(__BMI2__)
+            return __builtin_ctzll(_pdep_u64(uint64_t(1) << k, word));
+#else
+            while (k--)
+                word &= word - 1;
+            return __builtin_ctzll(word);
+#endif
+        }
+
+        /**
+         * @brief Operations shared by the dynamic and the fixed size bitsets.
+         *        _Derived provides _Words() and size(); bits past size() in
+         *        the last word are kept zero.
+         *
+         * @tparam _Derived
+         */
+        template <class _Derived>
+        class Bitset_base
+        {
+        public:
+            static constexpr size_t npos = size_t(-1);
+
+        protected:
+            uint64_t *_W() noexcept
+            {
+                return static_cast<_Derived *>(this)->_Words();
+            }
+
+            const uint64_t *_W() const noexcept
+            {
+                return static_cast<const _Derived *>(this)->_Words();
+            }
+
+            size_t _Bits() const noexcept
+            {
+                return static_cast<const _Derived *>(this)->size();
+            }
+
+            size_t _N() const noexcept
+            {
+                return _Bit_words(_Bits());
+            }
+
+            void _Trim() noexcept
+            {
+                const size_t extra = _Bits() % _Bits_per_word;
+                if (extra)
+                    _W()[_N() - 1] &= (uint64_t(1) << extra) - 1;
+            }
+
+            template <class _Op, class _Other>
+            _Derived &_Apply(const Bitset_base<_Other> &x) noexcept
+            {
+                const size_t n = std::min(_N(), x._N());
+                _Bits_apply<_Op>(_W(), x._W(), n);
+                if constexpr (std::is_same_v<_Op, Bits_and>)
+                    std::fill(_W() + n, _W() + _N(), uint64_t(0));
+                _Trim();
+                return static_cast<_Derived &>(*this);
+            }
+
+            template <class>
+            friend class Bitset_base;
+
+        public:
+            /**
+             * @brief Checks the bit at @a pos
+             *
+             * @param pos
+             * @return true
+             * @return false
+             */
+            bool test(size_t pos) const noexcept
+            {
+                return (_W()[pos / _Bits_per_word] >> (pos % _Bits_per_word)) & 1;
+            }
+
+            bool operator[](size_t pos) const noexcept
+            {
+                return test(pos);
+            }
+
+            _Derived &set(size_t pos) noexcept
+            {
+                _W()[pos / _Bits_per_word] |= uint64_t(1) << (pos % _Bits_per_word);
+                return static_cast<_Derived &>(*this);
+            }
+
+            _Derived &set(size_t pos, bool value) noexcept
+            {
+                return value ? set(pos) : reset(pos);
+            }
+
+            _Derived &reset(size_t pos) noexcept
+            {
+                _W()[pos / _Bits_per_word] &= ~(uint64_t(1) << (pos % _Bits_per_word));
+                return static_cast<_Derived &>(*this);
+            }
+
+            _Derived &flip(size_t pos) noexcept
+            {
+                _W()[pos / _Bits_per_word] ^= uint64_t(1) << (pos % _Bits_per_word);
+                return static_cast<_Derived &>(*this);
+            }
+
+            /**
+             * @brief Sets every bit
+             *
+             * @return _Derived&
+             */
+            _Derived &set() noexcept
+            {
+                std::fill(_W(), _W() + _N(), ~uint64_t(0));
+                _Trim();
+                return static_cast<_Derived &>(*this);
+            }
+
+            /**
+             * @brief Clears every bit
+             *
+             * @return _Derived&
+             */
+            _Derived &reset() noexcept
+            {
+                std::fill(_W(), _W() + _N(), uint64_t(0));
+                return static_cast<_Derived &>(*this);
+            }
+
+            /**
+             * @brief Flips every bit
+             *
+             * @return _Derived&
+             */
+            _Derived &flip() noexcept
+            {
+                uint64_t *w = _W();
+                for (size_t i = 0, n = _N(); i < n; ++i)
+                    w[i] = ~w[i];
+                _Trim();
+                return static_cast<_Derived &>(*this);
+            }
+
+            /**
+             * @brief Number of set bits
+             *
+             * @return size_t
+             */
+            size_t count() const noexcept
+            {
+                return _Bits_popcount(_W(), _N());
+            }
+
+            bool any() const noexcept
+            {
+                const uint64_t *w = _W();
+                for (size_t i = 0, n = _N(); i < n; ++i)
+                    if (w[i])
+                        return true;
+                return false;
+            }
+
+            bool none() const noexcept
+            {
+                return !any();
+            }
+
+            bool all() const noexcept
+            {
+                return count() == _Bits();
+            }
+
+            /**
+             * @brief Position of the first set bit, or npos
+             *
+             * @return size_t
+             */
+            size_t find_first() const noexcept
+            {
+                return _Find_from(0);
+            }
+
+            /**
+             * @brief Position of the first set bit after @a pos, or npos
+             *
+             * @param pos
+             * @return size_t
+             */
+            size_t find_next(size_t pos) const noexcept
+            {
+                return pos + 1 >= _Bits() ? npos : _Find_from(pos + 1);
+            }
+
+            /**
+             * @brief Number of set bits in [0, pos)
+             *
+             * @param pos
+             * @return size_t
+             */
+            size_t rank(size_t pos) const noexcept
+            {
+                const size_t word = pos / _Bits_per_word;
+                const size_t bit = pos % _Bits_per_word;
+                size_t count = _Bits_popcount(_W(), word);
+                if (bit)
+                    count += __builtin_popcountll(_W()[word] & ((uint64_t(1) << bit) - 1));
+                return count;
+            }
+
+            /**
+             * @brief Position of the @a k-th (from 0) set bit, or npos
+             *
+             * @param k
+             * @return size_t
+             */
+            size_t select(size_t k) const noexcept
+            {
+                const uint64_t *w = _W();
+                for (size_t i = 0, n = _N(); i < n; ++i)
+                {
+                    const size_t c = __builtin_popcountll(w[i]);
+                    if (k < c)
+                        return i * _Bits_per_word + _Bits_select_in_word(w[i], k);
+                    k -= c;
+                }
+                return npos;
+            }
+
+            /**
+             * @brief Calls @a fn(pos) for every set bit, in order
+             *
+             * @tparam _Fn
+             * @param fn
+             */
+            template <class _Fn>
+            void for_each_set(_Fn fn) const
+            {
+                const uint64_t *w = _W();
+                for (size_t i = 0, n = _N(); i < n; ++i)
+                {
+                    uint64_t word = w[i];
+                    while (word)
+                    {
+                        fn(i * _Bits_per_word + __builtin_ctzll(word));
+                        word &= word - 1;
+                    }
+                }
+            }
+
+            /**
+             * @brief Number of bits set in both bitsets
+             *
+             * @param x
+             * @return size_t
+             */
+            template <class _Other>
+            size_t intersection_count(const Bitset_base<_Other> &x) const noexcept
+            {
+                return _Bits_and_popcount(_W(), x._W(), std::min(_N(), x._N()));
+            }
+
+            /**
+             * @brief Checks whether any bit is set in both bitsets
+             */
+            template <class _Other>
+            bool intersects(const Bitset_base<_Other> &x) const noexcept
+            {
+                const uint64_t *a = _W();
+                const uint64_t *b = x._W();
+                for (size_t i = 0, n = std::min(_N(), x._N()); i < n; ++i)
+                    if (a[i] & b[i])
+                        return true;
+                return false;
+            }
+
+            /**
+             * @brief Bitwise operations combine the shared words; bits missing
+             *        from the shorter operand read as zero.
+             */
+            template <class _Other>
+            _Derived &operator&=(const Bitset_base<_Other> &x) noexcept
+            {
+                return _Apply<Bits_and>(x);
+            }
+
+            template <class _Other>
+            _Derived &operator|=(const Bitset_base<_Other> &x) noexcept
+            {
+                return _Apply<Bits_or>(x);
+            }
+
+            template <class _Other>
+            _Derived &operator^=(const Bitset_base<_Other> &x) noexcept
+            {
+                return _Apply<Bits_xor>(x);
+            }
+
+            /**
+             * @brief Clears the bits set in @a x (this & ~x)
+             */
+            template <class _Other>
+            _Derived &and_not(const Bitset_base<_Other> &x) noexcept
+            {
+                return _Apply<Bits_andnot>(x);
+            }
+
+        private:
+            size_t _Find_from(size_t pos) const noexcept
+            {
+                const uint64_t *w = _W();
+                const size_t n = _N();
+                size_t i = pos / _Bits_per_word;
+                if (i >= n)
+                    return npos;
+                uint64_t word = w[i] & (~uint64_t(0) << (pos % _Bits_per_word));
+                while (!word)
+                {
+                    if (++i == n)
+                        return npos;
+                    word = w[i];
+                }
+                return i * _Bits_per_word + __builtin_ctzll(word);
+            }
+        };
+    }
+
+    /**
+     * @brief Bitset of run-time size backed by a collections::vector of
+     *        64 bit words.
+     *
+     * @tparam _Alloc
+     */
+    template <class _Alloc = std::allocator<uint64_t>>
+    class basic_bitset : public __base::Bitset_base<basic_bitset<_Alloc>>
+    {
+        using _Base = __base::Bitset_base<basic_bitset<_Alloc>>;
+        friend _Base;
+
+    public:
+        using word_type = uint64_t;
+        using size_type = size_t;
+        using allocator_type = _Alloc;
+
+        /**
+         * @brief Construct a new bitset object with no bits
+         *
+         */
+        basic_bitset()
+            : _Size(0)
+        {
+        }
+
+        /**
+         * @brief Construct a new bitset object of @a n bits
+         *
+         * @param n
+         * @param value Initial value of every bit
+         */
+        explicit basic_bitset(size_type n, bool value = false, const allocator_type &alloc = allocator_type())
+            : _Data(__base::_Bit_words(n), value ? ~word_type(0) : word_type(0), alloc), _Size(n)
+        {
+            this->_Trim();
+        }
+
+        size_type size() const noexcept
+        {
+            return _Size;
+        }
+
+        bool empty() const noexcept
+        {
+            return _Size == 0;
+        }
+
+        size_type word_count() const noexcept
+        {
+            return _Data.size();
+        }
+
+        word_type *data() noexcept
+        {
+            return _Data.data();
+        }
+
+        const word_type *data() const noexcept
+        {
+            return _Data.data();
+        }
+
+        /**
+         * @brief Resizes to @a n bits; new bits take @a value
+         *
+         * @param n
+         * @param value
+         */
+        void resize(size_type n, bool value = false)
+        {
+            const size_type old = _Size;
+            _Data.resize(__base::_Bit_words(n), value ? ~word_type(0) : word_type(0));
+            _Size = n;
+            if (value && n > old && old % __base::_Bits_per_word)
+                _Data[old / __base::_Bits_per_word] |= ~word_type(0) << (old % __base::_Bits_per_word);
+            this->_Trim();
+        }
+
+        void push_back(bool value)
+        {
+            resize(_Size + 1);
+            this->set(_Size - 1, value);
+        }
+
+        void clear() noexcept
+        {
+            _Data.clear();
+            _Size = 0;
+        }
+
+        void reserve(size_type n)
+        {
+            _Data.reserve(__base::_Bit_words(n));
+        }
+
+        void swap(basic_bitset &x) noexcept
+        {
+            _Data.swap(x._Data);
+            std::swap(_Size, x._Size);
+        }
+
+        basic_bitset operator~() const
+        {
+            basic_bitset temp(*this);
+            temp.flip();
+            return temp;
+        }
+
+        friend bool operator==(const basic_bitset &x, const basic_bitset &y) noexcept
+        {
+            return x._Size == y._Size &&
+                   std::equal(x._Data.begin(), x._Data.end(), y._Data.begin());
+        }
+
+        friend bool operator!=(const basic_bitset &x, const basic_bitset &y) noexcept
+        {
+            return !(x == y);
+        }
+
+    private:
+        word_type *_Words() noexcept
+        {
+            return _Data.data();
+        }
+
+        const word_type *_Words() const noexcept
+        {
+            return _Data.data();
+        }
+
+        vector<word_type, _Alloc> _Data;
+        size_type _Size;
+    };
+
+    using bitset = basic_bitset<>;
+
+    /**
+     * @brief Bitset of compile-time size stored in a collections::array
+     *
+     * @tparam _Bits
+     */
+    template <size_t _Bits>
+    class fixed_bitset : public __base::Bitset_base<fixed_bitset<_Bits>>
+    {
+        using _Base = __base::Bitset_base<fixed_bitset<_Bits>>;
+        friend _Base;
+
+        static constexpr size_t _Nwords = __base::_Bit_words(_Bits) ? __base::_Bit_words(_Bits) : 1;
+
+    public:
+        using word_type = uint64_t;
+        using size_type = size_t;
+
+        /**
+         * @brief Construct a new fixed bitset object with every bit clear
+         *
+         */
+        fixed_bitset() noexcept
+        {
+            std::fill_n(_Data.data(), _Nwords, word_type(0));
+        }
+
+        explicit fixed_bitset(bool value) noexcept
+        {
+            std::fill_n(_Data.data(), _Nwords, value ? ~word_type(0) : word_type(0));
+            this->_Trim();
+        }
+
+        static constexpr size_type size() noexcept
+        {
+            return _Bits;
+        }
+
+        static constexpr size_type word_count() noexcept
+        {
+            return __base::_Bit_words(_Bits);
+        }
+
+        word_type *data() noexcept
+        {
+            return _Data.data();
+        }
+
+        const word_type *data() const noexcept
+        {
+            return _Data.data();
+        }
+
+        fixed_bitset operator~() const noexcept
+        {
+            fixed_bitset temp(*this);
+            temp.flip();
+            return temp;
+        }
+
+        friend bool operator==(const fixed_bitset &x, const fixed_bitset &y) noexcept
+        {
+            return std::equal(x._Data.data(), x._Data.data() + word_count(), y._Data.data());
+        }
+
+        friend bool operator!=(const fixed_bitset &x, const fixed_bitset &y) noexcept
+        {
+            return !(x == y);
+        }
+
+    private:
+        word_type *_Words() noexcept
+        {
+            return _Data.data();
+        }
+
+        const word_type *_Words() const noexcept
+        {
+            return _Data.data();
+        }
+
+        array<word_type, _Nwords> _Data;
+    };
+
+    template <class _Alloc>
+    inline basic_bitset<_Alloc> operator&(const basic_bitset<_Alloc> &x, const basic_bitset<_Alloc> &y)
+    {
+        basic_bitset<_Alloc> temp(x);
+        return temp &= y;
+    }
+
+    template <class _Alloc>
+    inline basic_bitset<_Alloc> operator|(const basic_bitset<_Alloc> &x, const basic_bitset<_Alloc> &y)
+    {
+        basic_bitset<_Alloc> temp(x);
+        return temp |= y;
+    }
+
+    template <class _Alloc>
+    inline basic_bitset<_Alloc> operator^(const basic_bitset<_Alloc> &x, const basic_bitset<_Alloc> &y)
+    {
+        basic_bitset<_Alloc> temp(x);
+        return temp ^= y;
+    }
+
+    template <size_t _Bits>
+    inline fixed_bitset<_Bits> operator&(const fixed_bitset<_Bits> &x, const fixed_bitset<_Bits> &y) noexcept
+    {
+        fixed_bitset<_Bits> temp(x);
+        return temp &= y;
+    }
+
+    template <size_t _Bits>
+    inline fixed_bitset<_Bits> operator|(const fixed_bitset<_Bits> &x, const fixed_bitset<_Bits> &y) noexcept
+    {
+        fixed_bitset<_Bits> temp(x);
+        return temp |= y;
+    }
+
+    template <size_t _Bits>
+    inline fixed_bitset<_Bits> operator^(const fixed_bitset<_Bits> &x, const fixed_bitset<_Bits> &y) noexcept
+    {
+        fixed_bitset<_Bits> temp(x);
+        return temp ^= y;
+    }
+}
@@ -0,0 +1,1826 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+#include <cstdint>
+#include <cstddef>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace collections
+{
+    /**
+     * @brief Default size in bytes of a b+ tree node. Four cache lines: the
+     *        keys of a node are scanned with a few sequential line fills.
+     */
+    inline constexpr size_t btree_default_node_bytes = 256;
+
+    /**
+     * @brief Node size matching a memory page, for very large trees.
+     */
+    inline constexpr size_t btree_page_node_bytes = 4096;
+
+    namespace __base
+    {
+        /**
+         * @brief Uninitialized storage for up to _Capacity objects of _Ty.
+         *        The owner node keeps the count of live objects.
+         *
+         * @tparam _Ty
+         * @tparam _Capacity
+         */
+        template <class _Ty, size_t _Capacity>
+        class Btree_slots
+        {
+        public:
+            _Ty *_Ptr() noexcept
+            {
+                return std::launder(reinterpret_cast<_Ty *>(_Data));
+            }
+
+            const _Ty *_Ptr() const noexcept
+            {
+                return std::launder(reinterpret_cast<const _Ty *>(_Data));
+            }
+
+            _Ty &operator[](size_t i) noexcept
+            {
+                return _Ptr()[i];
+            }
+
+            const _Ty &operator[](size_t i) const noexcept
+            {
+                return _Ptr()[i];
+            }
+
+            template <class... _Args>
+            void _Construct(size_t i, _Args &&...args)
+            {
+                ::new (static_cast<void *>(_Ptr() + i)) _Ty(std::forward<_Args>(args)...);
+            }
+
+            void _Destroy(size_t i) noexcept
+            {
+                std::destroy_at(_Ptr() + i);
+            }
+
+            void _Destroy_range(size_t first, size_t last) noexcept
+            {
+                std::destroy(_Ptr() + first, _Ptr() + last);
+            }
+
+            /**
+             * @brief Opens a hole at @a pos of the @a count live objects and
+             *        constructs the new object there.
+             */
+            template <class... _Args>
+            void _Emplace(size_t count, size_t pos, _Args &&...args)
+            {
+                _Ty *p = _Ptr();
+                if (pos == count)
+                {
+                    _Construct(count, std::forward<_Args>(args)...);
+                    return;
+                }
+                _Ty value(std::forward<_Args>(args)...);
+                _Construct(count, std::move(p[count - 1]));
+                std::move_backward(p + pos, p + count - 1, p + count);
+                p[pos] = std::move(value);
+            }
+
+            /**
+             * @brief Removes the object at @a pos of the @a count live objects.
+             */
+            void _Erase(size_t count, size_t pos) noexcept
+            {
+                _Ty *p = _Ptr();
+                std::move(p + pos + 1, p + count, p + pos);
+                _Destroy(count - 1);
+            }
+
+            /**
+             * @brief Moves [first, first + n) into uninitialized slots of @a dst
+             *        starting at @a dpos and destroys the sources.
+             */
+            void _Relocate(size_t first, size_t n, Btree_slots &dst, size_t dpos)
+            {
+                _Ty *src = _Ptr() + first;
+                std::uninitialized_move(src, src + n, dst._Ptr() + dpos);
+                std::destroy(src, src + n);
+            }
+
+            /**
+             * @brief Moves the last object into the front of @a dst.
+             */
+            void _Give_back(size_t count, Btree_slots &dst, size_t dcount)
+            {
+                dst._Emplace(dcount, 0, std::move(_Ptr()[count - 1]));
+                _Destroy(count - 1);
+            }
+
+            /**
+             * @brief Moves the first object onto the end of @a dst.
+             */
+            void _Give_front(size_t count, Btree_slots &dst, size_t dcount)
+            {
+                dst._Construct(dcount, std::move(_Ptr()[0]));
+                _Erase(count, 0);
+            }
+
+        private:
+            alignas(_Ty) unsigned char _Data[sizeof(_Ty) * _Capacity];
+        };
+
+        /**
+         * @brief Slots of a set: there is no mapped value to store.
+         */
+        template <size_t _Capacity>
+        class Btree_slots<void, _Capacity>
+        {
+        public:
+            template <class... _Args>
+            void _Construct(size_t, _Args &&...) noexcept {}
+            void _Destroy(size_t) noexcept {}
+            void _Destroy_range(size_t, size_t) noexcept {}
+            template <class... _Args>
+            void _Emplace(size_t, size_t, _Args &&...) noexcept {}
+            void _Erase(size_t, size_t) noexcept {}
+            void _Relocate(size_t, size_t, Btree_slots &, size_t) noexcept {}
+            void _Give_back(size_t, Btree_slots &, size_t) noexcept {}
+            void _Give_front(size_t, Btree_slots &, size_t) noexcept {}
+        };
+
+        class Btree_node_base
+        {
+        public:
+            uint16_t _Count;
+            bool _Leaf;
+        };
+
+        /**
+         * @brief Leaves are kept in a circular doubly linked list closed by the
+         *        tree header, in the same way as List_node_header.
+         */
+        class Btree_leaf_base
+            : public Btree_node_base
+        {
+        public:
+            Btree_leaf_base *_Prev;
+            Btree_leaf_base *_Next;
+
+            void _Hook(Btree_leaf_base *const position) noexcept
+            {
+                this->_Next = position;
+                this->_Prev = position->_Prev;
+                position->_Prev->_Next = this;
+                position->_Prev = this;
+            }
+
+            void _Unhook() noexcept
+            {
+                this->_Prev->_Next = this->_Next;
+                this->_Next->_Prev = this->_Prev;
+            }
+        };
+
+        template <class _Ty>
+        struct Btree_sizeof : std::integral_constant<size_t, sizeof(_Ty)>
+        {
+        };
+
+        template <>
+        struct Btree_sizeof<void> : std::integral_constant<size_t, 0>
+        {
+        };
+
+        /**
+         * @brief Computes how many keys fit a node of _NodeBytes bytes.
+         */
+        template <class _Key, class _Mapped, size_t _NodeBytes>
+        struct Btree_layout
+        {
+            static_assert(_NodeBytes >= 64, "a b+ tree node must span at least one cache line");
+
+            static constexpr size_t _Clamp(size_t n) noexcept
+            {
+                return n < 4 ? 4 : (n > 0xfffe ? 0xfffe : n);
+            }
+
+            static constexpr size_t _Leaf_capacity = _Clamp(
+                (_NodeBytes - sizeof(Btree_leaf_base)) / (sizeof(_Key) + Btree_sizeof<_Mapped>::value));
+
+            static constexpr size_t _Inner_capacity = _Clamp(
+                (_NodeBytes - sizeof(Btree_node_base) - sizeof(void *)) / (sizeof(_Key) + sizeof(void *)));
+        };
+
+        /**
+         * @brief Leaf node. Keys and values live in separate arrays so the
+         *        key scan touches only keys. One spare slot lets an insertion
+         *        overflow the node before it is split.
+         */
+        template <class _Key, class _Mapped, size_t _Capacity>
+        class Btree_leaf
+            : public Btree_leaf_base
+        {
+        public:
+            using key_type = _Key;
+            using mapped_type = _Mapped;
+
+            Btree_slots<_Key, _Capacity + 1> _Keys;
+            Btree_slots<_Mapped, _Capacity + 1> _Values;
+        };
+
+        /**
+         * @brief Inner node. _Keys[i] is a lower bound of every key below
+         *        _Children[i + 1].
+         */
+        template <class _Key, size_t _Capacity>
+        class Btree_inner
+            : public Btree_node_base
+        {
+        public:
+            Btree_slots<_Key, _Capacity + 1> _Keys;
+            Btree_node_base *_Children[_Capacity + 2];
+        };
+
+        /**
+         * @brief The key scan uses counting compares (and SIMD where available)
+         *        for arithmetic keys under the default ordering.
+         */
+        template <class _Key, class _Compare>
+        struct Btree_simd_search
+            : std::bool_constant<std::is_arithmetic_v<_Key> &&
+                                 (std::is_same_v<_Compare, std::less<_Key>> ||
+                                  std::is_same_v<_Compare, std::less<>>)>
+        {
+        };
+
+        /**
+         * @brief Width of the window scanned linearly; larger nodes are
+         *        narrowed by binary search first.
+         */
+        inline constexpr size_t _Btree_linear_window = 64;
+
+        /**
+         * @brief Counts keys less than @a key (or greater than @a key when
+         *        _Greater is set) in a window of arithmetic keys.
+         */
+        template <bool _Greater, class _Key>
+        size_t _Btree_count(const _Key *keys, size_t n, const _Key key) noexcept
+        {
+            size_t i = 0;
+            size_t count = 0;
+#if defined(__SSE2__)
+            if constexpr (std::is_integral_v<_Key> && std::is_signed_v<_Key> && sizeof(_Key) == 4)
+            {
+                const __m128i k = _mm_set1_epi32(static_cast<int32_t>(key));
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+                    const __m128i m = _Greater ? _mm_cmpgt_epi32(v, k) : _mm_cmplt_epi32(v, k);
+                    count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+                }
+            }
+            else if constexpr (std::is_same_v<_Key, float>)
+            {
+                const __m128 k = _mm_set1_ps(key);
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m128 v = _mm_loadu_ps(keys + i);
+                    count += __builtin_popcount(_mm_movemask_ps(_Greater ? _mm_cmpgt_ps(v, k) : _mm_cmplt_ps(v, k)));
+                }
+            }
+            else if constexpr (std::is_same_v<_Key, double>)
+            {
+                const __m128d k = _mm_set1_pd(key);
+                for (; i + 2 <= n; i += 2)
+                {
+                    const __m128d v = _mm_loadu_pd(keys + i);
+                    count += __builtin_popcount(_mm_movemask_pd(_Greater ? _mm_cmpgt_pd(v, k) : _mm_cmplt_pd(v, k)));
+                }
+            }
+#endif
+#if defined(__AVX2__)
+            if constexpr (std::is_integral_v<_Key> && std::is_signed_v<_Key> && sizeof(_Key) == 8)
+            {
+                const __m256i k = _mm256_set1_epi64x(static_cast<int64_t>(key));
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+                    const __m256i m = _Greater ? _mm256_cmpgt_epi64(v, k) : _mm256_cmpgt_epi64(k, v);
+                    count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+                }
+            }
+#endif
+            // branch free tail, auto-vectorized for the remaining key types
+            for (; i < n; ++i)
+                count += _Greater ? (key < keys[i]) : (keys[i] < key);
+            return count;
+        }
+
+        /**
+         * @brief Index of the first key not less than @a key.
+         */
+        template <class _Key, class _Compare>
+        size_t _Btree_lower_index(const _Key *keys, size_t n, const _Key &key, const _Compare &comp)
+        {
+            if constexpr (Btree_simd_search<_Key, _Compare>::value)
+            {
+                size_t base = 0;
+                while (n > _Btree_linear_window)
+                {
+                    const size_t half = n / 2;
+                    if (keys[base + half] < key)
+                    {
+                        base += half + 1;
+                        n -= half + 1;
+                    }
+                    else
+                        n = half;
+                }
+                return base + _Btree_count<false>(keys + base, n, key);
+            }
+            else
+                return std::lower_bound(keys, keys + n, key, comp) - keys;
+        }
+
+        /**
+         * @brief Index of the first key greater than @a key.
+         */
+        template <class _Key, class _Compare>
+        size_t _Btree_upper_index(const _Key *keys, size_t n, const _Key &key, const _Compare &comp)
+        {
+            if constexpr (Btree_simd_search<_Key, _Compare>::value)
+            {
+                size_t base = 0;
+                while (n > _Btree_linear_window)
+                {
+                    const size_t half = n / 2;
+                    if (!(key < keys[base + half]))
+                    {
+                        base += half + 1;
+                        n -= half + 1;
+                    }
+                    else
+                        n = half;
+                }
+                return base + n - _Btree_count<true>(keys + base, n, key);
+            }
+            else
+                return std::upper_bound(keys, keys + n, key, comp) - keys;
+        }
+
+        template <class _Ref>
+        class Btree_arrow_proxy
+        {
+        public:
+            _Ref _Value;
+
+            _Ref *operator->() noexcept
+            {
+                return std::addressof(_Value);
+            }
+        };
+
+        template <class _Key, class _Mapped, bool _Const>
+        struct Btree_value_traits
+        {
+            using value_type = std::pair<const _Key, _Mapped>;
+            using reference = std::pair<const _Key &, std::conditional_t<_Const, const _Mapped &, _Mapped &>>;
+            using pointer = Btree_arrow_proxy<reference>;
+        };
+
+        template <class _Key, bool _Const>
+        struct Btree_value_traits<_Key, void, _Const>
+        {
+            using value_type = _Key;
+            using reference = const _Key &;
+            using pointer = const _Key *;
+        };
+
+        /**
+         * @brief Bidirectional iterator walking the linked leaves.
+         *
+         * @tparam _Leaf
+         * @tparam _Const
+         */
+        template <class _Leaf, bool _Const>
+        class Btree_iterator
+        {
+            using _Key = typename _Leaf::key_type;
+            using _Mapped = typename _Leaf::mapped_type;
+            using _Traits = Btree_value_traits<_Key, _Mapped, _Const>;
+
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using difference_type = ptrdiff_t;
+            using value_type = typename _Traits::value_type;
+            using reference = typename _Traits::reference;
+            using pointer = typename _Traits::pointer;
+
+            Btree_iterator() noexcept
+                : _M_node(nullptr), _M_index(0)
+            {
+            }
+
+            Btree_iterator(const Btree_leaf_base *node, size_t index) noexcept
+                : _M_node(const_cast<Btree_leaf_base *>(node)), _M_index(index)
+            {
+            }
+
+            template <bool _OtherConst, typename = std::enable_if_t<_Const && !_OtherConst>>
+            Btree_iterator(const Btree_iterator<_Leaf, _OtherConst> &x) noexcept
+                : _M_node(x._M_node), _M_index(x._M_index)
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                _Leaf *leaf = static_cast<_Leaf *>(_M_node);
+                if constexpr (std::is_void_v<_Mapped>)
+                    return leaf->_Keys[_M_index];
+                else
+                    return reference(leaf->_Keys[_M_index], leaf->_Values[_M_index]);
+            }
+
+            pointer operator->() const noexcept
+            {
+                if constexpr (std::is_void_v<_Mapped>)
+                    return std::addressof(operator*());
+                else
+                    return pointer{operator*()};
+            }
+
+            Btree_iterator &operator++() noexcept
+            {
+                if (++_M_index >= _M_node->_Count)
+                {
+                    _M_node = _M_node->_Next;
+                    _M_index = 0;
+                }
+                return *this;
+            }
+
+            Btree_iterator operator++(int) noexcept
+            {
+                Btree_iterator temp{*this};
+                ++*this;
+                return temp;
+            }
+
+            Btree_iterator &operator--() noexcept
+            {
+                if (_M_index == 0)
+                {
+                    _M_node = _M_node->_Prev;
+                    _M_index = _M_node->_Count - 1;
+                }
+                else
+                    --_M_index;
+                return *this;
+            }
+
+            Btree_iterator operator--(int) noexcept
+            {
+                Btree_iterator temp{*this};
+                --*this;
+                return temp;
+            }
+
+            friend bool operator==(const Btree_iterator &x, const Btree_iterator &y) noexcept
+            {
+                return x._M_node == y._M_node && x._M_index == y._M_index;
+            }
+
+            friend bool operator!=(const Btree_iterator &x, const Btree_iterator &y) noexcept
+            {
+                return !(x == y);
+            }
+
+            Btree_leaf_base *_M_node;
+            size_t _M_index;
+        };
+
+        /**
+         * @brief B+ tree shared by btree_map and btree_set. Values are only
+         *        stored in leaves; _Mapped is void for sets.
+         *
+         * @tparam _Key
+         * @tparam _Mapped
+         * @tparam _Compare
+         * @tparam _Alloc
+         * @tparam _NodeBytes Target size of a node in bytes
+         */
+        template <class _Key, class _Mapped, class _Compare, class _Alloc, size_t _NodeBytes>
+        class Btree
+        {
+        protected:
+            using _Layout = Btree_layout<_Key, _Mapped, _NodeBytes>;
+
+            static constexpr size_t _Leaf_capacity = _Layout::_Leaf_capacity;
+            static constexpr size_t _Inner_capacity = _Layout::_Inner_capacity;
+            static constexpr size_t _Leaf_min = _Leaf_capacity / 2;
+            static constexpr size_t _Inner_min = _Inner_capacity / 2;
+            static constexpr size_t _Max_depth = 64;
+
+            using _Leaf = Btree_leaf<_Key, _Mapped, _Leaf_capacity>;
+            using _Inner = Btree_inner<_Key, _Inner_capacity>;
+
+            using leaf_alloc_t = typename std::allocator_traits<_Alloc>::template rebind_alloc<_Leaf>;
+            using leaf_alloc_traits = std::allocator_traits<leaf_alloc_t>;
+            using inner_alloc_t = typename std::allocator_traits<_Alloc>::template rebind_alloc<_Inner>;
+            using inner_alloc_traits = std::allocator_traits<inner_alloc_t>;
+
+            struct Path_entry
+            {
+                _Inner *_Node;
+                size_t _Index;
+            };
+
+            struct Btree_impl
+                : public leaf_alloc_t
+            {
+            public:
+                _Compare _Comp;
+                Btree_node_base *_Root;
+                Btree_leaf_base _Header;
+                size_t _Size;
+
+                Btree_impl(const _Compare &comp, const leaf_alloc_t &alloc)
+                    : leaf_alloc_t(alloc), _Comp(comp), _Root(nullptr), _Size(0)
+                {
+                    _Reset();
+                }
+
+                void _Reset() noexcept
+                {
+                    _Root = nullptr;
+                    _Size = 0;
+                    _Header._Count = 0;
+                    _Header._Leaf = true;
+                    _Header._Prev = _Header._Next = &_Header;
+                }
+
+                /**
+                 * @brief Takes the nodes of @a x, fixing the links that point
+                 *        to its header.
+                 */
+                void _Move_nodes(Btree_impl &x) noexcept
+                {
+                    if (!x._Root)
+                    {
+                        _Reset();
+                        return;
+                    }
+                    _Root = x._Root;
+                    _Size = x._Size;
+                    _Header._Prev = x._Header._Prev;
+                    _Header._Next = x._Header._Next;
+                    _Header._Prev->_Next = _Header._Next->_Prev = &_Header;
+                    x._Reset();
+                }
+            };
+
+            Btree_impl Impl;
+
+            Btree(const _Compare &comp, const _Alloc &alloc)
+                : Impl(comp, leaf_alloc_t(alloc))
+            {
+            }
+
+            ~Btree()
+            {
+                _Clear();
+            }
+
+            bool _Less(const _Key &x, const _Key &y) const
+            {
+                return Impl._Comp(x, y);
+            }
+
+            size_t _Lower_index(const _Key *keys, size_t n, const _Key &key) const
+            {
+                return _Btree_lower_index(keys, n, key, Impl._Comp);
+            }
+
+            size_t _Upper_index(const _Key *keys, size_t n, const _Key &key) const
+            {
+                return _Btree_upper_index(keys, n, key, Impl._Comp);
+            }
+
+            const Btree_leaf_base *_End() const noexcept
+            {
+                return &Impl._Header;
+            }
+
+            _Leaf *_Create_leaf()
+            {
+                leaf_alloc_t &alloc = Impl;
+                _Leaf *leaf = leaf_alloc_traits::allocate(alloc, 1);
+                ::new (static_cast<void *>(leaf)) _Leaf;
+                leaf->_Count = 0;
+                leaf->_Leaf = true;
+                return leaf;
+            }
+
+            _Inner *_Create_inner()
+            {
+                inner_alloc_t alloc(static_cast<leaf_alloc_t &>(Impl));
+                _Inner *inner = inner_alloc_traits::allocate(alloc, 1);
+                ::new (static_cast<void *>(inner)) _Inner;
+                inner->_Count = 0;
+                inner->_Leaf = false;
+                return inner;
+            }
+
+            void _Put_leaf(_Leaf *leaf) noexcept
+            {
+                leaf->_Keys._Destroy_range(0, leaf->_Count);
+                leaf->_Values._Destroy_range(0, leaf->_Count);
+                leaf_alloc_traits::deallocate(Impl, leaf, 1);
+            }
+
+            void _Put_inner(_Inner *inner) noexcept
+            {
+                inner->_Keys._Destroy_range(0, inner->_Count);
+                inner_alloc_t alloc(static_cast<leaf_alloc_t &>(Impl));
+                inner_alloc_traits::deallocate(alloc, inner, 1);
+            }
+
+            void _Destroy_subtree(Btree_node_base *node) noexcept
+            {
+                if (node->_Leaf)
+                {
+                    _Put_leaf(static_cast<_Leaf *>(node));
+                    return;
+                }
+                _Inner *inner = static_cast<_Inner *>(node);
+                for (size_t i = 0; i <= inner->_Count; ++i)
+                    _Destroy_subtree(inner->_Children[i]);
+                _Put_inner(inner);
+            }
+
+            void _Clear() noexcept
+            {
+                if (Impl._Root)
+                    _Destroy_subtree(Impl._Root);
+                Impl._Reset();
+            }
+
+            /**
+             * @brief Walks down to the leaf that may hold @a key, recording
+             *        the inner nodes visited when @a path is given.
+             */
+            _Leaf *_Descend(const _Key &key, Path_entry *path, size_t &depth) const
+            {
+                Btree_node_base *node = Impl._Root;
+                depth = 0;
+                while (!node->_Leaf)
+                {
+                    _Inner *inner = static_cast<_Inner *>(node);
+                    const size_t i = _Upper_index(inner->_Keys._Ptr(), inner->_Count, key);
+                    if (path)
+                        path[depth] = Path_entry{inner, i};
+                    ++depth;
+                    node = inner->_Children[i];
+                }
+                return static_cast<_Leaf *>(node);
+            }
+
+            /**
+             * @brief Moves a one-past-the-leaf position onto the next leaf.
+             */
+            std::pair<const Btree_leaf_base *, size_t> _Normalize(const Btree_leaf_base *leaf, size_t i) const noexcept
+            {
+                if (i >= leaf->_Count)
+                    return {leaf->_Next, 0};
+                return {leaf, i};
+            }
+
+            std::pair<const Btree_leaf_base *, size_t> _Begin() const noexcept
+            {
+                return {Impl._Header._Next, 0};
+            }
+
+            std::pair<const Btree_leaf_base *, size_t> _Find(const _Key &key) const
+            {
+                if (!Impl._Root)
+                    return {_End(), 0};
+                size_t depth;
+                const _Leaf *leaf = _Descend(key, nullptr, depth);
+                const size_t i = _Lower_index(leaf->_Keys._Ptr(), leaf->_Count, key);
+                if (i < leaf->_Count && !_Less(key, leaf->_Keys[i]))
+                    return {leaf, i};
+                return {_End(), 0};
+            }
+
+            std::pair<const Btree_leaf_base *, size_t> _Lower_bound(const _Key &key) const
+            {
+                if (!Impl._Root)
+                    return {_End(), 0};
+                size_t depth;
+                const _Leaf *leaf = _Descend(key, nullptr, depth);
+                return _Normalize(leaf, _Lower_index(leaf->_Keys._Ptr(), leaf->_Count, key));
+            }
+
+            std::pair<const Btree_leaf_base *, size_t> _Upper_bound(const _Key &key) const
+            {
+                if (!Impl._Root)
+                    return {_End(), 0};
+                size_t depth;
+                const _Leaf *leaf = _Descend(key, nullptr, depth);
+                return _Normalize(leaf, _Upper_index(leaf->_Keys._Ptr(), leaf->_Count, key));
+            }
+
+            /**
+             * @brief Inserts @a key with a value built from @a args unless the
+             *        key is already present.
+             *
+             * @return The position of the key and whether it was inserted
+             */
+            template <class _Kx, class... _Args>
+            std::pair<std::pair<const Btree_leaf_base *, size_t>, bool> _Emplace_unique(_Kx &&key, _Args &&...args)
+            {
+                if (!Impl._Root)
+                {
+                    _Leaf *leaf = _Create_leaf();
+                    leaf->_Hook(&Impl._Header);
+                    Impl._Root = leaf;
+                }
+
+                Path_entry path[_Max_depth];
+                size_t depth;
+                _Leaf *leaf = _Descend(key, path, depth);
+                size_t i = _Lower_index(leaf->_Keys._Ptr(), leaf->_Count, key);
+                if (i < leaf->_Count && !_Less(key, leaf->_Keys[i]))
+                    return {{leaf, i}, false};
+
+                // everything a split needs -- the sibling, the inner nodes that
+                // split above it and a copy of the separator key -- is made
+                // before the leaf changes, so a throw leaves the tree untouched
+                _Leaf *right = nullptr;
+                _Inner *spare[_Max_depth + 1];
+                size_t spares = 0;
+                std::optional<_Key> sep;
+                if (leaf->_Count == _Leaf_capacity)
+                {
+                    right = _Create_leaf();
+                    try
+                    {
+                        // one inner node per full ancestor, plus a new root
+                        // when they are full all the way up
+                        size_t level = depth;
+                        while (level > 0 && path[level - 1]._Node->_Count == _Inner_capacity)
+                            --level;
+                        const size_t needed = depth - level + (level == 0);
+                        for (; spares < needed; ++spares)
+                            spare[spares] = _Create_inner();
+                        constexpr size_t keep = (_Leaf_capacity + 1) / 2;
+                        if (keep < i)
+                            sep.emplace(leaf->_Keys[keep]);
+                        else if (keep == i)
+                            sep.emplace(key);
+                        else
+                            sep.emplace(leaf->_Keys[keep - 1]);
+                    }
+                    catch (...)
+                    {
+                        _Put_spares(spare, spares);
+                        leaf_alloc_traits::deallocate(Impl, right, 1);
+                        throw;
+                    }
+                }
+                try
+                {
+                    leaf->_Keys._Emplace(leaf->_Count, i, std::forward<_Kx>(key));
+                    try
+                    {
+                        leaf->_Values._Emplace(leaf->_Count, i, std::forward<_Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        leaf->_Keys._Erase(leaf->_Count + 1, i);
+                        throw;
+                    }
+                }
+                catch (...)
+                {
+                    if (right)
+                    {
+                        _Put_spares(spare, spares);
+                        leaf_alloc_traits::deallocate(Impl, right, 1);
+                    }
+                    throw;
+                }
+                ++leaf->_Count;
+                ++Impl._Size;
+
+                if (!right)
+                    return {{leaf, i}, true};
+
+                const size_t total = leaf->_Count;
+                const size_t keep = total / 2;
+                leaf->_Keys._Relocate(keep, total - keep, right->_Keys, 0);
+                leaf->_Values._Relocate(keep, total - keep, right->_Values, 0);
+                right->_Count = static_cast<uint16_t>(total - keep);
+                leaf->_Count = static_cast<uint16_t>(keep);
+                right->_Hook(leaf->_Next);
+
+                _Insert_separator(path, depth, std::move(*sep), right, spare);
+
+                if (i >= keep)
+                    return {{right, i - keep}, true};
+                return {{leaf, i}, true};
+            }
+
+            void _Put_spares(_Inner **spare, size_t n) noexcept
+            {
+                for (size_t k = 0; k < n; ++k)
+                    _Put_inner(spare[k]);
+            }
+
+            /**
+             * @brief Inserts @a child right of the node at the end of @a path,
+             *        splitting inner nodes up to the root as needed. The new
+             *        inner nodes come from @a spare, in the order they are
+             *        needed, so nothing here allocates.
+             */
+            void _Insert_separator(Path_entry *path, size_t depth, _Key sep, Btree_node_base *child, _Inner **spare)
+            {
+                while (true)
+                {
+                    if (depth == 0)
+                    {
+                        _Inner *root = *spare++;
+                        root->_Keys._Construct(0, std::move(sep));
+                        root->_Children[0] = Impl._Root;
+                        root->_Children[1] = child;
+                        root->_Count = 1;
+                        Impl._Root = root;
+                        return;
+                    }
+
+                    const Path_entry &entry = path[--depth];
+                    _Inner *node = entry._Node;
+                    const size_t idx = entry._Index;
+                    node->_Keys._Emplace(node->_Count, idx, std::move(sep));
+                    std::move_backward(node->_Children + idx + 1, node->_Children + node->_Count + 1,
+                                       node->_Children + node->_Count + 2);
+                    node->_Children[idx + 1] = child;
+                    ++node->_Count;
+
+                    if (node->_Count <= _Inner_capacity)
+                        return;
+
+                    // keys: left [0, mid), up [mid], right (mid, total)
+                    _Inner *right = *spare++;
+                    const size_t total = node->_Count;
+                    const size_t mid = total / 2;
+                    sep = std::move(node->_Keys[mid]);
+                    node->_Keys._Relocate(mid + 1, total - mid - 1, right->_Keys, 0);
+                    node->_Keys._Destroy(mid);
+                    std::copy(node->_Children + mid + 1, node->_Children + total + 1, right->_Children);
+                    right->_Count = static_cast<uint16_t>(total - mid - 1);
+                    node->_Count = static_cast<uint16_t>(mid);
+                    child = right;
+                }
+            }
+
+            /**
+             * @brief Removes the element @a i of @a leaf and rebalances.
+             *
+             * @return The position of the element that followed it
+             */
+            std::pair<const Btree_leaf_base *, size_t> _Erase_at(_Leaf *leaf, size_t i, Path_entry *path, size_t depth)
+            {
+                _Key erased = std::move(leaf->_Keys[i]);
+                leaf->_Keys._Erase(leaf->_Count, i);
+                leaf->_Values._Erase(leaf->_Count, i);
+                --leaf->_Count;
+                --Impl._Size;
+
+                if (depth == 0)
+                {
+                    if (leaf->_Count == 0)
+                    {
+                        leaf->_Unhook();
+                        _Put_leaf(leaf);
+                        Impl._Root = nullptr;
+                        return {_End(), 0};
+                    }
+                    return _Normalize(leaf, i);
+                }
+                if (leaf->_Count >= _Leaf_min)
+                    return _Normalize(leaf, i);
+
+                _Rebalance_leaf(leaf, path, depth);
+                return _Lower_bound(erased);
+            }
+
+            size_t _Erase_unique(const _Key &key)
+            {
+                if (!Impl._Root)
+                    return 0;
+                Path_entry path[_Max_depth];
+                size_t depth;
+                _Leaf *leaf = _Descend(key, path, depth);
+                const size_t i = _Lower_index(leaf->_Keys._Ptr(), leaf->_Count, key);
+                if (i == leaf->_Count || _Less(key, leaf->_Keys[i]))
+                    return 0;
+                _Erase_at(leaf, i, path, depth);
+                return 1;
+            }
+
+            std::pair<const Btree_leaf_base *, size_t> _Erase_position(const Btree_leaf_base *node, size_t i)
+            {
+                Path_entry path[_Max_depth];
+                size_t depth;
+                _Leaf *leaf = _Descend(static_cast<const _Leaf *>(node)->_Keys[i], path, depth);
+                return _Erase_at(leaf, i, path, depth);
+            }
+
+            void _Rebalance_leaf(_Leaf *leaf, Path_entry *path, size_t depth)
+            {
+                _Inner *parent = path[depth - 1]._Node;
+                const size_t idx = path[depth - 1]._Index;
+
+                if (idx > 0)
+                {
+                    _Leaf *left = static_cast<_Leaf *>(parent->_Children[idx - 1]);
+                    if (left->_Count > _Leaf_min)
+                    {
+                        left->_Keys._Give_back(left->_Count, leaf->_Keys, leaf->_Count);
+                        left->_Values._Give_back(left->_Count, leaf->_Values, leaf->_Count);
+                        --left->_Count;
+                        ++leaf->_Count;
+                        parent->_Keys[idx - 1] = leaf->_Keys[0];
+                        return;
+                    }
+                }
+                if (idx < parent->_Count)
+                {
+                    _Leaf *right = static_cast<_Leaf *>(parent->_Children[idx + 1]);
+                    if (right->_Count > _Leaf_min)
+                    {
+                        right->_Keys._Give_front(right->_Count, leaf->_Keys, leaf->_Count);
+                        right->_Values._Give_front(right->_Count, leaf->_Values, leaf->_Count);
+                        --right->_Count;
+                        ++leaf->_Count;
+                        parent->_Keys[idx] = right->_Keys[0];
+                        return;
+                    }
+                }
+
+                if (idx > 0)
+                    _Merge_leaves(static_cast<_Leaf *>(parent->_Children[idx - 1]), leaf, parent, idx - 1);
+                else
+                    _Merge_leaves(leaf, static_cast<_Leaf *>(parent->_Children[idx + 1]), parent, idx);
+                _Rebalance_inner(path, depth - 1);
+            }
+
+            void _Remove_separator(_Inner *parent, size_t sep) noexcept
+            {
+                parent->_Keys._Erase(parent->_Count, sep);
+                std::copy(parent->_Children + sep + 2, parent->_Children + parent->_Count + 1,
+                          parent->_Children + sep + 1);
+                --parent->_Count;
+            }
+
+            void _Merge_leaves(_Leaf *left, _Leaf *right, _Inner *parent, size_t sep)
+            {
+                right->_Keys._Relocate(0, right->_Count, left->_Keys, left->_Count);
+                right->_Values._Relocate(0, right->_Count, left->_Values, left->_Count);
+                left->_Count += right->_Count;
+                right->_Count = 0;
+                right->_Unhook();
+                _Put_leaf(right);
+                _Remove_separator(parent, sep);
+            }
+
+            void _Merge_inner(_Inner *left, _Inner *right, _Inner *parent, size_t sep)
+            {
+                const size_t lcount = left->_Count;
+                left->_Keys._Construct(lcount, std::move(parent->_Keys[sep]));
+                right->_Keys._Relocate(0, right->_Count, left->_Keys, lcount + 1);
+                std::copy(right->_Children, right->_Children + right->_Count + 1, left->_Children + lcount + 1);
+                left->_Count += right->_Count + 1;
+                right->_Count = 0;
+                _Put_inner(right);
+                _Remove_separator(parent, sep);
+            }
+
+            /**
+             * @brief Restores the minimum fill of the inner node at
+             *        path[depth] and of its ancestors.
+             */
+            void _Rebalance_inner(Path_entry *path, size_t depth)
+            {
+                while (true)
+                {
+                    _Inner *node = path[depth]._Node;
+                    if (depth == 0)
+                    {
+                        if (node->_Count == 0)
+                        {
+                            Impl._Root = node->_Children[0];
+                            _Put_inner(node);
+                        }
+                        return;
+                    }
+                    if (node->_Count >= _Inner_min)
+                        return;
+
+                    _Inner *parent = path[depth - 1]._Node;
+                    const size_t idx = path[depth - 1]._Index;
+
+                    if (idx > 0)
+                    {
+                        _Inner *left = static_cast<_Inner *>(parent->_Children[idx - 1]);
+                        if (left->_Count > _Inner_min)
+                        {
+                            node->_Keys._Emplace(node->_Count, 0, std::move(parent->_Keys[idx - 1]));
+                            std::move_backward(node->_Children, node->_Children + node->_Count + 1,
+                                               node->_Children + node->_Count + 2);
+                            node->_Children[0] = left->_Children[left->_Count];
+                            parent->_Keys[idx - 1] = std::move(left->_Keys[left->_Count - 1]);
+                            left->_Keys._Destroy(left->_Count - 1);
+                            --left->_Count;
+                            ++node->_Count;
+                            return;
+                        }
+                    }
+                    if (idx < parent->_Count)
+                    {
+                        _Inner *right = static_cast<_Inner *>(parent->_Children[idx + 1]);
+                        if (right->_Count > _Inner_min)
+                        {
+                            node->_Keys._Construct(node->_Count, std::move(parent->_Keys[idx]));
+                            node->_Children[node->_Count + 1] = right->_Children[0];
+                            parent->_Keys[idx] = std::move(right->_Keys[0]);
+                            right->_Keys._Erase(right->_Count, 0);
+                            std::copy(right->_Children + 1, right->_Children + right->_Count + 1, right->_Children);
+                            --right->_Count;
+                            ++node->_Count;
+                            return;
+                        }
+                    }
+
+                    if (idx > 0)
+                        _Merge_inner(static_cast<_Inner *>(parent->_Children[idx - 1]), node, parent, idx - 1);
+                    else
+                        _Merge_inner(node, static_cast<_Inner *>(parent->_Children[idx + 1]), parent, idx);
+                    --depth;
+                }
+            }
+
+            /**
+             * @brief Calls @a fn on every element with a key in [lo, hi),
+             *        walking the leaf chain.
+             */
+            template <class _Fn>
+            size_t _Scan(const _Key &lo, const _Key &hi, _Fn &fn) const
+            {
+                auto [node, i] = _Lower_bound(lo);
+                size_t visited = 0;
+                while (node != _End())
+                {
+                    const _Leaf *leaf = static_cast<const _Leaf *>(node);
+                    const size_t stop = _Lower_index(leaf->_Keys._Ptr(), leaf->_Count, hi);
+                    for (; i < stop; ++i)
+                    {
+                        if constexpr (std::is_void_v<_Mapped>)
+                            fn(leaf->_Keys[i]);
+                        else
+                            fn(leaf->_Keys[i], const_cast<_Leaf *>(leaf)->_Values[i]);
+                        ++visited;
+                    }
+                    if (stop < leaf->_Count)
+                        break;
+                    node = leaf->_Next;
+                    i = 0;
+                }
+                return visited;
+            }
+
+            void _Swap(Btree &x) noexcept
+            {
+                Btree_impl temp(Impl._Comp, Impl);
+                temp._Move_nodes(Impl);
+                Impl._Move_nodes(x.Impl);
+                x.Impl._Move_nodes(temp);
+                std::swap(Impl._Comp, x.Impl._Comp);
+                std::swap(static_cast<leaf_alloc_t &>(Impl), static_cast<leaf_alloc_t &>(x.Impl));
+            }
+        };
+    }
+
+    /**
+     * @brief Ordered map stored in a B+ tree. Nodes are sized to
+     *        _NodeBytes, keys of a node are contiguous and leaves are linked
+     *        for range scans.
+     *
+     * @tparam _Key
+     * @tparam _Ty
+     * @tparam _Compare
+     * @tparam _Alloc
+     * @tparam _NodeBytes
+     */
+    template <class _Key, class _Ty, class _Compare = std::less<_Key>,
+              class _Alloc = std::allocator<std::pair<const _Key, _Ty>>,
+              size_t _NodeBytes = btree_default_node_bytes>
+    class btree_map : protected __base::Btree<_Key, _Ty, _Compare, _Alloc, _NodeBytes>
+    {
+        using _Base = __base::Btree<_Key, _Ty, _Compare, _Alloc, _NodeBytes>;
+        using _Leaf = typename _Base::_Leaf;
+
+    public:
+        using key_type = _Key;
+        using mapped_type = _Ty;
+        using value_type = std::pair<const _Key, _Ty>;
+        using key_compare = _Compare;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        using iterator = __base::Btree_iterator<_Leaf, false>;
+        using const_iterator = __base::Btree_iterator<_Leaf, true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    protected:
+        using _Base::Impl;
+
+        template <class _Iter, class _Pos>
+        static _Iter _Make_iter(const _Pos &pos) noexcept
+        {
+            return _Iter(pos.first, pos.second);
+        }
+
+    public:
+        /**
+         * @brief Construct a new btree map object with no elements
+         *
+         */
+        btree_map()
+            : _Base(_Compare(), _Alloc())
+        {
+        }
+
+        /**
+         * @brief Construct a new btree map object with no elements
+         *
+         * @param comp Key ordering
+         * @param alloc An allocator object
+         */
+        explicit btree_map(const _Compare &comp, const allocator_type &alloc = allocator_type())
+            : _Base(comp, alloc)
+        {
+        }
+
+        /**
+         * @brief Construct a new btree map object with copies of range [first, last)
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        btree_map(Input first, Input last, const _Compare &comp = _Compare(),
+                  const allocator_type &alloc = allocator_type())
+            : _Base(comp, alloc)
+        {
+            insert(first, last);
+        }
+
+        btree_map(std::initializer_list<value_type> l, const _Compare &comp = _Compare(),
+                  const allocator_type &alloc = allocator_type())
+            : _Base(comp, alloc)
+        {
+            insert(l.begin(), l.end());
+        }
+
+        btree_map(const btree_map &x)
+            : _Base(x.Impl._Comp, allocator_type(static_cast<const typename _Base::leaf_alloc_t &>(x.Impl)))
+        {
+            insert(x.begin(), x.end());
+        }
+
+        btree_map(btree_map &&x) noexcept
+            : _Base(x.Impl._Comp, allocator_type(static_cast<const typename _Base::leaf_alloc_t &>(x.Impl)))
+        {
+            Impl._Move_nodes(x.Impl);
+        }
+
+        btree_map &operator=(const btree_map &x)
+        {
+            if (this != std::addressof(x))
+            {
+                btree_map temp(x);
+                swap(temp);
+            }
+            return *this;
+        }
+
+        btree_map &operator=(btree_map &&x) noexcept
+        {
+            if (this != std::addressof(x))
+            {
+                this->_Clear();
+                Impl._Move_nodes(x.Impl);
+            }
+            return *this;
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return allocator_type(static_cast<const typename _Base::leaf_alloc_t &>(Impl));
+        }
+
+        key_compare key_comp() const
+        {
+            return Impl._Comp;
+        }
+
+        /**
+         * @brief Number of keys held by a leaf node.
+         *
+         * @return constexpr size_type
+         */
+        static constexpr size_type node_capacity() noexcept
+        {
+            return _Base::_Leaf_capacity;
+        }
+
+        iterator begin() noexcept
+        {
+            return _Make_iter<iterator>(this->_Begin());
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return _Make_iter<const_iterator>(this->_Begin());
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(this->_End(), 0);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(this->_End(), 0);
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        bool empty() const noexcept
+        {
+            return Impl._Size == 0;
+        }
+
+        size_type size() const noexcept
+        {
+            return Impl._Size;
+        }
+
+        void clear() noexcept
+        {
+            this->_Clear();
+        }
+
+        /**
+         * @brief Inserts a copy of @a value unless its key is present.
+         *
+         * @param value
+         * @return std::pair<iterator, bool>
+         */
+        std::pair<iterator, bool> insert(const value_type &value)
+        {
+            return try_emplace(value.first, value.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type &&value)
+        {
+            return try_emplace(std::move(const_cast<_Key &>(value.first)), std::move(value.second));
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert(Input first, Input last)
+        {
+            for (; first != last; ++first)
+                try_emplace((*first).first, (*first).second);
+        }
+
+        void insert(std::initializer_list<value_type> l)
+        {
+            insert(l.begin(), l.end());
+        }
+
+        /**
+         * @brief Inserts a value built from @a args under @a key unless the
+         *        key is present, in which case nothing is constructed.
+         *
+         * @return std::pair<iterator, bool>
+         */
+        template <class... _Args>
+        std::pair<iterator, bool> try_emplace(const key_type &key, _Args &&...args)
+        {
+            auto res = this->_Emplace_unique(key, std::forward<_Args>(args)...);
+            return {_Make_iter<iterator>(res.first), res.second};
+        }
+
+        template <class... _Args>
+        std::pair<iterator, bool> try_emplace(key_type &&key, _Args &&...args)
+        {
+            auto res = this->_Emplace_unique(std::move(key), std::forward<_Args>(args)...);
+            return {_Make_iter<iterator>(res.first), res.second};
+        }
+
+        template <class... _Args>
+        std::pair<iterator, bool> emplace(const key_type &key, _Args &&...args)
+        {
+            return try_emplace(key, std::forward<_Args>(args)...);
+        }
+
+        /**
+         * @brief Inserts @a value under @a key or assigns it to the present
+         *        element.
+         */
+        template <class _Vx>
+        std::pair<iterator, bool> insert_or_assign(const key_type &key, _Vx &&value)
+        {
+            auto res = try_emplace(key, std::forward<_Vx>(value));
+            if (!res.second)
+                res.first->second = std::forward<_Vx>(value);
+            return res;
+        }
+
+        mapped_type &operator[](const key_type &key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        mapped_type &operator[](key_type &&key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        mapped_type &at(const key_type &key)
+        {
+            iterator it = find(key);
+            if (it == end())
+                throw std::out_of_range("collections::btree_map::at");
+            return it->second;
+        }
+
+        const mapped_type &at(const key_type &key) const
+        {
+            const_iterator it = find(key);
+            if (it == end())
+                throw std::out_of_range("collections::btree_map::at");
+            return it->second;
+        }
+
+        iterator find(const key_type &key)
+        {
+            return _Make_iter<iterator>(this->_Find(key));
+        }
+
+        const_iterator find(const key_type &key) const
+        {
+            return _Make_iter<const_iterator>(this->_Find(key));
+        }
+
+        bool contains(const key_type &key) const
+        {
+            return this->_Find(key).first != this->_End();
+        }
+
+        size_type count(const key_type &key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        iterator lower_bound(const key_type &key)
+        {
+            return _Make_iter<iterator>(this->_Lower_bound(key));
+        }
+
+        const_iterator lower_bound(const key_type &key) const
+        {
+            return _Make_iter<const_iterator>(this->_Lower_bound(key));
+        }
+
+        iterator upper_bound(const key_type &key)
+        {
+            return _Make_iter<iterator>(this->_Upper_bound(key));
+        }
+
+        const_iterator upper_bound(const key_type &key) const
+        {
+            return _Make_iter<const_iterator>(this->_Upper_bound(key));
+        }
+
+        std::pair<iterator, iterator> equal_range(const key_type &key)
+        {
+            return {lower_bound(key), upper_bound(key)};
+        }
+
+        std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const
+        {
+            return {lower_bound(key), upper_bound(key)};
+        }
+
+        /**
+         * @brief Removes the element with key @a key.
+         *
+         * @param key
+         * @return size_type The number of elements removed
+         */
+        size_type erase(const key_type &key)
+        {
+            return this->_Erase_unique(key);
+        }
+
+        /**
+         * @brief Removes the element at @a position.
+         *
+         * @param position
+         * @return iterator The element that followed it
+         */
+        iterator erase(const_iterator position)
+        {
+            return _Make_iter<iterator>(this->_Erase_position(position._M_node, position._M_index));
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            if (first == cbegin() && last == cend())
+            {
+                clear();
+                return end();
+            }
+            if (last == cend())
+            {
+                while (first != cend())
+                    first = erase(first);
+                return end();
+            }
+            const key_type stop = last->first;
+            while (first != cend() && Impl._Comp(first->first, stop))
+                first = erase(first);
+            return iterator(first._M_node, first._M_index);
+        }
+
+        /**
+         * @brief Calls @a fn(key, value) for every element with a key in
+         *        [lo, hi), in key order.
+         *
+         * @return size_type The number of elements visited
+         */
+        template <class _Fn>
+        size_type scan(const key_type &lo, const key_type &hi, _Fn fn)
+        {
+            return this->_Scan(lo, hi, fn);
+        }
+
+        void swap(btree_map &x) noexcept
+        {
+            this->_Swap(x);
+        }
+    };
+
+    /**
+     * @brief Ordered set stored in a B+ tree.
+     *
+     * @tparam _Key
+     * @tparam _Compare
+     * @tparam _Alloc
+     * @tparam _NodeBytes
+     */
+    template <class _Key, class _Compare = std::less<_Key>, class _Alloc = std::allocator<_Key>,
+              size_t _NodeBytes = btree_default_node_bytes>
+    class btree_set : protected __base::Btree<_Key, void, _Compare, _Alloc, _NodeBytes>
+    {
+        using _Base = __base::Btree<_Key, void, _Compare, _Alloc, _NodeBytes>;
+        using _Leaf = typename _Base::_Leaf;
+
+    public:
+        using key_type = _Key;
+        using value_type = _Key;
+        using key_compare = _Compare;
+        using value_compare = _Compare;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        using iterator = __base::Btree_iterator<_Leaf, true>;
+        using const_iterator = iterator;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = reverse_iterator;
+
+    protected:
+        using _Base::Impl;
+
+        template <class _Pos>
+        static iterator _Make_iter(const _Pos &pos) noexcept
+        {
+            return iterator(pos.first, pos.second);
+        }
+
+    public:
+        /**
+         * @brief Construct a new btree set object with no elements
+         *
+         */
+        btree_set()
+            : _Base(_Compare(), _Alloc())
+        {
+        }
+
+        explicit btree_set(const _Compare &comp, const allocator_type &alloc = allocator_type())
+            : _Base(comp, alloc)
+        {
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        btree_set(Input first, Input last, const _Compare &comp = _Compare(),
+                  const allocator_type &alloc = allocator_type())
+            : _Base(comp, alloc)
+        {
+            insert(first, last);
+        }
+
+        btree_set(std::initializer_list<value_type> l, const _Compare &comp = _Compare(),
+                  const allocator_type &alloc = allocator_type())
+            : _Base(comp, alloc)
+        {
+            insert(l.begin(), l.end());
+        }
+
+        btree_set(const btree_set &x)
+            : _Base(x.Impl._Comp, allocator_type(static_cast<const typename _Base::leaf_alloc_t &>(x.Impl)))
+        {
+            insert(x.begin(), x.end());
+        }
+
+        btree_set(btree_set &&x) noexcept
+            : _Base(x.Impl._Comp, allocator_type(static_cast<const typename _Base::leaf_alloc_t &>(x.Impl)))
+        {
+            Impl._Move_nodes(x.Impl);
+        }
+
+        btree_set &operator=(const btree_set &x)
+        {
+            if (this != std::addressof(x))
+            {
+                btree_set temp(x);
+                swap(temp);
+            }
+            return *this;
+        }
+
+        btree_set &operator=(btree_set &&x) noexcept
+        {
+            if (this != std::addressof(x))
+            {
+                this->_Clear();
+                Impl._Move_nodes(x.Impl);
+            }
+            return *this;
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return allocator_type(static_cast<const typename _Base::leaf_alloc_t &>(Impl));
+        }
+
+        key_compare key_comp() const
+        {
+            return Impl._Comp;
+        }
+
+        static constexpr size_type node_capacity() noexcept
+        {
+            return _Base::_Leaf_capacity;
+        }
+
+        iterator begin() const noexcept
+        {
+            return _Make_iter(this->_Begin());
+        }
+
+        iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        iterator end() const noexcept
+        {
+            return iterator(this->_End(), 0);
+        }
+
+        iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() const noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() const noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        bool empty() const noexcept
+        {
+            return Impl._Size == 0;
+        }
+
+        size_type size() const noexcept
+        {
+            return Impl._Size;
+        }
+
+        void clear() noexcept
+        {
+            this->_Clear();
+        }
+
+        std::pair<iterator, bool> insert(const value_type &value)
+        {
+            auto res = this->_Emplace_unique(value);
+            return {_Make_iter(res.first), res.second};
+        }
+
+        std::pair<iterator, bool> insert(value_type &&value)
+        {
+            auto res = this->_Emplace_unique(std::move(value));
+            return {_Make_iter(res.first), res.second};
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert(Input first, Input last)
+        {
+            for (; first != last; ++first)
+                this->_Emplace_unique(*first);
+        }
+
+        void insert(std::initializer_list<value_type> l)
+        {
+            insert(l.begin(), l.end());
+        }
+
+        template <class... _Args>
+        std::pair<iterator, bool> emplace(_Args &&...args)
+        {
+            return insert(value_type(std::forward<_Args>(args)...));
+        }
+
+        iterator find(const key_type &key) const
+        {
+            return _Make_iter(this->_Find(key));
+        }
+
+        bool contains(const key_type &key) const
+        {
+            return this->_Find(key).first != this->_End();
+        }
+
+        size_type count(const key_type &key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        iterator lower_bound(const key_type &key) const
+        {
+            return _Make_iter(this->_Lower_bound(key));
+        }
+
+        iterator upper_bound(const key_type &key) const
+        {
+            return _Make_iter(this->_Upper_bound(key));
+        }
+
+        std::pair<iterator, iterator> equal_range(const key_type &key) const
+        {
+            return {lower_bound(key), upper_bound(key)};
+        }
+
+        size_type erase(const key_type &key)
+        {
+            return this->_Erase_unique(key);
+        }
+
+        iterator erase(const_iterator position)
+        {
+            return _Make_iter(this->_Erase_position(position._M_node, position._M_index));
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            if (first == cbegin() && last == cend())
+            {
+                clear();
+                return end();
+            }
+            if (last == cend())
+            {
+                while (first != cend())
+                    first = erase(first);
+                return end();
+            }
+            const key_type stop = *last;
+            while (first != cend() && Impl._Comp(*first, stop))
+                first = erase(first);
+            return first;
+        }
+
+        /**
+         * @brief Calls @a fn(key) for every key in [lo, hi), in order.
+         *
+         * @return size_type The number of keys visited
+         */
+        template <class _Fn>
+        size_type scan(const key_type &lo, const key_type &hi, _Fn fn) const
+        {
+            return this->_Scan(lo, hi, fn);
+        }
+
+        void swap(btree_set &x) noexcept
+        {
+            this->_Swap(x);
+        }
+    };
+
+    template <class _Key, class _Ty, class _Compare, class _Alloc, size_t _NodeBytes>
+    inline bool operator==(const btree_map<_Key, _Ty, _Compare, _Alloc, _NodeBytes> &x,
+                           const btree_map<_Key, _Ty, _Compare, _Alloc, _NodeBytes> &y)
+    {
+        return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin());
+    }
+
+    template <class _Key, class _Ty, class _Compare, class _Alloc, size_t _NodeBytes>
+    inline bool operator!=(const btree_map<_Key, _Ty, _Compare, _Alloc, _NodeBytes> &x,
+                           const btree_map<_Key, _Ty, _Compare, _Alloc, _NodeBytes> &y)
+    {
+        return !(x == y);
+    }
+
+    template <class _Key, class _Compare, class _Alloc, size_t _NodeBytes>
+    inline bool operator==(const btree_set<_Key, _Compare, _Alloc, _NodeBytes> &x,
+                           const btree_set<_Key, _Compare, _Alloc, _NodeBytes> &y)
+    {
+        return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin());
+    }
+
+    template <class _Key, class _Compare, class _Alloc, size_t _NodeBytes>
+    inline bool operator!=(const btree_set<_Key, _Compare, _Alloc, _NodeBytes> &x,
+                           const btree_set<_Key, _Compare, _Alloc, _NodeBytes> &y)
+    {
+        return !(x == y);
+    }
+}
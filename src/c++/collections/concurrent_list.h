@@ -0,0 +1,469 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <iterator>
+#include <optional>
+#include <functional>
+#include <cstdint>
+#include <ext/aligned_buffer.h>
+#include "reclamation.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        /**
+         * @brief Link of a concurrent_list. The low bit of _Next marks the
+         *        node as logically erased; once set, _Next never changes.
+         */
+        class Concurrent_node_base
+        {
+        public:
+            static constexpr uintptr_t _Mark = 1;
+
+            static Concurrent_node_base *_Ptr(uintptr_t link) noexcept
+            {
+                return reinterpret_cast<Concurrent_node_base *>(link & ~_Mark);
+            }
+
+            static bool _Marked(uintptr_t link) noexcept
+            {
+                return link & _Mark;
+            }
+
+            static uintptr_t _Link(const Concurrent_node_base *node) noexcept
+            {
+                return reinterpret_cast<uintptr_t>(node);
+            }
+
+            std::atomic<uintptr_t> _Next{0};
+        };
+
+        template <class _Ty>
+        class Concurrent_node
+            : public Concurrent_node_base
+        {
+        public:
+            _Ty *_Valptr()
+            {
+                return _Data._M_ptr();
+            }
+
+            const _Ty *_Valptr() const
+            {
+                return _Data._M_ptr();
+            }
+
+        private:
+            __gnu_cxx::__aligned_membuf<_Ty> _Data;
+        };
+
+        template <class _Ty>
+        class Concurrent_list_iterator
+        {
+            using _Node = Concurrent_node<_Ty>;
+
+        public:
+            using Self = Concurrent_list_iterator<_Ty>;
+
+            using iterator_category = std::forward_iterator_tag;
+            using difference_type = ptrdiff_t;
+            using value_type = _Ty;
+            using pointer = const _Ty *;
+            using reference = const _Ty &;
+
+            Concurrent_list_iterator() noexcept
+                : _M_node(nullptr)
+            {
+            }
+
+            explicit Concurrent_list_iterator(Concurrent_node_base *node) noexcept
+                : _M_node(_Skip(node))
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                return *static_cast<_Node *>(_M_node)->_Valptr();
+            }
+
+            pointer operator->() const noexcept
+            {
+                return static_cast<_Node *>(_M_node)->_Valptr();
+            }
+
+            Self &operator++() noexcept
+            {
+                _M_node = _Skip(Concurrent_node_base::_Ptr(_M_node->_Next.load(std::memory_order_acquire)));
+                return *this;
+            }
+
+            Self operator++(int) noexcept
+            {
+                Self temp = *this;
+                ++*this;
+                return temp;
+            }
+
+            friend bool operator==(const Self &x, const Self &y) noexcept
+            {
+                return x._M_node == y._M_node;
+            }
+
+            friend bool operator!=(const Self &x, const Self &y) noexcept
+            {
+                return x._M_node != y._M_node;
+            }
+
+        private:
+            // erased nodes stay reachable until unlinked; step over them
+            static Concurrent_node_base *_Skip(Concurrent_node_base *node) noexcept
+            {
+                while (node)
+                {
+                    const uintptr_t next = node->_Next.load(std::memory_order_acquire);
+                    if (!Concurrent_node_base::_Marked(next))
+                        break;
+                    node = Concurrent_node_base::_Ptr(next);
+                }
+                return node;
+            }
+
+            Concurrent_node_base *_M_node;
+        };
+    }
+
+    /**
+     * @brief Lock-free sorted linked list of unique elements (Harris and
+     *        Michael). Insert, erase and lookup may run from any number of
+     *        threads. Erase first marks the node's link, then unlinks it;
+     *        traversals help unlink marked nodes they meet. Unlinked nodes are
+     *        retired into an epoch_domain and released through the node
+     *        allocator, so a thread still reading one is never left with
+     *        freed memory.
+     *
+     *        Elements are reached under an epoch guard: visit() and find()
+     *        take it themselves, and view() returns a range that holds it for
+     *        as long as it lives, so iteration is safe against concurrent
+     *        erase. Elements are immutable once inserted.
+     *
+     * @tparam _Ty
+     * @tparam _Compare Strict weak order; equivalent elements are duplicates
+     * @tparam _Alloc
+     */
+    template <class _Ty, class _Compare = std::less<_Ty>, class _Alloc = std::allocator<_Ty>>
+    class concurrent_list
+    {
+        using _Node_base = __base::Concurrent_node_base;
+        using _Node = __base::Concurrent_node<_Ty>;
+        using node_alloc_t = typename std::allocator_traits<_Alloc>::template rebind_alloc<_Node>;
+        using node_alloc_traits = std::allocator_traits<node_alloc_t>;
+
+    public:
+        using value_type = _Ty;
+        using size_type = size_t;
+        using key_compare = _Compare;
+        using allocator_type = _Alloc;
+        using const_reference = const _Ty &;
+        using const_iterator = __base::Concurrent_list_iterator<_Ty>;
+
+        /**
+         * @brief Elements of the list, pinned by an epoch guard for the
+         *        lifetime of the view. Elements inserted or erased meanwhile
+         *        may or may not be seen.
+         */
+        class view_type
+        {
+        public:
+            explicit view_type(const concurrent_list &l)
+                : _Guard(l._Domain), _List(l)
+            {
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return const_iterator(_Node_base::_Ptr(_List._Head._Next.load(std::memory_order_acquire)));
+            }
+
+            const_iterator end() const noexcept
+            {
+                return const_iterator();
+            }
+
+        private:
+            epoch_guard _Guard;
+            const concurrent_list &_List;
+        };
+
+        explicit concurrent_list(const _Compare &comp = _Compare(), const _Alloc &alloc = _Alloc())
+            : _Comp(comp), _Alloc_node(alloc), _Domain(default_epoch_domain())
+        {
+        }
+
+        /**
+         * @brief Construct an empty list retiring into @a domain, e.g. to keep
+         *        its reclamation apart from other structures
+         */
+        explicit concurrent_list(epoch_domain &domain, const _Compare &comp = _Compare(),
+                                 const _Alloc &alloc = _Alloc())
+            : _Comp(comp), _Alloc_node(alloc), _Domain(domain)
+        {
+        }
+
+        concurrent_list(const concurrent_list &) = delete;
+        concurrent_list &operator=(const concurrent_list &) = delete;
+
+        /**
+         * @brief Frees the linked nodes; no other thread may use the list.
+         *        Nodes already retired are freed by the domain.
+         */
+        ~concurrent_list()
+        {
+            _Node_base *node = _Node_base::_Ptr(_Head._Next.load(std::memory_order_acquire));
+            while (node)
+            {
+                _Node_base *next = _Node_base::_Ptr(node->_Next.load(std::memory_order_relaxed));
+                _Destroy_node(static_cast<_Node *>(node));
+                node = next;
+            }
+        }
+
+        /**
+         * @brief Inserts @a value unless an equivalent element is present
+         *
+         * @return true When inserted
+         */
+        bool insert(const value_type &value)
+        {
+            return emplace(value);
+        }
+
+        bool insert(value_type &&value)
+        {
+            return emplace(std::move(value));
+        }
+
+        template <class... _Args>
+        bool emplace(_Args &&...args)
+        {
+            _Node *node = _Create_node(std::forward<_Args>(args)...);
+            const _Ty &key = *node->_Valptr();
+            epoch_guard guard(_Domain);
+            for (;;)
+            {
+                auto [prev, curr] = _Search(key);
+                if (curr && !_Comp(key, *static_cast<_Node *>(curr)->_Valptr()))
+                {
+                    _Destroy_node(node);
+                    return false;
+                }
+                node->_Next.store(_Node_base::_Link(curr), std::memory_order_relaxed);
+                uintptr_t expected = _Node_base::_Link(curr);
+                if (prev->_Next.compare_exchange_strong(expected, _Node_base::_Link(node),
+                                                        std::memory_order_release, std::memory_order_relaxed))
+                {
+                    _Size.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief Erases the element equivalent to @a key
+         *
+         * @return true When this call erased it
+         */
+        bool erase(const _Ty &key)
+        {
+            epoch_guard guard(_Domain);
+            for (;;)
+            {
+                auto [prev, curr] = _Search(key);
+                if (!curr || _Comp(key, *static_cast<_Node *>(curr)->_Valptr()))
+                    return false;
+
+                uintptr_t next = curr->_Next.load(std::memory_order_acquire);
+                if (_Node_base::_Marked(next))
+                    continue;
+                if (!curr->_Next.compare_exchange_strong(next, next | _Node_base::_Mark, std::memory_order_acq_rel,
+                                                         std::memory_order_relaxed))
+                    continue;
+                _Size.fetch_sub(1, std::memory_order_relaxed);
+
+                uintptr_t expected = _Node_base::_Link(curr);
+                if (prev->_Next.compare_exchange_strong(expected, next, std::memory_order_release,
+                                                        std::memory_order_relaxed))
+                    _Retire(curr);
+                else
+                    _Search(key); // a traversal unlinks and retires it
+                return true;
+            }
+        }
+
+        /**
+         * @brief Whether an element equivalent to @a key is present. Never
+         *        writes, so lookups do not contend with each other.
+         */
+        bool contains(const _Ty &key) const
+        {
+            epoch_guard guard(_Domain);
+            return _Find(key) != nullptr;
+        }
+
+        /**
+         * @brief Calls fn(element) on the element equivalent to @a key while
+         *        it is pinned
+         *
+         * @return true When found
+         */
+        template <class _Fn>
+        bool visit(const _Ty &key, _Fn fn) const
+        {
+            epoch_guard guard(_Domain);
+            if (const _Node *node = _Find(key))
+            {
+                fn(*node->_Valptr());
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Copy of the element equivalent to @a key
+         */
+        std::optional<value_type> find(const _Ty &key) const
+        {
+            epoch_guard guard(_Domain);
+            if (const _Node *node = _Find(key))
+                return *node->_Valptr();
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Pins the list and returns its elements in order
+         */
+        view_type view() const
+        {
+            return view_type(*this);
+        }
+
+        /**
+         * @brief Calls fn(element) on each element in order
+         */
+        template <class _Fn>
+        void for_each(_Fn fn) const
+        {
+            for (const _Ty &x : view())
+                fn(x);
+        }
+
+        /**
+         * @brief Number of elements; exact only while no thread writes
+         */
+        size_type size() const noexcept
+        {
+            return _Size.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const noexcept
+        {
+            return _Node_base::_Ptr(_Head._Next.load(std::memory_order_acquire)) == nullptr;
+        }
+
+        allocator_type get_allocator() const
+        {
+            return allocator_type(_Alloc_node);
+        }
+
+    private:
+        template <class... _Args>
+        _Node *_Create_node(_Args &&...args)
+        {
+            _Node *node = std::to_address(node_alloc_traits::allocate(_Alloc_node, 1));
+            ::new (static_cast<void *>(node)) _Node;
+            try
+            {
+                node_alloc_traits::construct(_Alloc_node, node->_Valptr(), std::forward<_Args>(args)...);
+            }
+            catch (...)
+            {
+                node->~_Node();
+                node_alloc_traits::deallocate(_Alloc_node, node, 1);
+                throw;
+            }
+            return node;
+        }
+
+        void _Destroy_node(_Node *node) noexcept
+        {
+            node_alloc_traits::destroy(_Alloc_node, node->_Valptr());
+            node->~_Node();
+            node_alloc_traits::deallocate(_Alloc_node, node, 1);
+        }
+
+        void _Retire(_Node_base *node)
+        {
+            _Domain.retire(static_cast<_Node *>(node), [alloc = _Alloc_node](_Node *n) mutable
+                           {
+                node_alloc_traits::destroy(alloc, n->_Valptr());
+                n->~_Node();
+                node_alloc_traits::deallocate(alloc, n, 1); });
+        }
+
+        /**
+         * @brief Finds the first node not less than @a key and its
+         *        predecessor, unlinking marked nodes on the way. Must be
+         *        called under a guard.
+         */
+        std::pair<_Node_base *, _Node_base *> _Search(const _Ty &key)
+        {
+        retry:
+            _Node_base *prev = &_Head;
+            _Node_base *curr = _Node_base::_Ptr(prev->_Next.load(std::memory_order_acquire));
+            while (curr)
+            {
+                const uintptr_t next = curr->_Next.load(std::memory_order_acquire);
+                if (_Node_base::_Marked(next))
+                {
+                    uintptr_t expected = _Node_base::_Link(curr);
+                    const uintptr_t succ = next & ~_Node_base::_Mark;
+                    if (!prev->_Next.compare_exchange_strong(expected, succ, std::memory_order_acq_rel,
+                                                             std::memory_order_acquire))
+                        goto retry;
+                    _Retire(curr);
+                    curr = _Node_base::_Ptr(succ);
+                    continue;
+                }
+                if (!_Comp(*static_cast<_Node *>(curr)->_Valptr(), key))
+                    return {prev, curr};
+                prev = curr;
+                curr = _Node_base::_Ptr(next);
+            }
+            return {prev, nullptr};
+        }
+
+        /**
+         * @brief Read-only lookup that steps over marked nodes
+         */
+        const _Node *_Find(const _Ty &key) const
+        {
+            const _Node_base *curr = _Node_base::_Ptr(_Head._Next.load(std::memory_order_acquire));
+            while (curr)
+            {
+                const uintptr_t next = curr->_Next.load(std::memory_order_acquire);
+                const _Ty &value = *static_cast<const _Node *>(curr)->_Valptr();
+                if (!_Comp(value, key))
+                    return !_Node_base::_Marked(next) && !_Comp(key, value) ? static_cast<const _Node *>(curr) : nullptr;
+                curr = _Node_base::_Ptr(next);
+            }
+            return nullptr;
+        }
+
+        _Node_base _Head;
+        _Compare _Comp;
+        mutable node_alloc_t _Alloc_node;
+        epoch_domain &_Domain;
+        std::atomic<size_t> _Size{0};
+    };
+}
@@ -0,0 +1,1005 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+#include "vector.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        /**
+         * @brief Lower bound over a sorted contiguous range. The halving step
+         *        is written without a branch on the comparison so arithmetic
+         *        keys compile to conditional moves.
+         */
+        template <class _Key, class _Compare>
+        const _Key *_Flat_lower_bound(const _Key *first, size_t n, const _Key &key, const _Compare &comp)
+        {
+            while (n > 1)
+            {
+                const size_t half = n / 2;
+                first = comp(first[half], key) ? first + half : first;
+                n -= half;
+            }
+            return n && comp(*first, key) ? first + 1 : first;
+        }
+
+        template <class _Key, class _Compare>
+        const _Key *_Flat_upper_bound(const _Key *first, size_t n, const _Key &key, const _Compare &comp)
+        {
+            while (n > 1)
+            {
+                const size_t half = n / 2;
+                first = !comp(key, first[half]) ? first + half : first;
+                n -= half;
+            }
+            return n && !comp(key, *first) ? first + 1 : first;
+        }
+
+        template <class _Ref>
+        class Flat_arrow_proxy
+        {
+        public:
+            _Ref _Value;
+
+            _Ref *operator->() noexcept
+            {
+                return std::addressof(_Value);
+            }
+        };
+
+        /**
+         * @brief Random access iterator walking the key and the value arrays
+         *        of a flat_map side by side.
+         *
+         * @tparam _Key
+         * @tparam _Ty
+         * @tparam _Const
+         */
+        template <class _Key, class _Ty, bool _Const>
+        class Flat_map_iterator
+        {
+            using _Mapped_ptr = std::conditional_t<_Const, const _Ty *, _Ty *>;
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using difference_type = ptrdiff_t;
+            using value_type = std::pair<const _Key, _Ty>;
+            using reference = std::pair<const _Key &, std::conditional_t<_Const, const _Ty &, _Ty &>>;
+            using pointer = Flat_arrow_proxy<reference>;
+
+            using Self = Flat_map_iterator<_Key, _Ty, _Const>;
+
+            Flat_map_iterator() noexcept
+                : _M_key(), _M_value()
+            {
+            }
+
+            Flat_map_iterator(const _Key *key, _Mapped_ptr value) noexcept
+                : _M_key(key), _M_value(value)
+            {
+            }
+
+            template <bool _OtherConst, typename = std::enable_if_t<_Const && !_OtherConst>>
+            Flat_map_iterator(const Flat_map_iterator<_Key, _Ty, _OtherConst> &x) noexcept
+                : _M_key(x._M_key), _M_value(x._M_value)
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                return reference(*_M_key, *_M_value);
+            }
+
+            pointer operator->() const noexcept
+            {
+                return pointer{operator*()};
+            }
+
+            reference operator[](difference_type offset) const noexcept
+            {
+                return reference(_M_key[offset], _M_value[offset]);
+            }
+
+            Self &operator++() noexcept
+            {
+                ++_M_key;
+                ++_M_value;
+                return *this;
+            }
+
+            Self operator++(int) noexcept
+            {
+                Self temp{*this};
+                ++*this;
+                return temp;
+            }
+
+            Self &operator--() noexcept
+            {
+                --_M_key;
+                --_M_value;
+                return *this;
+            }
+
+            Self operator--(int) noexcept
+            {
+                Self temp{*this};
+                --*this;
+                return temp;
+            }
+
+            Self &operator+=(difference_type offset) noexcept
+            {
+                _M_key += offset;
+                _M_value += offset;
+                return *this;
+            }
+
+            Self &operator-=(difference_type offset) noexcept
+            {
+                return *this += -offset;
+            }
+
+            Self operator+(difference_type offset) const noexcept
+            {
+                return Self(_M_key + offset, _M_value + offset);
+            }
+
+            Self operator-(difference_type offset) const noexcept
+            {
+                return Self(_M_key - offset, _M_value - offset);
+            }
+
+            friend difference_type operator-(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key - y._M_key;
+            }
+
+            friend bool operator==(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key == y._M_key;
+            }
+
+            friend bool operator!=(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key != y._M_key;
+            }
+
+            friend bool operator<(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key < y._M_key;
+            }
+
+            friend bool operator>(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key > y._M_key;
+            }
+
+            friend bool operator<=(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key <= y._M_key;
+            }
+
+            friend bool operator>=(const Self &x, const Self &y) noexcept
+            {
+                return x._M_key >= y._M_key;
+            }
+
+            const _Key *_M_key;
+            _Mapped_ptr _M_value;
+        };
+    }
+
+    /**
+     * @brief Sorted associative container keeping keys and values in two
+     *        separate collections::vector. Lookups binary search the key
+     *        array only; built once and read many times.
+     *
+     * @tparam _Key
+     * @tparam _Ty
+     * @tparam _Compare
+     * @tparam _Alloc
+     */
+    template <class _Key, class _Ty, class _Compare = std::less<_Key>,
+              class _Alloc = std::allocator<std::pair<const _Key, _Ty>>>
+    class flat_map
+    {
+    public:
+        using key_type = _Key;
+        using mapped_type = _Ty;
+        using value_type = std::pair<const _Key, _Ty>;
+        using key_compare = _Compare;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        using key_container_type = vector<_Key, typename std::allocator_traits<_Alloc>::template rebind_alloc<_Key>>;
+        using mapped_container_type = vector<_Ty, typename std::allocator_traits<_Alloc>::template rebind_alloc<_Ty>>;
+
+        using iterator = __base::Flat_map_iterator<_Key, _Ty, false>;
+        using const_iterator = __base::Flat_map_iterator<_Key, _Ty, true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        /**
+         * @brief Construct a new flat map object with no elements
+         *
+         */
+        flat_map()
+        {
+        }
+
+        explicit flat_map(const _Compare &comp)
+            : _Comp(comp)
+        {
+        }
+
+        /**
+         * @brief Construct a new flat map object with the range [first, last).
+         *        The first of equivalent keys wins.
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        flat_map(Input first, Input last, const _Compare &comp = _Compare())
+            : _Comp(comp)
+        {
+            insert_range(first, last);
+        }
+
+        flat_map(std::initializer_list<value_type> l, const _Compare &comp = _Compare())
+            : _Comp(comp)
+        {
+            insert_range(l.begin(), l.end());
+        }
+
+        /**
+         * @brief Adopts already built key and value arrays; they are sorted
+         *        and deduplicated if needed.
+         *
+         * @param keys
+         * @param values
+         * @throw std::invalid_argument if the arrays differ in size
+         */
+        flat_map(key_container_type &&keys, mapped_container_type &&values, const _Compare &comp = _Compare())
+            : _Keys(std::move(keys)), _Values(std::move(values)), _Comp(comp)
+        {
+            if (_Keys.size() != _Values.size())
+                throw std::invalid_argument("collections::flat_map: keys and values differ in size");
+            _Sort_unique(0);
+        }
+
+        iterator begin() noexcept
+        {
+            return iterator(_Keys.data(), _Values.data());
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(_Keys.data(), _Values.data());
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        iterator end() noexcept
+        {
+            return begin() + size();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return begin() + size();
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        bool empty() const noexcept
+        {
+            return _Keys.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return _Keys.size();
+        }
+
+        size_type capacity() const noexcept
+        {
+            return _Keys.capacity();
+        }
+
+        void reserve(size_type n)
+        {
+            _Keys.reserve(n);
+            _Values.reserve(n);
+        }
+
+        void shrink_to_fit()
+        {
+            _Keys.shrink_to_fit();
+            _Values.shrink_to_fit();
+        }
+
+        void clear() noexcept
+        {
+            _Keys.clear();
+            _Values.clear();
+        }
+
+        key_compare key_comp() const
+        {
+            return _Comp;
+        }
+
+        /**
+         * @brief The sorted keys
+         *
+         * @return const key_container_type&
+         */
+        const key_container_type &keys() const noexcept
+        {
+            return _Keys;
+        }
+
+        /**
+         * @brief The values, in key order
+         *
+         * @return const mapped_container_type&
+         */
+        const mapped_container_type &values() const noexcept
+        {
+            return _Values;
+        }
+
+        /**
+         * @brief Inserts a value built from @a args under @a key unless the
+         *        key is present. O(n) because of the shift; use insert_range
+         *        to load many elements.
+         *
+         * @return std::pair<iterator, bool>
+         */
+        template <class _Kx, class... _Args>
+        std::pair<iterator, bool> try_emplace(_Kx &&key, _Args &&...args)
+        {
+            const size_type i = _Lower_index(key);
+            if (i < size() && !_Comp(key, _Keys[i]))
+                return {begin() + i, false};
+
+            _Keys.emplace(_Keys.cbegin() + i, std::forward<_Kx>(key));
+            try
+            {
+                _Values.emplace(_Values.cbegin() + i, std::forward<_Args>(args)...);
+            }
+            catch (...)
+            {
+                _Keys.erase(_Keys.cbegin() + i);
+                throw;
+            }
+            return {begin() + i, true};
+        }
+
+        std::pair<iterator, bool> insert(const value_type &value)
+        {
+            return try_emplace(value.first, value.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type &&value)
+        {
+            return try_emplace(std::move(const_cast<_Key &>(value.first)), std::move(value.second));
+        }
+
+        template <class... _Args>
+        std::pair<iterator, bool> emplace(const key_type &key, _Args &&...args)
+        {
+            return try_emplace(key, std::forward<_Args>(args)...);
+        }
+
+        template <class _Vx>
+        std::pair<iterator, bool> insert_or_assign(const key_type &key, _Vx &&value)
+        {
+            auto res = try_emplace(key, std::forward<_Vx>(value));
+            if (!res.second)
+                res.first->second = std::forward<_Vx>(value);
+            return res;
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert(Input first, Input last)
+        {
+            insert_range(first, last);
+        }
+
+        void insert(std::initializer_list<value_type> l)
+        {
+            insert_range(l.begin(), l.end());
+        }
+
+        /**
+         * @brief Bulk insertion: appends the range, sorts the appended part
+         *        and merges it into the sorted prefix dropping duplicate keys,
+         *        in O(n + m log m) instead of m shifting inserts. Present keys
+         *        and the first of equivalent new keys win.
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert_range(Input first, Input last)
+        {
+            const size_type old_size = size();
+            if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                            typename std::iterator_traits<Input>::iterator_category>)
+                reserve(old_size + std::distance(first, last));
+
+            try
+            {
+                for (; first != last; ++first)
+                {
+                    _Keys.emplace_back((*first).first);
+                    _Values.emplace_back((*first).second);
+                }
+            }
+            catch (...)
+            {
+                // the tail is unsorted and may hold a key without its value
+                _Keys.erase(_Keys.cbegin() + old_size, _Keys.cend());
+                _Values.erase(_Values.cbegin() + old_size, _Values.cend());
+                throw;
+            }
+            _Sort_unique(old_size);
+        }
+
+        mapped_type &operator[](const key_type &key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        mapped_type &operator[](key_type &&key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        mapped_type &at(const key_type &key)
+        {
+            const size_type i = _Find_index(key);
+            if (i == size())
+                throw std::out_of_range("collections::flat_map::at");
+            return _Values[i];
+        }
+
+        const mapped_type &at(const key_type &key) const
+        {
+            const size_type i = _Find_index(key);
+            if (i == size())
+                throw std::out_of_range("collections::flat_map::at");
+            return _Values[i];
+        }
+
+        iterator find(const key_type &key)
+        {
+            return begin() + _Find_index(key);
+        }
+
+        const_iterator find(const key_type &key) const
+        {
+            return begin() + _Find_index(key);
+        }
+
+        bool contains(const key_type &key) const
+        {
+            return _Find_index(key) != size();
+        }
+
+        size_type count(const key_type &key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        iterator lower_bound(const key_type &key)
+        {
+            return begin() + _Lower_index(key);
+        }
+
+        const_iterator lower_bound(const key_type &key) const
+        {
+            return begin() + _Lower_index(key);
+        }
+
+        iterator upper_bound(const key_type &key)
+        {
+            return begin() + _Upper_index(key);
+        }
+
+        const_iterator upper_bound(const key_type &key) const
+        {
+            return begin() + _Upper_index(key);
+        }
+
+        std::pair<iterator, iterator> equal_range(const key_type &key)
+        {
+            return {lower_bound(key), upper_bound(key)};
+        }
+
+        std::pair<const_iterator, const_iterator> equal_range(const key_type &key) const
+        {
+            return {lower_bound(key), upper_bound(key)};
+        }
+
+        size_type erase(const key_type &key)
+        {
+            const size_type i = _Find_index(key);
+            if (i == size())
+                return 0;
+            _Erase_range(i, i + 1);
+            return 1;
+        }
+
+        iterator erase(const_iterator position)
+        {
+            const size_type i = position - cbegin();
+            _Erase_range(i, i + 1);
+            return begin() + i;
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            const size_type i = first - cbegin();
+            _Erase_range(i, last - cbegin());
+            return begin() + i;
+        }
+
+        void swap(flat_map &x) noexcept
+        {
+            _Keys.swap(x._Keys);
+            _Values.swap(x._Values);
+            std::swap(_Comp, x._Comp);
+        }
+
+    private:
+        size_type _Lower_index(const key_type &key) const
+        {
+            return __base::_Flat_lower_bound(_Keys.data(), size(), key, _Comp) - _Keys.data();
+        }
+
+        size_type _Upper_index(const key_type &key) const
+        {
+            return __base::_Flat_upper_bound(_Keys.data(), size(), key, _Comp) - _Keys.data();
+        }
+
+        size_type _Find_index(const key_type &key) const
+        {
+            const size_type i = _Lower_index(key);
+            return (i < size() && !_Comp(key, _Keys[i])) ? i : size();
+        }
+
+        void _Erase_range(size_type first, size_type last)
+        {
+            _Keys.erase(_Keys.cbegin() + first, _Keys.cbegin() + last);
+            _Values.erase(_Values.cbegin() + first, _Values.cbegin() + last);
+        }
+
+        /**
+         * @brief Sorts the elements from @a sorted on and merges them into the
+         *        sorted prefix [0, sorted), keeping the first of equal keys.
+         *        Works in place; besides an index per appended element only
+         *        the appended tail is buffered, and only when there is a
+         *        prefix to merge with.
+         *
+         * @param sorted
+         */
+        void _Sort_unique(size_type sorted)
+        {
+            const size_type n = size();
+            if (n == sorted)
+                return;
+
+            // order the appended tail through an index permutation, then walk
+            // its cycles so each key and value moves once
+            const size_type m = n - sorted;
+            vector<size_type> order;
+            order.reserve(m);
+            for (size_type i = 0; i < m; ++i)
+                order.push_back(i);
+            std::stable_sort(order.begin(), order.end(), [this, sorted](size_type x, size_type y)
+                             { return _Comp(_Keys[sorted + x], _Keys[sorted + y]); });
+
+            for (size_type k = 0; k < m; ++k)
+            {
+                if (order[k] == k)
+                    continue;
+                _Key key = std::move(_Keys[sorted + k]);
+                _Ty value = std::move(_Values[sorted + k]);
+                size_type j = k;
+                for (;;)
+                {
+                    const size_type from = order[j];
+                    order[j] = j;
+                    if (from == k)
+                        break;
+                    _Keys[sorted + j] = std::move(_Keys[sorted + from]);
+                    _Values[sorted + j] = std::move(_Values[sorted + from]);
+                    j = from;
+                }
+                _Keys[sorted + j] = std::move(key);
+                _Values[sorted + j] = std::move(value);
+            }
+            order.clear();
+            order.shrink_to_fit();
+
+            // merge from the back; on equal keys the prefix element stays first
+            size_type from = sorted;
+            if (sorted != 0 && _Comp(_Keys[sorted], _Keys[sorted - 1]))
+            {
+                from = __base::_Flat_upper_bound(_Keys.data(), sorted, _Keys[sorted], _Comp) - _Keys.data();
+                key_container_type keys(std::make_move_iterator(_Keys.begin() + sorted),
+                                        std::make_move_iterator(_Keys.end()));
+                mapped_container_type values(std::make_move_iterator(_Values.begin() + sorted),
+                                             std::make_move_iterator(_Values.end()));
+                size_type i = sorted, j = m, d = n;
+                while (j != 0)
+                {
+                    --d;
+                    if (i != 0 && _Comp(keys[j - 1], _Keys[i - 1]))
+                    {
+                        --i;
+                        _Keys[d] = std::move(_Keys[i]);
+                        _Values[d] = std::move(_Values[i]);
+                    }
+                    else
+                    {
+                        --j;
+                        _Keys[d] = std::move(keys[j]);
+                        _Values[d] = std::move(values[j]);
+                    }
+                }
+            }
+
+            // drop equal keys; everything before @a from is already unique
+            size_type out = from != 0 ? from - 1 : 0;
+            for (size_type i = out + 1; i < n; ++i)
+            {
+                if (!_Comp(_Keys[out], _Keys[i]))
+                    continue;
+                if (++out != i)
+                {
+                    _Keys[out] = std::move(_Keys[i]);
+                    _Values[out] = std::move(_Values[i]);
+                }
+            }
+            _Erase_range(out + 1, n);
+        }
+
+        key_container_type _Keys;
+        mapped_container_type _Values;
+        _Compare _Comp;
+    };
+
+    /**
+     * @brief Sorted set stored in a collections::vector.
+     *
+     * @tparam _Key
+     * @tparam _Compare
+     * @tparam _Alloc
+     */
+    template <class _Key, class _Compare = std::less<_Key>, class _Alloc = std::allocator<_Key>>
+    class flat_set
+    {
+    public:
+        using key_type = _Key;
+        using value_type = _Key;
+        using key_compare = _Compare;
+        using value_compare = _Compare;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        using container_type = vector<_Key, _Alloc>;
+        using iterator = typename container_type::const_iterator;
+        using const_iterator = iterator;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = reverse_iterator;
+
+        /**
+         * @brief Construct a new flat set object with no elements
+         *
+         */
+        flat_set()
+        {
+        }
+
+        explicit flat_set(const _Compare &comp)
+            : _Comp(comp)
+        {
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        flat_set(Input first, Input last, const _Compare &comp = _Compare())
+            : _Comp(comp)
+        {
+            insert_range(first, last);
+        }
+
+        flat_set(std::initializer_list<value_type> l, const _Compare &comp = _Compare())
+            : _Comp(comp)
+        {
+            insert_range(l.begin(), l.end());
+        }
+
+        /**
+         * @brief Adopts an already built key array; it is sorted and
+         *        deduplicated if needed.
+         *
+         * @param keys
+         */
+        explicit flat_set(container_type &&keys, const _Compare &comp = _Compare())
+            : _Keys(std::move(keys)), _Comp(comp)
+        {
+            _Sort_unique(0);
+        }
+
+        iterator begin() const noexcept
+        {
+            return _Keys.cbegin();
+        }
+
+        iterator cbegin() const noexcept
+        {
+            return _Keys.cbegin();
+        }
+
+        iterator end() const noexcept
+        {
+            return _Keys.cend();
+        }
+
+        iterator cend() const noexcept
+        {
+            return _Keys.cend();
+        }
+
+        reverse_iterator rbegin() const noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() const noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        bool empty() const noexcept
+        {
+            return _Keys.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return _Keys.size();
+        }
+
+        size_type capacity() const noexcept
+        {
+            return _Keys.capacity();
+        }
+
+        void reserve(size_type n)
+        {
+            _Keys.reserve(n);
+        }
+
+        void shrink_to_fit()
+        {
+            _Keys.shrink_to_fit();
+        }
+
+        void clear() noexcept
+        {
+            _Keys.clear();
+        }
+
+        key_compare key_comp() const
+        {
+            return _Comp;
+        }
+
+        const container_type &keys() const noexcept
+        {
+            return _Keys;
+        }
+
+        std::pair<iterator, bool> insert(const value_type &value)
+        {
+            return emplace(value);
+        }
+
+        std::pair<iterator, bool> insert(value_type &&value)
+        {
+            return emplace(std::move(value));
+        }
+
+        template <class... _Args>
+        std::pair<iterator, bool> emplace(_Args &&...args)
+        {
+            value_type key(std::forward<_Args>(args)...);
+            const size_type i = _Lower_index(key);
+            if (i < size() && !_Comp(key, _Keys[i]))
+                return {begin() + i, false};
+            _Keys.emplace(_Keys.cbegin() + i, std::move(key));
+            return {begin() + i, true};
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert(Input first, Input last)
+        {
+            insert_range(first, last);
+        }
+
+        void insert(std::initializer_list<value_type> l)
+        {
+            insert_range(l.begin(), l.end());
+        }
+
+        /**
+         * @brief Bulk insertion: appends the range, sorts it, merges it into
+         *        the sorted prefix and drops duplicates in one pass.
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert_range(Input first, Input last)
+        {
+            const size_type old_size = size();
+            _Keys.insert(_Keys.cend(), first, last);
+            _Sort_unique(old_size);
+        }
+
+        iterator find(const key_type &key) const
+        {
+            return begin() + _Find_index(key);
+        }
+
+        bool contains(const key_type &key) const
+        {
+            return _Find_index(key) != size();
+        }
+
+        size_type count(const key_type &key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        iterator lower_bound(const key_type &key) const
+        {
+            return begin() + _Lower_index(key);
+        }
+
+        iterator upper_bound(const key_type &key) const
+        {
+            return begin() + (__base::_Flat_upper_bound(_Keys.data(), size(), key, _Comp) - _Keys.data());
+        }
+
+        std::pair<iterator, iterator> equal_range(const key_type &key) const
+        {
+            return {lower_bound(key), upper_bound(key)};
+        }
+
+        size_type erase(const key_type &key)
+        {
+            const size_type i = _Find_index(key);
+            if (i == size())
+                return 0;
+            _Keys.erase(_Keys.cbegin() + i);
+            return 1;
+        }
+
+        iterator erase(const_iterator position)
+        {
+            return _Keys.erase(position);
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            return _Keys.erase(first, last);
+        }
+
+        void swap(flat_set &x) noexcept
+        {
+            _Keys.swap(x._Keys);
+            std::swap(_Comp, x._Comp);
+        }
+
+    private:
+        size_type _Lower_index(const key_type &key) const
+        {
+            return __base::_Flat_lower_bound(_Keys.data(), size(), key, _Comp) - _Keys.data();
+        }
+
+        size_type _Find_index(const key_type &key) const
+        {
+            const size_type i = _Lower_index(key);
+            return (i < size() && !_Comp(key, _Keys[i])) ? i : size();
+        }
+
+        void _Sort_unique(size_type sorted)
+        {
+            auto first = _Keys.begin();
+            auto middle = first + sorted;
+            auto last = _Keys.end();
+            if (middle == last)
+                return;
+            std::stable_sort(middle, last, _Comp);
+            std::inplace_merge(first, middle, last, _Comp);
+            auto equal = [this](const _Key &x, const _Key &y)
+            { return !_Comp(x, y) && !_Comp(y, x); };
+            _Keys.erase(std::unique(first, last, equal), _Keys.end());
+        }
+
+        container_type _Keys;
+        _Compare _Comp;
+    };
+
+    template <class _Key, class _Ty, class _Compare, class _Alloc>
+    inline bool operator==(const flat_map<_Key, _Ty, _Compare, _Alloc> &x,
+                           const flat_map<_Key, _Ty, _Compare, _Alloc> &y)
+    {
+        return x.keys() == y.keys() && x.values() == y.values();
+    }
+
+    template <class _Key, class _Ty, class _Compare, class _Alloc>
+    inline bool operator!=(const flat_map<_Key, _Ty, _Compare, _Alloc> &x,
+                           const flat_map<_Key, _Ty, _Compare, _Alloc> &y)
+    {
+        return !(x == y);
+    }
+
+    template <class _Key, class _Compare, class _Alloc>
+    inline bool operator==(const flat_set<_Key, _Compare, _Alloc> &x, const flat_set<_Key, _Compare, _Alloc> &y)
+    {
+        return x.keys() == y.keys();
+    }
+
+    template <class _Key, class _Compare, class _Alloc>
+    inline bool operator!=(const flat_set<_Key, _Compare, _Alloc> &x, const flat_set<_Key, _Compare, _Alloc> &y)
+    {
+        return !(x == y);
+    }
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <mutex>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace collections
+{
+    /**
+     * @brief Size of the huge pages asked for, the x86-64 and arm64 default.
+     *        Mappings are rounded up to a multiple of it.
+     */
+    constexpr size_t hugepage_size = size_t(2) << 20;
+
+    /**
+     * @brief Largest object hugepage_allocator serves from its shared slabs;
+     *        bigger single objects fall through to operator new.
+     */
+    constexpr size_t hugepage_slab_object_max = 1024;
+
+    namespace __base
+    {
+        /**
+         * @brief Maps @a len bytes, a multiple of hugepage_size. Explicit huge
+         *        pages (MAP_HUGETLB) are tried first; they exist only when the
+         *        administrator reserved some. Otherwise an ordinary mapping is
+         *        aligned to hugepage_size and marked MADV_HUGEPAGE so that
+         *        transparent huge pages can back it. Where neither is
+         *        available the memory is still usable on normal pages.
+         */
+        inline void *_Hugepage_map(size_t len)
+        {
+#if defined(__linux__)
+#if defined(MAP_HUGETLB)
+            void *p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+                return p;
+#endif
+            // over-map by one huge page and trim both ends to the alignment
+            char *raw = static_cast<char *>(::mmap(nullptr, len + hugepage_size, PROT_READ | PROT_WRITE,
+                                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (raw == MAP_FAILED)
+                std::__throw_bad_alloc();
+            char *aligned = reinterpret_cast<char *>(
+                (reinterpret_cast<uintptr_t>(raw) + hugepage_size - 1) & ~uintptr_t(hugepage_size - 1));
+            if (aligned != raw)
+                ::munmap(raw, aligned - raw);
+            if (const size_t tail = hugepage_size - (aligned - raw))
+                ::munmap(aligned + len, tail);
+#if defined(MADV_HUGEPAGE)
+            ::madvise(aligned, len, MADV_HUGEPAGE);
+#endif
+            return aligned;
+#else
+            return ::operator new(len, std::align_val_t(hugepage_size));
+#endif
+        }
+
+        inline void _Hugepage_unmap(void *p, size_t len) noexcept
+        {
+#if defined(__linux__)
+            ::munmap(p, len);
+#else
+            ::operator delete(p, len, std::align_val_t(hugepage_size));
+#endif
+        }
+
+        /**
+         * @brief Process wide pool of single objects of one size, carved from
+         *        huge page slabs. Freed objects are kept on a free list for
+         *        reuse; the slabs stay mapped for the life of the process.
+         */
+        template <size_t _Size, size_t _Align>
+        class Hugepage_slab
+        {
+            struct Free
+            {
+                Free *_Next;
+            };
+
+            static constexpr size_t _Slot = (std::max(_Size, sizeof(Free)) + _Align - 1) / _Align * _Align;
+
+        public:
+            static Hugepage_slab &_Instance()
+            {
+                static Hugepage_slab *slab = new Hugepage_slab;
+                return *slab;
+            }
+
+            void *_Get()
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                if (Free *p = _Free)
+                {
+                    _Free = p->_Next;
+                    return p;
+                }
+                if (_Bump == _End)
+                {
+                    _Bump = static_cast<char *>(_Hugepage_map(hugepage_size));
+                    _End = _Bump + hugepage_size / _Slot * _Slot;
+                }
+                void *p = _Bump;
+                _Bump += _Slot;
+                return p;
+            }
+
+            void _Put(void *p) noexcept
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                _Free = ::new (p) Free{_Free};
+            }
+
+        private:
+            Hugepage_slab() = default;
+
+            std::mutex _Lock;
+            Free *_Free = nullptr;
+            char *_Bump = nullptr;
+            char *_End = nullptr;
+        };
+    }
+
+    /**
+     * @brief Allocator backing storage with huge pages to cut TLB misses on
+     *        large containers, with a transparent fallback to normal pages.
+     *
+     *        Blocks of hugepage_size bytes or more get their own mapping,
+     *        rounded up to whole huge pages; that is the path of a large
+     *        collections::vector. Single small objects, such as the nodes of
+     *        collections::list, are carved from shared huge page slabs.
+     *        Other small arrays come from operator new, where a huge page
+     *        would be mostly empty.
+     *
+     * @tparam _Ty
+     */
+    template <class _Ty>
+    class hugepage_allocator
+    {
+    public:
+        using value_type = _Ty;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        using propagate_on_container_move_assignment = std::true_type;
+        using is_always_equal = std::true_type;
+
+        hugepage_allocator() noexcept = default;
+
+        template <class _Other>
+        hugepage_allocator(const hugepage_allocator<_Other> &) noexcept
+        {
+        }
+
+        [[nodiscard]] _Ty *allocate(size_type n)
+        {
+            if (n > max_size())
+                std::__throw_bad_array_new_length();
+
+            const size_t bytes = n * sizeof(_Ty);
+            if (bytes >= hugepage_size)
+                return static_cast<_Ty *>(__base::_Hugepage_map(_S_mapping_size(bytes)));
+            if (n == 1 && _S_slab_object)
+                return static_cast<_Ty *>(_Slab::_Instance()._Get());
+            return static_cast<_Ty *>(::operator new(bytes, std::align_val_t(alignof(_Ty))));
+        }
+
+        void deallocate(_Ty *p, size_type n) noexcept
+        {
+            const size_t bytes = n * sizeof(_Ty);
+            if (bytes >= hugepage_size)
+                __base::_Hugepage_unmap(p, _S_mapping_size(bytes));
+            else if (n == 1 && _S_slab_object)
+                _Slab::_Instance()._Put(p);
+            else
+                ::operator delete(p, bytes, std::align_val_t(alignof(_Ty)));
+        }
+
+        size_type max_size() const noexcept
+        {
+            return (std::numeric_limits<size_type>::max() - hugepage_size) / sizeof(_Ty);
+        }
+
+        template <class _Other>
+        friend bool operator==(const hugepage_allocator &, const hugepage_allocator<_Other> &) noexcept
+        {
+            return true;
+        }
+
+        template <class _Other>
+        friend bool operator!=(const hugepage_allocator &, const hugepage_allocator<_Other> &) noexcept
+        {
+            return false;
+        }
+
+    private:
+        using _Slab = __base::Hugepage_slab<sizeof(_Ty), alignof(_Ty)>;
+
+        // slabs start on a huge page boundary, so any alignment of a small
+        // object is met by the slot size
+        static constexpr bool _S_slab_object = sizeof(_Ty) <= hugepage_slab_object_max;
+
+        static size_t _S_mapping_size(size_t bytes) noexcept
+        {
+            return (bytes + hugepage_size - 1) & ~(hugepage_size - 1);
+        }
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace collections
+{
+    /**
+     * @brief Default instrumentation policy of list and vector. Every hook is
+     *        an empty static function, so an uninstrumented container compiles
+     *        to the same code as before the hooks existed.
+     *
+     */
+    struct no_instrumentation
+    {
+        static constexpr bool enabled = false;
+
+        static void on_allocate(size_t) noexcept {}
+        static void on_deallocate(size_t) noexcept {}
+        static void on_reallocate() noexcept {}
+        static void on_copy(size_t) noexcept {}
+        static void on_move(size_t) noexcept {}
+        static void on_hop(size_t) noexcept {}
+    };
+
+    /**
+     * @brief Snapshot of the counters of a counting_instrumentation
+     *
+     */
+    struct container_stats
+    {
+        uint64_t allocations;
+        uint64_t deallocations;
+        uint64_t bytes_allocated;
+        uint64_t bytes_deallocated;
+        uint64_t reallocations;
+        uint64_t copies;
+        uint64_t moves;
+        uint64_t hops;
+    };
+
+    /**
+     * @brief Instrumentation policy counting allocations, bytes,
+     *        reallocations, element copies and moves, and node hops taken by
+     *        internal list walks.
+     *
+     *        The counters are shared by every container instantiated with
+     *        the same @a _Tag, so tagging each container declaration of
+     *        interest attributes the churn to it:
+     *
+     *            struct session_tag {};
+     *            using sessions = collections::list<session, std::allocator<session>,
+     *                                               collections::counting_instrumentation<session_tag>>;
+     *            ...
+     *            collections::container_stats s = collections::counting_instrumentation<session_tag>::stats();
+     *
+     *        Counters are relaxed atomics, so containers on different threads
+     *        may share a tag.
+     *
+     * @tparam _Tag
+     */
+    template <class _Tag = void>
+    struct counting_instrumentation
+    {
+        static constexpr bool enabled = true;
+
+        static void on_allocate(size_t bytes) noexcept
+        {
+            _Counters.allocations.fetch_add(1, std::memory_order_relaxed);
+            _Counters.bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        static void on_deallocate(size_t bytes) noexcept
+        {
+            _Counters.deallocations.fetch_add(1, std::memory_order_relaxed);
+            _Counters.bytes_deallocated.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        static void on_reallocate() noexcept
+        {
+            _Counters.reallocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static void on_copy(size_t n) noexcept
+        {
+            if (n)
+                _Counters.copies.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        static void on_move(size_t n) noexcept
+        {
+            if (n)
+                _Counters.moves.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        static void on_hop(size_t n) noexcept
+        {
+            if (n)
+                _Counters.hops.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        static container_stats stats() noexcept
+        {
+            return {_Counters.allocations.load(std::memory_order_relaxed),
+                    _Counters.deallocations.load(std::memory_order_relaxed),
+                    _Counters.bytes_allocated.load(std::memory_order_relaxed),
+                    _Counters.bytes_deallocated.load(std::memory_order_relaxed),
+                    _Counters.reallocations.load(std::memory_order_relaxed),
+                    _Counters.copies.load(std::memory_order_relaxed),
+                    _Counters.moves.load(std::memory_order_relaxed),
+                    _Counters.hops.load(std::memory_order_relaxed)};
+        }
+
+        static void reset() noexcept
+        {
+            _Counters.allocations.store(0, std::memory_order_relaxed);
+            _Counters.deallocations.store(0, std::memory_order_relaxed);
+            _Counters.bytes_allocated.store(0, std::memory_order_relaxed);
+            _Counters.bytes_deallocated.store(0, std::memory_order_relaxed);
+            _Counters.reallocations.store(0, std::memory_order_relaxed);
+            _Counters.copies.store(0, std::memory_order_relaxed);
+            _Counters.moves.store(0, std::memory_order_relaxed);
+            _Counters.hops.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        struct Counters
+        {
+            std::atomic<uint64_t> allocations{0};
+            std::atomic<uint64_t> deallocations{0};
+            std::atomic<uint64_t> bytes_allocated{0};
+            std::atomic<uint64_t> bytes_deallocated{0};
+            std::atomic<uint64_t> reallocations{0};
+            std::atomic<uint64_t> copies{0};
+            std::atomic<uint64_t> moves{0};
+            std::atomic<uint64_t> hops{0};
+        };
+
+        static inline Counters _Counters;
+    };
+}
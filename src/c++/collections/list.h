@@ -1,8 +1,17 @@
+#pragma once
+
 #include <memory>
+#include <iterator>
+#include <algorithm>
 #include <initializer_list>
+#include <optional>
+#include "instrumentation.h"
 
 namespace collections
 {
+    template <class _Ty, class _Alloc, class _Policy>
+    class list;
+
     namespace __base
     {
         class List_node_base
@@ -153,7 +162,7 @@ namespace collections
                 return _Data._M_ptr();
             }
 
-            _Ty *const _Valptr() const
+            const _Ty *_Valptr() const
             {
                 return _Data._M_ptr();
             }
@@ -175,8 +184,8 @@ namespace collections
             using iterator_category = std::bidirectional_iterator_tag;
             using difference_type = ptrdiff_t;
             using value_type = _Ty;
-            using pointer = _Ty *;
-            using reference = _Ty &;
+            using pointer = const _Ty *;
+            using reference = const _Ty &;
 
             List_iterator<_Ty> _Const_cast() const noexcept
             {
@@ -199,7 +208,7 @@ namespace collections
             {
             }
 
-            List_const_iterator(__base::List_iterator<_Ty>& x)
+            List_const_iterator(const __base::List_iterator<_Ty> &x)
                 : _M_node(x._M_node)
             {
             }
@@ -220,7 +229,7 @@ namespace collections
                 return *this;
             }
 
-            Self &operator++(int) noexcept
+            Self operator++(int) noexcept
             {
                 Self temp{*this};
                 _M_node = _M_node->_Next;
@@ -233,7 +242,7 @@ namespace collections
                 return *this;
             }
 
-            Self &operator--(int) noexcept
+            Self operator--(int) noexcept
             {
                 Self temp{*this};
                 _M_node = _M_node->_Prev;
@@ -247,7 +256,7 @@ namespace collections
 
             friend bool operator!=(const Self &_x, const Self &_y) noexcept
             {
-                return _x._M_node != _x._M_node;
+                return _x._M_node != _y._M_node;
             }
 
             __base::List_node_base *_M_node;
@@ -283,17 +292,17 @@ namespace collections
                 return const_cast<Self>(*this);
             }
 
-            reference operator*() noexcept
+            reference operator*() const noexcept
             {
-                return _Base::operator*();
+                return *static_cast<_Node *>(this->_M_node)->_Valptr();
             }
 
-            pointer operator->() noexcept
+            pointer operator->() const noexcept
             {
-                return _Base::operator->();
+                return static_cast<_Node *>(this->_M_node)->_Valptr();
             }
 
-            Self operator++() noexcept
+            Self &operator++() noexcept
             {
                 _Base::operator++();
                 return *this;
@@ -306,7 +315,7 @@ namespace collections
                 return temp;
             }
 
-            Self operator--() noexcept
+            Self &operator--() noexcept
             {
                 _Base::operator--();
                 return *this;
@@ -330,7 +339,27 @@ namespace collections
             }
         };
 
-        template <class _Ty, class _Alloc>
+        /**
+         * @brief Whether the node allocator lets list take n nodes from one
+         *        allocate(n) call. Allocators opt in with a member
+         *        `using bulk_node_allocation = std::true_type;`, promising that
+         *        every node of such a block may later be released on its own
+         *        with deallocate(p, 1), as pools and arenas do. std::allocator
+         *        makes no such promise.
+         */
+        template <class _Alloc, class = void>
+        struct List_bulk_allocation
+            : std::false_type
+        {
+        };
+
+        template <class _Alloc>
+        struct List_bulk_allocation<_Alloc, std::void_t<typename _Alloc::bulk_node_allocation>>
+            : _Alloc::bulk_node_allocation
+        {
+        };
+
+        template <class _Ty, class _Alloc, class _Policy = no_instrumentation>
         class List_base
         {
         protected:
@@ -339,17 +368,6 @@ namespace collections
             using node_alloc_t = typename allocator_traits::template rebind_alloc<List_node<_Ty>>;
             using node_alloc_traits = std::allocator_traits<node_alloc_t>;
 
-            static size_t _Distance(__base::List_node_base *first, __base::List_node_base *second)
-            {
-                size_t i = 0;
-                while (first != second)
-                {
-                    first = first->_Next;
-                    i++;
-                }
-                return i;
-            }
-
             struct List_impl
                 : public node_alloc_t
             {
@@ -367,7 +385,7 @@ namespace collections
                 }
 
                 List_impl(const node_alloc_t &alloc) noexcept
-                    : List_impl(alloc)
+                    : node_alloc_t(alloc)
                 {
                 }
             };
@@ -379,27 +397,25 @@ namespace collections
                 return Impl._M_node._Size;
             }
 
-            size_t _Node_count()
-            {
-                return _Distance(Impl._M_node._Next, std::addressof(Impl._M_node));
-            }
-
             typename node_alloc_traits::pointer _Get_node()
             {
-                return node_alloc_traits::allocate(Impl, 1);
+                typename node_alloc_traits::pointer ptr = node_alloc_traits::allocate(Impl, 1);
+                _Policy::on_allocate(sizeof(List_node<_Ty>));
+                return ptr;
             }
 
             void _Put_node(typename node_alloc_traits::pointer ptr) noexcept
             {
+                _Policy::on_deallocate(sizeof(List_node<_Ty>));
                 node_alloc_traits::deallocate(Impl, ptr, 1);
             }
 
             void _Clear() noexcept
             {
                 List_node_base *cur = Impl._M_node._Next;
-                while (cur != Impl._M_node)
+                while (cur != &Impl._M_node)
                 {
-                    List_node<_Ty> *temp = static_cast<List_node<_Ty>>(cur);
+                    List_node<_Ty> *temp = static_cast<List_node<_Ty> *>(cur);
                     cur = temp->_Next;
                     _Ty *val = temp->_Valptr();
                     node_alloc_traits::destroy(_Get_node_allocator(), val);
@@ -450,17 +466,147 @@ namespace collections
             {
             }
 
+            List_base(List_base &&) = default;
+
+            ~List_base() noexcept
+            {
+                _Clear();
+            }
+
             void _Init()
             {
                 this->Impl._M_node._Init();
             }
         };
+
+        /**
+         * @brief Owning handle to a node taken out of a list by extract().
+         *        The element stays in its node, so moving it to another list
+         *        with insert() allocates nothing and does not touch the value.
+         *        A handle that is never reinserted destroys and frees its node.
+         *
+         * @tparam _Ty
+         * @tparam _NodeAlloc
+         * @tparam _Policy
+         */
+        template <class _Ty, class _NodeAlloc, class _Policy>
+        class List_node_handle
+        {
+            using node_alloc_traits = std::allocator_traits<_NodeAlloc>;
+
+            template <class, class, class>
+            friend class collections::list;
+
+        public:
+            using value_type = _Ty;
+            using allocator_type = typename node_alloc_traits::template rebind_alloc<_Ty>;
+
+            constexpr List_node_handle() noexcept
+                : _Ptr(nullptr)
+            {
+            }
+
+            List_node_handle(List_node_handle &&x) noexcept
+                : _Ptr(x._Ptr), _Alloc(std::move(x._Alloc))
+            {
+                x._Ptr = nullptr;
+                x._Alloc.reset();
+            }
+
+            List_node_handle &operator=(List_node_handle &&x) noexcept
+            {
+                if (this != std::addressof(x))
+                {
+                    _Reset();
+                    _Ptr = x._Ptr;
+                    _Alloc = std::move(x._Alloc);
+                    x._Ptr = nullptr;
+                    x._Alloc.reset();
+                }
+                return *this;
+            }
+
+            List_node_handle(const List_node_handle &) = delete;
+            List_node_handle &operator=(const List_node_handle &) = delete;
+
+            ~List_node_handle()
+            {
+                _Reset();
+            }
+
+            [[nodiscard]] bool empty() const noexcept
+            {
+                return _Ptr == nullptr;
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return _Ptr != nullptr;
+            }
+
+            value_type &value() const noexcept
+            {
+                return *_Ptr->_Valptr();
+            }
+
+            allocator_type get_allocator() const
+            {
+                return allocator_type(*_Alloc);
+            }
+
+            void swap(List_node_handle &x) noexcept
+            {
+                std::swap(_Ptr, x._Ptr);
+                std::swap(_Alloc, x._Alloc);
+            }
+
+            friend void swap(List_node_handle &x, List_node_handle &y) noexcept
+            {
+                x.swap(y);
+            }
+
+        private:
+            List_node_handle(List_node<_Ty> *node, const _NodeAlloc &alloc)
+                : _Ptr(node), _Alloc(alloc)
+            {
+            }
+
+            List_node<_Ty> *_Release() noexcept
+            {
+                List_node<_Ty> *node = _Ptr;
+                _Ptr = nullptr;
+                _Alloc.reset();
+                return node;
+            }
+
+            void _Reset() noexcept
+            {
+                if (_Ptr)
+                {
+                    node_alloc_traits::destroy(*_Alloc, _Ptr->_Valptr());
+                    _Policy::on_deallocate(sizeof(List_node<_Ty>));
+                    node_alloc_traits::deallocate(*_Alloc, _Ptr, 1);
+                    _Ptr = nullptr;
+                    _Alloc.reset();
+                }
+            }
+
+            List_node<_Ty> *_Ptr;
+            std::optional<_NodeAlloc> _Alloc;
+        };
     }
 
-    template <class _Ty, class _Alloc = std::allocator<_Ty>>
-    class list : protected __base::List_base<_Ty, _Alloc>
+    /**
+     * @brief Doubly linked list.
+     *
+     * @tparam _Ty
+     * @tparam _Alloc
+     * @tparam _Policy Instrumentation hooks, see instrumentation.h
+     */
+    template <class _Ty, class _Alloc = std::allocator<_Ty>, class _Policy = no_instrumentation>
+    class list : protected __base::List_base<_Ty, _Alloc, _Policy>
     {
-        using _Base = __base::List_base<_Ty, _Alloc>;
+        using _Base = __base::List_base<_Ty, _Alloc, _Policy>;
         using alloc_t = typename _Base::alloc_t;
         using allocator_traits = typename _Base::allocator_traits;
         using node_alloc_t = typename _Base::node_alloc_t;
@@ -474,12 +620,14 @@ namespace collections
         using pointer = typename allocator_traits::pointer;
         using reference = _Ty &;
         using const_pointer = typename allocator_traits::const_pointer;
-        using const_reference = const reference;
+        using const_reference = const value_type &;
 
         using iterator = __base::List_iterator<_Ty>;
         using const_iterator = __base::List_const_iterator<_Ty>;
         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
         using reverse_iterator = std::reverse_iterator<iterator>;
+        using instrumentation_type = _Policy;
+        using node_type = __base::List_node_handle<_Ty, typename _Base::node_alloc_t, _Policy>;
 
     protected:
         using _Node = __base::List_node<_Ty>;
@@ -504,7 +652,9 @@ namespace collections
 
         static size_t _Distance(const_iterator first, const_iterator last)
         {
-            return std::distance(first, last);
+            const size_t n = std::distance(first, last);
+            _Policy::on_hop(n);
+            return n;
         }
 
         size_t _Node_count() const
@@ -548,7 +698,7 @@ namespace collections
          * @param alloc An allocator object.
          */
         explicit list(size_t n, const allocator_type &alloc = allocator_type())
-            : _Base(_node_alloc_t(alloc))
+            : _Base(node_alloc_t(alloc))
         {
             _Default_append(n);
         }
@@ -561,8 +711,8 @@ namespace collections
        *
        *  This constructor fills the list with @a n copies of @a value.
        */
-        explicit list(size_type n, value_type &&value = value_type(),
-                      const allocator_type &alloc = allocator_type())
+        list(size_type n, const value_type &value,
+             const allocator_type &alloc = allocator_type())
             : _Base(node_alloc_t(alloc))
         {
             _Fill_initialize(n, value);
@@ -578,7 +728,7 @@ namespace collections
                       const allocator_type &alloc = allocator_type())
             : _Base(node_alloc_t(alloc))
         {
-            _Fill_initialize(first, last, std::false_type());
+            _Fill_initialize(first, last);
         }
 
         /**
@@ -603,6 +753,40 @@ namespace collections
             _Fill_initialize(l.begin(), l.end());
         }
 
+        /**
+         * @brief Construct a new list with copies of the elements of @a x
+         *
+         * @param x
+         */
+        list(const list &x)
+            : _Base(node_alloc_traits::select_on_container_copy_construction(x._Get_node_allocator()))
+        {
+            _Fill_initialize(x.begin(), x.end());
+        }
+
+        list(list &&x) = default;
+
+        list &operator=(const list &x)
+        {
+            if (this != std::addressof(x))
+                assign(x.begin(), x.end());
+            return *this;
+        }
+
+        list &operator=(list &&x) noexcept
+        {
+            clear();
+            this->Impl._M_node._Move_nodes(std::move(x.Impl._M_node));
+            std::__alloc_on_move(_Get_node_allocator(), x._Get_node_allocator());
+            return *this;
+        }
+
+        list &operator=(std::initializer_list<value_type> l)
+        {
+            assign(l.begin(), l.end());
+            return *this;
+        }
+
         /**
          * @brief 
          * 
@@ -612,12 +796,12 @@ namespace collections
         void assign(size_t n, const value_type &value)
         {
             iterator it = begin();
-            while (--n && it != end())
-            {
+            for (; n && it != end(); --n, ++it)
                 *it = value;
-            }
             if (n > 0)
                 insert(end(), n, value);
+            else
+                erase(it, end());
         }
 
         /**
@@ -633,12 +817,14 @@ namespace collections
             iterator mfirst = begin();
             iterator mlast = end();
 
-            while (first != last && mfirst != mlast)
+            size_t copied = 0;
+            for (; first != last && mfirst != mlast; ++copied)
                 *mfirst++ = *first++;
+            _Policy::on_copy(copied);
             if (first == last)
                 this->erase(mfirst, mlast);
             else
-                this->insert<Input, std::_RequireInputIter<Input>>(mlast, first, last);
+                this->insert(mlast, first, last);
         }
 
         /**
@@ -670,7 +856,7 @@ namespace collections
          */
         const_reference back() const noexcept
         {
-            iterator temp = end();
+            const_iterator temp = end();
             --temp;
             return *temp;
         }
@@ -712,7 +898,7 @@ namespace collections
          */
         const_iterator cend() const noexcept
         {
-            return const_iterator(this->Impl._M_node);
+            return const_iterator(&this->Impl._M_node);
         }
 
         /**
@@ -722,7 +908,7 @@ namespace collections
          */
         const_reverse_iterator crbegin() const noexcept
         {
-            return const_reverse_iterator(begin());
+            return const_reverse_iterator(end());
         }
 
         /**
@@ -732,10 +918,14 @@ namespace collections
          */
         const_reverse_iterator crend() const noexcept
         {
-            return const_reverse_iterator(end());
+            return const_reverse_iterator(begin());
         }
 
-        void clear() const noexcept
+        /**
+         * @brief Destroys every element
+         *
+         */
+        void clear() noexcept
         {
             _Base::_Clear();
             _Base::_Init();
@@ -769,7 +959,7 @@ namespace collections
          * @return reference 
          */
         template <typename... Args>
-        reference emplace_back(Args &&...args) noexcept
+        reference emplace_back(Args &&...args)
         {
             this->_Insert(end(), std::forward<Args>(args)...);
             return back();
@@ -783,7 +973,7 @@ namespace collections
          * @return reference 
          */
         template <typename... Args>
-        reference emplace_front(Args &&...args) noexcept
+        reference emplace_front(Args &&...args)
         {
             this->_Insert(begin(), std::forward<Args>(args)...);
             return front();
@@ -826,16 +1016,59 @@ namespace collections
             return last._Const_cast();
         }
 
+        /**
+         * @brief Unlinks the element at position and hands its node over,
+         *        without destroying or moving the element.
+         * 
+         * @param position A dereferenceable iterator into the list
+         * @return node_type Owning handle to the node
+         */
+        node_type extract(const_iterator position) noexcept
+        {
+            _Node *node = static_cast<_Node *>(position._M_node);
+            node->_Unhook();
+            this->_Dec_size(1);
+            return node_type(node, _Get_node_allocator());
+        }
+
+        /**
+         * @brief Links the node owned by @a node before position. The handle
+         *        must come from a list whose allocator compares equal.
+         * 
+         * @param position 
+         * @param node Emptied on return
+         * @return iterator The inserted element, or position if @a node is empty
+         */
+        iterator insert(const_iterator position, node_type &&node) noexcept
+        {
+            if (node.empty())
+                return position._Const_cast();
+            if (std::__alloc_neq<node_alloc_t>::_S_do_it(_Get_node_allocator(), *node._Alloc))
+                __builtin_abort();
+            _Node *ptr = node._Release();
+            ptr->_Hook(position._M_node);
+            this->_Inc_size(1);
+            return iterator(ptr);
+        }
+
         /**
          * @brief Gets a reference to begin
          * 
          * @return reference 
          */
-        reference front()
+        reference front() noexcept
         {
-            iterator temp = begin();
-            temp++;
-            return *temp;
+            return *begin();
+        }
+
+        /**
+         * @brief Gets a constant reference to begin
+         * 
+         * @return const_reference 
+         */
+        const_reference front() const noexcept
+        {
+            return *begin();
         }
 
         /**
@@ -857,9 +1090,38 @@ namespace collections
          */
         iterator insert(const_iterator position, value_type &&value)
         {
+            _Policy::on_move(1);
             return this->emplace(position, std::move(value));
         }
 
+        /**
+         * @brief  Inserts a copy of given value into list before specified iterator
+         * 
+         * @param position Position to insert value
+         * @param value Value to insert
+         * @return iterator 
+         */
+        iterator insert(const_iterator position, const value_type &value)
+        {
+            _Policy::on_copy(1);
+            return this->emplace(position, value);
+        }
+
+        /**
+         * @brief Constructs an object in place before specified iterator
+         * 
+         * @tparam Args 
+         * @param position Position to insert value
+         * @param args Arguments forwarded to the constructor
+         * @return iterator Pointing to the new element
+         */
+        template <typename... Args>
+        iterator emplace(const_iterator position, Args &&...args)
+        {
+            this->_Insert(position._Const_cast(), std::forward<Args>(args)...);
+            return iterator(position._M_node->_Prev);
+        }
+
         /**
          * @brief Inserts a range into the list.
          * 
@@ -873,14 +1135,33 @@ namespace collections
         template <class Input, typename = std::_RequireInputIter<Input>>
         iterator insert(const_iterator position, Input first, Input last)
         {
-            list temp(first, last, get_allocator());
-            if (!temp.empty())
+            if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                            typename std::iterator_traits<Input>::iterator_category>)
             {
-                iterator it = temp.begin();
-                this->splice(position, std::move(temp));
-                return it;
+                const size_type n = std::distance(first, last);
+                _Policy::on_copy(n);
+                return _Insert_nodes(position, n, [this, &first](_Node *node)
+                                     {
+                                         node_alloc_traits::construct(_Get_node_allocator(), node->_Valptr(), *first);
+                                         ++first; });
+            }
+            else
+            {
+                __base::List_node_header chain;
+                size_type n = 0;
+                try
+                {
+                    for (; first != last; ++first, ++n)
+                        _Create_node(*first)->_Hook(&chain);
+                }
+                catch (...)
+                {
+                    _Free_chain(chain);
+                    throw;
+                }
+                _Policy::on_copy(n);
+                return _Link_chain(position, chain, n);
             }
-            return position._Const_cast();
         }
 
         /**
@@ -905,16 +1186,11 @@ namespace collections
          * @return An iterator pointing to the first element inserted
          *         (or position).
          */
-        iterator insert(const_iterator position, size_type n, const value_type &value) noexcept
+        iterator insert(const_iterator position, size_type n, const value_type &value)
         {
-            if (n)
-            {
-                list temp(n, value, get_allocator());
-                iterator it = temp.begin();
-                splice(position, it);
-                return it;
-            }
-            return position._Const_cast();
+            _Policy::on_copy(n);
+            return _Insert_nodes(position, n, [this, &value](_Node *node)
+                                 { node_alloc_traits::construct(_Get_node_allocator(), node->_Valptr(), value); });
         }
 
         /**
@@ -922,7 +1198,7 @@ namespace collections
          * 
          * @return size_type 
          */
-        size_type max_size() noexcept
+        size_type max_size() const noexcept
         {
             return node_alloc_traits::max_size(_Get_node_allocator());
         }
@@ -941,6 +1217,7 @@ namespace collections
                 iterator first2 = x.begin();
                 iterator last2 = x.end();
                 const size_t orig_size = x.size();
+                size_t moved = 0;
                 try
                 {
                     while (first1 != last1 && first2 != last2)
@@ -949,6 +1226,7 @@ namespace collections
                             iterator next = first2;
                             _Transfer(first1, first2, ++next);
                             first2 = next;
+                            ++moved;
                         }
                         else
                             ++first1;
@@ -960,9 +1238,9 @@ namespace collections
                 }
                 catch (...)
                 {
-                    const size_t dist = std::distance(first2, first1);
-                    this->_Inc_size(orig_size - dist);
-                    x._Set_size(dist);
+                    // only the comparison throws, before the tail transfer
+                    this->_Inc_size(moved);
+                    x._Set_size(orig_size - moved);
                     throw;
                 }
             }
@@ -995,6 +1273,7 @@ namespace collections
                 iterator first2 = x.begin();
                 iterator last2 = x.end();
                 const size_t orig_size = x.size();
+                size_t moved = 0;
                 try
                 {
                     while (first1 != last1 && first2 != last2)
@@ -1003,6 +1282,7 @@ namespace collections
                             iterator next = first2;
                             _Transfer(first1, first2, ++next);
                             first2 = next;
+                            ++moved;
                         }
                         else
                             ++first1;
@@ -1014,9 +1294,9 @@ namespace collections
                 }
                 catch (...)
                 {
-                    const size_t dist = std::distance(first2, first1);
-                    this->_Inc_size(orig_size - dist);
-                    x._Set_size(dist);
+                    // only the comparison throws, before the tail transfer
+                    this->_Inc_size(moved);
+                    x._Set_size(orig_size - moved);
                     throw;
                 }
             }
@@ -1058,19 +1338,63 @@ namespace collections
          * 
          * @param value 
          */
-        void push_back(value_type &&value) noexcept
+        void push_back(value_type &&value)
         {
+            _Policy::on_move(1);
             this->_Insert(end(), std::move(value));
         }
 
+        /**
+         * @brief Inserts a copy of value in the end of list
+         * 
+         * @param value 
+         */
+        void push_back(const value_type &value)
+        {
+            _Policy::on_copy(1);
+            this->_Insert(end(), value);
+        }
+
+        /**
+         * @brief Inserts a new value in the begin of list
+         * 
+         * @param value 
+         */
+        void push_front(value_type &&value)
+        {
+            _Policy::on_move(1);
+            this->_Insert(begin(), std::move(value));
+        }
+
+        /**
+         * @brief Inserts a copy of value in the begin of list
+         * 
+         * @param value 
+         */
+        void push_front(const value_type &value)
+        {
+            _Policy::on_copy(1);
+            this->_Insert(begin(), value);
+        }
+
         /**
          * @brief Gets a reverse iterator to list
          * 
          * @return reverse_iterator 
          */
-        reverse_iterator rbegin() const noexcept
+        reverse_iterator rbegin() noexcept
         {
-            return reverse_iterator(begin());
+            return reverse_iterator(end());
+        }
+
+        /**
+         * @brief Gets a constant reverse iterator to list
+         * 
+         * @return const_reverse_iterator 
+         */
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
         }
 
         /**
@@ -1078,75 +1402,89 @@ namespace collections
          * 
          * @return reverse_iterator 
          */
-        reverse_iterator rend()
+        reverse_iterator rend() noexcept
         {
-            return reverse_iterator(end());
+            return reverse_iterator(begin());
+        }
+
+        /**
+         * @brief Gets a constant reverse iterator to list
+         * 
+         * @return const_reverse_iterator 
+         */
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
         }
 
         /**
          * @brief Removes every element in the list equal to @a value.
-         *        Remaining elements stay in list order.
+         *        Remaining elements stay in list order. @a value may refer to
+         *        an element of the list: nothing is destroyed until the scan
+         *        is over.
          * 
          * @param value 
          * @return size_type 
          */
-        size_type remove(const value_type &value) noexcept
+        size_type remove(const value_type &value)
         {
-            size_type removed = 0;
-            iterator first = begin();
-            iterator last = end();
-            iterator extra = last;
+            return remove_if([&value](const value_type &x)
+                             { return x == value; });
+        }
 
-            while (first != last)
+        /**
+         * @brief Removes every element in the list for which the predicate
+         *        returns true. Matching nodes are unlinked run by run into a
+         *        detached chain, which is destroyed and freed once the scan
+         *        is over.
+         * 
+         * @tparam Predicate 
+         * @param pred 
+         * @return size_type 
+         */
+        template <class Predicate>
+        size_type remove_if(Predicate pred)
+        {
+            __base::List_node_header chain;
+            size_type removed = 0;
+            try
             {
-                iterator next = first;
-                ++next;
-                if (*next = value)
-                {
-                    if (std::addressof(first) != std::addressof(value))
-                    // check if the value found is the base value
-                    {
-                        _Erase(first);
-                        removed++;
-                    }
-                    else
-                        extra = first;
-                }
-                first = next;
+                removed = _Extract_if(chain, pred);
             }
-            if (extra != last)
+            catch (...)
             {
-                _Erase(extra);
-                removed++;
+                _Free_chain(chain);
+                throw;
             }
+            _Free_chain(chain);
             return removed;
         }
 
         /**
-         * @brief Removes every element in the list for which the predicate
-         *        returns true
+         * @brief Moves every element for which the predicate returns true
+         *        into a new list, without destroying or reallocating them, so
+         *        the nodes can be reused or released later.
          * 
          * @tparam Predicate 
          * @param pred 
-         * @return size_type 
+         * @return list The removed elements, in their former order
          */
         template <class Predicate>
-        size_type remove_if(Predicate pred) noexcept
+        list erase_if(Predicate pred)
         {
-            size_type removed = 0;
-            iterator first = begin();
-            iterator last = end();
-            while (first != last)
+            list removed(get_allocator());
+            __base::List_node_header chain;
+            size_type n = 0;
+            try
             {
-                iterator next = first;
-                ++next;
-                if (pred(*first))
-                {
-                    _Erase(first);
-                    removed++;
-                }
-                first = next;
+                n = _Extract_if(chain, pred);
             }
+            catch (...)
+            {
+                _Free_chain(chain);
+                throw;
+            }
+            removed._Link_chain(removed.cend(), chain, n);
             return removed;
         }
 
@@ -1155,7 +1493,7 @@ namespace collections
          * 
          * @param new_size 
          */
-        void resize(size_type new_size) noexcept
+        void resize(size_type new_size)
         {
             const_iterator it = this->_Resine_pos(new_size);
 
@@ -1171,9 +1509,9 @@ namespace collections
          * @param new_size 
          * @param value 
          */
-        void resize(size_type new_size, const value_type &value) noexcept
+        void resize(size_type new_size, const value_type &value)
         {
-            const_iterator it = this->_Resize_pos(new_size);
+            const_iterator it = this->_Resine_pos(new_size);
             if (new_size)
                 insert(end(), new_size, value);
             else
@@ -1185,7 +1523,7 @@ namespace collections
          *
          *  Reverse the order of elements in the list in linear time.
          */
-        void reverse() const noexcept
+        void reverse() noexcept
         {
             this->Impl._M_node._Reverse();
         }
@@ -1195,7 +1533,7 @@ namespace collections
          * 
          * @return size_type 
          */
-        size_type size()
+        size_type size() const noexcept
         {
             return this->_Get_size();
         }
@@ -1275,11 +1613,15 @@ namespace collections
             if (first != last)
             {
                 if (this != std::addressof(l))
+                {
                     _Compare_allocators(l);
 
-                size_t n = _Distance(first, last);
-                this->_Inc_size(n);
-                l._Dec_size(n);
+                    // counting is only needed when nodes change owner, and
+                    // not at all for the whole of l
+                    const size_t n = first == l.cbegin() && last == l.cend() ? l._Get_size() : _Distance(first, last);
+                    this->_Inc_size(n);
+                    l._Dec_size(n);
+                }
 
                 this->_Transfer(position._Const_cast(), first._Const_cast(), last._Const_cast());
             }
@@ -1302,7 +1644,7 @@ namespace collections
          * @brief Sorts the elements of this list. Equivalent elements remain in list order.
          * 
          */
-        void sort() noexcept
+        void sort()
         {
             if (this->Impl._M_node._Next != &this->Impl._M_node && this->Impl._M_node._Next->_Next != &this->Impl._M_node)
             {
@@ -1334,7 +1676,7 @@ namespace collections
                 catch (...)
                 {
                     this->splice(this->end(), carry);
-                    for (int i = 0; i < sizeof(temp) / sizeof(temp[0]); ++i)
+                    for (size_t i = 0; i < sizeof(temp) / sizeof(temp[0]); ++i)
                         this->splice(this->end(), temp[i]);
                     __throw_exception_again;
                 }
@@ -1346,7 +1688,7 @@ namespace collections
          * 
          */
         template <class Input>
-        void sort(Input comp) noexcept
+        void sort(Input comp)
         {
             if (this->Impl._M_node._Next != &this->Impl._M_node && this->Impl._M_node._Next->_Next != &this->Impl._M_node)
             {
@@ -1378,7 +1720,7 @@ namespace collections
                 catch (...)
                 {
                     this->splice(this->end(), carry);
-                    for (int i = 0; i < sizeof(temp) / sizeof(temp[0]); ++i)
+                    for (size_t i = 0; i < sizeof(temp) / sizeof(temp[0]); ++i)
                         this->splice(this->end(), temp[i]);
                     __throw_exception_again;
                 }
@@ -1406,27 +1748,21 @@ namespace collections
          * 
          * @return size_type 
          */
-        size_type unique() noexcept
+        size_type unique()
         {
-            iterator first = begin();
-            iterator last = end();
-
-            if (first == last)
-                return 0;
-
+            __base::List_node_header chain;
             size_type removed = 0;
-            iterator next = first;
-            while (++next != last)
+            try
             {
-                if (*first == *next)
-                {
-                    _Erase(next);
-                    removed++;
-                }
-                else
-                    first = next;
-                next = first;
+                removed = _Extract_duplicates(chain, [&](const value_type &x, const value_type &y)
+                                              { return x == y; });
+            }
+            catch (...)
+            {
+                _Free_chain(chain);
+                throw;
             }
+            _Free_chain(chain);
             return removed;
         }
 
@@ -1438,27 +1774,21 @@ namespace collections
          * @return size_type 
          */
         template <class Input>
-        size_type unique(Input bin) noexcept
+        size_type unique(Input bin)
         {
-            iterator first = begin();
-            iterator last = end();
-
-            if (first != last)
-                return 0;
-
+            __base::List_node_header chain;
             size_type removed = 0;
-            iterator next = first;
-            while (next != last)
+            try
             {
-                if (bin(*first, *next))
-                {
-                    _Erase(next);
-                    removed++;
-                }
-                else
-                    first = next;
-                next = first;
+                removed = _Extract_duplicates(chain, [&](const value_type &x, const value_type &y)
+                                              { return bin(x, y); });
             }
+            catch (...)
+            {
+                _Free_chain(chain);
+                throw;
+            }
+            _Free_chain(chain);
             return removed;
         }
 
@@ -1472,10 +1802,166 @@ namespace collections
 
         void _Default_append(size_type size)
         {
-            while (size--)
+            _Insert_nodes(cend(), size, [this](_Node *node)
+                          { node_alloc_traits::construct(_Get_node_allocator(), node->_Valptr()); });
+        }
+
+        /**
+         * @brief Creates n nodes, builds each value with construct(node) and
+         *        links them before position in one pass. Nodes come from a
+         *        single allocate(n) when the allocator opts into
+         *        bulk_node_allocation, otherwise from one call each.
+         *
+         * @return iterator The first inserted node, or position if n is 0
+         */
+        template <typename _Construct>
+        iterator _Insert_nodes(const_iterator position, size_type n, _Construct construct)
+        {
+            if (!n)
+                return position._Const_cast();
+
+            __base::List_node_header chain;
+            if constexpr (__base::List_bulk_allocation<node_alloc_t>::value)
+            {
+                _Node *block = node_alloc_traits::allocate(Impl, n);
+                _Policy::on_allocate(n * sizeof(_Node));
+                size_type built = 0;
+                try
+                {
+                    for (; built < n; ++built)
+                    {
+                        construct(block + built);
+                        block[built]._Hook(&chain);
+                    }
+                }
+                catch (...)
+                {
+                    for (size_type i = 0; i < built; ++i)
+                        node_alloc_traits::destroy(_Get_node_allocator(), block[i]._Valptr());
+                    _Policy::on_deallocate(n * sizeof(_Node));
+                    node_alloc_traits::deallocate(Impl, block, n);
+                    throw;
+                }
+            }
+            else
+            {
+                try
+                {
+                    for (size_type i = 0; i < n; ++i)
+                    {
+                        _Node *node = this->_Get_node();
+                        std::__allocated_ptr<node_alloc_t> guard{_Get_node_allocator(), node};
+                        construct(node);
+                        guard = nullptr;
+                        node->_Hook(&chain);
+                    }
+                }
+                catch (...)
+                {
+                    _Free_chain(chain);
+                    throw;
+                }
+            }
+            return _Link_chain(position, chain, n);
+        }
+
+        /**
+         * @brief Moves the n nodes of a detached chain before position
+         */
+        iterator _Link_chain(const_iterator position, __base::List_node_header &chain, size_type n) noexcept
+        {
+            if (!n)
+                return position._Const_cast();
+            iterator first(chain._Next);
+            position._M_node->_Transfer(chain._Next, &chain);
+            this->_Inc_size(n);
+            return first;
+        }
+
+        /**
+         * @brief Moves the elements matching pred onto the end of chain, one
+         *        transfer per run of adjacent matches
+         *
+         * @return size_type Number of nodes moved
+         */
+        template <class _Predicate>
+        size_type _Extract_if(__base::List_node_header &chain, _Predicate &pred)
+        {
+            size_type moved = 0;
+            iterator first = begin();
+            const iterator last = end();
+            while (first != last)
+            {
+                if (!pred(*first))
+                {
+                    ++first;
+                    continue;
+                }
+                iterator run_end = first;
+                size_type run = 0;
+                do
+                {
+                    ++run_end;
+                    ++run;
+                } while (run_end != last && pred(*run_end));
+                chain._Transfer(first._M_node, run_end._M_node);
+                this->_Dec_size(run);
+                moved += run;
+                first = run_end;
+            }
+            return moved;
+        }
+
+        /**
+         * @brief Moves every element equal, by eq, to the element before it
+         *        onto the end of chain
+         *
+         * @return size_type Number of nodes moved
+         */
+        template <class _Equal>
+        size_type _Extract_duplicates(__base::List_node_header &chain, _Equal eq)
+        {
+            size_type moved = 0;
+            iterator first = begin();
+            const iterator last = end();
+            if (first == last)
+                return 0;
+            iterator next = first;
+            while (++next != last)
+            {
+                if (!eq(*first, *next))
+                {
+                    first = next;
+                    continue;
+                }
+                iterator run_end = next;
+                size_type run = 0;
+                do
+                {
+                    ++run_end;
+                    ++run;
+                } while (run_end != last && eq(*first, *run_end));
+                chain._Transfer(next._M_node, run_end._M_node);
+                this->_Dec_size(run);
+                moved += run;
+                if (run_end == last)
+                    break;
+                first = next = run_end;
+            }
+            return moved;
+        }
+
+        void _Free_chain(__base::List_node_header &chain) noexcept
+        {
+            __base::List_node_base *cur = chain._Next;
+            while (cur != &chain)
             {
-                emplace_back();
+                _Node *node = static_cast<_Node *>(cur);
+                cur = cur->_Next;
+                node_alloc_traits::destroy(_Get_node_allocator(), node->_Valptr());
+                this->_Put_node(node);
             }
+            chain._Init();
         }
 
         void _Erase(const_iterator position)
@@ -1487,11 +1973,15 @@ namespace collections
             this->_Put_node(node);
         }
 
-        template <typename Input>
+        template <typename Input, typename = std::_RequireInputIter<Input>>
         void _Fill_initialize(Input first, Input last)
         {
-            for (; first != last; first++)
-                emplace_back(*first);
+            insert(cend(), first, last);
+        }
+
+        void _Fill_initialize(size_type n, const value_type &value)
+        {
+            insert(cend(), n, value);
         }
 
         template <typename... Args>
@@ -1507,7 +1997,7 @@ namespace collections
             position._M_node->_Transfer(first._M_node, end._M_node);
         }
 
-        iterator _Resine_pos(size_type &new_size) const
+        const_iterator _Resine_pos(size_type &new_size) const
         {
             const_iterator ret;
             const size_type len = this->_Get_size();
@@ -1517,12 +2007,14 @@ namespace collections
                 {
                     ret = begin();
                     std::advance(ret, new_size);
+                    _Policy::on_hop(new_size);
                 }
                 else
                 {
                     ret = end();
                     difference_type num_erase = len - new_size;
                     std::advance(ret, -num_erase);
+                    _Policy::on_hop(num_erase);
                 }
                 new_size = 0;
                 return ret;
@@ -1535,54 +2027,77 @@ namespace collections
         }
     };
 
-    template <class _Ty, class _Alloc>
-    inline bool operator==(list<_Ty, _Alloc> &l1, list<_Ty, _Alloc> &l2)
+    namespace __base
+    {
+        /**
+         * @brief Element types whose equality is equality of their bytes, so
+         *        nodes can be compared with memcmp, which the compiler lowers
+         *        to a few wide loads per node. Only integers and pointers:
+         *        classes and enums may overload == to look at less than all
+         *        of their bytes, and floating point has -0.0 and NaN.
+         */
+        template <class _Ty>
+        constexpr bool _List_bitwise_equal = (std::is_integral_v<_Ty> || std::is_pointer_v<_Ty>) &&
+                                             std::has_unique_object_representations_v<_Ty>;
+    }
+
+    template <class _Ty, class _Alloc, class _Policy>
+    inline bool operator==(const list<_Ty, _Alloc, _Policy> &l1, const list<_Ty, _Alloc, _Policy> &l2)
     {
-        using list = list<_Ty, _Alloc>;
-        using const_iterator =  typename list::const_iterator;
-        // check size
+        using list = list<_Ty, _Alloc, _Policy>;
+        using const_iterator = typename list::const_iterator;
+        // size is O(1), so lists of different length never get walked
         if (l1.size() != l2.size())
             return false;
+        if (std::addressof(l1) == std::addressof(l2))
+            return true;
 
-        // check content
         const_iterator it1 = l1.begin();
         const_iterator it2 = l2.begin();
-        const_iterator last1 = l1.end();
-        const_iterator last2 = l2.end();
+        const const_iterator last1 = l1.end();
 
-        for (; it1 != last1 && it2 != last2; ++it1, ++it2)
-            ;
-
-        return it1 == last1 && it2 == last2;
+        if constexpr (__base::_List_bitwise_equal<_Ty>)
+        {
+            for (; it1 != last1; ++it1, ++it2)
+                if (__builtin_memcmp(std::addressof(*it1), std::addressof(*it2), sizeof(_Ty)) != 0)
+                    return false;
+        }
+        else
+        {
+            for (; it1 != last1; ++it1, ++it2)
+                if (!(*it1 == *it2))
+                    return false;
+        }
+        return true;
     }
 
-    template <typename _Ty, typename _Alloc>
-    inline bool operator<(const list<_Ty, _Alloc> &x, const list<_Ty, _Alloc> &y)
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator<(const list<_Ty, _Alloc, _Policy> &x, const list<_Ty, _Alloc, _Policy> &y)
     {
         return std::lexicographical_compare(x.begin(), x.end(),
                                             y.begin(), y.end());
     }
 
-    template <typename _Ty, typename _Alloc>
-    inline bool operator>(const list<_Ty, _Alloc> &x, const list<_Ty, _Alloc> &y)
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator>(const list<_Ty, _Alloc, _Policy> &x, const list<_Ty, _Alloc, _Policy> &y)
     {
         return y < x;
     }
 
-    template <typename _Ty, typename _Alloc>
-    inline bool operator!=(const list<_Ty, _Alloc> &x, const list<_Ty, _Alloc> &y)
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator!=(const list<_Ty, _Alloc, _Policy> &x, const list<_Ty, _Alloc, _Policy> &y)
     {
         return !(x == y);
     }
 
-    template <typename _Ty, typename _Alloc>
-    inline bool operator<=(const list<_Ty, _Alloc> &x, const list<_Ty, _Alloc> &y)
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator<=(const list<_Ty, _Alloc, _Policy> &x, const list<_Ty, _Alloc, _Policy> &y)
     {
         return !(y < x);
     }
 
-    template <typename _Ty, typename _Alloc>
-    inline bool operator>=(const list<_Ty, _Alloc> &x, const list<_Ty, _Alloc> &y)
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator>=(const list<_Ty, _Alloc, _Policy> &x, const list<_Ty, _Alloc, _Policy> &y)
     {
         return !(x > y);
     }
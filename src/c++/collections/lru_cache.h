@@ -0,0 +1,921 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <utility>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+#include "list.h"
+#include "vector.h"
+
+namespace collections
+{
+    /**
+     * @brief Default weigher of the caches: every entry costs 1, so the
+     *        capacity is a number of entries. A weigher returning e.g. the
+     *        payload size in bytes turns it into a byte budget.
+     */
+    struct cache_unit_weight
+    {
+        template <class _Key, class _Ty>
+        size_t operator()(const _Key &, const _Ty &) const noexcept
+        {
+            return 1;
+        }
+    };
+
+    namespace __base
+    {
+        /**
+         * @brief Murmur3 finalizer. Every output bit depends on every input
+         *        bit, so disjoint bit ranges of the result can pick a shard and
+         *        a slot inside it without one choice narrowing the other.
+         */
+        inline uint64_t _Cache_mix(uint64_t h) noexcept
+        {
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 33;
+            h *= 0xC4CEB9FE1A85EC53ull;
+            h ^= h >> 33;
+            return h;
+        }
+
+        /**
+         * @brief Open addressing index from a key hash to a list iterator.
+         *        Linear probing with backward shift deletion, so there are no
+         *        tombstones and lookups never slow down under churn. Keys are
+         *        not stored: a probe matches on the saved hash first and only
+         *        then asks the caller to compare the entry.
+         *
+         * @tparam _Ref
+         */
+        template <class _Ref>
+        class Cache_index
+        {
+            struct Slot
+            {
+                size_t _Hash; // 0 marks an empty slot
+                _Ref _Target;
+            };
+
+        public:
+            static constexpr size_t npos = size_t(-1);
+
+            Cache_index()
+                : _Slots(16, Slot{0, _Ref()}), _Count(0), _Shift(64 - 4)
+            {
+            }
+
+            static size_t _Tag(size_t hash) noexcept
+            {
+                return hash | 1;
+            }
+
+            template <class _Match>
+            size_t _Find(size_t tag, _Match match) const
+            {
+                const size_t mask = _Slots.size() - 1;
+                for (size_t i = _Home(tag);; i = (i + 1) & mask)
+                {
+                    const Slot &slot = _Slots[i];
+                    if (slot._Hash == 0)
+                        return npos;
+                    if (slot._Hash == tag && match(slot._Target))
+                        return i;
+                }
+            }
+
+            void _Insert(size_t tag, _Ref ref)
+            {
+                if ((_Count + 1) * 4 > _Slots.size() * 3)
+                    _Grow();
+                _Place(tag, ref);
+                ++_Count;
+            }
+
+            void _Erase(size_t i) noexcept
+            {
+                const size_t mask = _Slots.size() - 1;
+                for (size_t j = (i + 1) & mask; _Slots[j]._Hash != 0; j = (j + 1) & mask)
+                {
+                    const size_t home = _Home(_Slots[j]._Hash);
+                    if (((j - home) & mask) >= ((j - i) & mask))
+                    {
+                        _Slots[i] = _Slots[j];
+                        i = j;
+                    }
+                }
+                _Slots[i]._Hash = 0;
+                --_Count;
+            }
+
+            _Ref &_At(size_t i) noexcept
+            {
+                return _Slots[i]._Target;
+            }
+
+            const _Ref &_At(size_t i) const noexcept
+            {
+                return _Slots[i]._Target;
+            }
+
+            void _Clear() noexcept
+            {
+                for (Slot &slot : _Slots)
+                    slot._Hash = 0;
+                _Count = 0;
+            }
+
+        private:
+            size_t _Home(size_t tag) const noexcept
+            {
+                // high bits of the mixed tag; sharded_cache uses the low ones
+                return size_t(_Cache_mix(tag) >> _Shift);
+            }
+
+            void _Place(size_t tag, _Ref ref) noexcept
+            {
+                const size_t mask = _Slots.size() - 1;
+                size_t i = _Home(tag);
+                while (_Slots[i]._Hash != 0)
+                    i = (i + 1) & mask;
+                _Slots[i] = Slot{tag, ref};
+            }
+
+            void _Grow()
+            {
+                vector<Slot> old(_Slots.size() * 2, Slot{0, _Ref()});
+                old.swap(_Slots);
+                --_Shift;
+                for (const Slot &slot : old)
+                    if (slot._Hash != 0)
+                        _Place(slot._Hash, slot._Target);
+            }
+
+            vector<Slot> _Slots;
+            size_t _Count;
+            unsigned _Shift;
+        };
+
+        template <class _Key, class _Ty>
+        struct Cache_entry
+        {
+            template <class _K, class... _Args>
+            Cache_entry(size_t tag, size_t charge, _K &&key, _Args &&...args)
+                : _Value(std::piecewise_construct, std::forward_as_tuple(std::forward<_K>(key)),
+                         std::forward_as_tuple(std::forward<_Args>(args)...)),
+                  _Tag(tag), _Charge(charge)
+            {
+            }
+
+            std::pair<const _Key, _Ty> _Value;
+            size_t _Tag;
+            size_t _Charge;
+        };
+
+        /**
+         * @brief State shared by lru_cache and lfu_cache: hashing, weighing,
+         *        the budget and the eviction callback.
+         */
+        template <class _Key, class _Ty, class _Hash, class _Eq, class _Weigher, class _Ref>
+        class Cache_base
+        {
+        public:
+            using eviction_callback = std::function<void(const _Key &, _Ty &)>;
+
+        protected:
+            Cache_base(size_t capacity, const _Weigher &weigher, const _Hash &hash, const _Eq &eq)
+                : _Hasher(hash), _Equal(eq), _Weigh(weigher), _Capacity(capacity), _Weight(0)
+            {
+            }
+
+            size_t _Tag_of(const _Key &key) const
+            {
+                return Cache_index<_Ref>::_Tag(_Hasher(key));
+            }
+
+            size_t _Lookup(const _Key &key, size_t tag) const
+            {
+                return _Index._Find(tag, [this, &key](const _Ref &ref)
+                                    { return _Equal(ref->_Value.first, key); });
+            }
+
+            void _Unindex(_Ref ref) noexcept
+            {
+                _Index._Erase(_Index._Find(ref->_Tag, [ref](const _Ref &x)
+                                           { return x == ref; }));
+                _Weight -= ref->_Charge;
+            }
+
+            void _Notify(_Ref ref)
+            {
+                if (_On_evict)
+                    _On_evict(ref->_Value.first, ref->_Value.second);
+            }
+
+            _Hash _Hasher;
+            _Eq _Equal;
+            _Weigher _Weigh;
+            size_t _Capacity;
+            size_t _Weight;
+            eviction_callback _On_evict;
+            Cache_index<_Ref> _Index;
+        };
+    }
+
+    /**
+     * @brief Least recently used cache. Entries live in a collections::list
+     *        kept in recency order (most recent first); a hit splices its
+     *        node to the front, so get and put are O(1) and never move the
+     *        key or the value. Lookups go through an open addressing index
+     *        of list iterators.
+     *
+     *        The capacity is in units of _Weigher: entries by default, bytes
+     *        with a byte-counting weigher. The callback set by on_evict() is
+     *        called for every entry dropped to make room, before it is
+     *        destroyed.
+     *
+     * @tparam _Key
+     * @tparam _Ty
+     * @tparam _Hash
+     * @tparam _Eq
+     * @tparam _Weigher Callable (key, value) -> size_t
+     * @tparam _Alloc
+     */
+    template <class _Key, class _Ty, class _Hash = std::hash<_Key>, class _Eq = std::equal_to<_Key>,
+              class _Weigher = cache_unit_weight, class _Alloc = std::allocator<std::pair<const _Key, _Ty>>>
+    class lru_cache
+        : public __base::Cache_base<_Key, _Ty, _Hash, _Eq, _Weigher,
+                                    __base::List_iterator<__base::Cache_entry<_Key, _Ty>>>
+    {
+        using _Entry = __base::Cache_entry<_Key, _Ty>;
+        using _List = list<_Entry, typename std::allocator_traits<_Alloc>::template rebind_alloc<_Entry>>;
+        using _Iter = typename _List::iterator;
+        using _Base = __base::Cache_base<_Key, _Ty, _Hash, _Eq, _Weigher, _Iter>;
+
+    public:
+        using key_type = _Key;
+        using mapped_type = _Ty;
+        using value_type = std::pair<const _Key, _Ty>;
+        using size_type = size_t;
+        using hasher = _Hash;
+        using key_equal = _Eq;
+        using weigher_type = _Weigher;
+        using allocator_type = _Alloc;
+        using eviction_callback = typename _Base::eviction_callback;
+
+        /**
+         * @brief Construct an empty cache
+         *
+         * @param capacity Budget in units of the weigher
+         */
+        explicit lru_cache(size_type capacity, const _Weigher &weigher = _Weigher(), const _Hash &hash = _Hash(),
+                           const _Eq &eq = _Eq(), const _Alloc &alloc = _Alloc())
+            : _Base(capacity, weigher, hash, eq), _Entries(typename _List::allocator_type(alloc))
+        {
+        }
+
+        lru_cache(const lru_cache &) = delete;
+        lru_cache &operator=(const lru_cache &) = delete;
+
+        void on_evict(eviction_callback fn)
+        {
+            this->_On_evict = std::move(fn);
+        }
+
+        /**
+         * @brief Looks up @a key and marks it most recently used
+         *
+         * @return _Ty* The cached value, or nullptr on a miss
+         */
+        _Ty *get(const _Key &key)
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            if (slot == this->_Index.npos)
+                return nullptr;
+            _Iter it = this->_Index._At(slot);
+            if (it != _Entries.begin())
+                _Entries.splice(_Entries.cbegin(), _Entries, it);
+            return std::addressof(it->_Value.second);
+        }
+
+        /**
+         * @brief Looks up @a key without touching the recency order
+         *
+         * @return _Ty* The cached value, or nullptr on a miss
+         */
+        _Ty *peek(const _Key &key)
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            return slot == this->_Index.npos ? nullptr : std::addressof(this->_Index._At(slot)->_Value.second);
+        }
+
+        const _Ty *peek(const _Key &key) const
+        {
+            return const_cast<lru_cache *>(this)->peek(key);
+        }
+
+        bool contains(const _Key &key) const
+        {
+            return this->_Lookup(key, this->_Tag_of(key)) != this->_Index.npos;
+        }
+
+        /**
+         * @brief Inserts or replaces the value of @a key as the most recently
+         *        used entry, evicting from the cold end until it fits.
+         *
+         * @param key
+         * @param args Constructor arguments of the value
+         * @return true When stored; false when the entry alone exceeds the
+         *         capacity, in which case any previous value of key is gone
+         */
+        template <class... _Args>
+        bool put(const _Key &key, _Args &&...args)
+        {
+            const size_t tag = this->_Tag_of(key);
+            const size_t slot = this->_Lookup(key, tag);
+            if (slot != this->_Index.npos)
+                _Drop(this->_Index._At(slot));
+
+            _Entries.emplace(_Entries.cbegin(), tag, 0, key, std::forward<_Args>(args)...);
+            _Iter it = _Entries.begin();
+            it->_Charge = this->_Weigh(it->_Value.first, it->_Value.second);
+            if (it->_Charge > this->_Capacity)
+            {
+                _Entries.erase(it);
+                return false;
+            }
+            _Evict(this->_Capacity - it->_Charge, 1);
+            try
+            {
+                this->_Index._Insert(tag, it);
+            }
+            catch (...)
+            {
+                _Entries.erase(it);
+                throw;
+            }
+            this->_Weight += it->_Charge;
+            return true;
+        }
+
+        /**
+         * @brief Removes @a key without calling the eviction callback
+         *
+         * @return true When the key was cached
+         */
+        bool erase(const _Key &key)
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            if (slot == this->_Index.npos)
+                return false;
+            _Drop(this->_Index._At(slot));
+            return true;
+        }
+
+        void clear() noexcept
+        {
+            this->_Index._Clear();
+            _Entries.clear();
+            this->_Weight = 0;
+        }
+
+        /**
+         * @brief Changes the budget, evicting cold entries that no longer fit
+         *
+         * @param capacity
+         */
+        void set_capacity(size_type capacity)
+        {
+            this->_Capacity = capacity;
+            _Evict(capacity, 0);
+        }
+
+        size_type size() const noexcept
+        {
+            return _Entries.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return _Entries.empty();
+        }
+
+        size_type weight() const noexcept
+        {
+            return this->_Weight;
+        }
+
+        size_type capacity() const noexcept
+        {
+            return this->_Capacity;
+        }
+
+        /**
+         * @brief Calls fn(key, value) from the most to the least recently used
+         *
+         * @tparam _Fn
+         * @param fn
+         */
+        template <class _Fn>
+        void for_each(_Fn fn) const
+        {
+            for (const _Entry &entry : _Entries)
+                fn(entry._Value.first, entry._Value.second);
+        }
+
+    private:
+        void _Drop(_Iter it)
+        {
+            this->_Unindex(it);
+            _Entries.erase(it);
+        }
+
+        /**
+         * @brief Evicts from the back until the weight is at most @a budget;
+         *        the first @a keep entries (fresh ones) are never victims.
+         */
+        void _Evict(size_t budget, size_t keep)
+        {
+            while (this->_Weight > budget && _Entries.size() > keep)
+            {
+                _Iter victim = std::prev(_Entries.end());
+                this->_Notify(victim);
+                _Drop(victim);
+            }
+        }
+
+        _List _Entries;
+    };
+
+    namespace __base
+    {
+        template <class _Key, class _Ty>
+        struct Lfu_bucket;
+
+        template <class _Key, class _Ty>
+        struct Lfu_entry
+            : public Cache_entry<_Key, _Ty>
+        {
+            using Cache_entry<_Key, _Ty>::Cache_entry;
+
+            List_iterator<Lfu_bucket<_Key, _Ty>> _Bucket;
+        };
+
+        template <class _Key, class _Ty>
+        struct Lfu_bucket
+        {
+            explicit Lfu_bucket(size_t freq)
+                : _Freq(freq)
+            {
+            }
+
+            size_t _Freq;
+            list<Lfu_entry<_Key, _Ty>> _Entries;
+        };
+    }
+
+    /**
+     * @brief Least frequently used cache with O(1) get and put. Entries with
+     *        the same hit count share a bucket list, most recent first, and
+     *        the buckets are kept in a list ordered by count. A hit splices
+     *        the node into the next bucket, so nothing is moved or
+     *        reallocated; the victim is the least recently used entry of the
+     *        lowest count.
+     *
+     *        Same interface as lru_cache.
+     *
+     * @tparam _Key
+     * @tparam _Ty
+     * @tparam _Hash
+     * @tparam _Eq
+     * @tparam _Weigher Callable (key, value) -> size_t
+     */
+    template <class _Key, class _Ty, class _Hash = std::hash<_Key>, class _Eq = std::equal_to<_Key>,
+              class _Weigher = cache_unit_weight>
+    class lfu_cache
+        : public __base::Cache_base<_Key, _Ty, _Hash, _Eq, _Weigher,
+                                    __base::List_iterator<__base::Lfu_entry<_Key, _Ty>>>
+    {
+        using _Entry = __base::Lfu_entry<_Key, _Ty>;
+        using _Bucket = __base::Lfu_bucket<_Key, _Ty>;
+        using _Entries = decltype(_Bucket::_Entries);
+        using _Iter = typename _Entries::iterator;
+        using _Bucket_iter = typename list<_Bucket>::iterator;
+        using _Base = __base::Cache_base<_Key, _Ty, _Hash, _Eq, _Weigher, _Iter>;
+
+    public:
+        using key_type = _Key;
+        using mapped_type = _Ty;
+        using value_type = std::pair<const _Key, _Ty>;
+        using size_type = size_t;
+        using hasher = _Hash;
+        using key_equal = _Eq;
+        using weigher_type = _Weigher;
+        using eviction_callback = typename _Base::eviction_callback;
+
+        explicit lfu_cache(size_type capacity, const _Weigher &weigher = _Weigher(), const _Hash &hash = _Hash(),
+                           const _Eq &eq = _Eq())
+            : _Base(capacity, weigher, hash, eq), _Size(0)
+        {
+        }
+
+        lfu_cache(const lfu_cache &) = delete;
+        lfu_cache &operator=(const lfu_cache &) = delete;
+
+        void on_evict(eviction_callback fn)
+        {
+            this->_On_evict = std::move(fn);
+        }
+
+        /**
+         * @brief Looks up @a key and counts a hit
+         *
+         * @return _Ty* The cached value, or nullptr on a miss
+         */
+        _Ty *get(const _Key &key)
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            if (slot == this->_Index.npos)
+                return nullptr;
+            _Iter it = this->_Index._At(slot);
+            _Promote(it);
+            return std::addressof(it->_Value.second);
+        }
+
+        _Ty *peek(const _Key &key)
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            return slot == this->_Index.npos ? nullptr : std::addressof(this->_Index._At(slot)->_Value.second);
+        }
+
+        const _Ty *peek(const _Key &key) const
+        {
+            return const_cast<lfu_cache *>(this)->peek(key);
+        }
+
+        bool contains(const _Key &key) const
+        {
+            return this->_Lookup(key, this->_Tag_of(key)) != this->_Index.npos;
+        }
+
+        /**
+         * @brief Hit count of @a key, 0 when it is not cached
+         */
+        size_type frequency(const _Key &key) const
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            return slot == this->_Index.npos ? 0 : this->_Index._At(slot)->_Bucket->_Freq;
+        }
+
+        /**
+         * @brief Inserts or replaces the value of @a key. A replaced entry
+         *        keeps its count plus one; a new entry starts at 1. The entry
+         *        being put is never its own victim.
+         *
+         * @return true When stored; false when the entry alone exceeds the
+         *         capacity, in which case any previous value of key is gone
+         */
+        template <class... _Args>
+        bool put(const _Key &key, _Args &&...args)
+        {
+            const size_t tag = this->_Tag_of(key);
+            const size_t slot = this->_Lookup(key, tag);
+
+            // weigh before linking, so an oversized entry costs nobody else
+            _Entries staging;
+            staging.emplace(staging.cbegin(), tag, 0, key, std::forward<_Args>(args)...);
+            _Iter it = staging.begin();
+            it->_Charge = this->_Weigh(it->_Value.first, it->_Value.second);
+            if (it->_Charge > this->_Capacity)
+            {
+                if (slot != this->_Index.npos)
+                    _Drop(this->_Index._At(slot));
+                return false;
+            }
+
+            if (slot != this->_Index.npos)
+            {
+                // take the place of the old node, then count the hit
+                _Iter old = this->_Index._At(slot);
+                _Bucket_iter bucket = old->_Bucket;
+                bucket->_Entries.splice(old, staging, it);
+                it->_Bucket = bucket;
+                ++_Size;
+                _Drop(old);
+                this->_Index._Insert(tag, it);
+                _Promote(it);
+            }
+            else
+            {
+                this->_Index._Insert(tag, it);
+                _Bucket_iter bucket = _Buckets.begin();
+                if (bucket == _Buckets.end() || bucket->_Freq != 1)
+                    bucket = _Buckets.emplace(bucket, 1);
+                bucket->_Entries.splice(bucket->_Entries.cbegin(), staging, it);
+                it->_Bucket = bucket;
+                ++_Size;
+            }
+            this->_Weight += it->_Charge;
+            _Evict(this->_Capacity, it);
+            return true;
+        }
+
+        bool erase(const _Key &key)
+        {
+            const size_t slot = this->_Lookup(key, this->_Tag_of(key));
+            if (slot == this->_Index.npos)
+                return false;
+            _Drop(this->_Index._At(slot));
+            return true;
+        }
+
+        void clear() noexcept
+        {
+            this->_Index._Clear();
+            _Buckets.clear();
+            this->_Weight = 0;
+            _Size = 0;
+        }
+
+        void set_capacity(size_type capacity)
+        {
+            this->_Capacity = capacity;
+            _Evict(capacity, _Iter());
+        }
+
+        size_type size() const noexcept
+        {
+            return _Size;
+        }
+
+        bool empty() const noexcept
+        {
+            return _Size == 0;
+        }
+
+        size_type weight() const noexcept
+        {
+            return this->_Weight;
+        }
+
+        size_type capacity() const noexcept
+        {
+            return this->_Capacity;
+        }
+
+        /**
+         * @brief Calls fn(key, value) from the next victim to the most
+         *        valuable entry
+         */
+        template <class _Fn>
+        void for_each(_Fn fn) const
+        {
+            for (const _Bucket &bucket : _Buckets)
+                for (auto it = bucket._Entries.rbegin(); it != bucket._Entries.rend(); ++it)
+                    fn(it->_Value.first, it->_Value.second);
+        }
+
+    private:
+        /**
+         * @brief Moves @a it to the front of the bucket of count + 1; the
+         *        old bucket goes away once empty
+         */
+        void _Promote(_Iter it)
+        {
+            _Bucket_iter from = it->_Bucket;
+            _Bucket_iter to = std::next(from);
+            if (to == _Buckets.end() || to->_Freq != from->_Freq + 1)
+                to = _Buckets.emplace(to, from->_Freq + 1);
+            to->_Entries.splice(to->_Entries.cbegin(), from->_Entries, it);
+            it->_Bucket = to;
+            if (from->_Entries.empty())
+                _Buckets.erase(from);
+        }
+
+        void _Drop(_Iter it)
+        {
+            this->_Unindex(it);
+            _Bucket_iter bucket = it->_Bucket;
+            bucket->_Entries.erase(it);
+            if (bucket->_Entries.empty())
+                _Buckets.erase(bucket);
+            --_Size;
+        }
+
+        /**
+         * @brief Evicts until the weight is at most @a budget, sparing @a keep
+         */
+        void _Evict(size_t budget, _Iter keep)
+        {
+            while (this->_Weight > budget)
+            {
+                _Bucket_iter bucket = _Buckets.begin();
+                _Iter victim = std::prev(bucket->_Entries.end());
+                if (victim == keep)
+                {
+                    if (victim != bucket->_Entries.begin())
+                        --victim;
+                    else if (++bucket != _Buckets.end())
+                        victim = std::prev(bucket->_Entries.end());
+                    else
+                        break;
+                }
+                this->_Notify(victim);
+                _Drop(victim);
+            }
+        }
+
+        list<_Bucket> _Buckets;
+        size_t _Size;
+    };
+
+    /**
+     * @brief Thread safe cache made of independent shards, each an _Cache
+     *        (lru_cache or lfu_cache) behind its own mutex. A key always maps
+     *        to the same shard, so threads working on different keys rarely
+     *        contend. Recency and frequency are tracked per shard, and each
+     *        shard gets an equal part of the capacity.
+     *
+     *        Values are returned by copy, since a reference would outlive
+     *        the lock; use with() to work on a value in place.
+     *
+     * @tparam _Cache
+     */
+    template <class _Cache>
+    class sharded_cache
+    {
+        struct alignas(64) Shard
+        {
+            Shard()
+                : _M_cache(0)
+            {
+            }
+
+            std::mutex _Lock;
+            _Cache _M_cache;
+        };
+
+    public:
+        using key_type = typename _Cache::key_type;
+        using mapped_type = typename _Cache::mapped_type;
+        using size_type = size_t;
+        using hasher = typename _Cache::hasher;
+        using eviction_callback = typename _Cache::eviction_callback;
+
+        /**
+         * @brief Construct an empty cache
+         *
+         * @param capacity Total budget, split evenly between the shards
+         * @param shards Rounded up to a power of two
+         */
+        explicit sharded_cache(size_type capacity, size_type shards = 16, const hasher &hash = hasher())
+            : _Hasher(hash)
+        {
+            size_type n = 1;
+            while (n < shards)
+                n *= 2;
+            _Count = n;
+            _Shards.reset(new Shard[n]);
+            set_capacity(capacity);
+        }
+
+        /**
+         * @brief Sets the eviction callback of every shard. It runs under the
+         *        lock of the shard, so it must not call back into the cache.
+         */
+        void on_evict(const eviction_callback &fn)
+        {
+            for (size_type i = 0; i < _Count; ++i)
+            {
+                std::lock_guard<std::mutex> lock(_Shards[i]._Lock);
+                _Shards[i]._M_cache.on_evict(fn);
+            }
+        }
+
+        /**
+         * @brief Copy of the value of @a key, counted as a hit
+         *
+         * @return std::optional<mapped_type> Empty on a miss
+         */
+        std::optional<mapped_type> get(const key_type &key)
+        {
+            Shard &shard = _Shard(key);
+            std::lock_guard<std::mutex> lock(shard._Lock);
+            if (mapped_type *value = shard._M_cache.get(key))
+                return *value;
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Calls fn(value) under the shard lock when @a key is cached
+         *
+         * @return true On a hit
+         */
+        template <class _Fn>
+        bool with(const key_type &key, _Fn fn)
+        {
+            Shard &shard = _Shard(key);
+            std::lock_guard<std::mutex> lock(shard._Lock);
+            if (mapped_type *value = shard._M_cache.get(key))
+            {
+                fn(*value);
+                return true;
+            }
+            return false;
+        }
+
+        template <class... _Args>
+        bool put(const key_type &key, _Args &&...args)
+        {
+            Shard &shard = _Shard(key);
+            std::lock_guard<std::mutex> lock(shard._Lock);
+            return shard._M_cache.put(key, std::forward<_Args>(args)...);
+        }
+
+        bool erase(const key_type &key)
+        {
+            Shard &shard = _Shard(key);
+            std::lock_guard<std::mutex> lock(shard._Lock);
+            return shard._M_cache.erase(key);
+        }
+
+        bool contains(const key_type &key)
+        {
+            Shard &shard = _Shard(key);
+            std::lock_guard<std::mutex> lock(shard._Lock);
+            return shard._M_cache.contains(key);
+        }
+
+        void clear()
+        {
+            for (size_type i = 0; i < _Count; ++i)
+            {
+                std::lock_guard<std::mutex> lock(_Shards[i]._Lock);
+                _Shards[i]._M_cache.clear();
+            }
+        }
+
+        void set_capacity(size_type capacity)
+        {
+            for (size_type i = 0; i < _Count; ++i)
+            {
+                std::lock_guard<std::mutex> lock(_Shards[i]._Lock);
+                _Shards[i]._M_cache.set_capacity(capacity / _Count + (i < capacity % _Count));
+            }
+        }
+
+        /**
+         * @brief Number of entries; shards are visited one at a time, so the
+         *        total is only exact while no other thread writes.
+         */
+        size_type size()
+        {
+            size_type n = 0;
+            for (size_type i = 0; i < _Count; ++i)
+            {
+                std::lock_guard<std::mutex> lock(_Shards[i]._Lock);
+                n += _Shards[i]._M_cache.size();
+            }
+            return n;
+        }
+
+        size_type weight()
+        {
+            size_type n = 0;
+            for (size_type i = 0; i < _Count; ++i)
+            {
+                std::lock_guard<std::mutex> lock(_Shards[i]._Lock);
+                n += _Shards[i]._M_cache.weight();
+            }
+            return n;
+        }
+
+        size_type shard_count() const noexcept
+        {
+            return _Count;
+        }
+
+    private:
+        Shard &_Shard(const key_type &key)
+        {
+            // low bits of the mixed hash; Cache_index homes on the high ones,
+            // so the keys of a shard still spread over its whole table
+            return _Shards[size_t(__base::_Cache_mix(_Hasher(key))) & (_Count - 1)];
+        }
+
+        hasher _Hasher;
+        size_type _Count;
+        std::unique_ptr<Shard[]> _Shards;
+    };
+
+    template <class _Key, class _Ty, class _Hash = std::hash<_Key>, class _Eq = std::equal_to<_Key>,
+              class _Weigher = cache_unit_weight>
+    using concurrent_lru_cache = sharded_cache<lru_cache<_Key, _Ty, _Hash, _Eq, _Weigher>>;
+
+    template <class _Key, class _Ty, class _Hash = std::hash<_Key>, class _Eq = std::equal_to<_Key>,
+              class _Weigher = cache_unit_weight>
+    using concurrent_lfu_cache = sharded_cache<lfu_cache<_Key, _Ty, _Hash, _Eq, _Weigher>>;
+}
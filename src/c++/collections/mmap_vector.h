@@ -0,0 +1,494 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vector.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        /**
+         * @brief First bytes of an mmap_vector file. The elements follow at
+         *        sizeof(Mmap_vector_header), which keeps them 64 byte aligned.
+         */
+        struct alignas(64) Mmap_vector_header
+        {
+            static constexpr char _Magic_value[8] = {'C', 'O', 'L', 'M', 'M', 'V', 'E', 'C'};
+            static constexpr uint32_t _Version_value = 1;
+            static constexpr uint32_t _Byte_order_value = 0x01020304;
+
+            char _Magic[8];
+            uint32_t _Version;
+            uint32_t _Byte_order;
+            uint64_t _Element_size;
+            uint64_t _Size;
+        };
+
+        /**
+         * @brief A file mapped shared and read-write. Growing extends the
+         *        file with ftruncate and then the mapping with mremap, which
+         *        may move it.
+         */
+        class Mmap_file
+        {
+        public:
+            Mmap_file() noexcept = default;
+
+            Mmap_file(Mmap_file &&x) noexcept
+                : _Fd(x._Fd), _Map(x._Map), _Length(x._Length)
+            {
+                x._Fd = -1;
+                x._Map = nullptr;
+                x._Length = 0;
+            }
+
+            ~Mmap_file()
+            {
+                if (_Map)
+                    ::munmap(_Map, _Length);
+                if (_Fd >= 0)
+                    ::close(_Fd);
+            }
+
+            void _Swap(Mmap_file &x) noexcept
+            {
+                std::swap(_Fd, x._Fd);
+                std::swap(_Map, x._Map);
+                std::swap(_Length, x._Length);
+            }
+
+            /**
+             * @brief Opens or creates @a path and maps the whole file; a new
+             *        or empty file is first extended to @a length bytes, any
+             *        other file is left as it is.
+             *
+             * @return Whether the file was empty
+             */
+            bool _Open(const char *path, size_t length)
+            {
+                _Fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+                if (_Fd < 0)
+                    _S_throw("cannot open collections::mmap_vector file");
+
+                struct stat st;
+                if (::fstat(_Fd, &st) != 0)
+                    _S_throw("cannot stat collections::mmap_vector file");
+                _Length = size_t(st.st_size);
+                const bool empty = _Length == 0;
+                if (empty)
+                {
+                    if (::ftruncate(_Fd, off_t(length)) != 0)
+                        _S_throw("cannot extend collections::mmap_vector file");
+                    _Length = length;
+                }
+
+                void *map = ::mmap(nullptr, _Length, PROT_READ | PROT_WRITE, MAP_SHARED, _Fd, 0);
+                if (map == MAP_FAILED)
+                    _S_throw("cannot map collections::mmap_vector file");
+                _Map = static_cast<char *>(map);
+                return empty;
+            }
+
+            void _Resize(size_t length)
+            {
+                const size_t old = _Length;
+                if (length == old)
+                    return;
+                // a shrinking file must lose its pages from the mapping first,
+                // a growing one must exist before they are mapped
+                if (length > old && ::ftruncate(_Fd, off_t(length)) != 0)
+                    _S_throw("cannot extend collections::mmap_vector file");
+
+                void *map = ::mremap(_Map, old, length, MREMAP_MAYMOVE);
+                if (map == MAP_FAILED)
+                    _S_throw("cannot remap collections::mmap_vector file");
+                _Map = static_cast<char *>(map);
+                _Length = length;
+
+                if (length < old && ::ftruncate(_Fd, off_t(length)) != 0)
+                    _S_throw("cannot shrink collections::mmap_vector file");
+            }
+
+            void _Sync(bool wait) const
+            {
+                if (_Map && ::msync(_Map, _Length, wait ? MS_SYNC : MS_ASYNC) != 0)
+                    _S_throw("cannot sync collections::mmap_vector file");
+            }
+
+            [[noreturn]] static void _S_throw(const char *msg)
+            {
+                throw std::system_error(errno, std::generic_category(), msg);
+            }
+
+            int _Fd = -1;
+            char *_Map = nullptr;
+            size_t _Length = 0;
+        };
+    }
+
+    /**
+     * @brief Vector of trivially copyable elements living in a file mapping.
+     *        Opening an existing file maps it and is done: there is no load
+     *        step, pages come in on demand. Growth extends the file and the
+     *        mapping; the element count is kept in the file header on every
+     *        change, so the file is consistent whenever the process stops
+     *        (data reaches the disk with the page cache, or at sync()).
+     *
+     *        Pointers and iterators are invalidated by any growth, like a
+     *        reallocation of collections::vector.
+     *
+     * @tparam _Ty
+     */
+    template <typename _Ty>
+    class mmap_vector
+    {
+        static_assert(std::is_trivially_copyable_v<_Ty>, "collections::mmap_vector needs trivially copyable elements");
+        static_assert(alignof(_Ty) <= alignof(__base::Mmap_vector_header), "collections::mmap_vector element is over-aligned");
+
+        using _Header = __base::Mmap_vector_header;
+
+    public:
+        using value_type = _Ty;
+        using pointer = _Ty *;
+        using const_pointer = const _Ty *;
+        using reference = value_type &;
+        using const_reference = const value_type &;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using const_iterator = __base::Vector_const_iterator<_Ty>;
+        using iterator = __base::Vector_iterator<_Ty>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        /**
+         * @brief Opens the vector stored at @a path, creating an empty one
+         *        if the file does not exist
+         *
+         * @param path
+         * @throw std::system_error if the file cannot be opened or mapped
+         * @throw std::runtime_error if the file holds something else
+         */
+        explicit mmap_vector(const std::string &path)
+        {
+            const bool created = _M_file._Open(path.c_str(), sizeof(_Header));
+            _Header *header = _Get_header();
+            if (created)
+            {
+                std::memcpy(header->_Magic, _Header::_Magic_value, sizeof(header->_Magic));
+                header->_Version = _Header::_Version_value;
+                header->_Byte_order = _Header::_Byte_order_value;
+                header->_Element_size = sizeof(_Ty);
+            }
+            else if (_M_file._Length < sizeof(_Header) ||
+                     std::memcmp(header->_Magic, _Header::_Magic_value, sizeof(header->_Magic)) != 0 ||
+                     header->_Version != _Header::_Version_value)
+                throw std::runtime_error("not a collections::mmap_vector file");
+            else if (header->_Byte_order != _Header::_Byte_order_value)
+                throw std::runtime_error("collections::mmap_vector file has the other byte order");
+            else if (header->_Element_size != sizeof(_Ty) ||
+                     header->_Size > (_M_file._Length - sizeof(_Header)) / sizeof(_Ty))
+                throw std::runtime_error("collections::mmap_vector file does not match the element type");
+            _Update_pointers(header->_Size);
+        }
+
+        mmap_vector(mmap_vector &&x) noexcept
+            : _M_file(std::move(x._M_file)), _Start(x._Start), _Last(x._Last), _End_storage(x._End_storage)
+        {
+            x._Start = x._Last = x._End_storage = nullptr;
+        }
+
+        mmap_vector &operator=(mmap_vector &&x) noexcept
+        {
+            mmap_vector(std::move(x)).swap(*this);
+            return *this;
+        }
+
+        mmap_vector(mmap_vector const &) = delete;
+        mmap_vector &operator=(mmap_vector const &) = delete;
+
+        void swap(mmap_vector &x) noexcept
+        {
+            _M_file._Swap(x._M_file);
+            std::swap(_Start, x._Start);
+            std::swap(_Last, x._Last);
+            std::swap(_End_storage, x._End_storage);
+        }
+
+        iterator begin() noexcept
+        {
+            return iterator(_Start);
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(_Last);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(_Start);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(_Last);
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return const_iterator(_Start);
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return const_iterator(_Last);
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return const_reverse_iterator(cend());
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return const_reverse_iterator(cbegin());
+        }
+
+        size_type size() const noexcept
+        {
+            return size_type(_Last - _Start);
+        }
+
+        size_type capacity() const noexcept
+        {
+            return size_type(_End_storage - _Start);
+        }
+
+        size_type max_size() const noexcept
+        {
+            // the file length must fit both off_t and size_t
+            constexpr uintmax_t limit = std::min<uintmax_t>(std::numeric_limits<off_t>::max(),
+                                                            std::numeric_limits<size_t>::max());
+            return size_type((limit - sizeof(_Header)) / sizeof(_Ty));
+        }
+
+        bool empty() const noexcept
+        {
+            return _Start == _Last;
+        }
+
+        pointer data() noexcept
+        {
+            return _Start;
+        }
+
+        const_pointer data() const noexcept
+        {
+            return _Start;
+        }
+
+        reference operator[](size_type n) noexcept
+        {
+            return _Start[n];
+        }
+
+        const_reference operator[](size_type n) const noexcept
+        {
+            return _Start[n];
+        }
+
+        reference at(size_type n)
+        {
+            if (n >= size())
+                std::__throw_out_of_range("collections::mmap_vector::at");
+            return _Start[n];
+        }
+
+        const_reference at(size_type n) const
+        {
+            if (n >= size())
+                std::__throw_out_of_range("collections::mmap_vector::at");
+            return _Start[n];
+        }
+
+        reference front() noexcept
+        {
+            return *_Start;
+        }
+
+        const_reference front() const noexcept
+        {
+            return *_Start;
+        }
+
+        reference back() noexcept
+        {
+            return *(_Last - 1);
+        }
+
+        const_reference back() const noexcept
+        {
+            return *(_Last - 1);
+        }
+
+        void push_back(value_type const &value)
+        {
+            emplace_back(value);
+        }
+
+        template <typename... _Args>
+        reference emplace_back(_Args &&...args)
+        {
+            if (_Last == _End_storage)
+            {
+                // the argument may live in the mapping about to move
+                const value_type value(std::forward<_Args>(args)...);
+                _Remap(_Check_len(1, "collections::mmap_vector::emplace_back"));
+                ::new (static_cast<void *>(_Last)) value_type(value);
+            }
+            else
+                ::new (static_cast<void *>(_Last)) value_type(std::forward<_Args>(args)...);
+            _Set_size(size() + 1);
+            return back();
+        }
+
+        void pop_back() noexcept
+        {
+            _Set_size(size() - 1);
+        }
+
+        /**
+         * @brief Appends copies of [first, last) with one growth of the file
+         *
+         * @param first
+         * @param last
+         */
+        void append(const_pointer first, const_pointer last)
+        {
+            const size_type n = size_type(last - first);
+            if (size_type(_End_storage - _Last) < n)
+            {
+                // the range may come from this vector
+                const size_type offset = size_type(first - _Start);
+                const bool inside = first >= _Start && first < _Last;
+                _Remap(_Check_len(n, "collections::mmap_vector::append"));
+                if (inside)
+                    first = _Start + offset;
+            }
+            std::memmove(static_cast<void *>(_Last), first, n * sizeof(_Ty));
+            _Set_size(size() + n);
+        }
+
+        void resize(size_type n, value_type const &value = value_type())
+        {
+            if (n > max_size())
+                std::__throw_length_error("collections::mmap_vector::resize");
+            if (n > capacity())
+            {
+                const value_type copy(value);
+                _Remap(n);
+                std::uninitialized_fill(_Last, _Start + n, copy);
+            }
+            else if (n > size())
+                std::uninitialized_fill(_Last, _Start + n, value);
+            _Set_size(n);
+        }
+
+        void reserve(size_type n)
+        {
+            if (n > max_size())
+                std::__throw_length_error("collections::mmap_vector::reserve");
+            if (n > capacity())
+                _Remap(n);
+        }
+
+        void clear() noexcept
+        {
+            _Set_size(0);
+        }
+
+        /**
+         * @brief Truncates the file to the elements in use
+         *
+         */
+        void shrink_to_fit()
+        {
+            _Remap(size());
+        }
+
+        /**
+         * @brief Writes the dirty pages to the file
+         *
+         * @param wait Whether to block until the data is on the disk; when
+         *        false the writeback is only scheduled
+         */
+        void sync(bool wait = true) const
+        {
+            _M_file._Sync(wait);
+        }
+
+    private:
+        _Header *_Get_header() const noexcept
+        {
+            return reinterpret_cast<_Header *>(_M_file._Map);
+        }
+
+        void _Update_pointers(size_type n) noexcept
+        {
+            _Start = reinterpret_cast<pointer>(_M_file._Map + sizeof(_Header));
+            _Last = _Start + n;
+            _End_storage = _Start + (_M_file._Length - sizeof(_Header)) / sizeof(_Ty);
+        }
+
+        void _Set_size(size_type n) noexcept
+        {
+            _Last = _Start + n;
+            _Get_header()->_Size = n;
+        }
+
+        size_type _Check_len(size_type n, const char *msg) const
+        {
+            if (max_size() - size() < n)
+                std::__throw_length_error(msg);
+
+            const size_type len = size() + std::max(size(), n);
+            return (len < size() || len > max_size()) ? max_size() : len;
+        }
+
+        void _Remap(size_type n)
+        {
+            if (n > max_size())
+                std::__throw_length_error("collections::mmap_vector");
+            const size_type count = size();
+            _M_file._Resize(sizeof(_Header) + n * sizeof(_Ty));
+            _Update_pointers(count);
+        }
+
+        __base::Mmap_file _M_file;
+        pointer _Start = nullptr;
+        pointer _Last = nullptr;
+        pointer _End_storage = nullptr;
+    };
+}
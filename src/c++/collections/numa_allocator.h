@@ -0,0 +1,302 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace collections
+{
+    /**
+     * @brief Where a numa_allocator places its pages
+     *
+     * local - the kernel default: each page lands on the node of the thread
+     *         that first writes it, so fill the container in parallel (see
+     *         the vector constructor taking a pool).
+     * interleave - pages round robin over every node; the choice when all
+     *         sockets read the whole container.
+     * bind - every page on one node.
+     */
+    enum class numa_policy
+    {
+        local,
+        interleave,
+        bind
+    };
+
+    /**
+     * @brief Requests of at least this many bytes get their own mapping
+     *        and a placement policy; smaller ones come from operator new,
+     *        since a policy only applies to whole pages.
+     */
+    constexpr size_t numa_mapping_threshold = size_t(64) << 10;
+
+    namespace __base
+    {
+        struct Numa_topology
+        {
+            // ids beyond this are ignored by the placement calls
+            static constexpr unsigned _Max_nodes = 1024;
+            static constexpr unsigned _Word_bits = std::numeric_limits<unsigned long>::digits;
+
+            unsigned long _Online[_Max_nodes / _Word_bits] = {};
+            unsigned _Count = 0;
+            size_t _Page_size = 4096;
+
+            static const Numa_topology &_Instance()
+            {
+                static const Numa_topology topology;
+                return topology;
+            }
+
+            bool _Is_online(unsigned node) const noexcept
+            {
+                return node < _Max_nodes && (_Online[node / _Word_bits] >> (node % _Word_bits) & 1);
+            }
+
+        private:
+            Numa_topology()
+            {
+#if defined(__linux__)
+                const long page = sysconf(_SC_PAGESIZE);
+                if (page > 0)
+                    _Page_size = size_t(page);
+
+                // a list of ranges such as "0-1,4"
+                if (std::FILE *file = std::fopen("/sys/devices/system/node/online", "r"))
+                {
+                    unsigned lo, hi;
+                    while (std::fscanf(file, "%u", &lo) == 1)
+                    {
+                        hi = lo;
+                        int sep = std::fgetc(file);
+                        if (sep == '-')
+                        {
+                            if (std::fscanf(file, "%u", &hi) != 1)
+                                break;
+                            sep = std::fgetc(file);
+                        }
+                        for (unsigned node = lo; node <= hi && node < _Max_nodes; ++node)
+                        {
+                            _Online[node / _Word_bits] |= 1ul << (node % _Word_bits);
+                            ++_Count;
+                        }
+                        if (sep != ',')
+                            break;
+                    }
+                    std::fclose(file);
+                }
+#endif
+                // no sysfs (or not Linux): one node holding everything
+                if (!_Count)
+                {
+                    _Online[0] = 1;
+                    _Count = 1;
+                }
+            }
+        };
+    }
+
+    /**
+     * @brief Number of online NUMA nodes; 1 when the machine has no NUMA
+     *        support or it cannot be queried.
+     *
+     * @return unsigned
+     */
+    inline unsigned numa_node_count() noexcept
+    {
+        return __base::Numa_topology::_Instance()._Count;
+    }
+
+    /**
+     * @brief Applies @a policy to the whole pages inside [addr, addr + bytes).
+     *        Pages already touched keep their place; only later faults
+     *        follow the policy. Use it on storage the container does not
+     *        own, e.g. a heap allocated collections::array, before filling.
+     *
+     * @param addr
+     * @param bytes
+     * @param policy
+     * @param node The node for numa_policy::bind
+     * @return true if the kernel took the policy; false on a single node
+     *         machine, for an offline @a node, or without mbind
+     */
+    inline bool numa_place(void *addr, size_t bytes, numa_policy policy, unsigned node = 0) noexcept
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+        using __base::Numa_topology;
+        const Numa_topology &topology = Numa_topology::_Instance();
+        if (topology._Count < 2 || policy == numa_policy::local)
+            return false;
+        if (policy == numa_policy::bind && !topology._Is_online(node))
+            return false;
+
+        const uintptr_t page = topology._Page_size;
+        const uintptr_t lo = (reinterpret_cast<uintptr_t>(addr) + page - 1) & ~(page - 1);
+        const uintptr_t hi = (reinterpret_cast<uintptr_t>(addr) + bytes) & ~(page - 1);
+        if (lo >= hi)
+            return false;
+
+        // values of MPOL_BIND and MPOL_INTERLEAVE in <linux/mempolicy.h>
+        constexpr int mpol_bind = 2;
+        constexpr int mpol_interleave = 3;
+
+        unsigned long mask[Numa_topology::_Max_nodes / Numa_topology::_Word_bits] = {};
+        int mode;
+        if (policy == numa_policy::bind)
+        {
+            mask[node / Numa_topology::_Word_bits] = 1ul << (node % Numa_topology::_Word_bits);
+            mode = mpol_bind;
+        }
+        else
+        {
+            std::copy(std::begin(topology._Online), std::end(topology._Online), mask);
+            mode = mpol_interleave;
+        }
+        return syscall(SYS_mbind, lo, hi - lo, mode, mask, Numa_topology::_Max_nodes + 1, 0u) == 0;
+#else
+        (void)addr;
+        (void)bytes;
+        (void)policy;
+        (void)node;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Allocator placing large blocks by a numa_policy, e.g.
+     *        collections::vector<double, numa_allocator<double>>. Blocks of
+     *        numa_mapping_threshold bytes or more are mapped anonymously and
+     *        then placed; smaller ones come from operator new. Where the
+     *        placement cannot be applied (one node, no mbind) the mapping is
+     *        simply used as is, so the allocator behaves the same everywhere.
+     *
+     *        All instances draw from the same sources, so they compare
+     *        equal; the policy propagates so that an assigned container
+     *        adopts the placement of its source.
+     *
+     * @tparam _Ty
+     */
+    template <class _Ty>
+    class numa_allocator
+    {
+        template <class>
+        friend class numa_allocator;
+
+    public:
+        using value_type = _Ty;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::true_type;
+
+        /**
+         * @brief Construct an allocator for @a policy
+         *
+         * @param policy
+         * @param node The node for numa_policy::bind
+         */
+        numa_allocator(numa_policy policy = numa_policy::local, unsigned node = 0) noexcept
+            : _M_policy(policy), _M_node(node)
+        {
+        }
+
+        template <class _Other>
+        numa_allocator(const numa_allocator<_Other> &x) noexcept
+            : _M_policy(x._M_policy), _M_node(x._M_node)
+        {
+        }
+
+        [[nodiscard]] _Ty *allocate(size_type n)
+        {
+            if (n > max_size())
+                std::__throw_bad_array_new_length();
+
+            const size_t bytes = n * sizeof(_Ty);
+            if (!_S_mapped(bytes))
+                return static_cast<_Ty *>(::operator new(bytes, std::align_val_t(alignof(_Ty))));
+
+#if defined(__linux__)
+            // the mapping owns its last partial page, so the policy covers it too
+            const size_t length = _S_mapping_size(bytes);
+            void *p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                std::__throw_bad_alloc();
+            numa_place(p, length, _M_policy, _M_node);
+            return static_cast<_Ty *>(p);
+#else
+            return static_cast<_Ty *>(::operator new(bytes, std::align_val_t(alignof(_Ty))));
+#endif
+        }
+
+        void deallocate(_Ty *p, size_type n) noexcept
+        {
+            const size_t bytes = n * sizeof(_Ty);
+#if defined(__linux__)
+            if (_S_mapped(bytes))
+            {
+                ::munmap(p, _S_mapping_size(bytes));
+                return;
+            }
+#endif
+            ::operator delete(p, bytes, std::align_val_t(alignof(_Ty)));
+        }
+
+        size_type max_size() const noexcept
+        {
+            return std::numeric_limits<size_type>::max() / sizeof(_Ty);
+        }
+
+        numa_policy policy() const noexcept
+        {
+            return _M_policy;
+        }
+
+        unsigned node() const noexcept
+        {
+            return _M_node;
+        }
+
+        template <class _Other>
+        friend bool operator==(const numa_allocator &, const numa_allocator<_Other> &) noexcept
+        {
+            return true;
+        }
+
+        template <class _Other>
+        friend bool operator!=(const numa_allocator &, const numa_allocator<_Other> &) noexcept
+        {
+            return false;
+        }
+
+    private:
+        static bool _S_mapped(size_t bytes) noexcept
+        {
+            // mmap only guarantees page alignment
+            return bytes >= numa_mapping_threshold && alignof(_Ty) <= __base::Numa_topology::_Instance()._Page_size;
+        }
+
+        static size_t _S_mapping_size(size_t bytes) noexcept
+        {
+            const size_t page = __base::Numa_topology::_Instance()._Page_size;
+            return (bytes + page - 1) & ~(page - 1);
+        }
+
+        numa_policy _M_policy;
+        unsigned _M_node;
+    };
+}
@@ -0,0 +1,1026 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+#include <ext/aligned_buffer.h>
+
+namespace collections
+{
+    template <class _Ty, class _Alloc>
+    class persistent_vector;
+
+    template <class _Ty, class _Alloc>
+    class transient_vector;
+
+    namespace __base
+    {
+        constexpr unsigned _Pvec_bits = 5;
+        constexpr size_t _Pvec_width = size_t(1) << _Pvec_bits;
+        constexpr size_t _Pvec_mask = _Pvec_width - 1;
+
+        /**
+         * @brief Trie node shared between versions. _Owner names the
+         *        transient that created the node and may still change it in
+         *        place; 0 marks a node that is never changed again.
+         */
+        struct Pvec_node
+        {
+            explicit Pvec_node(uint64_t owner) noexcept
+                : _Refs(1), _Owner(owner)
+            {
+            }
+
+            std::atomic<uint32_t> _Refs;
+            uint64_t _Owner;
+        };
+
+        struct Pvec_inner
+            : Pvec_node
+        {
+            explicit Pvec_inner(uint64_t owner) noexcept
+                : Pvec_node(owner), _Child()
+            {
+            }
+
+            Pvec_node *_Child[_Pvec_width];
+        };
+
+        template <class _Ty>
+        struct Pvec_leaf
+            : Pvec_node
+        {
+            explicit Pvec_leaf(uint64_t owner) noexcept
+                : Pvec_node(owner)
+            {
+            }
+
+            _Ty *_Valptr(size_t i) noexcept
+            {
+                return _Values[i]._M_ptr();
+            }
+
+            const _Ty *_Valptr(size_t i) const noexcept
+            {
+                return _Values[i]._M_ptr();
+            }
+
+            uint32_t _Count = 0;
+            __gnu_cxx::__aligned_membuf<_Ty> _Values[_Pvec_width];
+        };
+
+        inline uint64_t _Pvec_new_owner() noexcept
+        {
+            static std::atomic<uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief The trie of persistent_vector and transient_vector, after
+         *        Bagwell and Hickey: 32-way inner nodes over leaves of 32
+         *        elements, plus a tail leaf holding the last 1 to 32
+         *        elements so appends rarely touch the trie. Nodes are
+         *        reference counted. An edit copies the nodes on the path it
+         *        changes, unless the editing transient owns them.
+         */
+        template <class _Ty, class _Alloc>
+        class Pvec_base
+        {
+            template <class, class>
+            friend class Pvec_iterator;
+
+        protected:
+            using _Leaf = Pvec_leaf<_Ty>;
+            using _Inner = Pvec_inner;
+            using _Value_alloc = typename std::allocator_traits<_Alloc>::template rebind_alloc<_Ty>;
+            using _Value_traits = std::allocator_traits<_Value_alloc>;
+            using _Leaf_alloc = typename _Value_traits::template rebind_alloc<_Leaf>;
+            using _Leaf_traits = std::allocator_traits<_Leaf_alloc>;
+            using _Inner_alloc = typename _Value_traits::template rebind_alloc<_Inner>;
+            using _Inner_traits = std::allocator_traits<_Inner_alloc>;
+
+            explicit Pvec_base(const _Alloc &alloc = _Alloc())
+                : _M_alloc(alloc)
+            {
+            }
+
+            Pvec_base(const Pvec_base &x) noexcept
+                : _M_alloc(x._M_alloc), _Size(x._Size), _Shift(x._Shift), _Root(x._Root), _Tail(x._Tail)
+            {
+                _Retain(_Root);
+                _Retain(_Tail);
+            }
+
+            Pvec_base(Pvec_base &&x) noexcept
+                : _M_alloc(x._M_alloc), _Size(x._Size), _Shift(x._Shift), _Root(x._Root), _Tail(x._Tail)
+            {
+                x._Size = 0;
+                x._Shift = _Pvec_bits;
+                x._Root = nullptr;
+                x._Tail = nullptr;
+            }
+
+            ~Pvec_base()
+            {
+                _Release_inner(_Root, _Shift);
+                _Release_leaf(_Tail);
+            }
+
+            void _Swap(Pvec_base &x) noexcept
+            {
+                std::swap(_M_alloc, x._M_alloc);
+                std::swap(_Size, x._Size);
+                std::swap(_Shift, x._Shift);
+                std::swap(_Root, x._Root);
+                std::swap(_Tail, x._Tail);
+            }
+
+            size_t _Tail_offset() const noexcept
+            {
+                return _Tail ? _Size - _Tail->_Count : 0;
+            }
+
+            const _Leaf *_Leaf_for(size_t i) const noexcept
+            {
+                if (i >= _Tail_offset())
+                    return _Tail;
+                const _Inner *node = _Root;
+                for (unsigned level = _Shift; level > _Pvec_bits; level -= _Pvec_bits)
+                    node = static_cast<const _Inner *>(node->_Child[(i >> level) & _Pvec_mask]);
+                return static_cast<const _Leaf *>(node->_Child[(i >> _Pvec_bits) & _Pvec_mask]);
+            }
+
+            const _Ty &_Get(size_t i) const noexcept
+            {
+                return *_Leaf_for(i)->_Valptr(i & _Pvec_mask);
+            }
+
+            void _Range_check(size_t i, const char *msg) const
+            {
+                if (i >= _Size)
+                    std::__throw_out_of_range(msg);
+            }
+
+            template <class... _Args>
+            void _Emplace_back(uint64_t owner, _Args &&...args)
+            {
+                if (_Tail && _Tail->_Count < _Pvec_width)
+                {
+                    _Tail = _Edit_leaf(_Tail, owner);
+                    _Value_traits::construct(_M_alloc, _Tail->_Valptr(_Tail->_Count), std::forward<_Args>(args)...);
+                    ++_Tail->_Count;
+                    ++_Size;
+                    return;
+                }
+
+                // the full tail moves into the trie behind a new one
+                _Leaf *leaf = _New_leaf(owner);
+                try
+                {
+                    _Value_traits::construct(_M_alloc, leaf->_Valptr(0), std::forward<_Args>(args)...);
+                    leaf->_Count = 1;
+                    if (_Tail)
+                        _Push_tail(owner);
+                }
+                catch (...)
+                {
+                    _Release_leaf(leaf);
+                    throw;
+                }
+                _Tail = leaf;
+                ++_Size;
+            }
+
+            template <class _Value>
+            void _Set(size_t i, _Value &&value, uint64_t owner)
+            {
+                const size_t offset = _Tail_offset();
+                if (i >= offset)
+                {
+                    _Tail = _Edit_leaf(_Tail, owner);
+                    *_Tail->_Valptr(i - offset) = std::forward<_Value>(value);
+                    return;
+                }
+
+                _Root = _Edit_inner(_Root, _Shift, owner);
+                _Inner *node = _Root;
+                for (unsigned level = _Shift; level > _Pvec_bits; level -= _Pvec_bits)
+                {
+                    Pvec_node *&slot = node->_Child[(i >> level) & _Pvec_mask];
+                    slot = _Edit_inner(static_cast<_Inner *>(slot), level - _Pvec_bits, owner);
+                    node = static_cast<_Inner *>(slot);
+                }
+                Pvec_node *&slot = node->_Child[(i >> _Pvec_bits) & _Pvec_mask];
+                _Leaf *leaf = _Edit_leaf(static_cast<_Leaf *>(slot), owner);
+                slot = leaf;
+                *leaf->_Valptr(i & _Pvec_mask) = std::forward<_Value>(value);
+            }
+
+            void _Pop_back(uint64_t owner)
+            {
+                if (_Tail->_Count > 1)
+                {
+                    _Tail = _Edit_leaf(_Tail, owner);
+                    --_Tail->_Count;
+                    _Value_traits::destroy(_M_alloc, _Tail->_Valptr(_Tail->_Count));
+                    --_Size;
+                    return;
+                }
+                if (_Size == 1)
+                {
+                    _Release_leaf(_Tail);
+                    _Tail = nullptr;
+                    _Size = 0;
+                    return;
+                }
+
+                // the last leaf of the trie becomes the tail
+                const size_t i = _Size - 2;
+                _Leaf *tail = const_cast<_Leaf *>(_Leaf_for(i));
+                _Retain(tail);
+                try
+                {
+                    _Pop_tail(i, owner);
+                }
+                catch (...)
+                {
+                    _Release_leaf(tail);
+                    throw;
+                }
+                _Release_leaf(_Tail);
+                _Tail = tail;
+                --_Size;
+            }
+
+            _Value_alloc _M_alloc;
+            size_t _Size = 0;
+            unsigned _Shift = _Pvec_bits;
+            _Inner *_Root = nullptr;
+            _Leaf *_Tail = nullptr;
+
+        private:
+            static void _Retain(Pvec_node *node) noexcept
+            {
+                if (node)
+                    node->_Refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            static bool _Drop(Pvec_node *node) noexcept
+            {
+                return node && node->_Refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+
+            _Leaf *_New_leaf(uint64_t owner)
+            {
+                _Leaf_alloc alloc(_M_alloc);
+                return ::new (static_cast<void *>(_Leaf_traits::allocate(alloc, 1))) _Leaf(owner);
+            }
+
+            _Inner *_New_inner(uint64_t owner)
+            {
+                _Inner_alloc alloc(_M_alloc);
+                return ::new (static_cast<void *>(_Inner_traits::allocate(alloc, 1))) _Inner(owner);
+            }
+
+            void _Release_leaf(_Leaf *leaf) noexcept
+            {
+                if (!_Drop(leaf))
+                    return;
+                for (uint32_t i = 0; i < leaf->_Count; ++i)
+                    _Value_traits::destroy(_M_alloc, leaf->_Valptr(i));
+                leaf->~_Leaf();
+                _Leaf_alloc alloc(_M_alloc);
+                _Leaf_traits::deallocate(alloc, leaf, 1);
+            }
+
+            /**
+             * @brief Drops a reference to @a node, whose children are leaves
+             *        when @a level is 5 and inner nodes of level - 5 otherwise
+             */
+            void _Release_inner(_Inner *node, unsigned level) noexcept
+            {
+                if (!_Drop(node))
+                    return;
+                for (Pvec_node *child : node->_Child)
+                {
+                    if (level == _Pvec_bits)
+                        _Release_leaf(static_cast<_Leaf *>(child));
+                    else
+                        _Release_inner(static_cast<_Inner *>(child), level - _Pvec_bits);
+                }
+                node->~_Inner();
+                _Inner_alloc alloc(_M_alloc);
+                _Inner_traits::deallocate(alloc, node, 1);
+            }
+
+            /**
+             * @brief @a leaf itself if @a owner may change it, else a copy
+             *        standing in for it; the reference to @a leaf passes to
+             *        the copy, so the caller just stores the result.
+             */
+            _Leaf *_Edit_leaf(_Leaf *leaf, uint64_t owner)
+            {
+                if (owner && leaf->_Owner == owner)
+                    return leaf;
+                _Leaf *copy = _New_leaf(owner);
+                try
+                {
+                    for (; copy->_Count < leaf->_Count; ++copy->_Count)
+                        _Value_traits::construct(_M_alloc, copy->_Valptr(copy->_Count), *leaf->_Valptr(copy->_Count));
+                }
+                catch (...)
+                {
+                    _Release_leaf(copy);
+                    throw;
+                }
+                _Release_leaf(leaf);
+                return copy;
+            }
+
+            _Inner *_Edit_inner(_Inner *node, unsigned level, uint64_t owner)
+            {
+                if (owner && node->_Owner == owner)
+                    return node;
+                _Inner *copy = _New_inner(owner);
+                for (size_t i = 0; i < _Pvec_width; ++i)
+                {
+                    copy->_Child[i] = node->_Child[i];
+                    _Retain(copy->_Child[i]);
+                }
+                _Release_inner(node, level);
+                return copy;
+            }
+
+            /**
+             * @brief A chain of empty inner nodes from @a level down to 5;
+             *        the leaf goes into the first slot of @a bottom
+             */
+            _Inner *_New_path(unsigned level, uint64_t owner, _Inner *&bottom)
+            {
+                _Inner *top = _New_inner(owner);
+                bottom = top;
+                try
+                {
+                    for (unsigned below = level; below > _Pvec_bits; below -= _Pvec_bits)
+                    {
+                        _Inner *child = _New_inner(owner);
+                        bottom->_Child[0] = child;
+                        bottom = child;
+                    }
+                }
+                catch (...)
+                {
+                    _Release_inner(top, level);
+                    throw;
+                }
+                return top;
+            }
+
+            /**
+             * @brief Moves the full tail into the trie, adding a level when
+             *        the trie is full. Nothing is linked before every node
+             *        is allocated, so a failure leaves the trie as it was.
+             */
+            void _Push_tail(uint64_t owner)
+            {
+                // index of the last element of the tail
+                const size_t i = _Size - 1;
+                _Inner *bottom;
+                if (!_Root)
+                {
+                    _Root = _New_path(_Pvec_bits, owner, bottom);
+                    bottom->_Child[0] = _Tail;
+                    _Shift = _Pvec_bits;
+                    _Tail = nullptr;
+                    return;
+                }
+                if ((_Size >> _Pvec_bits) > (size_t(1) << _Shift))
+                {
+                    _Inner *path = _New_path(_Shift, owner, bottom);
+                    _Inner *root;
+                    try
+                    {
+                        root = _New_inner(owner);
+                    }
+                    catch (...)
+                    {
+                        _Release_inner(path, _Shift);
+                        throw;
+                    }
+                    bottom->_Child[0] = _Tail;
+                    root->_Child[0] = _Root;
+                    root->_Child[1] = path;
+                    _Root = root;
+                    _Shift += _Pvec_bits;
+                    _Tail = nullptr;
+                    return;
+                }
+
+                _Root = _Edit_inner(_Root, _Shift, owner);
+                _Inner *node = _Root;
+                for (unsigned level = _Shift;; level -= _Pvec_bits)
+                {
+                    Pvec_node *&slot = node->_Child[(i >> level) & _Pvec_mask];
+                    if (level == _Pvec_bits)
+                    {
+                        slot = _Tail;
+                        break;
+                    }
+                    if (!slot)
+                    {
+                        _Inner *path = _New_path(level - _Pvec_bits, owner, bottom);
+                        bottom->_Child[0] = _Tail;
+                        slot = path;
+                        break;
+                    }
+                    slot = _Edit_inner(static_cast<_Inner *>(slot), level - _Pvec_bits, owner);
+                    node = static_cast<_Inner *>(slot);
+                }
+                _Tail = nullptr;
+            }
+
+            /**
+             * @brief Unlinks the leaf holding element @a i, the last leaf of
+             *        the trie, with the inner nodes it leaves empty, then
+             *        drops a level the root no longer needs
+             */
+            void _Pop_tail(size_t i, uint64_t owner)
+            {
+                if (i < _Pvec_width)
+                {
+                    _Release_inner(_Root, _Shift);
+                    _Root = nullptr;
+                    _Shift = _Pvec_bits;
+                    return;
+                }
+
+                _Root = _Edit_inner(_Root, _Shift, owner);
+                _Inner *node = _Root;
+                for (unsigned level = _Shift;; level -= _Pvec_bits)
+                {
+                    Pvec_node *&slot = node->_Child[(i >> level) & _Pvec_mask];
+                    if (level == _Pvec_bits)
+                    {
+                        _Release_leaf(static_cast<_Leaf *>(slot));
+                        slot = nullptr;
+                        break;
+                    }
+                    // the subtree empties when the leaf is its first one
+                    if ((i & ((size_t(1) << level) - 1)) < _Pvec_width)
+                    {
+                        _Release_inner(static_cast<_Inner *>(slot), level - _Pvec_bits);
+                        slot = nullptr;
+                        break;
+                    }
+                    slot = _Edit_inner(static_cast<_Inner *>(slot), level - _Pvec_bits, owner);
+                    node = static_cast<_Inner *>(slot);
+                }
+
+                if (_Shift > _Pvec_bits && !_Root->_Child[1])
+                {
+                    _Inner *only = static_cast<_Inner *>(_Root->_Child[0]);
+                    _Retain(only);
+                    _Release_inner(_Root, _Shift);
+                    _Root = only;
+                    _Shift -= _Pvec_bits;
+                }
+            }
+        };
+
+        /**
+         * @brief Random access iterator of persistent_vector and
+         *        transient_vector. It keeps the leaf it is in, so a walk
+         *        descends the trie once per 32 elements.
+         */
+        template <class _Ty, class _Alloc>
+        class Pvec_iterator
+        {
+            using _Trie = Pvec_base<_Ty, _Alloc>;
+
+            template <class, class>
+            friend class collections::persistent_vector;
+
+            template <class, class>
+            friend class collections::transient_vector;
+
+        public:
+            using value_type = _Ty;
+            using reference = const value_type &;
+            using pointer = const value_type *;
+            using difference_type = ptrdiff_t;
+            using iterator_category = std::random_access_iterator_tag;
+
+            using Self = Pvec_iterator<_Ty, _Alloc>;
+
+            Pvec_iterator() noexcept = default;
+
+            reference operator*() const noexcept
+            {
+                return *operator->();
+            }
+
+            pointer operator->() const noexcept
+            {
+                if (!_Leaf || _Index - _Leaf_first >= _Leaf->_Count)
+                {
+                    // the tail starts on a multiple of 32 as well
+                    _Leaf_first = _Index & ~_Pvec_mask;
+                    _Leaf = _Trie_of()._Leaf_for(_Index);
+                }
+                return _Leaf->_Valptr(_Index - _Leaf_first);
+            }
+
+            reference operator[](difference_type offset) const noexcept
+            {
+                return *(*this + offset);
+            }
+
+            Self &operator++() noexcept
+            {
+                ++_Index;
+                return *this;
+            }
+
+            Self operator++(int) noexcept
+            {
+                Self temp{*this};
+                ++_Index;
+                return temp;
+            }
+
+            Self &operator--() noexcept
+            {
+                --_Index;
+                return *this;
+            }
+
+            Self operator--(int) noexcept
+            {
+                Self temp{*this};
+                --_Index;
+                return temp;
+            }
+
+            Self &operator+=(difference_type offset) noexcept
+            {
+                _Index += size_t(offset);
+                return *this;
+            }
+
+            Self &operator-=(difference_type offset) noexcept
+            {
+                return operator+=(-offset);
+            }
+
+            Self operator+(difference_type offset) const noexcept
+            {
+                Self temp{*this};
+                return temp += offset;
+            }
+
+            Self operator-(difference_type offset) const noexcept
+            {
+                Self temp{*this};
+                return temp -= offset;
+            }
+
+            friend Self operator+(difference_type offset, Self const &x) noexcept
+            {
+                return x + offset;
+            }
+
+            friend difference_type operator-(Self const &x, Self const &y) noexcept
+            {
+                return difference_type(x._Index - y._Index);
+            }
+
+            friend bool operator==(Self const &x, Self const &y) noexcept
+            {
+                return x._Index == y._Index;
+            }
+
+            friend bool operator!=(Self const &x, Self const &y) noexcept
+            {
+                return x._Index != y._Index;
+            }
+
+            friend bool operator<(Self const &x, Self const &y) noexcept
+            {
+                return x._Index < y._Index;
+            }
+
+            friend bool operator>(Self const &x, Self const &y) noexcept
+            {
+                return y < x;
+            }
+
+            friend bool operator<=(Self const &x, Self const &y) noexcept
+            {
+                return !(y < x);
+            }
+
+            friend bool operator>=(Self const &x, Self const &y) noexcept
+            {
+                return !(x < y);
+            }
+
+        private:
+            Pvec_iterator(const void *trie, size_t index) noexcept
+                : _Owner(trie), _Index(index)
+            {
+            }
+
+            const _Trie &_Trie_of() const noexcept
+            {
+                return *static_cast<const _Trie *>(_Owner);
+            }
+
+            const void *_Owner = nullptr;
+            size_t _Index = 0;
+            mutable const Pvec_leaf<_Ty> *_Leaf = nullptr;
+            mutable size_t _Leaf_first = 0;
+        };
+    }
+
+    /**
+     * @brief Immutable vector with structural sharing. Every update returns
+     *        a new version in O(log32 n), copying only the nodes on its path;
+     *        copies of a version are O(1) snapshots that stay valid however
+     *        the other versions change. Versions may be read from many
+     *        threads at once. For batches of updates, take a transient().
+     *
+     * @tparam _Ty
+     * @tparam _Alloc
+     */
+    template <class _Ty, class _Alloc = std::allocator<_Ty>>
+    class persistent_vector
+        : protected __base::Pvec_base<_Ty, _Alloc>
+    {
+        using _Base = __base::Pvec_base<_Ty, _Alloc>;
+
+        friend class transient_vector<_Ty, _Alloc>;
+
+    public:
+        using value_type = _Ty;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = const value_type &;
+        using const_reference = const value_type &;
+        using const_iterator = __base::Pvec_iterator<_Ty, _Alloc>;
+        using iterator = const_iterator;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using reverse_iterator = const_reverse_iterator;
+        using transient_type = transient_vector<_Ty, _Alloc>;
+
+        persistent_vector() = default;
+
+        explicit persistent_vector(const allocator_type &alloc)
+            : _Base(alloc)
+        {
+        }
+
+        /**
+         * @brief Construct a new persistent vector with copies of range
+         *        [first, last)
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         * @param alloc
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        persistent_vector(Input first, Input last, const allocator_type &alloc = allocator_type())
+            : _Base(alloc)
+        {
+            transient_type batch = transient();
+            for (; first != last; ++first)
+                batch.push_back(*first);
+            *this = batch.persistent();
+        }
+
+        persistent_vector(std::initializer_list<value_type> l, const allocator_type &alloc = allocator_type())
+            : persistent_vector(l.begin(), l.end(), alloc)
+        {
+        }
+
+        persistent_vector(const persistent_vector &) = default;
+        persistent_vector(persistent_vector &&) noexcept = default;
+
+        persistent_vector &operator=(const persistent_vector &x)
+        {
+            persistent_vector(x).swap(*this);
+            return *this;
+        }
+
+        persistent_vector &operator=(persistent_vector &&x) noexcept
+        {
+            persistent_vector(std::move(x)).swap(*this);
+            return *this;
+        }
+
+        void swap(persistent_vector &x) noexcept
+        {
+            this->_Swap(x);
+        }
+
+        allocator_type get_allocator() const
+        {
+            return allocator_type(this->_M_alloc);
+        }
+
+        size_type size() const noexcept
+        {
+            return this->_Size;
+        }
+
+        bool empty() const noexcept
+        {
+            return !this->_Size;
+        }
+
+        const_reference operator[](size_type n) const noexcept
+        {
+            return this->_Get(n);
+        }
+
+        const_reference at(size_type n) const
+        {
+            this->_Range_check(n, "collections::persistent_vector::at");
+            return this->_Get(n);
+        }
+
+        const_reference front() const noexcept
+        {
+            return this->_Get(0);
+        }
+
+        const_reference back() const noexcept
+        {
+            return *this->_Tail->_Valptr(this->_Tail->_Count - 1);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(static_cast<const _Base *>(this), 0);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(static_cast<const _Base *>(this), this->_Size);
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        /**
+         * @brief A version with @a value appended
+         *
+         */
+        [[nodiscard]] persistent_vector push_back(const value_type &value) const
+        {
+            persistent_vector result(*this);
+            result._Emplace_back(0, value);
+            return result;
+        }
+
+        [[nodiscard]] persistent_vector push_back(value_type &&value) const
+        {
+            persistent_vector result(*this);
+            result._Emplace_back(0, std::move(value));
+            return result;
+        }
+
+        /**
+         * @brief A version with element @a n replaced by @a value
+         *
+         * @throw std::out_of_range if @a n >= size()
+         */
+        [[nodiscard]] persistent_vector set(size_type n, const value_type &value) const
+        {
+            this->_Range_check(n, "collections::persistent_vector::set");
+            persistent_vector result(*this);
+            result._Set(n, value, 0);
+            return result;
+        }
+
+        [[nodiscard]] persistent_vector set(size_type n, value_type &&value) const
+        {
+            this->_Range_check(n, "collections::persistent_vector::set");
+            persistent_vector result(*this);
+            result._Set(n, std::move(value), 0);
+            return result;
+        }
+
+        /**
+         * @brief A version without the last element; the vector must not be
+         *        empty
+         *
+         */
+        [[nodiscard]] persistent_vector pop_back() const
+        {
+            persistent_vector result(*this);
+            result._Pop_back(0);
+            return result;
+        }
+
+        /**
+         * @brief A mutable copy for a batch of updates, which then change
+         *        the nodes the batch has already copied in place
+         *
+         * @return transient_type
+         */
+        transient_type transient() const
+        {
+            return transient_type(*this);
+        }
+
+        friend bool operator==(const persistent_vector &x, const persistent_vector &y)
+        {
+            if (x._Size != y._Size)
+                return false;
+            if (x._Root == y._Root && x._Tail == y._Tail)
+                return true;
+            return std::equal(x.begin(), x.end(), y.begin());
+        }
+
+        friend bool operator!=(const persistent_vector &x, const persistent_vector &y)
+        {
+            return !(x == y);
+        }
+
+    private:
+        explicit persistent_vector(const _Base &trie) noexcept
+            : _Base(trie)
+        {
+        }
+    };
+
+    /**
+     * @brief Mutable form of a persistent_vector, for batches of updates.
+     *        The first change of a node copies it as usual, later ones
+     *        change the copy in place; persistent() ends the ownership, so
+     *        versions taken from it never change. Not for concurrent use.
+     *
+     * @tparam _Ty
+     * @tparam _Alloc
+     */
+    template <class _Ty, class _Alloc = std::allocator<_Ty>>
+    class transient_vector
+        : protected __base::Pvec_base<_Ty, _Alloc>
+    {
+        using _Base = __base::Pvec_base<_Ty, _Alloc>;
+
+        friend class persistent_vector<_Ty, _Alloc>;
+
+    public:
+        using value_type = _Ty;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = const value_type &;
+        using const_reference = const value_type &;
+        using const_iterator = __base::Pvec_iterator<_Ty, _Alloc>;
+        using iterator = const_iterator;
+        using persistent_type = persistent_vector<_Ty, _Alloc>;
+
+        explicit transient_vector(const allocator_type &alloc = allocator_type())
+            : _Base(alloc), _Owner(__base::_Pvec_new_owner())
+        {
+        }
+
+        transient_vector(transient_vector &&x) noexcept
+            : _Base(std::move(x)), _Owner(x._Owner)
+        {
+            x._Owner = __base::_Pvec_new_owner();
+        }
+
+        transient_vector &operator=(transient_vector &&x) noexcept
+        {
+            transient_vector(std::move(x)).swap(*this);
+            return *this;
+        }
+
+        transient_vector(const transient_vector &) = delete;
+        transient_vector &operator=(const transient_vector &) = delete;
+
+        void swap(transient_vector &x) noexcept
+        {
+            this->_Swap(x);
+            std::swap(_Owner, x._Owner);
+        }
+
+        size_type size() const noexcept
+        {
+            return this->_Size;
+        }
+
+        bool empty() const noexcept
+        {
+            return !this->_Size;
+        }
+
+        const_reference operator[](size_type n) const noexcept
+        {
+            return this->_Get(n);
+        }
+
+        const_reference at(size_type n) const
+        {
+            this->_Range_check(n, "collections::transient_vector::at");
+            return this->_Get(n);
+        }
+
+        const_reference back() const noexcept
+        {
+            return *this->_Tail->_Valptr(this->_Tail->_Count - 1);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(static_cast<const _Base *>(this), 0);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(static_cast<const _Base *>(this), this->_Size);
+        }
+
+        void push_back(const value_type &value)
+        {
+            this->_Emplace_back(_Owner, value);
+        }
+
+        void push_back(value_type &&value)
+        {
+            this->_Emplace_back(_Owner, std::move(value));
+        }
+
+        template <class... _Args>
+        const_reference emplace_back(_Args &&...args)
+        {
+            this->_Emplace_back(_Owner, std::forward<_Args>(args)...);
+            return back();
+        }
+
+        /**
+         * @brief Replaces element @a n by @a value
+         *
+         * @throw std::out_of_range if @a n >= size()
+         */
+        template <class _Value>
+        void set(size_type n, _Value &&value)
+        {
+            this->_Range_check(n, "collections::transient_vector::set");
+            this->_Set(n, std::forward<_Value>(value), _Owner);
+        }
+
+        void pop_back()
+        {
+            this->_Pop_back(_Owner);
+        }
+
+        /**
+         * @brief The current contents as a persistent_vector. The transient
+         *        stays usable; its next changes copy what they touch again.
+         *
+         * @return persistent_type
+         */
+        persistent_type persistent()
+        {
+            _Owner = __base::_Pvec_new_owner();
+            return persistent_type(static_cast<const _Base &>(*this));
+        }
+
+    private:
+        explicit transient_vector(const persistent_type &x)
+            : _Base(static_cast<const _Base &>(x)), _Owner(__base::_Pvec_new_owner())
+        {
+        }
+
+        uint64_t _Owner;
+    };
+}
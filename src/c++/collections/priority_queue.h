@@ -0,0 +1,596 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+#include "vector.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        /**
+         * @brief Implicit d-ary heap operations over a random access range.
+         *        The root is at 0 and the children of i are
+         *        [i * _Arity + 1, i * _Arity + _Arity].
+         *
+         * @tparam _Arity
+         */
+        template <size_t _Arity>
+        class Heap_base
+        {
+            static_assert(_Arity >= 2, "a heap needs at least two children per node");
+
+        public:
+            static size_t _Parent(size_t i) noexcept
+            {
+                return (i - 1) / _Arity;
+            }
+
+            static size_t _First_child(size_t i) noexcept
+            {
+                return i * _Arity + 1;
+            }
+
+            /**
+             * @brief Index of the child of @a i that must be on top, or @a n
+             *        when @a i is a leaf.
+             */
+            template <class _Ty, class _Compare>
+            static size_t _Top_child(const _Ty *data, size_t i, size_t n, const _Compare &comp)
+            {
+                size_t first = _First_child(i);
+                if (first >= n)
+                    return n;
+                const size_t last = std::min(first + _Arity, n);
+                size_t best = first;
+                for (size_t c = first + 1; c < last; ++c)
+                    if (comp(data[best], data[c]))
+                        best = c;
+                return best;
+            }
+
+            /**
+             * @brief Moves the element at @a i up while it beats its parent.
+             *        @a moved is called with every element that changes slot.
+             */
+            template <class _Ty, class _Compare, class _Moved>
+            static size_t _Sift_up(_Ty *data, size_t i, const _Compare &comp, _Moved &&moved)
+            {
+                _Ty value = std::move(data[i]);
+                while (i > 0)
+                {
+                    const size_t parent = _Parent(i);
+                    if (!comp(data[parent], value))
+                        break;
+                    data[i] = std::move(data[parent]);
+                    moved(data[i], i);
+                    i = parent;
+                }
+                data[i] = std::move(value);
+                moved(data[i], i);
+                return i;
+            }
+
+            /**
+             * @brief Moves the element at @a i down while a child beats it.
+             */
+            template <class _Ty, class _Compare, class _Moved>
+            static size_t _Sift_down(_Ty *data, size_t i, size_t n, const _Compare &comp, _Moved &&moved)
+            {
+                _Ty value = std::move(data[i]);
+                while (true)
+                {
+                    const size_t child = _Top_child(data, i, n, comp);
+                    if (child == n || !comp(value, data[child]))
+                        break;
+                    data[i] = std::move(data[child]);
+                    moved(data[i], i);
+                    i = child;
+                }
+                data[i] = std::move(value);
+                moved(data[i], i);
+                return i;
+            }
+
+            /**
+             * @brief Floyd's bottom-up construction, O(n).
+             */
+            template <class _Ty, class _Compare, class _Moved>
+            static void _Heapify(_Ty *data, size_t n, const _Compare &comp, _Moved &&moved)
+            {
+                if (n < 2)
+                    return;
+                for (size_t i = _Parent(n - 1) + 1; i-- > 0;)
+                    _Sift_down(data, i, n, comp, moved);
+            }
+        };
+
+        struct Heap_no_tracking
+        {
+            template <class _Ty>
+            void operator()(const _Ty &, size_t) const noexcept
+            {
+            }
+        };
+    }
+
+    /**
+     * @brief Priority queue over a d-ary heap in a collections::vector. The
+     *        top is the greatest element under _Compare. A 4-ary heap halves
+     *        the depth of a binary one and the children of a node share a
+     *        cache line.
+     *
+     * @tparam _Ty
+     * @tparam _Compare
+     * @tparam _Arity
+     * @tparam _Alloc
+     */
+    template <class _Ty, class _Compare = std::less<_Ty>, size_t _Arity = 4,
+              class _Alloc = std::allocator<_Ty>>
+    class priority_queue : protected __base::Heap_base<_Arity>
+    {
+        using _Base = __base::Heap_base<_Arity>;
+
+    public:
+        using value_type = _Ty;
+        using reference = _Ty &;
+        using const_reference = const _Ty &;
+        using size_type = size_t;
+        using value_compare = _Compare;
+        using container_type = vector<_Ty, _Alloc>;
+
+        static constexpr size_type arity = _Arity;
+
+        /**
+         * @brief Construct a new priority queue object with no elements
+         *
+         */
+        priority_queue()
+        {
+        }
+
+        explicit priority_queue(const _Compare &comp)
+            : _Comp(comp)
+        {
+        }
+
+        /**
+         * @brief Adopts @a container and heapifies it in O(n)
+         *
+         * @param container
+         * @param comp
+         */
+        explicit priority_queue(container_type &&container, const _Compare &comp = _Compare())
+            : _Data(std::move(container)), _Comp(comp)
+        {
+            heapify();
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        priority_queue(Input first, Input last, const _Compare &comp = _Compare())
+            : _Data(first, last), _Comp(comp)
+        {
+            heapify();
+        }
+
+        priority_queue(std::initializer_list<value_type> l, const _Compare &comp = _Compare())
+            : _Data(l), _Comp(comp)
+        {
+            heapify();
+        }
+
+        bool empty() const noexcept
+        {
+            return _Data.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return _Data.size();
+        }
+
+        void reserve(size_type n)
+        {
+            _Data.reserve(n);
+        }
+
+        void clear() noexcept
+        {
+            _Data.clear();
+        }
+
+        /**
+         * @brief Gets the greatest element
+         *
+         * @return const_reference
+         */
+        const_reference top() const noexcept
+        {
+            return _Data.front();
+        }
+
+        void push(const value_type &value)
+        {
+            emplace(value);
+        }
+
+        void push(value_type &&value)
+        {
+            emplace(std::move(value));
+        }
+
+        template <class... _Args>
+        void emplace(_Args &&...args)
+        {
+            _Data.emplace_back(std::forward<_Args>(args)...);
+            _Base::_Sift_up(_Data.data(), _Data.size() - 1, _Comp, __base::Heap_no_tracking());
+        }
+
+        /**
+         * @brief Removes the greatest element
+         *
+         */
+        void pop()
+        {
+            if (_Data.size() > 1)
+            {
+                _Data.front() = std::move(_Data.back());
+                _Data.pop_back();
+                _Base::_Sift_down(_Data.data(), 0, _Data.size(), _Comp, __base::Heap_no_tracking());
+            }
+            else
+                _Data.pop_back();
+        }
+
+        /**
+         * @brief Removes and returns the greatest element
+         *
+         * @return value_type
+         */
+        value_type extract_top()
+        {
+            value_type value = std::move(_Data.front());
+            pop();
+            return value;
+        }
+
+        /**
+         * @brief Replaces the greatest element, cheaper than pop then push:
+         *        one sift instead of two. Useful for top-k selection.
+         *
+         * @param value
+         */
+        void replace_top(value_type value)
+        {
+            _Data.front() = std::move(value);
+            _Base::_Sift_down(_Data.data(), 0, _Data.size(), _Comp, __base::Heap_no_tracking());
+        }
+
+        /**
+         * @brief Appends a range without restoring the heap property per
+         *        element, then rebuilds it in O(n).
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void push_range(Input first, Input last)
+        {
+            _Data.insert(_Data.cend(), first, last);
+            heapify();
+        }
+
+        /**
+         * @brief Restores the heap property over the whole storage in O(n)
+         *
+         */
+        void heapify()
+        {
+            _Base::_Heapify(_Data.data(), _Data.size(), _Comp, __base::Heap_no_tracking());
+        }
+
+        /**
+         * @brief Gives back the storage, in heap order
+         *
+         * @return container_type
+         */
+        container_type release() noexcept
+        {
+            return std::move(_Data);
+        }
+
+        const container_type &container() const noexcept
+        {
+            return _Data;
+        }
+
+        void swap(priority_queue &x) noexcept
+        {
+            _Data.swap(x._Data);
+            std::swap(_Comp, x._Comp);
+        }
+
+    private:
+        container_type _Data;
+        _Compare _Comp;
+    };
+
+    /**
+     * @brief Priority queue whose elements are reachable through stable
+     *        handles, for decrease_key/increase_key and erase of arbitrary
+     *        elements in O(log n). Each element records its heap slot in a
+     *        side table indexed by handle.
+     *
+     * @tparam _Ty
+     * @tparam _Compare
+     * @tparam _Arity
+     * @tparam _Alloc
+     */
+    template <class _Ty, class _Compare = std::less<_Ty>, size_t _Arity = 4,
+              class _Alloc = std::allocator<_Ty>>
+    class indexed_priority_queue : protected __base::Heap_base<_Arity>
+    {
+        using _Base = __base::Heap_base<_Arity>;
+
+    public:
+        using value_type = _Ty;
+        using const_reference = const _Ty &;
+        using size_type = size_t;
+        using value_compare = _Compare;
+        using handle_type = size_t;
+
+        static constexpr size_type arity = _Arity;
+        static constexpr handle_type npos = handle_type(-1);
+
+    private:
+        struct Heap_entry
+        {
+            _Ty _Value;
+            handle_type _Handle;
+        };
+
+        struct Entry_compare
+        {
+            _Compare _Comp;
+
+            bool operator()(const Heap_entry &x, const Heap_entry &y) const
+            {
+                return _Comp(x._Value, y._Value);
+            }
+        };
+
+        using entry_alloc_t = typename std::allocator_traits<_Alloc>::template rebind_alloc<Heap_entry>;
+        using slot_alloc_t = typename std::allocator_traits<_Alloc>::template rebind_alloc<size_t>;
+
+        /**
+         * @brief Keeps the slot table in sync as entries move in the heap.
+         */
+        struct Slot_tracker
+        {
+            size_t *_Slots;
+
+            void operator()(const Heap_entry &entry, size_t i) const noexcept
+            {
+                _Slots[entry._Handle] = i;
+            }
+        };
+
+    public:
+        /**
+         * @brief Construct a new indexed priority queue object with no elements
+         *
+         */
+        indexed_priority_queue()
+        {
+        }
+
+        explicit indexed_priority_queue(const _Compare &comp)
+            : _Comp{comp}
+        {
+        }
+
+        bool empty() const noexcept
+        {
+            return _Heap.empty();
+        }
+
+        size_type size() const noexcept
+        {
+            return _Heap.size();
+        }
+
+        void reserve(size_type n)
+        {
+            _Heap.reserve(n);
+            _Slots.reserve(n);
+        }
+
+        const_reference top() const noexcept
+        {
+            return _Heap.front()._Value;
+        }
+
+        /**
+         * @brief Handle of the greatest element
+         *
+         * @return handle_type
+         */
+        handle_type top_handle() const noexcept
+        {
+            return _Heap.front()._Handle;
+        }
+
+        /**
+         * @brief Checks whether @a handle refers to an element in the queue
+         *
+         * @param handle
+         * @return true
+         * @return false
+         */
+        bool contains(handle_type handle) const noexcept
+        {
+            return handle < _Slots.size() && _Slots[handle] != npos;
+        }
+
+        /**
+         * @brief Gets the element behind @a handle
+         *
+         * @param handle
+         * @return const_reference
+         */
+        const_reference operator[](handle_type handle) const noexcept
+        {
+            return _Heap[_Slots[handle]]._Value;
+        }
+
+        /**
+         * @brief Inserts a new element
+         *
+         * @return handle_type A handle valid until the element leaves the queue
+         */
+        template <class... _Args>
+        handle_type emplace(_Args &&...args)
+        {
+            handle_type handle;
+            if (!_Free.empty())
+            {
+                handle = _Free.back();
+                _Free.pop_back();
+            }
+            else
+            {
+                handle = _Slots.size();
+                _Slots.push_back(npos);
+            }
+            _Heap.push_back(Heap_entry{_Ty(std::forward<_Args>(args)...), handle});
+            _Base::_Sift_up(_Heap.data(), _Heap.size() - 1, _Comp, _Tracker());
+            return handle;
+        }
+
+        handle_type push(const value_type &value)
+        {
+            return emplace(value);
+        }
+
+        handle_type push(value_type &&value)
+        {
+            return emplace(std::move(value));
+        }
+
+        /**
+         * @brief Removes the greatest element
+         *
+         */
+        void pop()
+        {
+            _Remove_at(0);
+        }
+
+        value_type extract_top()
+        {
+            value_type value = std::move(_Heap.front()._Value);
+            _Remove_at(0);
+            return value;
+        }
+
+        /**
+         * @brief Changes the element behind @a handle and moves it to its
+         *        new place, up or down.
+         *
+         * @param handle
+         * @param value
+         */
+        void update(handle_type handle, value_type value)
+        {
+            const size_t i = _Slots[handle];
+            const bool up = _Comp._Comp(_Heap[i]._Value, value);
+            _Heap[i]._Value = std::move(value);
+            if (up)
+                _Base::_Sift_up(_Heap.data(), i, _Comp, _Tracker());
+            else
+                _Base::_Sift_down(_Heap.data(), i, _Heap.size(), _Comp, _Tracker());
+        }
+
+        /**
+         * @brief Gives the element behind @a handle a smaller key: the
+         *        classic decrease-key of a min-queue such as one ordered by
+         *        std::greater, where the element moves towards the top. The
+         *        direction of the move comes from comparing the old and new
+         *        key through _Compare, as in update(), so any comparator works.
+         *
+         * @param handle
+         * @param value
+         */
+        void decrease_key(handle_type handle, value_type value)
+        {
+            update(handle, std::move(value));
+        }
+
+        /**
+         * @brief Gives the element behind @a handle a larger key; see
+         *        decrease_key()
+         *
+         * @param handle
+         * @param value
+         */
+        void increase_key(handle_type handle, value_type value)
+        {
+            update(handle, std::move(value));
+        }
+
+        /**
+         * @brief Removes the element behind @a handle
+         *
+         * @param handle
+         */
+        void erase(handle_type handle)
+        {
+            _Remove_at(_Slots[handle]);
+        }
+
+        void clear() noexcept
+        {
+            _Heap.clear();
+            _Slots.clear();
+            _Free.clear();
+        }
+
+    private:
+        Slot_tracker _Tracker() noexcept
+        {
+            return Slot_tracker{_Slots.data()};
+        }
+
+        void _Remove_at(size_t i)
+        {
+            const handle_type handle = _Heap[i]._Handle;
+            const size_t last = _Heap.size() - 1;
+            if (i != last)
+            {
+                _Heap[i] = std::move(_Heap[last]);
+                _Heap.pop_back();
+                _Slots[_Heap[i]._Handle] = i;
+                if (i > 0 && _Comp(_Heap[_Base::_Parent(i)], _Heap[i]))
+                    _Base::_Sift_up(_Heap.data(), i, _Comp, _Tracker());
+                else
+                    _Base::_Sift_down(_Heap.data(), i, _Heap.size(), _Comp, _Tracker());
+            }
+            else
+                _Heap.pop_back();
+            _Slots[handle] = npos;
+            _Free.push_back(handle);
+        }
+
+        vector<Heap_entry, entry_alloc_t> _Heap;
+        vector<size_t, slot_alloc_t> _Slots;
+        vector<handle_type, slot_alloc_t> _Free;
+        Entry_compare _Comp;
+    };
+}
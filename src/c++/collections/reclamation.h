@@ -0,0 +1,667 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+#include "vector.h"
+
+namespace collections
+{
+    /**
+     * @brief Hazard slots a thread owns in each hazard_domain
+     */
+    constexpr size_t hazard_pointer_slots = 8;
+
+    namespace __base
+    {
+        /**
+         * @brief An object waiting for reclamation. Concrete records know how
+         *        to give their object back, through the allocator that made it
+         *        or through a deleter, and then release themselves.
+         */
+        struct Retired
+        {
+            Retired *_Next;
+            const void *_Key; // address readers protect
+            uint64_t _Epoch;
+            void (*_Reclaim)(Retired *) noexcept;
+        };
+
+        /**
+         * @brief Record for an object made with allocator_traits<_Alloc>. The
+         *        record itself is allocated with the same allocator rebound,
+         *        so deferred frees stay inside the caller's allocator model.
+         */
+        template <class _Alloc>
+        struct Retired_alloc
+            : Retired
+        {
+            using alloc_traits = std::allocator_traits<_Alloc>;
+            using record_alloc_t = typename alloc_traits::template rebind_alloc<Retired_alloc>;
+            using record_traits = std::allocator_traits<record_alloc_t>;
+
+            typename alloc_traits::pointer _Ptr;
+            _Alloc _M_alloc;
+
+            Retired_alloc(typename alloc_traits::pointer p, const _Alloc &alloc)
+                : Retired{nullptr, std::to_address(p), 0, &Retired_alloc::_Do_reclaim}, _Ptr(p), _M_alloc(alloc)
+            {
+            }
+
+            static Retired *_Make(typename alloc_traits::pointer p, const _Alloc &alloc)
+            {
+                record_alloc_t ralloc(alloc);
+                Retired_alloc *r = std::to_address(record_traits::allocate(ralloc, 1));
+                ::new (static_cast<void *>(r)) Retired_alloc(p, alloc);
+                return r;
+            }
+
+            static void _Do_reclaim(Retired *base) noexcept
+            {
+                Retired_alloc *r = static_cast<Retired_alloc *>(base);
+                alloc_traits::destroy(r->_M_alloc, std::to_address(r->_Ptr));
+                alloc_traits::deallocate(r->_M_alloc, r->_Ptr, 1);
+                record_alloc_t ralloc(r->_M_alloc);
+                r->~Retired_alloc();
+                record_traits::deallocate(ralloc, r, 1);
+            }
+        };
+
+        template <class _Ty, class _Deleter>
+        struct Retired_deleter
+            : Retired
+        {
+            _Ty *_Ptr;
+            _Deleter _Del;
+
+            Retired_deleter(_Ty *p, _Deleter del)
+                : Retired{nullptr, p, 0, &Retired_deleter::_Do_reclaim}, _Ptr(p), _Del(std::move(del))
+            {
+            }
+
+            static void _Do_reclaim(Retired *base) noexcept
+            {
+                Retired_deleter *r = static_cast<Retired_deleter *>(base);
+                r->_Del(r->_Ptr);
+                delete r;
+            }
+        };
+
+        /**
+         * @brief FIFO of retired objects owned by one thread record
+         */
+        struct Retired_list
+        {
+            Retired *_Head = nullptr;
+            Retired *_Tail = nullptr;
+            size_t _Count = 0;
+
+            void _Push(Retired *r) noexcept
+            {
+                r->_Next = nullptr;
+                if (_Tail)
+                    _Tail->_Next = r;
+                else
+                    _Head = r;
+                _Tail = r;
+                ++_Count;
+            }
+
+            template <class _Pred>
+            size_t _Reclaim_front_while(_Pred pred) noexcept
+            {
+                size_t n = 0;
+                while (_Head && pred(*_Head))
+                {
+                    Retired *r = _Head;
+                    _Head = r->_Next;
+                    r->_Reclaim(r);
+                    ++n;
+                }
+                if (!_Head)
+                    _Tail = nullptr;
+                _Count -= n;
+                return n;
+            }
+
+            template <class _Pred>
+            size_t _Reclaim_if(_Pred pred) noexcept
+            {
+                Retired *keep = nullptr;
+                Retired **tail = &keep;
+                Retired *last = nullptr;
+                size_t n = 0;
+                for (Retired *r = _Head; r;)
+                {
+                    Retired *next = r->_Next;
+                    if (pred(*r))
+                    {
+                        r->_Reclaim(r);
+                        ++n;
+                    }
+                    else
+                    {
+                        *tail = last = r;
+                        tail = &r->_Next;
+                    }
+                    r = next;
+                }
+                *tail = nullptr;
+                _Head = keep;
+                _Tail = last;
+                _Count -= n;
+                return n;
+            }
+
+            void _Reclaim_all() noexcept
+            {
+                _Reclaim_front_while([](const Retired &)
+                                     { return true; });
+            }
+        };
+
+        struct Reclaim_record
+        {
+            std::atomic<bool> _In_use{false};
+            Reclaim_record *_Next = nullptr;
+            Retired_list _Retired;
+        };
+
+        /**
+         * @brief Ids of live domains. Thread exit consults it so a thread
+         *        never touches the records of a domain destroyed before it.
+         */
+        class Reclaim_live_domains
+        {
+        public:
+            static Reclaim_live_domains &_Instance()
+            {
+                static Reclaim_live_domains *live = new Reclaim_live_domains;
+                return *live;
+            }
+
+            uint64_t _Register()
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                _Ids.push_back(++_Last);
+                return _Last;
+            }
+
+            void _Unregister(uint64_t id)
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                for (size_t i = 0; i < _Ids.size(); ++i)
+                    if (_Ids[i] == id)
+                    {
+                        _Ids[i] = _Ids.back();
+                        _Ids.pop_back();
+                        break;
+                    }
+            }
+
+            template <class _Fn>
+            void _For_live(_Fn fn)
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                fn(_Ids);
+            }
+
+        private:
+            std::mutex _Lock;
+            vector<uint64_t> _Ids;
+            uint64_t _Last = 0;
+        };
+
+        /**
+         * @brief The records a thread holds in each domain it has used;
+         *        they are handed back when the thread exits.
+         */
+        class Reclaim_thread_cache
+        {
+        public:
+            struct Entry
+            {
+                uint64_t _Domain;
+                Reclaim_record *_Record;
+            };
+
+            static Reclaim_thread_cache &_Get()
+            {
+                thread_local Reclaim_thread_cache cache;
+                return cache;
+            }
+
+            ~Reclaim_thread_cache()
+            {
+                if (_Entries.empty())
+                    return;
+                Reclaim_live_domains::_Instance()._For_live([this](const vector<uint64_t> &live)
+                                                            {
+                    for (const Entry &e : _Entries)
+                        if (std::find(live.begin(), live.end(), e._Domain) != live.end())
+                            e._Record->_In_use.store(false, std::memory_order_release); });
+            }
+
+            vector<Entry> _Entries;
+        };
+
+        /**
+         * @brief Owns the per-thread records of a domain. A thread acquires a
+         *        record on first use and keeps it until it exits; a later
+         *        thread may adopt it, retired objects included.
+         *
+         * @tparam _Record
+         */
+        template <class _Record>
+        class Reclaim_domain
+        {
+        public:
+            Reclaim_domain()
+                : _Id(Reclaim_live_domains::_Instance()._Register())
+            {
+            }
+
+            Reclaim_domain(const Reclaim_domain &) = delete;
+            Reclaim_domain &operator=(const Reclaim_domain &) = delete;
+
+            /**
+             * @brief Frees whatever is still retired. No thread may be inside
+             *        the domain any more.
+             */
+            ~Reclaim_domain()
+            {
+                Reclaim_live_domains::_Instance()._Unregister(_Id);
+                vector<Reclaim_thread_cache::Entry> &mine = Reclaim_thread_cache::_Get()._Entries;
+                for (size_t i = 0; i < mine.size(); ++i)
+                    if (mine[i]._Domain == _Id)
+                    {
+                        mine[i] = mine.back();
+                        mine.pop_back();
+                        break;
+                    }
+                _Record *r = static_cast<_Record *>(_Records.load(std::memory_order_acquire));
+                while (r)
+                {
+                    _Record *next = static_cast<_Record *>(r->_Next);
+                    r->_Retired._Reclaim_all();
+                    delete r;
+                    r = next;
+                }
+            }
+
+        protected:
+            _Record *_Local()
+            {
+                for (const Reclaim_thread_cache::Entry &e : Reclaim_thread_cache::_Get()._Entries)
+                    if (e._Domain == _Id)
+                        return static_cast<_Record *>(e._Record);
+                _Record *r = _Acquire();
+                Reclaim_thread_cache::_Get()._Entries.push_back({_Id, r});
+                return r;
+            }
+
+            template <class _Fn>
+            void _For_each_record(_Fn fn) const
+            {
+                for (Reclaim_record *r = _Records.load(std::memory_order_acquire); r; r = r->_Next)
+                    fn(*static_cast<_Record *>(r));
+            }
+
+            size_t _Record_count() const noexcept
+            {
+                return _Count.load(std::memory_order_relaxed);
+            }
+
+        private:
+            _Record *_Acquire()
+            {
+                for (Reclaim_record *r = _Records.load(std::memory_order_acquire); r; r = r->_Next)
+                {
+                    bool expected = false;
+                    if (!r->_In_use.load(std::memory_order_relaxed) &&
+                        r->_In_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                        return static_cast<_Record *>(r);
+                }
+                _Record *r = new _Record;
+                r->_In_use.store(true, std::memory_order_relaxed);
+                Reclaim_record *head = _Records.load(std::memory_order_relaxed);
+                do
+                    r->_Next = head;
+                while (!_Records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+                _Count.fetch_add(1, std::memory_order_relaxed);
+                return r;
+            }
+
+            const uint64_t _Id;
+            std::atomic<Reclaim_record *> _Records{nullptr};
+            std::atomic<size_t> _Count{0};
+        };
+
+        struct Epoch_record
+            : Reclaim_record
+        {
+            // (epoch << 1) | 1 while inside a guard, 0 when quiescent
+            std::atomic<uint64_t> _Local{0};
+            unsigned _Nest = 0;
+        };
+
+        struct Hazard_record
+            : Reclaim_record
+        {
+            std::atomic<const void *> _Hazards[hazard_pointer_slots] = {};
+            unsigned _Used = 0;
+        };
+    }
+
+    /**
+     * @brief Epoch based reclamation domain. Readers enter a critical region
+     *        with an epoch_guard; an object retired while the global epoch
+     *        is e is freed once the epoch reaches e + 2, at which point every
+     *        guard that could have seen it has ended. Entering and leaving a
+     *        guard costs a store and a fence, so it suits read-mostly
+     *        structures; a stalled reader holds back all reclamation.
+     *
+     *        Retire an object with the allocator that made it, as List_base
+     *        does with its node allocator:
+     *
+     *            domain.retire(node, node_alloc);    // destroy + deallocate later
+     *            domain.retire(new_ed_ptr);          // delete later
+     */
+    class epoch_domain
+        : public __base::Reclaim_domain<__base::Epoch_record>
+    {
+        friend class epoch_guard;
+
+    public:
+        /**
+         * @brief Construct a new epoch domain
+         *
+         * @param threshold Retired objects per thread between reclamation passes
+         */
+        explicit epoch_domain(size_t threshold = 128)
+            : _Threshold(threshold ? threshold : 1)
+        {
+        }
+
+        /**
+         * @brief Defers destroying and deallocating @a p through @a alloc
+         *        until no guard can reach it
+         */
+        template <class _Alloc, typename = std::_RequireAllocator<_Alloc>>
+        void retire(typename std::allocator_traits<_Alloc>::pointer p, const _Alloc &alloc)
+        {
+            _Retire(__base::Retired_alloc<_Alloc>::_Make(p, alloc));
+        }
+
+        /**
+         * @brief Defers del(p), by default delete p
+         */
+        template <class _Ty, class _Deleter = std::default_delete<_Ty>,
+                  typename = std::enable_if_t<std::is_invocable_v<_Deleter &, _Ty *>>>
+        void retire(_Ty *p, _Deleter del = _Deleter())
+        {
+            _Retire(new __base::Retired_deleter<_Ty, _Deleter>(p, std::move(del)));
+        }
+
+        /**
+         * @brief Tries to advance the epoch and frees what the calling thread
+         *        retired that is now unreachable
+         *
+         * @return size_t Objects freed
+         */
+        size_t collect()
+        {
+            return _Collect(*_Local());
+        }
+
+        uint64_t epoch() const noexcept
+        {
+            return _Epoch.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void _Enter()
+        {
+            __base::Epoch_record &r = *_Local();
+            if (r._Nest++ == 0)
+            {
+                r._Local.store(_Epoch.load(std::memory_order_relaxed) << 1 | 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        void _Leave() noexcept
+        {
+            __base::Epoch_record &r = *_Local();
+            if (--r._Nest == 0)
+                r._Local.store(0, std::memory_order_release);
+        }
+
+        void _Retire(__base::Retired *item)
+        {
+            __base::Epoch_record &r = *_Local();
+            item->_Epoch = _Epoch.load(std::memory_order_acquire);
+            r._Retired._Push(item);
+            if (r._Retired._Count >= _Threshold)
+                _Collect(r);
+        }
+
+        bool _Try_advance() noexcept
+        {
+            uint64_t epoch = _Epoch.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool blocked = false;
+            _For_each_record([&](const __base::Epoch_record &r)
+                             {
+                const uint64_t local = r._Local.load(std::memory_order_acquire);
+                if ((local & 1) && (local >> 1) != epoch)
+                    blocked = true; });
+            return !blocked && _Epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+        }
+
+        size_t _Collect(__base::Epoch_record &r)
+        {
+            _Try_advance();
+            const uint64_t epoch = _Epoch.load(std::memory_order_acquire);
+            return r._Retired._Reclaim_front_while([epoch](const __base::Retired &item)
+                                                   { return item._Epoch + 2 <= epoch; });
+        }
+
+        std::atomic<uint64_t> _Epoch{2};
+        const size_t _Threshold;
+    };
+
+    /**
+     * @brief Critical region of an epoch_domain. Pointers loaded from the
+     *        structure stay valid until the guard ends. Guards nest.
+     *
+     */
+    class epoch_guard
+    {
+    public:
+        explicit epoch_guard(epoch_domain &domain)
+            : _Domain(domain)
+        {
+            _Domain._Enter();
+        }
+
+        epoch_guard(const epoch_guard &) = delete;
+        epoch_guard &operator=(const epoch_guard &) = delete;
+
+        ~epoch_guard()
+        {
+            _Domain._Leave();
+        }
+
+    private:
+        epoch_domain &_Domain;
+    };
+
+    /**
+     * @brief Hazard pointer domain. A reader publishes the address it is about
+     *        to use in one of its hazard slots; a retired object is freed by a
+     *        scan that finds it in no slot. Memory held back is bounded by the
+     *        number of slots, whatever the readers do, at the price of a
+     *        fenced store per protected pointer.
+     *
+     *        Each thread owns hazard_pointer_slots slots in a domain.
+     */
+    class hazard_domain
+        : public __base::Reclaim_domain<__base::Hazard_record>
+    {
+        friend class hazard_pointer;
+
+    public:
+        /**
+         * @brief Construct a new hazard domain
+         *
+         * @param threshold Minimum retired objects per thread between scans;
+         *        the effective value also grows with the number of slots
+         */
+        explicit hazard_domain(size_t threshold = 64)
+            : _Threshold(threshold ? threshold : 1)
+        {
+        }
+
+        template <class _Alloc, typename = std::_RequireAllocator<_Alloc>>
+        void retire(typename std::allocator_traits<_Alloc>::pointer p, const _Alloc &alloc)
+        {
+            _Retire(__base::Retired_alloc<_Alloc>::_Make(p, alloc));
+        }
+
+        template <class _Ty, class _Deleter = std::default_delete<_Ty>,
+                  typename = std::enable_if_t<std::is_invocable_v<_Deleter &, _Ty *>>>
+        void retire(_Ty *p, _Deleter del = _Deleter())
+        {
+            _Retire(new __base::Retired_deleter<_Ty, _Deleter>(p, std::move(del)));
+        }
+
+        /**
+         * @brief Frees what the calling thread retired that no slot protects
+         *
+         * @return size_t Objects freed
+         */
+        size_t collect()
+        {
+            return _Scan(*_Local());
+        }
+
+    private:
+        void _Retire(__base::Retired *item)
+        {
+            __base::Hazard_record &r = *_Local();
+            r._Retired._Push(item);
+            if (r._Retired._Count >= std::max(_Threshold, 2 * hazard_pointer_slots * _Record_count()))
+                _Scan(r);
+        }
+
+        size_t _Scan(__base::Hazard_record &r)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            vector<const void *> hazards;
+            _For_each_record([&hazards](const __base::Hazard_record &h)
+                             {
+                for (const auto &slot : h._Hazards)
+                    if (const void *p = slot.load(std::memory_order_acquire))
+                        hazards.push_back(p); });
+            std::sort(hazards.begin(), hazards.end());
+            return r._Retired._Reclaim_if([&hazards](const __base::Retired &item)
+                                          { return !std::binary_search(hazards.begin(), hazards.end(), item._Key); });
+        }
+
+        const size_t _Threshold;
+    };
+
+    /**
+     * @brief One hazard slot of the calling thread. protect() publishes a
+     *        pointer so a concurrent retire cannot free it until reset() or
+     *        destruction.
+     *
+     */
+    class hazard_pointer
+    {
+    public:
+        /**
+         * @throws std::length_error when the thread has no free slot left
+         */
+        explicit hazard_pointer(hazard_domain &domain)
+            : _Record(domain._Local())
+        {
+            const unsigned free = ~_Record->_Used & ((1u << hazard_pointer_slots) - 1);
+            if (!free)
+                throw std::length_error("collections::hazard_pointer: out of hazard slots");
+            _Slot = unsigned(__builtin_ctz(free));
+            _Record->_Used |= 1u << _Slot;
+        }
+
+        hazard_pointer(const hazard_pointer &) = delete;
+        hazard_pointer &operator=(const hazard_pointer &) = delete;
+
+        ~hazard_pointer()
+        {
+            reset();
+            _Record->_Used &= ~(1u << _Slot);
+        }
+
+        /**
+         * @brief Loads @a src and protects the result, retrying until the
+         *        published value is still the current one
+         */
+        template <class _Ty>
+        _Ty *protect(const std::atomic<_Ty *> &src) noexcept
+        {
+            return protect(src, [](_Ty *p)
+                           { return p; });
+        }
+
+        /**
+         * @brief As protect(src), publishing unmask(value) instead, for
+         *        sources that carry mark bits
+         */
+        template <class _Ty, class _Unmask>
+        _Ty *protect(const std::atomic<_Ty *> &src, _Unmask unmask) noexcept
+        {
+            _Ty *p = src.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                reset(unmask(p));
+                _Ty *again = src.load(std::memory_order_acquire);
+                if (again == p)
+                    return p;
+                p = again;
+            }
+        }
+
+        /**
+         * @brief Publishes @a p as is; the caller must validate it afterwards
+         */
+        void reset(const void *p = nullptr) noexcept
+        {
+            _Record->_Hazards[_Slot].store(p, std::memory_order_seq_cst);
+        }
+
+    private:
+        __base::Hazard_record *_Record;
+        unsigned _Slot;
+    };
+
+    /**
+     * @brief Process wide domains, never destroyed, for structures that do
+     *        not need their own.
+     */
+    inline epoch_domain &default_epoch_domain()
+    {
+        static epoch_domain *domain = new epoch_domain;
+        return *domain;
+    }
+
+    inline hazard_domain &default_hazard_domain()
+    {
+        static hazard_domain *domain = new hazard_domain;
+        return *domain;
+    }
+}
@@ -0,0 +1,1187 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <initializer_list>
+#include "vector.h"
+#include "bitset.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        enum class Roaring_kind : uint8_t
+        {
+            array = 0,
+            bitmap = 1,
+            run = 2
+        };
+
+        /**
+         * @brief Sets the bits [lo, hi] (inclusive) of a word array.
+         */
+        inline void _Bits_set_range(uint64_t *words, uint32_t lo, uint32_t hi) noexcept
+        {
+            const uint32_t first = lo / 64;
+            const uint32_t last = hi / 64;
+            const uint64_t head = ~uint64_t(0) << (lo % 64);
+            const uint64_t tail = ~uint64_t(0) >> (63 - hi % 64);
+            if (first == last)
+            {
+                words[first] |= head & tail;
+                return;
+            }
+            words[first] |= head;
+            for (uint32_t i = first + 1; i < last; ++i)
+                words[i] = ~uint64_t(0);
+            words[last] |= tail;
+        }
+
+        /**
+         * @brief The 65536 bits of a bitmap chunk, or nothing for the other
+         *        layouts. The size is part of the type so the word loops have
+         *        a bound the compiler can see.
+         */
+        class Roaring_words
+        {
+        public:
+            static constexpr size_t _Count = 1024;
+
+            Roaring_words() noexcept = default;
+            Roaring_words(Roaring_words &&) noexcept = default;
+            Roaring_words &operator=(Roaring_words &&) noexcept = default;
+
+            Roaring_words(const Roaring_words &x)
+                : _Words(x._Words ? new std::array<uint64_t, _Count>(*x._Words) : nullptr)
+            {
+            }
+
+            Roaring_words &operator=(const Roaring_words &x)
+            {
+                if (this != &x)
+                    Roaring_words(x).swap(*this);
+                return *this;
+            }
+
+            void swap(Roaring_words &x) noexcept
+            {
+                _Words.swap(x._Words);
+            }
+
+            /**
+             * @brief Allocates the words, all clear
+             */
+            void _Allocate()
+            {
+                _Words.reset(new std::array<uint64_t, _Count>{});
+            }
+
+            void _Release() noexcept
+            {
+                _Words.reset();
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return bool(_Words);
+            }
+
+            uint64_t *data() noexcept
+            {
+                return _Words->data();
+            }
+
+            const uint64_t *data() const noexcept
+            {
+                return _Words->data();
+            }
+
+            uint64_t &operator[](size_t i) noexcept
+            {
+                return (*_Words)[i];
+            }
+
+            uint64_t operator[](size_t i) const noexcept
+            {
+                return (*_Words)[i];
+            }
+
+            size_t _Bytes() const noexcept
+            {
+                return _Words ? sizeof(*_Words) : 0;
+            }
+
+            friend bool operator==(const Roaring_words &x, const Roaring_words &y) noexcept
+            {
+                if (!x._Words || !y._Words)
+                    return !x._Words == !y._Words;
+                return *x._Words == *y._Words;
+            }
+
+        private:
+            std::unique_ptr<std::array<uint64_t, _Count>> _Words;
+        };
+
+        /**
+         * @brief Values of one 64K chunk, in one of three layouts:
+         *        a sorted array of uint16 (at most 4096 values), a 65536 bit
+         *        bitmap, or sorted runs stored as (start, length - 1) pairs.
+         */
+        class Roaring_container
+        {
+        public:
+            static constexpr uint32_t _Array_max = 4096;
+            static constexpr size_t _Bitmap_words = Roaring_words::_Count;
+
+            Roaring_kind _Kind = Roaring_kind::array;
+            uint32_t _Card = 0;
+            vector<uint16_t> _Values;
+            Roaring_words _Words;
+
+            size_t _Runs() const noexcept
+            {
+                return _Values.size() / 2;
+            }
+
+            uint32_t _Run_start(size_t r) const noexcept
+            {
+                return _Values[2 * r];
+            }
+
+            uint32_t _Run_end(size_t r) const noexcept
+            {
+                return uint32_t(_Values[2 * r]) + _Values[2 * r + 1];
+            }
+
+            /**
+             * @brief Whether a container read from outside holds up: values
+             *        and runs strictly ascending and inside the chunk, arrays
+             *        within _Array_max, and _Card matching the payload.
+             */
+            bool _Valid() const noexcept
+            {
+                switch (_Kind)
+                {
+                case Roaring_kind::array:
+                    if (_Card > _Array_max || _Values.size() != _Card)
+                        return false;
+                    for (size_t i = 1; i < _Values.size(); ++i)
+                        if (_Values[i - 1] >= _Values[i])
+                            return false;
+                    return true;
+                case Roaring_kind::run:
+                {
+                    uint64_t card = 0;
+                    for (size_t r = 0; r < _Runs(); ++r)
+                    {
+                        if (_Run_end(r) > 0xFFFF || (r && _Run_start(r) <= _Run_end(r - 1)))
+                            return false;
+                        card += uint64_t(_Values[2 * r + 1]) + 1;
+                    }
+                    return card == _Card;
+                }
+                default:
+                    return _Words && _Bits_popcount(_Words.data(), _Bitmap_words) == _Card;
+                }
+            }
+
+            /**
+             * @brief Index of the last run starting at or before @a v, or -1
+             */
+            ptrdiff_t _Run_find(uint32_t v) const noexcept
+            {
+                size_t lo = 0;
+                size_t hi = _Runs();
+                while (lo < hi)
+                {
+                    const size_t mid = (lo + hi) / 2;
+                    if (_Run_start(mid) <= v)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                return ptrdiff_t(lo) - 1;
+            }
+
+            bool _Contains(uint16_t v) const noexcept
+            {
+                switch (_Kind)
+                {
+                case Roaring_kind::array:
+                    return std::binary_search(_Values.begin(), _Values.end(), v);
+                case Roaring_kind::bitmap:
+                    return (_Words[v / 64] >> (v % 64)) & 1;
+                default:
+                {
+                    const ptrdiff_t r = _Run_find(v);
+                    return r >= 0 && v <= _Run_end(r);
+                }
+                }
+            }
+
+            bool _Add(uint16_t v)
+            {
+                switch (_Kind)
+                {
+                case Roaring_kind::array:
+                {
+                    auto it = std::lower_bound(_Values.begin(), _Values.end(), v);
+                    if (it != _Values.end() && *it == v)
+                        return false;
+                    if (_Card == _Array_max)
+                    {
+                        _To_bitmap();
+                        return _Add(v);
+                    }
+                    _Values.insert(it, v);
+                    break;
+                }
+                case Roaring_kind::bitmap:
+                {
+                    uint64_t &word = _Words[v / 64];
+                    const uint64_t bit = uint64_t(1) << (v % 64);
+                    if (word & bit)
+                        return false;
+                    word |= bit;
+                    break;
+                }
+                default:
+                {
+                    const ptrdiff_t r = _Run_find(v);
+                    if (r >= 0 && v <= _Run_end(r))
+                        return false;
+                    const bool joins_prev = r >= 0 && _Run_end(r) + 1 == v;
+                    const bool joins_next = size_t(r + 1) < _Runs() && _Run_start(r + 1) == uint32_t(v) + 1;
+                    if (joins_prev && joins_next)
+                    {
+                        _Values[2 * r + 1] += _Values[2 * r + 3] + 2;
+                        _Values.erase(_Values.cbegin() + 2 * (r + 1), _Values.cbegin() + 2 * (r + 2));
+                    }
+                    else if (joins_prev)
+                        ++_Values[2 * r + 1];
+                    else if (joins_next)
+                    {
+                        --_Values[2 * (r + 1)];
+                        ++_Values[2 * (r + 1) + 1];
+                    }
+                    else
+                    {
+                        const uint16_t run[2] = {v, 0};
+                        _Values.insert(_Values.cbegin() + 2 * (r + 1), run, run + 2);
+                    }
+                    break;
+                }
+                }
+                ++_Card;
+                return true;
+            }
+
+            bool _Remove(uint16_t v)
+            {
+                switch (_Kind)
+                {
+                case Roaring_kind::array:
+                {
+                    auto it = std::lower_bound(_Values.begin(), _Values.end(), v);
+                    if (it == _Values.end() || *it != v)
+                        return false;
+                    _Values.erase(it);
+                    break;
+                }
+                case Roaring_kind::bitmap:
+                {
+                    uint64_t &word = _Words[v / 64];
+                    const uint64_t bit = uint64_t(1) << (v % 64);
+                    if (!(word & bit))
+                        return false;
+                    word &= ~bit;
+                    if (_Card - 1 <= _Array_max)
+                    {
+                        --_Card;
+                        _To_array();
+                        return true;
+                    }
+                    break;
+                }
+                default:
+                    if (!_Contains(v))
+                        return false;
+                    _Card > _Array_max ? _To_bitmap() : _To_array();
+                    return _Remove(v);
+                }
+                --_Card;
+                return true;
+            }
+
+            template <class _Fn>
+            void _For_each(uint32_t high, _Fn &fn) const
+            {
+                switch (_Kind)
+                {
+                case Roaring_kind::array:
+                    for (uint16_t v : _Values)
+                        fn(high | v);
+                    break;
+                case Roaring_kind::bitmap:
+                    for (size_t i = 0; i < _Bitmap_words; ++i)
+                    {
+                        uint64_t word = _Words[i];
+                        while (word)
+                        {
+                            fn(high | uint32_t(i * 64 + __builtin_ctzll(word)));
+                            word &= word - 1;
+                        }
+                    }
+                    break;
+                default:
+                    for (size_t r = 0; r < _Runs(); ++r)
+                        for (uint32_t v = _Run_start(r), end = _Run_end(r); v <= end; ++v)
+                            fn(high | v);
+                    break;
+                }
+            }
+
+            void _To_bitmap()
+            {
+                Roaring_words words;
+                words._Allocate();
+                if (_Kind == Roaring_kind::array)
+                    for (uint16_t v : _Values)
+                        words[v / 64] |= uint64_t(1) << (v % 64);
+                else if (_Kind == Roaring_kind::run)
+                    for (size_t r = 0; r < _Runs(); ++r)
+                        _Bits_set_range(words.data(), _Run_start(r), _Run_end(r));
+                else
+                    return;
+                _Words.swap(words);
+                _Values.clear();
+                _Values.shrink_to_fit();
+                _Kind = Roaring_kind::bitmap;
+            }
+
+            void _To_array()
+            {
+                vector<uint16_t> values;
+                values.reserve(_Card);
+                auto push = [&values](uint32_t v)
+                { values.push_back(uint16_t(v)); };
+                if (_Kind == Roaring_kind::array)
+                    return;
+                _For_each(0, push);
+                _Values.swap(values);
+                _Words._Release();
+                _Kind = Roaring_kind::array;
+            }
+
+            void _Recount() noexcept
+            {
+                _Card = uint32_t(_Bits_popcount(_Words.data(), _Bitmap_words));
+            }
+
+            /**
+             * @brief Picks the smallest of the three layouts for the values.
+             */
+            void _Optimize()
+            {
+                size_t runs = 0;
+                if (_Kind == Roaring_kind::run)
+                    runs = _Runs();
+                else
+                {
+                    uint32_t prev = 0x10000;
+                    auto count = [&runs, &prev](uint32_t v)
+                    {
+                        if (v != prev + 1)
+                            ++runs;
+                        prev = v;
+                    };
+                    _For_each(0, count);
+                }
+
+                const size_t run_bytes = runs * 4;
+                const size_t other_bytes = _Card <= _Array_max ? _Card * 2 : _Bitmap_words * 8;
+                if (run_bytes < other_bytes)
+                {
+                    if (_Kind == Roaring_kind::run)
+                        return;
+                    vector<uint16_t> values;
+                    values.reserve(runs * 2);
+                    uint32_t prev = 0x10000;
+                    auto build = [&values, &prev](uint32_t v)
+                    {
+                        if (v != prev + 1)
+                        {
+                            values.push_back(uint16_t(v));
+                            values.push_back(0);
+                        }
+                        else
+                            ++values.back();
+                        prev = v;
+                    };
+                    _For_each(0, build);
+                    _Values.swap(values);
+                    _Words._Release();
+                    _Kind = Roaring_kind::run;
+                }
+                else if (_Kind == Roaring_kind::run)
+                    _Card > _Array_max ? _To_bitmap() : _To_array();
+            }
+
+            static Roaring_container _Make_run(uint32_t lo, uint32_t hi)
+            {
+                Roaring_container c;
+                c._Kind = Roaring_kind::run;
+                c._Card = hi - lo + 1;
+                c._Values.push_back(uint16_t(lo));
+                c._Values.push_back(uint16_t(hi - lo));
+                return c;
+            }
+
+            /**
+             * @brief Array view of a non-bitmap container; runs are expanded.
+             */
+            static vector<uint16_t> _Expand(const Roaring_container &c)
+            {
+                if (c._Kind == Roaring_kind::array)
+                    return c._Values;
+                vector<uint16_t> values;
+                values.reserve(c._Card);
+                auto push = [&values](uint32_t v)
+                { values.push_back(uint16_t(v)); };
+                c._For_each(0, push);
+                return values;
+            }
+
+            static Roaring_container _Union(const Roaring_container &x, const Roaring_container &y)
+            {
+                if (x._Kind == Roaring_kind::run && y._Kind == Roaring_kind::run)
+                    return _Union_runs(x, y);
+
+                if (x._Kind == Roaring_kind::bitmap || y._Kind == Roaring_kind::bitmap ||
+                    x._Card + y._Card > _Array_max)
+                {
+                    const Roaring_container &b = x._Kind == Roaring_kind::bitmap ? x : y;
+                    const Roaring_container &o = x._Kind == Roaring_kind::bitmap ? y : x;
+                    Roaring_container c;
+                    if (b._Kind == Roaring_kind::bitmap)
+                        c = b;
+                    else
+                    {
+                        c = b;
+                        c._To_bitmap();
+                    }
+                    switch (o._Kind)
+                    {
+                    case Roaring_kind::bitmap:
+                        _Bits_apply<Bits_or>(c._Words.data(), o._Words.data(), _Bitmap_words);
+                        break;
+                    case Roaring_kind::array:
+                        for (uint16_t v : o._Values)
+                            c._Words[v / 64] |= uint64_t(1) << (v % 64);
+                        break;
+                    default:
+                        for (size_t r = 0; r < o._Runs(); ++r)
+                            _Bits_set_range(c._Words.data(), o._Run_start(r), o._Run_end(r));
+                        break;
+                    }
+                    c._Recount();
+                    if (c._Card <= _Array_max)
+                        c._To_array();
+                    return c;
+                }
+
+                const vector<uint16_t> a = _Expand(x);
+                const vector<uint16_t> b = _Expand(y);
+                Roaring_container c;
+                c._Values.resize(a.size() + b.size());
+                c._Values.erase(std::set_union(a.begin(), a.end(), b.begin(), b.end(), c._Values.begin()),
+                                c._Values.end());
+                c._Card = uint32_t(c._Values.size());
+                return c;
+            }
+
+            static Roaring_container _Union_runs(const Roaring_container &x, const Roaring_container &y)
+            {
+                Roaring_container c;
+                c._Kind = Roaring_kind::run;
+                size_t i = 0;
+                size_t j = 0;
+                auto append = [&c](uint32_t lo, uint32_t hi)
+                {
+                    const size_t n = c._Runs();
+                    if (n && lo <= c._Run_end(n - 1) + 1)
+                    {
+                        if (hi > c._Run_end(n - 1))
+                            c._Values[2 * n - 1] = uint16_t(hi - c._Run_start(n - 1));
+                    }
+                    else
+                    {
+                        c._Values.push_back(uint16_t(lo));
+                        c._Values.push_back(uint16_t(hi - lo));
+                    }
+                };
+                while (i < x._Runs() || j < y._Runs())
+                {
+                    if (j == y._Runs() || (i < x._Runs() && x._Run_start(i) <= y._Run_start(j)))
+                    {
+                        append(x._Run_start(i), x._Run_end(i));
+                        ++i;
+                    }
+                    else
+                    {
+                        append(y._Run_start(j), y._Run_end(j));
+                        ++j;
+                    }
+                }
+                c._Card = 0;
+                for (size_t r = 0; r < c._Runs(); ++r)
+                    c._Card += c._Run_end(r) - c._Run_start(r) + 1;
+                return c;
+            }
+
+            static Roaring_container _Intersect(const Roaring_container &x, const Roaring_container &y)
+            {
+                Roaring_container c;
+                if (x._Kind == Roaring_kind::run && y._Kind == Roaring_kind::run)
+                {
+                    c._Kind = Roaring_kind::run;
+                    size_t i = 0;
+                    size_t j = 0;
+                    while (i < x._Runs() && j < y._Runs())
+                    {
+                        const uint32_t lo = std::max(x._Run_start(i), y._Run_start(j));
+                        const uint32_t hi = std::min(x._Run_end(i), y._Run_end(j));
+                        if (lo <= hi)
+                        {
+                            c._Values.push_back(uint16_t(lo));
+                            c._Values.push_back(uint16_t(hi - lo));
+                            c._Card += hi - lo + 1;
+                        }
+                        x._Run_end(i) < y._Run_end(j) ? ++i : ++j;
+                    }
+                    return c;
+                }
+
+                if (x._Kind == Roaring_kind::array || y._Kind == Roaring_kind::array)
+                {
+                    // filter the array through the other container
+                    const Roaring_container &a = x._Kind == Roaring_kind::array ? x : y;
+                    const Roaring_container &o = x._Kind == Roaring_kind::array ? y : x;
+                    if (o._Kind == Roaring_kind::array)
+                    {
+                        c._Values.resize(std::min(a._Values.size(), o._Values.size()));
+                        c._Values.erase(std::set_intersection(a._Values.begin(), a._Values.end(),
+                                                              o._Values.begin(), o._Values.end(),
+                                                              c._Values.begin()),
+                                        c._Values.end());
+                    }
+                    else
+                    {
+                        c._Values.reserve(a._Values.size());
+                        for (uint16_t v : a._Values)
+                            if (o._Contains(v))
+                                c._Values.push_back(v);
+                    }
+                    c._Card = uint32_t(c._Values.size());
+                    return c;
+                }
+
+                // bitmap & bitmap, or bitmap & run
+                c = x;
+                c._To_bitmap();
+                if (y._Kind == Roaring_kind::bitmap)
+                    _Bits_apply<Bits_and>(c._Words.data(), y._Words.data(), _Bitmap_words);
+                else
+                {
+                    Roaring_container m = y;
+                    m._To_bitmap();
+                    _Bits_apply<Bits_and>(c._Words.data(), m._Words.data(), _Bitmap_words);
+                }
+                c._Recount();
+                if (c._Card <= _Array_max)
+                    c._To_array();
+                return c;
+            }
+
+            static bool _Equal(const Roaring_container &x, const Roaring_container &y)
+            {
+                if (x._Card != y._Card)
+                    return false;
+                if (x._Kind == y._Kind)
+                    return x._Kind == Roaring_kind::bitmap ? x._Words == y._Words : x._Values == y._Values;
+                Roaring_container a = x;
+                Roaring_container b = y;
+                a._To_bitmap();
+                b._To_bitmap();
+                return a._Words == b._Words;
+            }
+
+            size_t _Size_in_bytes() const noexcept
+            {
+                return sizeof(*this) + _Values.capacity() * sizeof(uint16_t) + _Words._Bytes();
+            }
+        };
+
+        /**
+         * @brief Little endian encoding helpers for the serialized form.
+         */
+        template <class _Ty>
+        inline void _Put_le(uint8_t *&out, _Ty value) noexcept
+        {
+            for (size_t i = 0; i < sizeof(_Ty); ++i)
+                *out++ = uint8_t(uint64_t(value) >> (8 * i));
+        }
+
+        template <class _Ty>
+        inline _Ty _Get_le(const uint8_t *&in) noexcept
+        {
+            uint64_t value = 0;
+            for (size_t i = 0; i < sizeof(_Ty); ++i)
+                value |= uint64_t(*in++) << (8 * i);
+            return _Ty(value);
+        }
+
+        template <class _Ty>
+        inline void _Put_le_array(uint8_t *&out, const _Ty *data, size_t n) noexcept
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            std::memcpy(out, data, n * sizeof(_Ty));
+            out += n * sizeof(_Ty);
+#else
+            for (size_t i = 0; i < n; ++i)
+                _Put_le(out, data[i]);
+#endif
+        }
+
+        template <class _Ty>
+        inline void _Get_le_array(const uint8_t *&in, _Ty *data, size_t n) noexcept
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            std::memcpy(data, in, n * sizeof(_Ty));
+            in += n * sizeof(_Ty);
+#else
+            for (size_t i = 0; i < n; ++i)
+                data[i] = _Get_le<_Ty>(in);
+#endif
+        }
+    }
+
+    /**
+     * @brief Compressed set of 32 bit integers. Values are split by their
+     *        high 16 bits into 64K chunks, and each chunk is stored as a
+     *        sorted array, a bitmap or a list of runs, whichever fits it.
+     *
+     */
+    class roaring_bitmap
+    {
+        using _Container = __base::Roaring_container;
+
+    public:
+        using value_type = uint32_t;
+        using size_type = size_t;
+
+        /**
+         * @brief Serialization magic, "RBM1" in little endian
+         */
+        static constexpr uint32_t serial_cookie = 0x314d4252;
+        static constexpr uint16_t serial_version = 1;
+
+        /**
+         * @brief Construct a new roaring bitmap object with no values
+         *
+         */
+        roaring_bitmap()
+        {
+        }
+
+        roaring_bitmap(std::initializer_list<value_type> l)
+        {
+            add_many(l.begin(), l.end());
+        }
+
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        roaring_bitmap(Input first, Input last)
+        {
+            add_many(first, last);
+        }
+
+        /**
+         * @brief Adds @a value
+         *
+         * @param value
+         * @return true When the value was not present
+         */
+        bool add(value_type value)
+        {
+            return _Get_or_create(uint16_t(value >> 16))._Add(uint16_t(value));
+        }
+
+        /**
+         * @brief Adds every value of [first, last). Consecutive values that
+         *        fall in the same chunk reuse the chunk lookup.
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void add_many(Input first, Input last)
+        {
+            _Container *c = nullptr;
+            uint32_t key = 0x10000;
+            for (; first != last; ++first)
+            {
+                const value_type value = *first;
+                if ((value >> 16) != key)
+                {
+                    key = value >> 16;
+                    c = &_Get_or_create(uint16_t(key));
+                }
+                c->_Add(uint16_t(value));
+            }
+        }
+
+        /**
+         * @brief Adds every value of [lo, hi)
+         *
+         * @param lo
+         * @param hi
+         */
+        void add_range(uint64_t lo, uint64_t hi)
+        {
+            hi = std::min<uint64_t>(hi, uint64_t(1) << 32);
+            while (lo < hi)
+            {
+                const uint16_t key = uint16_t(lo >> 16);
+                const uint32_t first = uint32_t(lo & 0xffff);
+                const uint32_t last = uint32_t(std::min<uint64_t>(hi - 1, (uint64_t(key) << 16) | 0xffff) & 0xffff);
+                _Container run = _Container::_Make_run(first, last);
+                const size_t i = _Index(key);
+                if (i < _Keys.size() && _Keys[i] == key)
+                    _Containers[i] = _Container::_Union(_Containers[i], run);
+                else
+                {
+                    _Keys.insert(_Keys.cbegin() + i, key);
+                    _Containers.insert(_Containers.cbegin() + i, std::move(run));
+                }
+                lo = (uint64_t(key) + 1) << 16;
+            }
+        }
+
+        /**
+         * @brief Removes @a value
+         *
+         * @param value
+         * @return true When the value was present
+         */
+        bool remove(value_type value)
+        {
+            const uint16_t key = uint16_t(value >> 16);
+            const size_t i = _Index(key);
+            if (i == _Keys.size() || _Keys[i] != key)
+                return false;
+            if (!_Containers[i]._Remove(uint16_t(value)))
+                return false;
+            if (_Containers[i]._Card == 0)
+            {
+                _Keys.erase(_Keys.cbegin() + i);
+                _Containers.erase(_Containers.cbegin() + i);
+            }
+            return true;
+        }
+
+        bool contains(value_type value) const
+        {
+            const uint16_t key = uint16_t(value >> 16);
+            const size_t i = _Index(key);
+            return i < _Keys.size() && _Keys[i] == key && _Containers[i]._Contains(uint16_t(value));
+        }
+
+        /**
+         * @brief Number of values
+         *
+         * @return size_type
+         */
+        size_type cardinality() const noexcept
+        {
+            size_type n = 0;
+            for (const _Container &c : _Containers)
+                n += c._Card;
+            return n;
+        }
+
+        size_type size() const noexcept
+        {
+            return cardinality();
+        }
+
+        bool empty() const noexcept
+        {
+            return _Keys.empty();
+        }
+
+        void clear() noexcept
+        {
+            _Keys.clear();
+            _Containers.clear();
+        }
+
+        /**
+         * @brief Number of 64K chunks holding values
+         *
+         * @return size_type
+         */
+        size_type container_count() const noexcept
+        {
+            return _Keys.size();
+        }
+
+        /**
+         * @brief Approximate heap footprint
+         *
+         * @return size_type
+         */
+        size_type size_in_bytes() const noexcept
+        {
+            size_type n = sizeof(*this) + _Keys.capacity() * sizeof(uint16_t);
+            for (const _Container &c : _Containers)
+                n += c._Size_in_bytes();
+            return n;
+        }
+
+        /**
+         * @brief Converts every chunk to run layout where that is smaller.
+         *        Worth calling once a clustered set is built.
+         *
+         */
+        void run_optimize()
+        {
+            for (_Container &c : _Containers)
+                c._Optimize();
+        }
+
+        /**
+         * @brief Calls @a fn(value) for every value, in increasing order
+         *
+         * @tparam _Fn
+         * @param fn
+         */
+        template <class _Fn>
+        void for_each(_Fn fn) const
+        {
+            for (size_t i = 0; i < _Keys.size(); ++i)
+                _Containers[i]._For_each(uint32_t(_Keys[i]) << 16, fn);
+        }
+
+        /**
+         * @brief Appends every value, in increasing order, to @a out
+         *
+         * @param out
+         */
+        template <class _Alloc>
+        void append_to(vector<value_type, _Alloc> &out) const
+        {
+            out.reserve(out.size() + cardinality());
+            for_each([&out](value_type v)
+                     { out.push_back(v); });
+        }
+
+        vector<value_type> to_vector() const
+        {
+            vector<value_type> out;
+            append_to(out);
+            return out;
+        }
+
+        roaring_bitmap &operator|=(const roaring_bitmap &x)
+        {
+            vector<uint16_t> keys;
+            vector<_Container> containers;
+            keys.reserve(_Keys.size() + x._Keys.size());
+            containers.reserve(_Keys.size() + x._Keys.size());
+            size_t i = 0;
+            size_t j = 0;
+            while (i < _Keys.size() || j < x._Keys.size())
+            {
+                if (j == x._Keys.size() || (i < _Keys.size() && _Keys[i] < x._Keys[j]))
+                {
+                    keys.push_back(_Keys[i]);
+                    containers.push_back(std::move(_Containers[i++]));
+                }
+                else if (i == _Keys.size() || x._Keys[j] < _Keys[i])
+                {
+                    keys.push_back(x._Keys[j]);
+                    containers.push_back(x._Containers[j++]);
+                }
+                else
+                {
+                    keys.push_back(_Keys[i]);
+                    containers.push_back(_Container::_Union(_Containers[i++], x._Containers[j++]));
+                }
+            }
+            _Keys.swap(keys);
+            _Containers.swap(containers);
+            return *this;
+        }
+
+        roaring_bitmap &operator&=(const roaring_bitmap &x)
+        {
+            vector<uint16_t> keys;
+            vector<_Container> containers;
+            size_t i = 0;
+            size_t j = 0;
+            while (i < _Keys.size() && j < x._Keys.size())
+            {
+                if (_Keys[i] < x._Keys[j])
+                    ++i;
+                else if (x._Keys[j] < _Keys[i])
+                    ++j;
+                else
+                {
+                    _Container c = _Container::_Intersect(_Containers[i++], x._Containers[j++]);
+                    if (c._Card)
+                    {
+                        keys.push_back(_Keys[i - 1]);
+                        containers.push_back(std::move(c));
+                    }
+                }
+            }
+            _Keys.swap(keys);
+            _Containers.swap(containers);
+            return *this;
+        }
+
+        /**
+         * @brief Number of values in both bitmaps, without building the
+         *        intersection
+         *
+         * @param x
+         * @return size_type
+         */
+        size_type intersection_count(const roaring_bitmap &x) const
+        {
+            size_type n = 0;
+            size_t i = 0;
+            size_t j = 0;
+            while (i < _Keys.size() && j < x._Keys.size())
+            {
+                if (_Keys[i] < x._Keys[j])
+                    ++i;
+                else if (x._Keys[j] < _Keys[i])
+                    ++j;
+                else
+                {
+                    const _Container &a = _Containers[i++];
+                    const _Container &b = x._Containers[j++];
+                    if (a._Kind == __base::Roaring_kind::bitmap && b._Kind == __base::Roaring_kind::bitmap)
+                        n += __base::_Bits_and_popcount(a._Words.data(), b._Words.data(), _Container::_Bitmap_words);
+                    else
+                        n += _Container::_Intersect(a, b)._Card;
+                }
+            }
+            return n;
+        }
+
+        friend roaring_bitmap operator|(const roaring_bitmap &x, const roaring_bitmap &y)
+        {
+            roaring_bitmap temp(x);
+            return temp |= y;
+        }
+
+        friend roaring_bitmap operator&(const roaring_bitmap &x, const roaring_bitmap &y)
+        {
+            roaring_bitmap temp(x);
+            return temp &= y;
+        }
+
+        friend bool operator==(const roaring_bitmap &x, const roaring_bitmap &y)
+        {
+            if (x._Keys != y._Keys)
+                return false;
+            for (size_t i = 0; i < x._Keys.size(); ++i)
+                if (!_Container::_Equal(x._Containers[i], y._Containers[i]))
+                    return false;
+            return true;
+        }
+
+        friend bool operator!=(const roaring_bitmap &x, const roaring_bitmap &y)
+        {
+            return !(x == y);
+        }
+
+        /**
+         * @brief Size in bytes of the serialized form
+         *
+         * @return size_type
+         */
+        size_type serialized_size() const noexcept
+        {
+            size_type n = 12;
+            for (const _Container &c : _Containers)
+                n += 12 + (c._Kind == __base::Roaring_kind::bitmap ? _Container::_Bitmap_words * 8 : c._Values.size() * 2);
+            return n;
+        }
+
+        /**
+         * @brief Writes the bitmap to @a out, which must hold
+         *        serialized_size() bytes. The format is little endian:
+         *        cookie u32, version u16, reserved u16, chunk count u32, then
+         *        per chunk key u16, kind u8, reserved u8, cardinality u32,
+         *        payload length u32 and the payload words.
+         *
+         * @param out
+         * @return size_type The number of bytes written
+         */
+        size_type serialize(uint8_t *out) const noexcept
+        {
+            uint8_t *const start = out;
+            __base::_Put_le<uint32_t>(out, serial_cookie);
+            __base::_Put_le<uint16_t>(out, serial_version);
+            __base::_Put_le<uint16_t>(out, 0);
+            __base::_Put_le<uint32_t>(out, uint32_t(_Keys.size()));
+            for (size_t i = 0; i < _Keys.size(); ++i)
+            {
+                const _Container &c = _Containers[i];
+                __base::_Put_le<uint16_t>(out, _Keys[i]);
+                __base::_Put_le<uint8_t>(out, uint8_t(c._Kind));
+                __base::_Put_le<uint8_t>(out, 0);
+                __base::_Put_le<uint32_t>(out, c._Card);
+                if (c._Kind == __base::Roaring_kind::bitmap)
+                {
+                    __base::_Put_le<uint32_t>(out, uint32_t(_Container::_Bitmap_words));
+                    __base::_Put_le_array(out, c._Words.data(), _Container::_Bitmap_words);
+                }
+                else
+                {
+                    __base::_Put_le<uint32_t>(out, uint32_t(c._Values.size()));
+                    __base::_Put_le_array(out, c._Values.data(), c._Values.size());
+                }
+            }
+            return size_type(out - start);
+        }
+
+        /**
+         * @brief Appends the serialized form to @a out
+         *
+         * @param out
+         */
+        template <class _Alloc>
+        void serialize(vector<uint8_t, _Alloc> &out) const
+        {
+            const size_type offset = out.size();
+            out.resize(offset + serialized_size());
+            serialize(out.data() + offset);
+        }
+
+        /**
+         * @brief Reads a bitmap written by serialize()
+         *
+         * @param in
+         * @param n Bytes available at @a in
+         * @return roaring_bitmap
+         * @throws std::runtime_error on malformed input
+         */
+        static roaring_bitmap deserialize(const uint8_t *in, size_type n)
+        {
+            const uint8_t *const end = in + n;
+            auto need = [&in, end](size_t bytes)
+            {
+                if (size_t(end - in) < bytes)
+                    throw std::runtime_error("collections::roaring_bitmap: truncated input");
+            };
+
+            need(12);
+            if (__base::_Get_le<uint32_t>(in) != serial_cookie)
+                throw std::runtime_error("collections::roaring_bitmap: bad cookie");
+            if (__base::_Get_le<uint16_t>(in) != serial_version)
+                throw std::runtime_error("collections::roaring_bitmap: unsupported version");
+            __base::_Get_le<uint16_t>(in);
+            const uint32_t count = __base::_Get_le<uint32_t>(in);
+            if (count > 0x10000)
+                throw std::runtime_error("collections::roaring_bitmap: too many chunks");
+
+            roaring_bitmap r;
+            r._Keys.reserve(count);
+            r._Containers.reserve(count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                need(12);
+                const uint16_t key = __base::_Get_le<uint16_t>(in);
+                const uint8_t kind = __base::_Get_le<uint8_t>(in);
+                __base::_Get_le<uint8_t>(in);
+                _Container c;
+                c._Card = __base::_Get_le<uint32_t>(in);
+                const uint32_t length = __base::_Get_le<uint32_t>(in);
+                if (!r._Keys.empty() && key <= r._Keys.back())
+                    throw std::runtime_error("collections::roaring_bitmap: unsorted chunks");
+                if (c._Card == 0 || c._Card > 0x10000)
+                    throw std::runtime_error("collections::roaring_bitmap: bad cardinality");
+
+                switch (kind)
+                {
+                case uint8_t(__base::Roaring_kind::bitmap):
+                    if (length != _Container::_Bitmap_words)
+                        throw std::runtime_error("collections::roaring_bitmap: bad bitmap length");
+                    need(length * 8);
+                    c._Kind = __base::Roaring_kind::bitmap;
+                    c._Words._Allocate();
+                    __base::_Get_le_array(in, c._Words.data(), length);
+                    break;
+                case uint8_t(__base::Roaring_kind::array):
+                case uint8_t(__base::Roaring_kind::run):
+                    if (kind == uint8_t(__base::Roaring_kind::array) ? length != c._Card : (length % 2 || length > 0x10000))
+                        throw std::runtime_error("collections::roaring_bitmap: bad payload length");
+                    need(size_t(length) * 2);
+                    c._Kind = __base::Roaring_kind(kind);
+                    c._Values.resize(length);
+                    __base::_Get_le_array(in, c._Values.data(), length);
+                    break;
+                default:
+                    throw std::runtime_error("collections::roaring_bitmap: bad chunk kind");
+                }
+                if (!c._Valid())
+                    throw std::runtime_error("collections::roaring_bitmap: inconsistent chunk");
+                r._Keys.push_back(key);
+                r._Containers.push_back(std::move(c));
+            }
+            return r;
+        }
+
+        template <class _Alloc>
+        static roaring_bitmap deserialize(const vector<uint8_t, _Alloc> &in)
+        {
+            return deserialize(in.data(), in.size());
+        }
+
+        void swap(roaring_bitmap &x) noexcept
+        {
+            _Keys.swap(x._Keys);
+            _Containers.swap(x._Containers);
+        }
+
+    private:
+        size_t _Index(uint16_t key) const noexcept
+        {
+            return std::lower_bound(_Keys.begin(), _Keys.end(), key) - _Keys.begin();
+        }
+
+        _Container &_Get_or_create(uint16_t key)
+        {
+            const size_t i = _Index(key);
+            if (i == _Keys.size() || _Keys[i] != key)
+            {
+                _Keys.insert(_Keys.cbegin() + i, key);
+                _Containers.emplace(_Containers.cbegin() + i);
+            }
+            return _Containers[i];
+        }
+
+        vector<uint16_t> _Keys;
+        vector<_Container> _Containers;
+    };
+}
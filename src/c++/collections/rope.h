@@ -0,0 +1,1044 @@
+#pragma once
+
+#include <span>
+#include <memory>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+#include "vector.h"
+
+namespace collections
+{
+    template <class _Ty, class _Alloc>
+    class rope;
+
+    /**
+     * @brief Bytes a rope chunk holds at most; an insert into a full chunk
+     *        splits it in two. Inserts and erases move at most this much.
+     */
+    constexpr size_t rope_chunk_bytes = 4096;
+
+    namespace __base
+    {
+        /**
+         * @brief Treap node owning one chunk. _Total counts the elements of
+         *        the whole subtree; _Prev and _Next thread the nodes in
+         *        sequence order for iteration. A chunk is never empty.
+         */
+        template <class _Ty, class _Alloc>
+        struct Rope_node
+        {
+            Rope_node(uint32_t priority, const _Alloc &alloc)
+                : _Priority(priority), _Data(alloc)
+            {
+            }
+
+            static size_t _S_total(const Rope_node *node) noexcept
+            {
+                return node ? node->_Total : 0;
+            }
+
+            void _Update() noexcept
+            {
+                _Total = _S_total(_Left) + _Data.size() + _S_total(_Right);
+            }
+
+            Rope_node *_Left = nullptr;
+            Rope_node *_Right = nullptr;
+            Rope_node *_Prev = nullptr;
+            Rope_node *_Next = nullptr;
+            size_t _Total = 0;
+            uint32_t _Priority;
+            vector<_Ty, _Alloc> _Data;
+        };
+
+        /**
+         * @brief Bidirectional iterator over the elements of a rope. It
+         *        keeps the chunk it is in, so stepping is O(1); the end
+         *        iterator has no chunk and steps back through the root.
+         */
+        template <class _Ty, class _Alloc, bool _Const>
+        class Rope_iterator
+        {
+            using _Node = Rope_node<_Ty, _Alloc>;
+
+            template <class, class, bool>
+            friend class Rope_iterator;
+
+            friend class rope<_Ty, _Alloc>;
+
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = _Ty;
+            using difference_type = ptrdiff_t;
+            using pointer = std::conditional_t<_Const, const _Ty *, _Ty *>;
+            using reference = std::conditional_t<_Const, const _Ty &, _Ty &>;
+
+            Rope_iterator() noexcept = default;
+
+            template <bool _Other, typename = std::enable_if_t<_Const && !_Other>>
+            Rope_iterator(const Rope_iterator<_Ty, _Alloc, _Other> &x) noexcept
+                : _Root(x._Root), _Current(x._Current), _Offset(x._Offset)
+            {
+            }
+
+            reference operator*() const noexcept
+            {
+                return _Current->_Data[_Offset];
+            }
+
+            pointer operator->() const noexcept
+            {
+                return std::addressof(_Current->_Data[_Offset]);
+            }
+
+            Rope_iterator &operator++() noexcept
+            {
+                if (++_Offset == _Current->_Data.size())
+                {
+                    _Current = _Current->_Next;
+                    _Offset = 0;
+                }
+                return *this;
+            }
+
+            Rope_iterator operator++(int) noexcept
+            {
+                Rope_iterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            Rope_iterator &operator--() noexcept
+            {
+                if (_Offset)
+                    --_Offset;
+                else
+                {
+                    if (_Current)
+                        _Current = _Current->_Prev;
+                    else
+                        for (_Current = *_Root; _Current->_Right;)
+                            _Current = _Current->_Right;
+                    _Offset = _Current->_Data.size() - 1;
+                }
+                return *this;
+            }
+
+            Rope_iterator operator--(int) noexcept
+            {
+                Rope_iterator tmp = *this;
+                --*this;
+                return tmp;
+            }
+
+            friend bool operator==(const Rope_iterator &x, const Rope_iterator &y) noexcept
+            {
+                return x._Current == y._Current && x._Offset == y._Offset;
+            }
+
+            friend bool operator!=(const Rope_iterator &x, const Rope_iterator &y) noexcept
+            {
+                return !(x == y);
+            }
+
+        private:
+            Rope_iterator(_Node *const *root, _Node *current, size_t offset) noexcept
+                : _Root(root), _Current(current), _Offset(offset)
+            {
+            }
+
+            _Node *const *_Root = nullptr;
+            _Node *_Current = nullptr;
+            size_t _Offset = 0;
+        };
+
+        /**
+         * @brief Forward iterator over the chunks of a rope, each seen as a
+         *        contiguous span, for scanning with vectorized loops
+         */
+        template <class _Ty, class _Alloc>
+        class Rope_chunk_iterator
+        {
+            using _Node = Rope_node<_Ty, _Alloc>;
+
+            friend class rope<_Ty, _Alloc>;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::span<const _Ty>;
+            using difference_type = ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            Rope_chunk_iterator() noexcept = default;
+
+            value_type operator*() const noexcept
+            {
+                return value_type(_Current->_Data.data(), _Current->_Data.size());
+            }
+
+            Rope_chunk_iterator &operator++() noexcept
+            {
+                _Current = _Current->_Next;
+                return *this;
+            }
+
+            Rope_chunk_iterator operator++(int) noexcept
+            {
+                Rope_chunk_iterator tmp = *this;
+                _Current = _Current->_Next;
+                return tmp;
+            }
+
+            friend bool operator==(const Rope_chunk_iterator &x, const Rope_chunk_iterator &y) noexcept
+            {
+                return x._Current == y._Current;
+            }
+
+            friend bool operator!=(const Rope_chunk_iterator &x, const Rope_chunk_iterator &y) noexcept
+            {
+                return x._Current != y._Current;
+            }
+
+        private:
+            explicit Rope_chunk_iterator(const _Node *current) noexcept
+                : _Current(current)
+            {
+            }
+
+            const _Node *_Current = nullptr;
+        };
+    }
+
+    /**
+     * @brief Sequence stored as a balanced tree of small contiguous chunks
+     *        (a treap keyed by position), for large buffers edited in the
+     *        middle. Inserting or erasing one element, finding the n-th one,
+     *        splitting at a position and concatenating two ropes are all
+     *        O(log n); scanning goes chunk by chunk through chunks().
+     *
+     *        Edits invalidate all iterators.
+     *
+     * @tparam _Ty
+     * @tparam _Alloc
+     */
+    template <class _Ty, class _Alloc = std::allocator<_Ty>>
+    class rope
+    {
+        using _Node = __base::Rope_node<_Ty, _Alloc>;
+        using _Node_alloc = typename std::allocator_traits<_Alloc>::template rebind_alloc<_Node>;
+        using _Node_traits = std::allocator_traits<_Node_alloc>;
+
+    public:
+        using value_type = _Ty;
+        using allocator_type = _Alloc;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = value_type &;
+        using const_reference = const value_type &;
+        using iterator = __base::Rope_iterator<_Ty, _Alloc, false>;
+        using const_iterator = __base::Rope_iterator<_Ty, _Alloc, true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using chunk_iterator = __base::Rope_chunk_iterator<_Ty, _Alloc>;
+
+        /**
+         * @brief Elements a chunk holds at most
+         */
+        static constexpr size_type chunk_capacity = std::max<size_type>(16, rope_chunk_bytes / sizeof(_Ty));
+
+        /**
+         * @brief The chunks of a rope in order, for range-for
+         */
+        struct chunk_range
+        {
+            chunk_iterator begin() const noexcept
+            {
+                return _First;
+            }
+
+            chunk_iterator end() const noexcept
+            {
+                return chunk_iterator();
+            }
+
+            chunk_iterator _First;
+        };
+
+        rope() = default;
+
+        explicit rope(const allocator_type &alloc)
+            : _M_alloc(alloc)
+        {
+        }
+
+        rope(size_type n, const value_type &value, const allocator_type &alloc = allocator_type())
+            : _M_alloc(alloc)
+        {
+            _Fill_initialize(n, value);
+        }
+
+        /**
+         * @brief Construct a new rope with copies of range [first, last),
+         *        packed into full chunks
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         * @param alloc
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        rope(Input first, Input last, const allocator_type &alloc = allocator_type())
+            : _M_alloc(alloc)
+        {
+            _Range_initialize(first, last);
+        }
+
+        rope(std::initializer_list<value_type> l, const allocator_type &alloc = allocator_type())
+            : rope(l.begin(), l.end(), alloc)
+        {
+        }
+
+        rope(const rope &x)
+            : _M_alloc(_Node_traits::select_on_container_copy_construction(x._M_alloc))
+        {
+            _Range_initialize(x.begin(), x.end());
+        }
+
+        rope(rope &&x) noexcept
+            : _M_alloc(std::move(x._M_alloc)), _Root(x._Root), _Seed(x._Seed)
+        {
+            x._Root = nullptr;
+        }
+
+        ~rope()
+        {
+            _Destroy_tree(_Root);
+        }
+
+        rope &operator=(const rope &x)
+        {
+            if (this != &x)
+                rope(x).swap(*this);
+            return *this;
+        }
+
+        rope &operator=(rope &&x) noexcept
+        {
+            rope(std::move(x)).swap(*this);
+            return *this;
+        }
+
+        rope &operator=(std::initializer_list<value_type> l)
+        {
+            rope(l, get_allocator()).swap(*this);
+            return *this;
+        }
+
+        void swap(rope &x) noexcept
+        {
+            std::swap(_M_alloc, x._M_alloc);
+            std::swap(_Root, x._Root);
+            std::swap(_Seed, x._Seed);
+        }
+
+        allocator_type get_allocator() const
+        {
+            return allocator_type(_M_alloc);
+        }
+
+        iterator begin() noexcept
+        {
+            return iterator(&_Root, _Leftmost(_Root), 0);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(&_Root, _Leftmost(_Root), 0);
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(&_Root, nullptr, 0);
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(&_Root, nullptr, 0);
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        /**
+         * @brief Iterator to the element at @a n, or end() when @a n is
+         *        size(); O(log n)
+         */
+        iterator nth(size_type n) noexcept
+        {
+            if (n == size())
+                return end();
+            std::pair<_Node *, size_type> at = _Find(n);
+            return iterator(&_Root, at.first, at.second);
+        }
+
+        const_iterator nth(size_type n) const noexcept
+        {
+            return const_cast<rope *>(this)->nth(n);
+        }
+
+        /**
+         * @brief The chunks in order, each a std::span<const _Ty>
+         */
+        chunk_range chunks() const noexcept
+        {
+            return chunk_range{chunk_iterator(_Leftmost(_Root))};
+        }
+
+        size_type size() const noexcept
+        {
+            return _Node::_S_total(_Root);
+        }
+
+        bool empty() const noexcept
+        {
+            return !_Root;
+        }
+
+        reference operator[](size_type n) noexcept
+        {
+            std::pair<_Node *, size_type> at = _Find(n);
+            return at.first->_Data[at.second];
+        }
+
+        const_reference operator[](size_type n) const noexcept
+        {
+            std::pair<_Node *, size_type> at = _Find(n);
+            return at.first->_Data[at.second];
+        }
+
+        reference at(size_type n)
+        {
+            _Range_check(n, "collections::rope::at");
+            return (*this)[n];
+        }
+
+        const_reference at(size_type n) const
+        {
+            _Range_check(n, "collections::rope::at");
+            return (*this)[n];
+        }
+
+        reference front() noexcept
+        {
+            return _Leftmost(_Root)->_Data.front();
+        }
+
+        const_reference front() const noexcept
+        {
+            return _Leftmost(_Root)->_Data.front();
+        }
+
+        reference back() noexcept
+        {
+            return _Rightmost(_Root)->_Data.back();
+        }
+
+        const_reference back() const noexcept
+        {
+            return _Rightmost(_Root)->_Data.back();
+        }
+
+        /**
+         * @brief Inserts a new element before position @a pos; O(log n)
+         *
+         * @param pos Index in [0, size()]
+         */
+        template <typename... Args>
+        reference emplace(size_type pos, Args &&...args)
+        {
+            if (!_Root)
+            {
+                _Node *node = _New_node();
+                try
+                {
+                    node->_Data.emplace_back(std::forward<Args>(args)...);
+                }
+                catch (...)
+                {
+                    _Delete_node(node);
+                    throw;
+                }
+                node->_Update();
+                _Root = node;
+                return node->_Data.front();
+            }
+
+            // Only the chunk at pos changes, so the totals on its path are
+            // fixed on the way back; a full chunk is first split in two.
+            _Ty *inserted = nullptr;
+            size_type full = 0;
+            auto put = [&](_Node *node, size_type offset)
+            {
+                if (node->_Data.size() == chunk_capacity)
+                {
+                    full = pos - offset;
+                    return false;
+                }
+                inserted = std::addressof(*node->_Data.emplace(node->_Data.cbegin() + offset, std::forward<Args>(args)...));
+                return true;
+            };
+            if (_Visit(_Root, pos, true, put))
+                return *inserted;
+
+            // The arguments may name an element the split is about to move.
+            value_type tmp(std::forward<Args>(args)...);
+            _Cut(full + chunk_capacity / 2);
+            _Visit(_Root, pos, true, [&](_Node *node, size_type offset)
+                   {
+                       inserted = std::addressof(*node->_Data.emplace(node->_Data.cbegin() + offset, std::move(tmp)));
+                       return true;
+                   });
+            return *inserted;
+        }
+
+        void insert(size_type pos, const value_type &value)
+        {
+            emplace(pos, value);
+        }
+
+        void insert(size_type pos, value_type &&value)
+        {
+            emplace(pos, std::move(value));
+        }
+
+        /**
+         * @brief Inserts copies of the range [first, last) before position
+         *        @a pos; O(log n) on top of copying the range
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void insert(size_type pos, Input first, Input last)
+        {
+            insert(pos, rope(first, last, get_allocator()));
+        }
+
+        void insert(size_type pos, std::initializer_list<value_type> l)
+        {
+            insert(pos, l.begin(), l.end());
+        }
+
+        /**
+         * @brief Moves the elements of @a x in before position @a pos,
+         *        leaving @a x empty; O(log n) when the allocators compare
+         *        equal, otherwise the elements are moved one by one
+         */
+        void insert(size_type pos, rope &&x)
+        {
+            if (!x._Root)
+                return;
+            if (!_Node_traits::is_always_equal::value && !(_M_alloc == x._M_alloc))
+            {
+                insert(pos, std::make_move_iterator(x.begin()), std::make_move_iterator(x.end()));
+                x.clear();
+                return;
+            }
+            _Cut(pos);
+            _Node *left, *right;
+            _Split_tree(_Root, pos, left, right);
+            _Root = _Merge_tree(_Merge_tree(left, x._Root), right);
+            x._Root = nullptr;
+        }
+
+        void push_back(const value_type &value)
+        {
+            emplace(size(), value);
+        }
+
+        void push_back(value_type &&value)
+        {
+            emplace(size(), std::move(value));
+        }
+
+        template <typename... Args>
+        reference emplace_back(Args &&...args)
+        {
+            return emplace(size(), std::forward<Args>(args)...);
+        }
+
+        void push_front(const value_type &value)
+        {
+            emplace(0, value);
+        }
+
+        void push_front(value_type &&value)
+        {
+            emplace(0, std::move(value));
+        }
+
+        /**
+         * @brief Appends the elements of @a x, leaving it empty; O(log n)
+         *        when the allocators compare equal
+         */
+        void append(rope &&x)
+        {
+            insert(size(), std::move(x));
+        }
+
+        void append(const rope &x)
+        {
+            append(rope(x));
+        }
+
+        /**
+         * @brief Removes the element at @a pos; O(log n)
+         */
+        void erase(size_type pos)
+        {
+            std::pair<_Node *, size_type> at = _Find(pos);
+            if (at.first->_Data.size() == 1)
+            {
+                erase(pos, pos + 1);
+                return;
+            }
+            _Visit(_Root, pos, false, [](_Node *node, size_type offset)
+                   {
+                       node->_Data.erase(node->_Data.cbegin() + offset);
+                       return true;
+                   });
+            const size_type start = pos - at.second;
+            _Coalesce(start);
+            if (start)
+                _Coalesce(start - 1 - _Find(start - 1).second);
+        }
+
+        /**
+         * @brief Removes the elements in [first, last); O(log n) on top of
+         *        destroying them
+         */
+        void erase(size_type first, size_type last)
+        {
+            if (first == last)
+                return;
+            rope removed = split(first);
+            rope rest = removed.split(last - first);
+            const size_type junction = size();
+            _Root = _Merge_tree(_Root, rest._Root);
+            rest._Root = nullptr;
+            if (junction)
+                _Coalesce(junction - _Find(junction - 1).second - 1);
+        }
+
+        void pop_back()
+        {
+            erase(size() - 1);
+        }
+
+        void pop_front()
+        {
+            erase(0);
+        }
+
+        /**
+         * @brief Moves the elements from @a pos on into the returned rope,
+         *        keeping [0, pos) here; O(log n)
+         */
+        rope split(size_type pos)
+        {
+            rope tail(get_allocator());
+            _Cut(pos);
+            _Split_tree(_Root, pos, _Root, tail._Root);
+            return tail;
+        }
+
+        /**
+         * @brief A new rope with copies of the elements in [first, last);
+         *        O(log n) on top of copying them
+         */
+        rope slice(size_type first, size_type last) const
+        {
+            const_iterator from = nth(first);
+            rope result(get_allocator());
+            result._Range_initialize(from, std::next(from, difference_type(last - first)));
+            return result;
+        }
+
+        void clear() noexcept
+        {
+            _Destroy_tree(_Root);
+            _Root = nullptr;
+        }
+
+    private:
+        _Node *_New_node()
+        {
+            // xorshift32; the priorities only have to look random
+            _Seed ^= _Seed << 13;
+            _Seed ^= _Seed >> 17;
+            _Seed ^= _Seed << 5;
+            _Node_alloc alloc(_M_alloc);
+            _Node *node = _Node_traits::allocate(alloc, 1);
+            try
+            {
+                ::new (static_cast<void *>(node)) _Node(_Seed, _M_alloc);
+            }
+            catch (...)
+            {
+                _Node_traits::deallocate(alloc, node, 1);
+                throw;
+            }
+            return node;
+        }
+
+        void _Delete_node(_Node *node) noexcept
+        {
+            node->~_Node();
+            _Node_alloc alloc(_M_alloc);
+            _Node_traits::deallocate(alloc, node, 1);
+        }
+
+        void _Destroy_tree(_Node *node) noexcept
+        {
+            while (node)
+            {
+                _Destroy_tree(node->_Left);
+                _Node *right = node->_Right;
+                _Delete_node(node);
+                node = right;
+            }
+        }
+
+        static _Node *_Leftmost(_Node *node) noexcept
+        {
+            if (node)
+                while (node->_Left)
+                    node = node->_Left;
+            return node;
+        }
+
+        static _Node *_Rightmost(_Node *node) noexcept
+        {
+            if (node)
+                while (node->_Right)
+                    node = node->_Right;
+            return node;
+        }
+
+        void _Range_check(size_type n, const char *what) const
+        {
+            if (n >= size())
+                std::__throw_out_of_range(what);
+        }
+
+        /**
+         * @brief The chunk holding element @a pos and the offset in it
+         */
+        std::pair<_Node *, size_type> _Find(size_type pos) const noexcept
+        {
+            _Node *node = _Root;
+            for (;;)
+            {
+                const size_type left = _Node::_S_total(node->_Left);
+                if (pos < left)
+                    node = node->_Left;
+                else if ((pos -= left) < node->_Data.size())
+                    return {node, pos};
+                else
+                {
+                    pos -= node->_Data.size();
+                    node = node->_Right;
+                }
+            }
+        }
+
+        /**
+         * @brief Calls @a fn with the chunk holding position @a pos (or, with
+         *        @a at_end, the chunk it ends) and the offset in it; when it
+         *        returns true the chunk was changed and the totals on the path
+         *        are brought up to date.
+         */
+        template <class _Fn>
+        static bool _Visit(_Node *node, size_type pos, bool at_end, _Fn &&fn)
+        {
+            const size_type left = _Node::_S_total(node->_Left);
+            const size_type here = node->_Data.size();
+            bool changed;
+            if (pos < left)
+                changed = _Visit(node->_Left, pos, at_end, fn);
+            else if (pos - left < here || (at_end && pos - left == here))
+                changed = fn(node, pos - left);
+            else
+                changed = _Visit(node->_Right, pos - left - here, at_end, fn);
+            if (changed)
+                node->_Update();
+            return changed;
+        }
+
+        /**
+         * @brief Splits @a node into the first @a pos elements and the rest.
+         *        @a pos must fall between chunks; nodes are only relinked.
+         */
+        static void _Split(_Node *node, size_type pos, _Node *&left, _Node *&right) noexcept
+        {
+            if (!node)
+            {
+                left = right = nullptr;
+                return;
+            }
+            const size_type before = _Node::_S_total(node->_Left);
+            if (pos <= before)
+            {
+                _Split(node->_Left, pos, left, node->_Left);
+                right = node;
+            }
+            else
+            {
+                _Split(node->_Right, pos - before - node->_Data.size(), node->_Right, right);
+                left = node;
+            }
+            node->_Update();
+        }
+
+        static _Node *_Merge(_Node *left, _Node *right) noexcept
+        {
+            if (!left)
+                return right;
+            if (!right)
+                return left;
+            if (left->_Priority >= right->_Priority)
+            {
+                left->_Right = _Merge(left->_Right, right);
+                left->_Update();
+                return left;
+            }
+            right->_Left = _Merge(left, right->_Left);
+            right->_Update();
+            return right;
+        }
+
+        /**
+         * @brief _Split, also cutting the thread of chunks at @a pos
+         */
+        static void _Split_tree(_Node *node, size_type pos, _Node *&left, _Node *&right) noexcept
+        {
+            _Split(node, pos, left, right);
+            if (left && right)
+            {
+                _Rightmost(left)->_Next = nullptr;
+                _Leftmost(right)->_Prev = nullptr;
+            }
+        }
+
+        /**
+         * @brief _Merge, also joining the threads of chunks
+         */
+        static _Node *_Merge_tree(_Node *left, _Node *right) noexcept
+        {
+            if (left && right)
+            {
+                _Node *last = _Rightmost(left);
+                _Node *first = _Leftmost(right);
+                last->_Next = first;
+                first->_Prev = last;
+            }
+            return _Merge(left, right);
+        }
+
+        /**
+         * @brief Makes @a pos fall between chunks, moving the tail of the
+         *        chunk it falls in to a new chunk. Throws before changing
+         *        anything.
+         */
+        void _Cut(size_type pos)
+        {
+            if (pos == 0 || pos >= size())
+                return;
+            std::pair<_Node *, size_type> at = _Find(pos);
+            if (!at.second)
+                return;
+            _Node *node = _New_node();
+            try
+            {
+                vector<_Ty, _Alloc> &data = at.first->_Data;
+                node->_Data.reserve(data.size() - at.second);
+                node->_Data.insert(node->_Data.end(),
+                                   std::__make_move_if_noexcept_iterator(data.begin() + at.second),
+                                   std::__make_move_if_noexcept_iterator(data.end()));
+            }
+            catch (...)
+            {
+                _Delete_node(node);
+                throw;
+            }
+            node->_Update();
+            _Visit(_Root, pos - at.second, false, [&](_Node *chunk, size_type)
+                   {
+                       chunk->_Data.erase(chunk->_Data.cbegin() + at.second, chunk->_Data.cend());
+                       return true;
+                   });
+            _Node *left, *right;
+            _Split_tree(_Root, pos, left, right);
+            _Root = _Merge_tree(_Merge_tree(left, node), right);
+        }
+
+        /**
+         * @brief Folds the chunk after the one starting at @a start into it
+         *        when both are at most a quarter full, so erasing leaves no
+         *        trail of tiny chunks. Skipped when it cannot be done without
+         *        throwing.
+         */
+        void _Coalesce(size_type start) noexcept
+        {
+            if constexpr (std::is_nothrow_move_constructible_v<_Ty>)
+            {
+                _Node *node = _Find(start).first;
+                _Node *next = node->_Next;
+                const size_type here = node->_Data.size();
+                if (!next || here > chunk_capacity / 4 || next->_Data.size() > chunk_capacity / 4)
+                    return;
+                try
+                {
+                    node->_Data.reserve(here + next->_Data.size());
+                }
+                catch (...)
+                {
+                    return;
+                }
+                _Node *left, *middle, *right;
+                _Split_tree(_Root, start + here, left, right);
+                _Split_tree(right, next->_Data.size(), middle, right);
+                _Root = _Merge_tree(left, right);
+                _Visit(_Root, start, false, [&](_Node *chunk, size_type)
+                       {
+                           for (_Ty &value : middle->_Data)
+                               chunk->_Data.emplace_back(std::move(value));
+                           return true;
+                       });
+                _Delete_node(middle);
+            }
+        }
+
+        /**
+         * @brief Builds the empty rope from [first, last), in full chunks
+         */
+        template <typename Input>
+        void _Range_initialize(Input first, Input last)
+        {
+            try
+            {
+                while (first != last)
+                {
+                    _Node *node = _New_node();
+                    try
+                    {
+                        node->_Data.reserve(chunk_capacity);
+                        for (; first != last && node->_Data.size() < chunk_capacity; ++first)
+                            node->_Data.emplace_back(*first);
+                    }
+                    catch (...)
+                    {
+                        _Delete_node(node);
+                        throw;
+                    }
+                    node->_Update();
+                    _Root = _Merge_tree(_Root, node);
+                }
+            }
+            catch (...)
+            {
+                clear();
+                throw;
+            }
+        }
+
+        void _Fill_initialize(size_type n, const value_type &value)
+        {
+            try
+            {
+                for (; n; n -= std::min(n, chunk_capacity))
+                {
+                    _Node *node = _New_node();
+                    try
+                    {
+                        node->_Data.insert(node->_Data.end(), std::min(n, chunk_capacity), value);
+                    }
+                    catch (...)
+                    {
+                        _Delete_node(node);
+                        throw;
+                    }
+                    node->_Update();
+                    _Root = _Merge_tree(_Root, node);
+                }
+            }
+            catch (...)
+            {
+                clear();
+                throw;
+            }
+        }
+
+        _Node_alloc _M_alloc;
+        _Node *_Root = nullptr;
+        uint32_t _Seed = 0x9e3779b9u;
+    };
+
+    template <class _Ty, class _Alloc>
+    inline bool operator==(const rope<_Ty, _Alloc> &x, const rope<_Ty, _Alloc> &y)
+    {
+        return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin());
+    }
+
+    template <class _Ty, class _Alloc>
+    inline bool operator!=(const rope<_Ty, _Alloc> &x, const rope<_Ty, _Alloc> &y)
+    {
+        return !(x == y);
+    }
+
+    template <class _Ty, class _Alloc>
+    inline void swap(rope<_Ty, _Alloc> &x, rope<_Ty, _Alloc> &y) noexcept
+    {
+        x.swap(y);
+    }
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include "serialization.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        /**
+         * @brief Read-only elements of a raw serialized image, used in
+         *        place. The header is checked once, here; afterwards access
+         *        is plain pointer arithmetic over the caller's buffer, which
+         *        must outlive the view.
+         */
+        template <class _Ty>
+        class Serial_view
+        {
+            static_assert(_Serial_raw<_Ty>, "serialized views need trivially copyable elements");
+
+        public:
+            using value_type = _Ty;
+            using pointer = const _Ty *;
+            using const_pointer = const _Ty *;
+            using reference = const value_type &;
+            using const_reference = const value_type &;
+            using size_type = size_t;
+            using difference_type = ptrdiff_t;
+            using const_iterator = Vector_const_iterator<_Ty>;
+            using iterator = const_iterator;
+            using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+            using reverse_iterator = const_reverse_iterator;
+
+            const_iterator begin() const noexcept
+            {
+                return const_iterator(_Start);
+            }
+
+            const_iterator end() const noexcept
+            {
+                return const_iterator(_Last);
+            }
+
+            const_iterator cbegin() const noexcept
+            {
+                return const_iterator(_Start);
+            }
+
+            const_iterator cend() const noexcept
+            {
+                return const_iterator(_Last);
+            }
+
+            const_reverse_iterator rbegin() const noexcept
+            {
+                return const_reverse_iterator(end());
+            }
+
+            const_reverse_iterator rend() const noexcept
+            {
+                return const_reverse_iterator(begin());
+            }
+
+            const_reverse_iterator crbegin() const noexcept
+            {
+                return const_reverse_iterator(cend());
+            }
+
+            const_reverse_iterator crend() const noexcept
+            {
+                return const_reverse_iterator(cbegin());
+            }
+
+            bool empty() const noexcept
+            {
+                return _Start == _Last;
+            }
+
+            const_pointer data() const noexcept
+            {
+                return _Start;
+            }
+
+            const_reference operator[](size_type n) const noexcept
+            {
+                return _Start[n];
+            }
+
+            const_reference front() const noexcept
+            {
+                return *_Start;
+            }
+
+            const_reference back() const noexcept
+            {
+                return *(_Last - 1);
+            }
+
+            /**
+             * @brief Bytes of the buffer taken by the image, header included;
+             *        the next image of a concatenated file starts there
+             *
+             * @return size_type
+             */
+            size_type image_size() const noexcept
+            {
+                return Serial_header::_Size + size_type(_Last - _Start) * sizeof(_Ty);
+            }
+
+        protected:
+            Serial_view() noexcept = default;
+
+            /**
+             * @brief Checks the image at @a image and returns its count
+             *
+             * @throw std::runtime_error if the image is malformed, of another
+             *        container or element type, in the other byte order,
+             *        longer than @a bytes, or misaligned for _Ty
+             */
+            uint64_t _Attach(const void *image, size_t bytes, serial_kind kind, serial_kind alternative)
+            {
+                if (bytes < Serial_header::_Size)
+                    throw std::runtime_error("truncated collections serialized image");
+                const unsigned char *in = static_cast<const unsigned char *>(image);
+                const Serial_header header = Serial_header::_Decode(in);
+                header._Expect<_Ty>(header._Kind == alternative ? alternative : kind, true);
+                if (header._Swapped && sizeof(_Ty) > 1)
+                    throw std::runtime_error("collections serialized image has the other byte order");
+                if (header._Count > (bytes - Serial_header::_Size) / sizeof(_Ty))
+                    throw std::runtime_error("truncated collections serialized image");
+
+                const unsigned char *first = in + Serial_header::_Size;
+                if (reinterpret_cast<uintptr_t>(first) % alignof(_Ty))
+                    throw std::runtime_error("collections serialized image is misaligned for its element type");
+                _Start = reinterpret_cast<const _Ty *>(first);
+                _Last = _Start + header._Count;
+                return header._Count;
+            }
+
+            const _Ty *_Start = nullptr;
+            const _Ty *_Last = nullptr;
+        };
+    }
+
+    /**
+     * @brief Read-only view of a vector image written by serialize(), used
+     *        where it lies: in a loaded buffer or in a file mapped into
+     *        several processes, which then share the page cache. The image
+     *        of a list stores its elements the same way and is accepted too.
+     *
+     *        The elements must be trivially copyable and the image written
+     *        on a machine of the same byte order. The data after the 24 byte
+     *        header must be aligned for _Ty, which holds for alignments up
+     *        to 8 when the buffer is, as mmap and operator new return.
+     *
+     * @tparam _Ty
+     */
+    template <class _Ty>
+    class vector_view
+        : public __base::Serial_view<_Ty>
+    {
+        using _Base = __base::Serial_view<_Ty>;
+
+    public:
+        using typename _Base::const_reference;
+        using typename _Base::size_type;
+
+        vector_view() noexcept = default;
+
+        /**
+         * @brief View the image at the start of [image, image + bytes)
+         *
+         * @param image
+         * @param bytes
+         * @throw std::runtime_error if the image cannot be viewed
+         */
+        vector_view(const void *image, size_t bytes)
+        {
+            this->_Attach(image, bytes, serial_kind::vector, serial_kind::list);
+        }
+
+        size_type size() const noexcept
+        {
+            return size_type(this->_Last - this->_Start);
+        }
+
+        const_reference at(size_type n) const
+        {
+            if (n >= size())
+                std::__throw_out_of_range("collections::vector_view::at");
+            return this->_Start[n];
+        }
+    };
+
+    /**
+     * @brief Read-only view of an array<_Ty, _Size> image written by
+     *        serialize(); see vector_view for the requirements
+     *
+     * @tparam _Ty
+     * @tparam _Size
+     */
+    template <class _Ty, size_t _Size>
+    class array_view
+        : public __base::Serial_view<_Ty>
+    {
+        using _Base = __base::Serial_view<_Ty>;
+
+    public:
+        using typename _Base::const_reference;
+        using typename _Base::size_type;
+
+        /**
+         * @brief View the image at the start of [image, image + bytes)
+         *
+         * @param image
+         * @param bytes
+         * @throw std::runtime_error if the image cannot be viewed or does not
+         *        hold _Size elements
+         */
+        array_view(const void *image, size_t bytes)
+        {
+            if (this->_Attach(image, bytes, serial_kind::array, serial_kind::array) != _Size)
+                throw std::runtime_error("collections serialized array has another size");
+        }
+
+        constexpr size_type size() const noexcept
+        {
+            return _Size;
+        }
+
+        const_reference at(size_type n) const
+        {
+            if (n >= _Size)
+                std::__throw_out_of_range("collections::array_view::at");
+            return this->_Start[n];
+        }
+    };
+}
@@ -0,0 +1,601 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <cstdint>
+#include <bit>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "array.h"
+#include "vector.h"
+#include "list.h"
+
+namespace collections
+{
+    /**
+     * @brief Size of the buffer a list is streamed through; a list is never
+     *        gathered into one contiguous block on save or load.
+     */
+    constexpr size_t serialization_chunk_bytes = size_t(64) << 10;
+
+    /**
+     * @brief Which container wrote a serialized image
+     *
+     */
+    enum class serial_kind : uint8_t
+    {
+        array = 1,
+        vector = 2,
+        list = 3
+    };
+
+    namespace __base
+    {
+        /**
+         * @brief Header in front of every serialized container, 24 bytes:
+         *
+         *   0  magic "CLSR"
+         *   4  format version
+         *   5  byte order of the writer, 'L' or 'B'
+         *   6  serial_kind
+         *   7  1 if the elements are stored as raw bytes, 0 if encoded one
+         *      by one
+         *   8  sizeof the element for raw images, else 0
+         *  12  reserved, 0
+         *  16  element count
+         *
+         * Multi byte fields, here and in the payload, are in the writer's
+         * byte order; a reader of the other order swaps them.
+         */
+        struct Serial_header
+        {
+            static constexpr char _Magic[4] = {'C', 'L', 'S', 'R'};
+            static constexpr uint8_t _Version = 1;
+            static constexpr size_t _Size = 24;
+
+            static constexpr char _S_native_order() noexcept
+            {
+                return std::endian::native == std::endian::little ? 'L' : 'B';
+            }
+
+            serial_kind _Kind;
+            bool _Raw;
+            uint32_t _Element_size;
+            uint64_t _Count;
+            bool _Swapped = false;
+
+            void _Encode(unsigned char (&out)[_Size]) const noexcept
+            {
+                std::memset(out, 0, _Size);
+                std::memcpy(out, _Magic, 4);
+                out[4] = _Version;
+                out[5] = _S_native_order();
+                out[6] = uint8_t(_Kind);
+                out[7] = _Raw;
+                std::memcpy(out + 8, &_Element_size, 4);
+                std::memcpy(out + 16, &_Count, 8);
+            }
+
+            /**
+             * @brief Reads and checks a header
+             *
+             * @throw std::runtime_error if @a in does not start with a
+             *        header of this version
+             */
+            static Serial_header _Decode(const unsigned char *in)
+            {
+                if (std::memcmp(in, _Magic, 4) != 0)
+                    throw std::runtime_error("not a collections serialized image");
+                if (in[4] != _Version)
+                    throw std::runtime_error("unsupported collections serialization version");
+                if (in[5] != 'L' && in[5] != 'B')
+                    throw std::runtime_error("corrupt collections serialization header");
+
+                Serial_header header;
+                header._Kind = serial_kind(in[6]);
+                header._Raw = in[7] != 0;
+                header._Swapped = in[5] != _S_native_order();
+                std::memcpy(&header._Element_size, in + 8, 4);
+                std::memcpy(&header._Count, in + 16, 8);
+                if (header._Swapped)
+                {
+                    header._Element_size = _Byteswap(header._Element_size);
+                    header._Count = _Byteswap(header._Count);
+                }
+                return header;
+            }
+
+            template <class _Int>
+            static _Int _Byteswap(_Int x) noexcept
+            {
+                _Swap_bytes(&x, sizeof(x));
+                return x;
+            }
+
+            static void _Swap_bytes(void *p, size_t n) noexcept
+            {
+                std::reverse(static_cast<unsigned char *>(p), static_cast<unsigned char *>(p) + n);
+            }
+
+            /**
+             * @brief Checks the header describes a container of @a kind
+             *        holding _Ty stored the way this build would store it
+             */
+            template <class _Ty>
+            void _Expect(serial_kind kind, bool raw) const
+            {
+                if (_Kind != kind)
+                    throw std::runtime_error("collections serialized image holds another container");
+                if (_Raw != raw || (raw && _Element_size != sizeof(_Ty)))
+                    throw std::runtime_error("collections serialized image holds another element type");
+                if (raw && _Swapped && !std::is_scalar_v<_Ty>)
+                    throw std::runtime_error("collections serialized image of a structure has the other byte order");
+            }
+        };
+
+        /**
+         * @brief Elements stored as their object representation
+         *
+         */
+        template <class _Ty>
+        constexpr bool _Serial_raw = std::is_trivially_copyable_v<_Ty> && !std::is_pointer_v<_Ty>;
+
+        class Serial_writer
+        {
+        public:
+            explicit Serial_writer(std::ostream &out) noexcept
+                : _Out(out)
+            {
+            }
+
+            void _Bytes(const void *p, size_t n)
+            {
+                _Out.write(static_cast<const char *>(p), std::streamsize(n));
+                if (!_Out)
+                    throw std::runtime_error("cannot write collections serialized image");
+            }
+
+            void _Count(uint64_t n)
+            {
+                _Bytes(&n, sizeof(n));
+            }
+
+            std::ostream &_Out;
+        };
+
+        class Serial_reader
+        {
+        public:
+            Serial_reader(std::istream &in, bool swapped) noexcept
+                : _In(in), _Swapped(swapped)
+            {
+            }
+
+            void _Bytes(void *p, size_t n)
+            {
+                _In.read(static_cast<char *>(p), std::streamsize(n));
+                if (size_t(_In.gcount()) != n)
+                    throw std::runtime_error("truncated collections serialized image");
+                if (_Remaining != _Unknown)
+                    _Remaining -= std::min<uint64_t>(_Remaining, n);
+            }
+
+            /**
+             * @brief Reads @a n raw elements, swapping each on a foreign
+             *        byte order. Only scalars can be swapped: the layout of
+             *        a structure is not in the image.
+             */
+            template <class _Ty>
+            void _Elements(_Ty *p, size_t n)
+            {
+                if constexpr (!std::is_scalar_v<_Ty>)
+                    if (_Swapped)
+                        throw std::runtime_error("collections serialized image of a structure has the other byte order");
+                _Bytes(p, n * sizeof(_Ty));
+                if constexpr (sizeof(_Ty) > 1)
+                    if (_Swapped)
+                        for (size_t i = 0; i < n; ++i)
+                            Serial_header::_Swap_bytes(p + i, sizeof(_Ty));
+            }
+
+            uint64_t _Count()
+            {
+                uint64_t n;
+                _Elements(&n, 1);
+                return n;
+            }
+
+            /**
+             * @brief Notes how many bytes a seekable stream has left, once
+             *        per top-level read: every seek discards the buffer of a
+             *        file stream. Elements read by collections_deserialize()
+             *        are not subtracted, which only makes the bound looser.
+             */
+            void _Measure()
+            {
+                const std::istream::pos_type here = _In.tellg();
+                if (here == std::istream::pos_type(-1))
+                    return;
+                _In.seekg(0, std::ios_base::end);
+                const std::istream::pos_type end = _In.tellg();
+                _In.seekg(here);
+                if (end != std::istream::pos_type(-1) && end >= here)
+                    _Remaining = uint64_t(end - here);
+            }
+
+            /**
+             * @brief Fails early when the stream is known to hold fewer than
+             *        @a n elements of @a size bytes, before storage for them
+             *        is made
+             *
+             * @return Whether the stream length is known; if not, callers
+             *         grow their storage as the data actually arrives
+             */
+            bool _Expect(uint64_t n, size_t size)
+            {
+                if (_Remaining == _Unknown)
+                    return false;
+                if (n > _Remaining / size)
+                    throw std::runtime_error("truncated collections serialized image");
+                return true;
+            }
+
+            static constexpr uint64_t _Unknown = uint64_t(-1);
+
+            std::istream &_In;
+            bool _Swapped;
+            uint64_t _Remaining = _Unknown;
+        };
+
+        /**
+         * @brief Encoding of one element that is not stored raw. Strings and
+         *        the collections containers are built in; other types
+         *        provide, found by argument dependent lookup,
+         *
+         *          void collections_serialize(std::ostream &, const T &);
+         *          void collections_deserialize(std::istream &, T &);
+         */
+        template <class _Ty>
+        struct Serial_codec
+        {
+            static void _Write(Serial_writer &w, const _Ty &x)
+            {
+                collections_serialize(w._Out, x);
+            }
+
+            static void _Read(Serial_reader &r, _Ty &x)
+            {
+                collections_deserialize(r._In, x);
+            }
+        };
+
+        template <class _Ty>
+        void _Serial_write_elements(Serial_writer &w, const _Ty *p, size_t n)
+        {
+            if constexpr (_Serial_raw<_Ty>)
+                w._Bytes(p, n * sizeof(_Ty));
+            else
+                for (size_t i = 0; i < n; ++i)
+                    Serial_codec<_Ty>::_Write(w, p[i]);
+        }
+
+        template <class _Ty>
+        void _Serial_read_elements(Serial_reader &r, _Ty *p, size_t n)
+        {
+            if constexpr (_Serial_raw<_Ty>)
+                r._Elements(p, n);
+            else
+                for (size_t i = 0; i < n; ++i)
+                    Serial_codec<_Ty>::_Read(r, p[i]);
+        }
+
+        template <class _Ty, class _Alloc, class _Policy>
+        void _Serial_write_payload(Serial_writer &w, const vector<_Ty, _Alloc, _Policy> &v)
+        {
+            _Serial_write_elements(w, v.data(), v.size());
+        }
+
+        template <class _Ty, class _Alloc, class _Policy>
+        void _Serial_read_payload(Serial_reader &r, vector<_Ty, _Alloc, _Policy> &v, uint64_t n)
+        {
+            v.clear();
+            if (n > v.max_size())
+                throw std::runtime_error("collections serialized vector is too large");
+            if constexpr (_Serial_raw<_Ty>)
+            {
+                if (r._Expect(n, sizeof(_Ty)))
+                {
+                    v.resize(n);
+                    r._Elements(v.data(), n);
+                }
+                else
+                {
+                    // a corrupt count runs into the end of the stream
+                    // before it can make a huge allocation
+                    constexpr size_t chunk = std::max<size_t>(1, serialization_chunk_bytes / sizeof(_Ty));
+                    while (n)
+                    {
+                        const size_t k = size_t(std::min<uint64_t>(n, chunk));
+                        const size_t filled = v.size();
+                        // grow geometrically, never past the announced count
+                        if (v.capacity() < filled + k)
+                            v.reserve(size_t(std::min<uint64_t>(filled + n, std::max<uint64_t>(2 * uint64_t(v.capacity()), filled + k))));
+                        v.resize(filled + k);
+                        r._Elements(v.data() + filled, k);
+                        n -= k;
+                    }
+                }
+            }
+            else
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    _Ty x{};
+                    Serial_codec<_Ty>::_Read(r, x);
+                    v.push_back(std::move(x));
+                }
+            }
+        }
+
+        template <class _Ty, class _Alloc, class _Policy>
+        void _Serial_write_payload(Serial_writer &w, const list<_Ty, _Alloc, _Policy> &l)
+        {
+            if constexpr (_Serial_raw<_Ty>)
+            {
+                constexpr size_t chunk = std::max<size_t>(1, serialization_chunk_bytes / sizeof(_Ty));
+                std::unique_ptr<_Ty[]> buffer(new _Ty[chunk]);
+                size_t filled = 0;
+                for (const _Ty &x : l)
+                {
+                    buffer[filled++] = x;
+                    if (filled == chunk)
+                    {
+                        w._Bytes(buffer.get(), filled * sizeof(_Ty));
+                        filled = 0;
+                    }
+                }
+                w._Bytes(buffer.get(), filled * sizeof(_Ty));
+            }
+            else
+                for (const _Ty &x : l)
+                    Serial_codec<_Ty>::_Write(w, x);
+        }
+
+        template <class _Ty, class _Alloc, class _Policy>
+        void _Serial_read_payload(Serial_reader &r, list<_Ty, _Alloc, _Policy> &l, uint64_t n)
+        {
+            l.clear();
+            if constexpr (_Serial_raw<_Ty>)
+            {
+                constexpr size_t chunk = std::max<size_t>(1, serialization_chunk_bytes / sizeof(_Ty));
+                std::unique_ptr<_Ty[]> buffer(new _Ty[chunk]);
+                while (n)
+                {
+                    const size_t k = size_t(std::min<uint64_t>(n, chunk));
+                    r._Elements(buffer.get(), k);
+                    l.insert(l.cend(), buffer.get(), buffer.get() + k);
+                    n -= k;
+                }
+            }
+            else
+            {
+                for (; n; --n)
+                {
+                    _Ty x{};
+                    Serial_codec<_Ty>::_Read(r, x);
+                    l.push_back(std::move(x));
+                }
+            }
+        }
+
+        template <class _Ty, size_t _Size>
+        void _Serial_write_payload(Serial_writer &w, const array<_Ty, _Size> &a)
+        {
+            _Serial_write_elements(w, a.data(), _Size);
+        }
+
+        template <class _Ty, size_t _Size>
+        void _Serial_read_payload(Serial_reader &r, array<_Ty, _Size> &a, uint64_t n)
+        {
+            if (n != _Size)
+                throw std::runtime_error("collections serialized array has another size");
+            _Serial_read_elements(r, a.data(), _Size);
+        }
+
+        template <class _Char, class _Traits, class _Alloc>
+        struct Serial_codec<std::basic_string<_Char, _Traits, _Alloc>>
+        {
+            using _String = std::basic_string<_Char, _Traits, _Alloc>;
+
+            static void _Write(Serial_writer &w, const _String &s)
+            {
+                w._Count(s.size());
+                _Serial_write_elements(w, s.data(), s.size());
+            }
+
+            static void _Read(Serial_reader &r, _String &s)
+            {
+                uint64_t n = r._Count();
+                if (n > s.max_size())
+                    throw std::runtime_error("collections serialized string is too large");
+                if (r._Expect(n, sizeof(_Char)))
+                {
+                    s.resize(size_t(n));
+                    _Serial_read_elements(r, s.data(), s.size());
+                    return;
+                }
+                constexpr size_t chunk = std::max<size_t>(1, serialization_chunk_bytes / sizeof(_Char));
+                s.clear();
+                while (n)
+                {
+                    const size_t k = size_t(std::min<uint64_t>(n, chunk));
+                    const size_t filled = s.size();
+                    s.resize(filled + k);
+                    _Serial_read_elements(r, s.data() + filled, k);
+                    n -= k;
+                }
+            }
+        };
+
+        template <class _Ty, class _Alloc, class _Policy>
+        struct Serial_codec<vector<_Ty, _Alloc, _Policy>>
+        {
+            static void _Write(Serial_writer &w, const vector<_Ty, _Alloc, _Policy> &v)
+            {
+                w._Count(v.size());
+                _Serial_write_payload(w, v);
+            }
+
+            static void _Read(Serial_reader &r, vector<_Ty, _Alloc, _Policy> &v)
+            {
+                _Serial_read_payload(r, v, r._Count());
+            }
+        };
+
+        template <class _Ty, class _Alloc, class _Policy>
+        struct Serial_codec<list<_Ty, _Alloc, _Policy>>
+        {
+            static void _Write(Serial_writer &w, const list<_Ty, _Alloc, _Policy> &l)
+            {
+                w._Count(l.size());
+                _Serial_write_payload(w, l);
+            }
+
+            static void _Read(Serial_reader &r, list<_Ty, _Alloc, _Policy> &l)
+            {
+                _Serial_read_payload(r, l, r._Count());
+            }
+        };
+
+        template <class _Ty, size_t _Size>
+        struct Serial_codec<array<_Ty, _Size>>
+        {
+            static void _Write(Serial_writer &w, const array<_Ty, _Size> &a)
+            {
+                _Serial_write_payload(w, a);
+            }
+
+            static void _Read(Serial_reader &r, array<_Ty, _Size> &a)
+            {
+                _Serial_read_payload(r, a, _Size);
+            }
+        };
+
+        template <class _Ty, class _Container>
+        void _Serialize(std::ostream &out, const _Container &c, serial_kind kind, size_t n)
+        {
+            Serial_header header{kind, _Serial_raw<_Ty>, _Serial_raw<_Ty> ? uint32_t(sizeof(_Ty)) : 0u, n};
+            unsigned char bytes[Serial_header::_Size];
+            header._Encode(bytes);
+
+            Serial_writer w(out);
+            w._Bytes(bytes, sizeof(bytes));
+            _Serial_write_payload(w, c);
+        }
+
+        template <class _Ty, class _Container>
+        void _Deserialize(std::istream &in, _Container &c, serial_kind kind)
+        {
+            unsigned char bytes[Serial_header::_Size];
+            Serial_reader r(in, false);
+            r._Measure();
+            r._Bytes(bytes, sizeof(bytes));
+            const Serial_header header = Serial_header::_Decode(bytes);
+            header._Expect<_Ty>(kind, _Serial_raw<_Ty>);
+            r._Swapped = header._Swapped;
+            _Serial_read_payload(r, c, header._Count);
+        }
+    }
+
+    /**
+     * @brief Writes @a v to @a out: a 24 byte header, then the elements as
+     *        one block when they are trivially copyable, else one by one.
+     *
+     * @param out
+     * @param v
+     * @throw std::runtime_error if the stream fails
+     */
+    template <class _Ty, class _Alloc, class _Policy>
+    void serialize(std::ostream &out, const vector<_Ty, _Alloc, _Policy> &v)
+    {
+        __base::_Serialize<_Ty>(out, v, serial_kind::vector, v.size());
+    }
+
+    /**
+     * @brief Replaces the contents of @a v with the image read from @a in.
+     *        Raw elements are read straight into the vector's storage. On
+     *        failure @a v is valid but its contents are unspecified.
+     *
+     * @param in
+     * @param v
+     * @throw std::runtime_error if the image is malformed, truncated or of
+     *        another container or element type
+     */
+    template <class _Ty, class _Alloc, class _Policy>
+    void deserialize(std::istream &in, vector<_Ty, _Alloc, _Policy> &v)
+    {
+        __base::_Deserialize<_Ty>(in, v, serial_kind::vector);
+    }
+
+    /**
+     * @brief Writes @a l to @a out. Raw elements are gathered into a buffer
+     *        of serialization_chunk_bytes and written a chunk at a time.
+     *
+     * @param out
+     * @param l
+     * @throw std::runtime_error if the stream fails
+     */
+    template <class _Ty, class _Alloc, class _Policy>
+    void serialize(std::ostream &out, const list<_Ty, _Alloc, _Policy> &l)
+    {
+        __base::_Serialize<_Ty>(out, l, serial_kind::list, l.size());
+    }
+
+    /**
+     * @brief Replaces the contents of @a l with the image read from @a in,
+     *        a chunk at a time. On failure @a l is valid but its contents
+     *        are unspecified.
+     *
+     * @param in
+     * @param l
+     * @throw std::runtime_error if the image is malformed, truncated or of
+     *        another container or element type
+     */
+    template <class _Ty, class _Alloc, class _Policy>
+    void deserialize(std::istream &in, list<_Ty, _Alloc, _Policy> &l)
+    {
+        __base::_Deserialize<_Ty>(in, l, serial_kind::list);
+    }
+
+    /**
+     * @brief Writes @a a to @a out
+     *
+     * @param out
+     * @param a
+     * @throw std::runtime_error if the stream fails
+     */
+    template <class _Ty, size_t _Size>
+    void serialize(std::ostream &out, const array<_Ty, _Size> &a)
+    {
+        __base::_Serialize<_Ty>(out, a, serial_kind::array, _Size);
+    }
+
+    /**
+     * @brief Overwrites @a a with the image read from @a in, which must
+     *        hold exactly _Size elements
+     *
+     * @param in
+     * @param a
+     * @throw std::runtime_error if the image is malformed, truncated or of
+     *        another container, element type or size
+     */
+    template <class _Ty, size_t _Size>
+    void deserialize(std::istream &in, array<_Ty, _Size> &a)
+    {
+        __base::_Deserialize<_Ty>(in, a, serial_kind::array);
+    }
+}
@@ -0,0 +1,606 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <streambuf>
+#include <ostream>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include "list.h"
+#include "vector.h"
+#include "serialization.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        /**
+         * @brief Fixed set of equal chunk buffers shared by the snapshots of
+         *        one writer; taking one blocks while all are queued.
+         */
+        class Snapshot_buffers
+        {
+        public:
+            Snapshot_buffers(size_t chunk, size_t count)
+                : _Chunk(chunk), _Storage(new char[chunk * count])
+            {
+                for (size_t i = 0; i < count; ++i)
+                    _Free.push_back(_Storage.get() + i * chunk);
+            }
+
+            char *_Acquire()
+            {
+                std::unique_lock<std::mutex> lock(_Lock);
+                _Available.wait(lock, [this]
+                                { return !_Free.empty(); });
+                char *buffer = _Free.back();
+                _Free.pop_back();
+                return buffer;
+            }
+
+            void _Release(char *buffer)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_Lock);
+                    _Free.push_back(buffer);
+                }
+                _Available.notify_one();
+            }
+
+            const size_t _Chunk;
+
+        private:
+            std::unique_ptr<char[]> _Storage;
+            vector<char *> _Free;
+            std::mutex _Lock;
+            std::condition_variable _Available;
+        };
+
+        /**
+         * @brief One snapshot in flight. The image goes to "<path>.tmp",
+         *        which replaces @a path once written and synced, so a crash
+         *        never leaves a torn file under the real name.
+         *
+         *        A copy-on-write snapshot also records the state of every
+         *        chunk of the source: _Pending, being written straight from
+         *        the source, copied aside by the owner, or written.
+         */
+        struct Snapshot_job
+        {
+            enum : uint8_t
+            {
+                _Pending,
+                _Writing,
+                _Copied,
+                _Written
+            };
+
+            Snapshot_job(const std::string &path, Snapshot_buffers &buffers)
+                : _Path(path), _Temp(path + ".tmp"), _Buffers(buffers)
+            {
+                _Fd = ::open(_Temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (_Fd < 0)
+                    throw std::system_error(errno, std::generic_category(), "cannot create collections snapshot file");
+            }
+
+            ~Snapshot_job()
+            {
+                if (_Fd >= 0)
+                    ::close(_Fd);
+                for (char *copy : _Copies)
+                    if (copy)
+                        _Buffers._Release(copy);
+            }
+
+            void _Fail(int error)
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                if (!_Error)
+                    _Error = error;
+            }
+
+            bool _Failed()
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                return _Error != 0;
+            }
+
+            void _Write(const char *data, size_t bytes, uint64_t offset)
+            {
+                while (bytes)
+                {
+                    const ssize_t n = ::pwrite(_Fd, data, bytes, off_t(offset));
+                    if (n < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        _Fail(errno);
+                        return;
+                    }
+                    data += n;
+                    bytes -= size_t(n);
+                    offset += uint64_t(n);
+                }
+            }
+
+            /**
+             * @brief Writes the source chunk by chunk, each from the owner's
+             *        copy if it made one, else straight from the source
+             */
+            void _Write_source()
+            {
+                const size_t chunk = _Buffers._Chunk;
+                for (size_t i = 0; i < _State.size(); ++i)
+                {
+                    const size_t bytes = std::min(chunk, _Source_bytes - i * chunk);
+                    const uint64_t offset = _Source_offset + i * chunk;
+                    const char *from;
+                    {
+                        std::lock_guard<std::mutex> lock(_Lock);
+                        if (_State[i] == _Pending)
+                        {
+                            _State[i] = _Writing;
+                            from = _Source + i * chunk;
+                        }
+                        else
+                            from = _Copies[i];
+                    }
+                    if (!_Failed())
+                        _Write(from, bytes, offset);
+                    {
+                        std::lock_guard<std::mutex> lock(_Lock);
+                        _State[i] = _Written;
+                        if (_Copies[i])
+                        {
+                            _Buffers._Release(_Copies[i]);
+                            _Copies[i] = nullptr;
+                        }
+                    }
+                    _Changed.notify_all();
+                }
+            }
+
+            /**
+             * @brief Owner side of copy-on-write: makes sure the bytes
+             *        [first, last) of the source are no longer needed in
+             *        place, copying their pending chunks aside. Only a chunk
+             *        being written at that moment is waited for.
+             */
+            void _Release_source(size_t first, size_t last)
+            {
+                if (first >= last || first >= _Source_bytes)
+                    return;
+                last = std::min(last, _Source_bytes);
+                const size_t chunk = _Buffers._Chunk;
+                for (size_t i = first / chunk; i <= (last - 1) / chunk; ++i)
+                {
+                    std::unique_lock<std::mutex> lock(_Lock);
+                    if (_State[i] == _Pending)
+                    {
+                        // the buffer may take a while: do not hold the
+                        // writer off meanwhile, it may write the chunk itself
+                        lock.unlock();
+                        char *copy = _Buffers._Acquire();
+                        lock.lock();
+                        if (_State[i] == _Pending)
+                        {
+                            std::memcpy(copy, _Source + i * chunk, std::min(chunk, _Source_bytes - i * chunk));
+                            _Copies[i] = copy;
+                            _State[i] = _Copied;
+                            continue;
+                        }
+                        lock.unlock();
+                        _Buffers._Release(copy);
+                        lock.lock();
+                    }
+                    _Changed.wait(lock, [this, i]
+                                  { return _State[i] != _Writing; });
+                }
+            }
+
+            /**
+             * @brief Syncs and renames the file into place, or removes it
+             *        after a failure
+             */
+            void _Finish()
+            {
+                if (!_Failed() && ::fsync(_Fd) != 0)
+                    _Fail(errno);
+                ::close(_Fd);
+                _Fd = -1;
+                if (!_Failed() && ::rename(_Temp.c_str(), _Path.c_str()) != 0)
+                    _Fail(errno);
+                if (_Failed())
+                    ::unlink(_Temp.c_str());
+                {
+                    std::lock_guard<std::mutex> lock(_Lock);
+                    _Done = true;
+                }
+                _Changed.notify_all();
+            }
+
+            std::string _Path;
+            std::string _Temp;
+            Snapshot_buffers &_Buffers;
+            int _Fd = -1;
+
+            std::mutex _Lock;
+            std::condition_variable _Changed;
+            int _Error = 0;
+            bool _Done = false;
+
+            const char *_Source = nullptr;
+            size_t _Source_bytes = 0;
+            uint64_t _Source_offset = 0;
+            vector<uint8_t> _State;
+            vector<char *> _Copies;
+        };
+
+        struct Snapshot_op
+        {
+            enum _Kind_type
+            {
+                _Buffer,
+                _Source,
+                _Encode,
+                _Finish
+            };
+
+            std::shared_ptr<Snapshot_job> _Job;
+            _Kind_type _Kind;
+            char *_Data;
+            size_t _Bytes;
+            uint64_t _Offset;
+            std::function<void(std::ostream &)> _Encoder = {};
+        };
+
+        class Snapshot_queue
+        {
+        public:
+            void _Push(Snapshot_op op)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_Lock);
+                    _Ops.push_back(std::move(op));
+                }
+                _Ready.notify_one();
+            }
+
+            bool _Pop(Snapshot_op &op)
+            {
+                std::unique_lock<std::mutex> lock(_Lock);
+                _Ready.wait(lock, [this]
+                            { return !_Ops.empty() || _Stop; });
+                if (_Ops.empty())
+                    return false;
+                op = std::move(_Ops.front());
+                _Ops.pop_front();
+                return true;
+            }
+
+            void _Close()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_Lock);
+                    _Stop = true;
+                }
+                _Ready.notify_one();
+            }
+
+        private:
+            list<Snapshot_op> _Ops;
+            std::mutex _Lock;
+            std::condition_variable _Ready;
+            bool _Stop = false;
+        };
+
+        /**
+         * @brief Stream buffer of the writer thread: what serialize()
+         *        produces is gathered in @a buffer and written one chunk at a
+         *        time
+         */
+        class Snapshot_streambuf
+            : public std::streambuf
+        {
+        public:
+            Snapshot_streambuf(Snapshot_job &job, char *buffer, size_t bytes) noexcept
+                : _Job(job)
+            {
+                setp(buffer, buffer + bytes);
+            }
+
+            /**
+             * @brief Writes the last partial chunk
+             */
+            void _Close()
+            {
+                _Flush();
+            }
+
+        protected:
+            int_type overflow(int_type ch) override
+            {
+                if (!_Flush())
+                    return traits_type::eof();
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                {
+                    *pptr() = traits_type::to_char_type(ch);
+                    pbump(1);
+                }
+                return traits_type::not_eof(ch);
+            }
+
+        private:
+            bool _Flush()
+            {
+                const size_t bytes = size_t(pptr() - pbase());
+                if (!_Job._Failed())
+                    _Job._Write(pbase(), bytes, _Offset);
+                _Offset += bytes;
+                setp(pbase(), epptr());
+                return !_Job._Failed();
+            }
+
+            Snapshot_job &_Job;
+            uint64_t _Offset = 0;
+        };
+    }
+
+    /**
+     * @brief Handle of a snapshot being written in the background
+     *
+     */
+    class snapshot
+    {
+    public:
+        snapshot() noexcept = default;
+
+        explicit snapshot(std::shared_ptr<__base::Snapshot_job> job) noexcept
+            : _M_job(std::move(job))
+        {
+        }
+
+        /**
+         * @brief Whether the file is complete (or the snapshot failed)
+         *
+         */
+        bool ready() const
+        {
+            if (!_M_job)
+                return true;
+            std::lock_guard<std::mutex> lock(_M_job->_Lock);
+            return _M_job->_Done;
+        }
+
+        /**
+         * @brief Blocks until the file is synced and in place
+         *
+         * @throw std::system_error if writing it failed
+         */
+        void wait() const
+        {
+            if (!_M_job)
+                return;
+            std::unique_lock<std::mutex> lock(_M_job->_Lock);
+            _M_job->_Changed.wait(lock, [this]
+                                  { return _M_job->_Done; });
+            if (_M_job->_Error)
+                throw std::system_error(_M_job->_Error, std::generic_category(), "cannot write collections snapshot");
+        }
+
+    protected:
+        std::shared_ptr<__base::Snapshot_job> _M_job;
+    };
+
+    /**
+     * @brief Copy-on-write snapshot of a vector, see
+     *        snapshot_writer::save_cow()
+     *
+     * @tparam _Ty
+     */
+    template <class _Ty>
+    class vector_snapshot
+        : public snapshot
+    {
+    public:
+        using snapshot::snapshot;
+
+        /**
+         * @brief Call before changing the elements [first, last) of the
+         *        vector: their chunks are copied aside unless already
+         *        written. Blocks only for a free buffer or for a chunk the
+         *        writer is writing at that moment.
+         *
+         * @param first
+         * @param last
+         */
+        void prepare_write(size_t first, size_t last)
+        {
+            if (_M_job)
+                _M_job->_Release_source(first * sizeof(_Ty), last * sizeof(_Ty));
+        }
+
+        void prepare_write(size_t index)
+        {
+            prepare_write(index, index + 1);
+        }
+    };
+
+    /**
+     * @brief Writes container snapshots to disk on a background thread, in
+     *        the format of serialize(). The thread encodes and writes with
+     *        pwrite one chunk at a time; the file appears under its name only
+     *        once complete and synced.
+     *
+     */
+    class snapshot_writer
+    {
+    public:
+        /**
+         * @brief Starts the writer thread
+         *
+         * @param chunk_bytes Size of one buffer and one write
+         * @param buffers Number of buffers for the chunks save_cow() copies
+         *        aside; at most this many are held across all snapshots in
+         *        flight, plus the one chunk the thread encodes into
+         * @param copy_limit_bytes Largest container, in bytes of elements,
+         *        save() agrees to copy
+         */
+        explicit snapshot_writer(size_t chunk_bytes = size_t(1) << 20, size_t buffers = 8,
+                                 size_t copy_limit_bytes = size_t(256) << 20)
+            : _Buffers(std::max<size_t>(chunk_bytes, 4096), std::max<size_t>(buffers, 1)),
+              _Copy_limit(copy_limit_bytes),
+              _Encode_buffer(new char[_Buffers._Chunk]),
+              _Thread([this]
+                      { _Run(); })
+        {
+        }
+
+        snapshot_writer(const snapshot_writer &) = delete;
+        snapshot_writer &operator=(const snapshot_writer &) = delete;
+
+        /**
+         * @brief Completes the queued snapshots, then joins the thread
+         *
+         */
+        ~snapshot_writer()
+        {
+            _Queue._Close();
+            _Thread.join();
+        }
+
+        /**
+         * @brief Snapshots @a c, any container serialize() takes. The caller
+         *        blocks while @a c is copied, which freezes its state:
+         *        encoding and disk writes happen on the writer thread, and
+         *        @a c may change again once this returns. The copy lives
+         *        until the snapshot is written, so @a c is held twice
+         *        meanwhile.
+         *
+         *        That copy is O(n) on the calling thread, so containers over
+         *        the writer's copy limit are refused. Vectors of trivially
+         *        copyable elements can use save_cow() instead, which copies
+         *        only the chunks changed before they are written. Lists have
+         *        no such path: a node does not know its position, so the
+         *        owner cannot tell which chunk a change falls in.
+         *
+         * @param path
+         * @param c
+         * @return snapshot
+         * @throw std::length_error if @a c is over the copy limit
+         * @throw std::system_error if the file cannot be created
+         */
+        template <class _Container>
+        snapshot save(const std::string &path, const _Container &c)
+        {
+            if (c.size() > _Copy_limit / sizeof(typename _Container::value_type))
+                std::__throw_length_error("collections::snapshot_writer::save");
+            auto job = std::make_shared<__base::Snapshot_job>(path, _Buffers);
+            auto frozen = std::make_shared<const _Container>(c);
+            _Queue._Push({job, __base::Snapshot_op::_Encode, nullptr, 0, 0, [frozen](std::ostream &out)
+                          { serialize(out, *frozen); }});
+            _Queue._Push({job, __base::Snapshot_op::_Finish, nullptr, 0, 0});
+            return snapshot(std::move(job));
+        }
+
+        /**
+         * @brief Snapshots @a v without copying it up front: the writer
+         *        reads the elements in place. Until the snapshot is ready the
+         *        caller must call prepare_write() on the result before
+         *        changing elements, and must not reallocate or shrink @a v;
+         *        appending within the capacity is fine.
+         *
+         * @param path
+         * @param v
+         * @return vector_snapshot<_Ty>
+         * @throw std::system_error if the file cannot be created
+         */
+        template <class _Ty, class _Alloc, class _Policy>
+        vector_snapshot<_Ty> save_cow(const std::string &path, const vector<_Ty, _Alloc, _Policy> &v)
+        {
+            static_assert(__base::_Serial_raw<_Ty>, "copy-on-write snapshots need trivially copyable elements");
+
+            auto job = std::make_shared<__base::Snapshot_job>(path, _Buffers);
+            job->_Source = reinterpret_cast<const char *>(v.data());
+            job->_Source_bytes = v.size() * sizeof(_Ty);
+            job->_Source_offset = __base::Serial_header::_Size;
+            const size_t chunks = (job->_Source_bytes + _Buffers._Chunk - 1) / _Buffers._Chunk;
+            job->_State.resize(chunks, __base::Snapshot_job::_Pending);
+            job->_Copies.resize(chunks, nullptr);
+
+            __base::Serial_header header{serial_kind::vector, true, uint32_t(sizeof(_Ty)), v.size()};
+            unsigned char encoded[__base::Serial_header::_Size];
+            header._Encode(encoded);
+            char *bytes = _Buffers._Acquire();
+            std::memcpy(bytes, encoded, sizeof(encoded));
+            _Queue._Push({job, __base::Snapshot_op::_Buffer, bytes, __base::Serial_header::_Size, 0});
+            _Queue._Push({job, __base::Snapshot_op::_Source, nullptr, 0, 0});
+            _Queue._Push({job, __base::Snapshot_op::_Finish, nullptr, 0, 0});
+            return vector_snapshot<_Ty>(std::move(job));
+        }
+
+    private:
+        void _Run()
+        {
+            __base::Snapshot_op op;
+            while (_Queue._Pop(op))
+            {
+                switch (op._Kind)
+                {
+                case __base::Snapshot_op::_Buffer:
+                    if (!op._Job->_Failed())
+                        op._Job->_Write(op._Data, op._Bytes, op._Offset);
+                    _Buffers._Release(op._Data);
+                    break;
+                case __base::Snapshot_op::_Source:
+                    op._Job->_Write_source();
+                    break;
+                case __base::Snapshot_op::_Encode:
+                    _Encode(*op._Job, op._Encoder);
+                    break;
+                case __base::Snapshot_op::_Finish:
+                    op._Job->_Finish();
+                    break;
+                }
+                op._Job.reset();
+                op._Encoder = nullptr;
+            }
+        }
+
+        /**
+         * @brief Serializes a frozen container through _Encode_buffer, a
+         *        buffer of the writer's own: taking one from _Buffers could
+         *        wait on owners whose copies only this thread releases
+         */
+        void _Encode(__base::Snapshot_job &job, const std::function<void(std::ostream &)> &encoder)
+        {
+            __base::Snapshot_streambuf buffer(job, _Encode_buffer.get(), _Buffers._Chunk);
+            std::ostream out(&buffer);
+            try
+            {
+                encoder(out);
+                buffer._Close();
+            }
+            catch (...)
+            {
+                job._Fail(ECANCELED);
+            }
+        }
+
+        __base::Snapshot_buffers _Buffers;
+        __base::Snapshot_queue _Queue;
+        const size_t _Copy_limit;
+        std::unique_ptr<char[]> _Encode_buffer;
+        std::thread _Thread;
+    };
+}
@@ -0,0 +1,544 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "list.h"
+#include "vector.h"
+
+namespace collections
+{
+    namespace __base
+    {
+        struct Pool_task
+        {
+            void (*_Run)(Pool_task *);
+        };
+
+        template <class _Fn>
+        struct Pool_task_impl
+            : Pool_task
+        {
+            explicit Pool_task_impl(_Fn &&fn)
+                : Pool_task{&Pool_task_impl::_Do_run}, _Fn_obj(std::move(fn))
+            {
+            }
+
+            static void _Do_run(Pool_task *base)
+            {
+                std::unique_ptr<Pool_task_impl> self(static_cast<Pool_task_impl *>(base));
+                self->_Fn_obj();
+            }
+
+            _Fn _Fn_obj;
+        };
+
+        /**
+         * @brief Chase-Lev work stealing deque (the C11 formulation of Le et
+         *        al.). The owner pushes and takes at the bottom without
+         *        contention; thieves take from the top with a CAS. Outgrown
+         *        rings are kept until the deque dies, since a thief may still
+         *        be reading one.
+         */
+        class Work_deque
+        {
+            struct Ring
+            {
+                explicit Ring(size_t capacity)
+                    : _Mask(capacity - 1), _Slots(new std::atomic<Pool_task *>[capacity])
+                {
+                }
+
+                std::atomic<Pool_task *> &operator[](int64_t i) noexcept
+                {
+                    return _Slots[size_t(i) & _Mask];
+                }
+
+                size_t _Capacity() const noexcept
+                {
+                    return _Mask + 1;
+                }
+
+                const size_t _Mask;
+                std::unique_ptr<std::atomic<Pool_task *>[]> _Slots;
+            };
+
+        public:
+            Work_deque()
+            {
+                _Rings.push_back(std::make_unique<Ring>(256));
+                _Array.store(_Rings.back().get(), std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Owner only
+             */
+            void _Push(Pool_task *task)
+            {
+                const int64_t b = _Bottom.load(std::memory_order_relaxed);
+                const int64_t t = _Top.load(std::memory_order_acquire);
+                Ring *a = _Array.load(std::memory_order_relaxed);
+                if (b - t > int64_t(a->_Capacity()) - 1)
+                    a = _Grow(a, t, b);
+                // release on the slot itself publishes the task to thieves
+                (*a)[b].store(task, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_release);
+                _Bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Owner only; newest task first
+             */
+            Pool_task *_Take() noexcept
+            {
+                const int64_t b = _Bottom.load(std::memory_order_relaxed) - 1;
+                Ring *a = _Array.load(std::memory_order_relaxed);
+                _Bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t t = _Top.load(std::memory_order_relaxed);
+                Pool_task *task = nullptr;
+                if (t <= b)
+                {
+                    task = (*a)[b].load(std::memory_order_relaxed);
+                    if (t == b)
+                    {
+                        // last element: race the thieves for it
+                        if (!_Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed))
+                            task = nullptr;
+                        _Bottom.store(b + 1, std::memory_order_relaxed);
+                    }
+                }
+                else
+                    _Bottom.store(b + 1, std::memory_order_relaxed);
+                return task;
+            }
+
+            /**
+             * @brief Any thread; oldest task first
+             */
+            Pool_task *_Steal() noexcept
+            {
+                int64_t t = _Top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const int64_t b = _Bottom.load(std::memory_order_acquire);
+                if (t >= b)
+                    return nullptr;
+                Ring *a = _Array.load(std::memory_order_acquire);
+                Pool_task *task = (*a)[t].load(std::memory_order_acquire);
+                if (!_Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    return nullptr;
+                return task;
+            }
+
+            bool _Empty() const noexcept
+            {
+                return _Top.load(std::memory_order_acquire) >= _Bottom.load(std::memory_order_acquire);
+            }
+
+        private:
+            Ring *_Grow(Ring *a, int64_t t, int64_t b)
+            {
+                _Rings.push_back(std::make_unique<Ring>(a->_Capacity() * 2));
+                Ring *bigger = _Rings.back().get();
+                for (int64_t i = t; i < b; ++i)
+                    (*bigger)[i].store((*a)[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                _Array.store(bigger, std::memory_order_release);
+                return bigger;
+            }
+
+            alignas(64) std::atomic<int64_t> _Top{0};
+            alignas(64) std::atomic<int64_t> _Bottom{0};
+            std::atomic<Ring *> _Array{nullptr};
+            vector<std::unique_ptr<Ring>> _Rings;
+        };
+
+        /**
+         * @brief Completion state of one parallel_for call
+         */
+        struct Pool_group
+        {
+            std::atomic<size_t> _Pending{0};
+            std::atomic<bool> _Failed{false};
+            std::exception_ptr _Error;
+
+            void _Fail(std::exception_ptr e) noexcept
+            {
+                bool expected = false;
+                if (_Failed.compare_exchange_strong(expected, true))
+                    _Error = e;
+            }
+        };
+    }
+
+    /**
+     * @brief How thread_pool places its workers
+     */
+    enum class thread_pinning
+    {
+        none,    // leave placement to the scheduler
+        compact, // worker i on the i-th CPU the process may use
+    };
+
+    /**
+     * @brief Work stealing thread pool. Each worker owns a Chase-Lev deque:
+     *        work spawned by a worker goes to its own deque and is taken back
+     *        newest first, which keeps it cache warm, while idle workers
+     *        steal the oldest (largest) pieces from others. Work submitted
+     *        from outside the pool goes through a shared queue. Idle workers
+     *        sleep on a condition variable.
+     *
+     *        A thread waiting in parallel_for() runs pending tasks instead of
+     *        blocking, so parallel_for() may be nested and called from
+     *        workers.
+     *
+     */
+    class thread_pool
+    {
+        struct alignas(64) Worker
+        {
+            __base::Work_deque _Deque;
+            std::thread _Thread;
+        };
+
+    public:
+        /**
+         * @brief Starts the workers
+         *
+         * @param threads Number of workers, hardware concurrency by default
+         * @param pinning
+         */
+        explicit thread_pool(size_t threads = 0, thread_pinning pinning = thread_pinning::none)
+        {
+            if (!threads)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            _Count = threads;
+            _Workers.reset(new Worker[threads]);
+            for (size_t i = 0; i < threads; ++i)
+                _Workers[i]._Thread = std::thread([this, i]
+                                                  { _Worker_loop(i); });
+            if (pinning == thread_pinning::compact)
+            {
+                const vector<int> cpus = _Allowed_cpus();
+                for (size_t i = 0; i < threads && !cpus.empty(); ++i)
+                    pin_worker(i, size_t(cpus[i % cpus.size()]));
+            }
+        }
+
+        thread_pool(const thread_pool &) = delete;
+        thread_pool &operator=(const thread_pool &) = delete;
+
+        /**
+         * @brief Runs what is still queued, then joins the workers
+         *
+         */
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_Sleep_lock);
+                _Stop.store(true, std::memory_order_seq_cst);
+                _Signal.fetch_add(1, std::memory_order_relaxed);
+            }
+            _Wake.notify_all();
+            for (size_t i = 0; i < _Count; ++i)
+                _Workers[i]._Thread.join();
+        }
+
+        size_t size() const noexcept
+        {
+            return _Count;
+        }
+
+        /**
+         * @brief Index of the calling worker of this pool, or -1
+         */
+        ptrdiff_t worker_index() const noexcept
+        {
+            return _Current_pool == this ? ptrdiff_t(_Current_index) : -1;
+        }
+
+        /**
+         * @brief Pins a worker to one CPU
+         *
+         * @return true On success; always false where affinity is unsupported
+         */
+        bool pin_worker(size_t worker, size_t cpu)
+        {
+#if defined(__linux__)
+            if (worker >= _Count || cpu >= CPU_SETSIZE)
+                return false;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return pthread_setaffinity_np(_Workers[worker]._Thread.native_handle(), sizeof(set), &set) == 0;
+#else
+            (void)worker;
+            (void)cpu;
+            return false;
+#endif
+        }
+
+        /**
+         * @brief Queues fn() to run once. fn must not throw.
+         *
+         * @tparam _Fn
+         * @param fn
+         */
+        template <class _Fn>
+        void post(_Fn fn)
+        {
+            _Schedule(new __base::Pool_task_impl<_Fn>(std::move(fn)));
+        }
+
+        /**
+         * @brief Queues fn() and returns a future of its result or exception
+         *
+         * @tparam _Fn
+         * @param fn
+         * @return std::future<std::invoke_result_t<_Fn>>
+         */
+        template <class _Fn>
+        std::future<std::invoke_result_t<_Fn>> submit(_Fn fn)
+        {
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<_Fn>()>>(std::move(fn));
+            std::future<std::invoke_result_t<_Fn>> result = task->get_future();
+            post([task]
+                 { (*task)(); });
+            return result;
+        }
+
+        /**
+         * @brief Calls fn(lo, hi) over blocks covering [first, last). Blocks
+         *        are split off lazily, in halves, so idle workers steal large
+         *        pieces and the caller keeps the rest. The first exception
+         *        thrown is rethrown here after every started block ends; the
+         *        blocks not yet started are skipped.
+         *
+         * @tparam _Fn
+         * @param first
+         * @param last
+         * @param fn Callable (size_t lo, size_t hi)
+         * @param grain Largest block run without splitting; 0 picks about
+         *        8 blocks per worker
+         */
+        template <class _Fn>
+        void parallel_for_blocks(size_t first, size_t last, _Fn fn, size_t grain = 0)
+        {
+            if (first >= last)
+                return;
+            const size_t n = last - first;
+            if (!grain)
+                grain = std::max<size_t>(1, n / (_Count * 8));
+            if (n <= grain)
+            {
+                fn(first, last);
+                return;
+            }
+
+            __base::Pool_group group;
+            _Split(group, first, last, grain, fn);
+            _Help_until([&group]
+                        { return group._Pending.load(std::memory_order_acquire) == 0; });
+            if (group._Error)
+                std::rethrow_exception(group._Error);
+        }
+
+        /**
+         * @brief Calls fn(i) for every i in [first, last)
+         *
+         * @tparam _Fn
+         * @param first
+         * @param last
+         * @param fn Callable (size_t i)
+         * @param grain See parallel_for_blocks()
+         */
+        template <class _Fn>
+        void parallel_for(size_t first, size_t last, _Fn fn, size_t grain = 0)
+        {
+            parallel_for_blocks(
+                first, last, [&fn](size_t lo, size_t hi)
+                {
+                    for (size_t i = lo; i < hi; ++i)
+                        fn(i); },
+                grain);
+        }
+
+    private:
+        template <class _Fn>
+        void _Split(__base::Pool_group &group, size_t lo, size_t hi, size_t grain, _Fn &fn)
+        {
+            while (hi - lo > grain)
+            {
+                const size_t mid = lo + (hi - lo) / 2;
+                group._Pending.fetch_add(1, std::memory_order_relaxed);
+                post([this, &group, mid, hi, grain, &fn]
+                     {
+                         _Split(group, mid, hi, grain, fn);
+                         group._Pending.fetch_sub(1, std::memory_order_release); });
+                hi = mid;
+            }
+            if (group._Failed.load(std::memory_order_relaxed))
+                return;
+            try
+            {
+                fn(lo, hi);
+            }
+            catch (...)
+            {
+                group._Fail(std::current_exception());
+            }
+        }
+
+        void _Schedule(__base::Pool_task *task)
+        {
+            if (_Current_pool == this)
+                _Workers[_Current_index]._Deque._Push(task);
+            else
+            {
+                std::lock_guard<std::mutex> lock(_Inject_lock);
+                _Injected.push_back(task);
+                _Injected_count.fetch_add(1, std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_Sleepers.load(std::memory_order_seq_cst) > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_Sleep_lock);
+                    _Signal.fetch_add(1, std::memory_order_relaxed);
+                }
+                _Wake.notify_one();
+            }
+        }
+
+        __base::Pool_task *_Find_task(size_t self)
+        {
+            if (self < _Count)
+                if (__base::Pool_task *task = _Workers[self]._Deque._Take())
+                    return task;
+            if (_Injected_count.load(std::memory_order_relaxed))
+            {
+                std::lock_guard<std::mutex> lock(_Inject_lock);
+                if (!_Injected.empty())
+                {
+                    __base::Pool_task *task = _Injected.front();
+                    _Injected.pop_front();
+                    _Injected_count.fetch_sub(1, std::memory_order_relaxed);
+                    return task;
+                }
+            }
+            // start at a different victim each time to spread the thieves
+            const size_t start = _Victim.fetch_add(1, std::memory_order_relaxed);
+            for (size_t k = 0; k < _Count; ++k)
+            {
+                const size_t victim = (start + k) % _Count;
+                if (victim != self)
+                    if (__base::Pool_task *task = _Workers[victim]._Deque._Steal())
+                        return task;
+            }
+            return nullptr;
+        }
+
+        template <class _Pred>
+        void _Help_until(_Pred done)
+        {
+            const size_t self = _Current_pool == this ? _Current_index : _Count;
+            while (!done())
+            {
+                if (__base::Pool_task *task = _Find_task(self))
+                    task->_Run(task);
+                else
+                    std::this_thread::yield();
+            }
+        }
+
+        void _Worker_loop(size_t index)
+        {
+            _Current_pool = this;
+            _Current_index = index;
+            for (;;)
+            {
+                if (__base::Pool_task *task = _Find_task(index))
+                {
+                    task->_Run(task);
+                    continue;
+                }
+
+                // announce the nap before the last look, so a concurrent
+                // _Schedule either sees us or we see its task
+                _Sleepers.fetch_add(1, std::memory_order_seq_cst);
+                const uint64_t signal = _Signal.load(std::memory_order_seq_cst);
+                if (__base::Pool_task *task = _Find_task(index))
+                {
+                    _Sleepers.fetch_sub(1, std::memory_order_relaxed);
+                    task->_Run(task);
+                    continue;
+                }
+                if (_Stop.load(std::memory_order_seq_cst))
+                {
+                    _Sleepers.fetch_sub(1, std::memory_order_relaxed);
+                    return;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(_Sleep_lock);
+                    _Wake.wait(lock, [this, signal]
+                               { return _Signal.load(std::memory_order_relaxed) != signal ||
+                                        _Stop.load(std::memory_order_relaxed); });
+                }
+                _Sleepers.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        static vector<int> _Allowed_cpus()
+        {
+            vector<int> cpus;
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0)
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                    if (CPU_ISSET(cpu, &set))
+                        cpus.push_back(cpu);
+#endif
+            return cpus;
+        }
+
+        static inline thread_local thread_pool *_Current_pool = nullptr;
+        static inline thread_local size_t _Current_index = 0;
+
+        size_t _Count;
+        std::unique_ptr<Worker[]> _Workers;
+
+        std::mutex _Inject_lock;
+        list<__base::Pool_task *> _Injected;
+        std::atomic<size_t> _Injected_count{0};
+        std::atomic<size_t> _Victim{0};
+
+        std::mutex _Sleep_lock;
+        std::condition_variable _Wake;
+        std::atomic<size_t> _Sleepers{0};
+        std::atomic<uint64_t> _Signal{0};
+        std::atomic<bool> _Stop{false};
+    };
+
+    /**
+     * @brief Process wide pool with one worker per hardware thread, started
+     *        on first use
+     */
+    inline thread_pool &default_thread_pool()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+}
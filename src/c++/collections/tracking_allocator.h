@@ -0,0 +1,411 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <source_location>
+#include <type_traits>
+#include "vector.h"
+
+namespace collections
+{
+    /**
+     * @brief Number of power of two buckets in a size histogram; bucket i
+     *        counts requests of (2^(i-1), 2^i] bytes.
+     */
+    constexpr size_t tracking_histogram_bins = 48;
+
+    /**
+     * @brief Counters of one call site, as returned by tracking_snapshot()
+     *
+     */
+    struct tracking_site_stats
+    {
+        std::string label;
+        std::string file;
+        unsigned line;
+        uint64_t allocations;
+        uint64_t deallocations;
+        uint64_t bytes_total;
+        int64_t live_bytes;
+        int64_t peak_bytes;
+        uint64_t histogram[tracking_histogram_bins];
+    };
+
+    namespace __base
+    {
+        class Tracking_site
+        {
+        public:
+            Tracking_site(const char *label, const char *file, unsigned line)
+                : _Label(label), _File(file ? file : ""), _Line(line)
+            {
+            }
+
+            static size_t _Bin(size_t bytes) noexcept
+            {
+                const size_t bin = bytes > 1 ? size_t(64 - __builtin_clzll(uint64_t(bytes - 1))) : 0;
+                return bin < tracking_histogram_bins ? bin : tracking_histogram_bins - 1;
+            }
+
+            void _On_allocate(size_t bytes) noexcept
+            {
+                _Allocations.fetch_add(1, std::memory_order_relaxed);
+                _Bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+                _Histogram[_Bin(bytes)].fetch_add(1, std::memory_order_relaxed);
+                const int64_t live = _Live_bytes.fetch_add(int64_t(bytes), std::memory_order_relaxed) + int64_t(bytes);
+                int64_t peak = _Peak_bytes.load(std::memory_order_relaxed);
+                while (live > peak && !_Peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+                    ;
+            }
+
+            void _On_deallocate(size_t bytes) noexcept
+            {
+                _Deallocations.fetch_add(1, std::memory_order_relaxed);
+                _Live_bytes.fetch_sub(int64_t(bytes), std::memory_order_relaxed);
+            }
+
+            tracking_site_stats _Stats() const
+            {
+                tracking_site_stats s{_Label, _File, _Line,
+                                      _Allocations.load(std::memory_order_relaxed),
+                                      _Deallocations.load(std::memory_order_relaxed),
+                                      _Bytes_total.load(std::memory_order_relaxed),
+                                      _Live_bytes.load(std::memory_order_relaxed),
+                                      _Peak_bytes.load(std::memory_order_relaxed),
+                                      {}};
+                for (size_t i = 0; i < tracking_histogram_bins; ++i)
+                    s.histogram[i] = _Histogram[i].load(std::memory_order_relaxed);
+                return s;
+            }
+
+            void _Reset() noexcept
+            {
+                _Allocations.store(0, std::memory_order_relaxed);
+                _Deallocations.store(0, std::memory_order_relaxed);
+                _Bytes_total.store(0, std::memory_order_relaxed);
+                _Peak_bytes.store(_Live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                for (auto &bin : _Histogram)
+                    bin.store(0, std::memory_order_relaxed);
+            }
+
+            const std::string _Label;
+            const std::string _File;
+            const unsigned _Line;
+            Tracking_site *_Next = nullptr;
+
+        private:
+            std::atomic<uint64_t> _Allocations{0};
+            std::atomic<uint64_t> _Deallocations{0};
+            std::atomic<uint64_t> _Bytes_total{0};
+            // signed: a node may be freed through an allocator tagged
+            // differently from the one that allocated it (e.g. after splice)
+            std::atomic<int64_t> _Live_bytes{0};
+            std::atomic<int64_t> _Peak_bytes{0};
+            std::atomic<uint64_t> _Histogram[tracking_histogram_bins] = {};
+        };
+
+        /**
+         * @brief Process-wide list of call sites. It is never destroyed, so
+         *        allocators living in static objects stay valid until exit.
+         */
+        class Tracking_registry
+        {
+        public:
+            static Tracking_registry &_Instance()
+            {
+                static Tracking_registry *registry = new Tracking_registry;
+                return *registry;
+            }
+
+            Tracking_site *_Site(const char *label, const char *file, unsigned line)
+            {
+                std::lock_guard<std::mutex> lock(_Lock);
+                for (Tracking_site *s = _Head.load(std::memory_order_relaxed); s; s = s->_Next)
+                    if (s->_Line == line && s->_Label == label && s->_File == (file ? file : ""))
+                        return s;
+
+                Tracking_site *s = new Tracking_site(label, file, line);
+                s->_Next = _Head.load(std::memory_order_relaxed);
+                _Head.store(s, std::memory_order_release);
+#ifdef _DEBUG
+                _Enable_exit_report(false);
+#endif
+                return s;
+            }
+
+            template <class _Fn>
+            void _For_each(_Fn fn) const
+            {
+                for (Tracking_site *s = _Head.load(std::memory_order_acquire); s; s = s->_Next)
+                    fn(*s);
+            }
+
+            /**
+             * @brief Installs the exit hook once; @a full selects the whole
+             *        report rather than leaks only.
+             */
+            void _Enable_exit_report(bool full)
+            {
+                if (full)
+                    _Full_exit_report.store(true, std::memory_order_relaxed);
+                bool expected = false;
+                if (_Exit_hook.compare_exchange_strong(expected, true))
+                    std::atexit(&Tracking_registry::_At_exit);
+            }
+
+        private:
+            static void _At_exit();
+
+            std::mutex _Lock;
+            std::atomic<Tracking_site *> _Head{nullptr};
+            std::atomic<bool> _Exit_hook{false};
+            std::atomic<bool> _Full_exit_report{false};
+        };
+    }
+
+    /**
+     * @brief Allocator adaptor recording, per call site, allocation counts,
+     *        live bytes, the high-water mark and a histogram of request sizes.
+     *        Memory comes from @a _Inner.
+     *
+     *        A site is a label plus the file and line constructing the
+     *        allocator, so tagging a container is just
+     *
+     *            collections::list<session, collections::tracking_allocator<std::allocator<session>>>
+     *                sessions(collections::tracking_allocator<std::allocator<session>>("sessions"));
+     *
+     *        Rebinding (e.g. to List_base::node_alloc_t) keeps the site, so
+     *        node allocations are reported under the container's tag. The
+     *        allocator moves and swaps along with the memory it made, and
+     *        allocators of different sites compare unequal, so memory is
+     *        always released under the site that allocated it; splicing
+     *        between lists with different tags is therefore not allowed.
+     *
+     * @tparam _Inner
+     */
+    template <class _Inner>
+    class tracking_allocator
+    {
+        using _Inner_traits = std::allocator_traits<_Inner>;
+
+        template <class>
+        friend class tracking_allocator;
+
+    public:
+        using inner_allocator_type = _Inner;
+        using value_type = typename _Inner_traits::value_type;
+        using pointer = typename _Inner_traits::pointer;
+        using const_pointer = typename _Inner_traits::const_pointer;
+        using void_pointer = typename _Inner_traits::void_pointer;
+        using const_void_pointer = typename _Inner_traits::const_void_pointer;
+        using size_type = typename _Inner_traits::size_type;
+        using difference_type = typename _Inner_traits::difference_type;
+
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
+        template <class _Other>
+        struct rebind
+        {
+            using other = tracking_allocator<typename _Inner_traits::template rebind_alloc<_Other>>;
+        };
+
+        /**
+         * @brief Allocator reporting under the "untagged" site
+         *
+         */
+        tracking_allocator()
+            : _M_inner(), _Site(_Untagged())
+        {
+        }
+
+        /**
+         * @brief Allocator reporting under @a label at the caller's location
+         *
+         * @param label
+         * @param inner
+         * @param where Filled in by the compiler
+         */
+        explicit tracking_allocator(const char *label, const _Inner &inner = _Inner(),
+                                    std::source_location where = std::source_location::current())
+            : _M_inner(inner),
+              _Site(__base::Tracking_registry::_Instance()._Site(label, where.file_name(), where.line()))
+        {
+        }
+
+        template <class _Other>
+        tracking_allocator(const tracking_allocator<_Other> &x) noexcept
+            : _M_inner(x._M_inner), _Site(x._Site)
+        {
+        }
+
+        [[nodiscard]] pointer allocate(size_type n)
+        {
+            pointer p = _Inner_traits::allocate(_M_inner, n);
+            _Site->_On_allocate(n * sizeof(value_type));
+            return p;
+        }
+
+        void deallocate(pointer p, size_type n) noexcept
+        {
+            _Site->_On_deallocate(n * sizeof(value_type));
+            _Inner_traits::deallocate(_M_inner, p, n);
+        }
+
+        size_type max_size() const noexcept
+        {
+            return _Inner_traits::max_size(_M_inner);
+        }
+
+        tracking_allocator select_on_container_copy_construction() const
+        {
+            tracking_allocator copy(*this);
+            copy._M_inner = _Inner_traits::select_on_container_copy_construction(_M_inner);
+            return copy;
+        }
+
+        const _Inner &inner_allocator() const noexcept
+        {
+            return _M_inner;
+        }
+
+        /**
+         * @brief Counters of the site this allocator reports to
+         *
+         * @return tracking_site_stats
+         */
+        tracking_site_stats stats() const
+        {
+            return _Site->_Stats();
+        }
+
+        /**
+         * @brief Equal when both report to the same site and their inner
+         *        allocators are equal; memory released through an allocator
+         *        of another site would be charged to the wrong tag.
+         */
+        template <class _Other>
+        friend bool operator==(const tracking_allocator &x, const tracking_allocator<_Other> &y) noexcept
+        {
+            return x._Site == y._Site && x._M_inner == _Inner(y._M_inner);
+        }
+
+        template <class _Other>
+        friend bool operator!=(const tracking_allocator &x, const tracking_allocator<_Other> &y) noexcept
+        {
+            return !(x == y);
+        }
+
+    private:
+        static __base::Tracking_site *_Untagged()
+        {
+            static __base::Tracking_site *site = __base::Tracking_registry::_Instance()._Site("untagged", nullptr, 0);
+            return site;
+        }
+
+        _Inner _M_inner;
+        __base::Tracking_site *_Site;
+    };
+
+    /**
+     * @brief Counters of every call site seen so far
+     *
+     * @return vector<tracking_site_stats>
+     */
+    inline vector<tracking_site_stats> tracking_snapshot()
+    {
+        vector<tracking_site_stats> out;
+        __base::Tracking_registry::_Instance()._For_each([&out](const __base::Tracking_site &s)
+                                                         { out.push_back(s._Stats()); });
+        return out;
+    }
+
+    /**
+     * @brief Bytes allocated through tracking allocators and not yet freed
+     *
+     * @return int64_t
+     */
+    inline int64_t tracking_live_bytes()
+    {
+        int64_t live = 0;
+        __base::Tracking_registry::_Instance()._For_each([&live](const __base::Tracking_site &s)
+                                                         { live += s._Stats().live_bytes; });
+        return live;
+    }
+
+    /**
+     * @brief Zeroes the counters of every site; live bytes are kept so later
+     *        leak checks stay right.
+     *
+     */
+    inline void tracking_reset()
+    {
+        __base::Tracking_registry::_Instance()._For_each([](const __base::Tracking_site &s)
+                                                         { const_cast<__base::Tracking_site &>(s)._Reset(); });
+    }
+
+    /**
+     * @brief Writes the per-site table and size histograms to @a out
+     *
+     * @param out
+     * @param leaks_only Only list sites with live bytes
+     * @return true When nothing is leaked
+     */
+    inline bool tracking_report(std::FILE *out = stderr, bool leaks_only = false)
+    {
+        bool clean = true;
+        bool header = false;
+        __base::Tracking_registry::_Instance()._For_each([&](const __base::Tracking_site &site)
+                                                         {
+            const tracking_site_stats s = site._Stats();
+            if (s.live_bytes != 0)
+                clean = false;
+            if (leaks_only && s.live_bytes == 0)
+                return;
+            if (!header)
+            {
+                std::fprintf(out, "%-24s %-32s %12s %12s %14s %12s %12s\n", "label", "site", "allocs", "frees",
+                             "bytes", "live", "peak");
+                header = true;
+            }
+            char where[512];
+            std::snprintf(where, sizeof(where), "%s:%u", s.file.c_str(), s.line);
+            std::fprintf(out, "%-24s %-32s %12llu %12llu %14llu %12lld %12lld\n", s.label.c_str(), where,
+                         (unsigned long long)s.allocations, (unsigned long long)s.deallocations,
+                         (unsigned long long)s.bytes_total, (long long)s.live_bytes, (long long)s.peak_bytes);
+            if (leaks_only)
+                return;
+            for (size_t i = 0; i < tracking_histogram_bins; ++i)
+                if (s.histogram[i])
+                    std::fprintf(out, "    <= %-14llu %12llu\n", (unsigned long long)(uint64_t(1) << i),
+                                 (unsigned long long)s.histogram[i]);
+        });
+        if (leaks_only && !clean)
+            std::fprintf(out, "collections::tracking_allocator: %lld bytes still allocated\n",
+                         (long long)tracking_live_bytes());
+        return clean;
+    }
+
+    /**
+     * @brief Prints the full report when the program exits. Debug builds
+     *        (_DEBUG) always print the leaked sites at exit.
+     *
+     */
+    inline void tracking_report_at_exit()
+    {
+        __base::Tracking_registry::_Instance()._Enable_exit_report(true);
+    }
+
+    inline void __base::Tracking_registry::_At_exit()
+    {
+        tracking_report(stderr, !_Instance()._Full_exit_report.load(std::memory_order_relaxed));
+    }
+}
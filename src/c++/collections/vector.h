@@ -1,13 +1,20 @@
+#pragma once
+
 #include <memory>
 #include <type_traits>
 #include <iterator>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <initializer_list>
 #include <bits/allocator.h>
+#include "instrumentation.h"
 
 namespace collections
 {
     namespace __base
     {
-        template <typename _Ty, typename _Alloc>
+        template <typename _Ty, typename _Alloc, typename _Policy = no_instrumentation>
         class Vector_base
         {
         public:
@@ -24,6 +31,7 @@ namespace collections
                 pointer _End_storage;
 
                 Vector_impl_data() noexcept
+                    : _Start(), _Last(), _End_storage()
                 {
                 }
 
@@ -88,12 +96,12 @@ namespace collections
             };
 
         protected:
-            allocator_type &_Get_allocator() noexcept
+            alloc_type &_Get_allocator() noexcept
             {
                 return Impl;
             }
 
-            allocator_type const &_Get_allocator() const noexcept
+            alloc_type const &_Get_allocator() const noexcept
             {
                 return Impl;
             }
@@ -117,27 +125,37 @@ namespace collections
             }
 
             Vector_base(allocator_type &&alloc)
-                : Impl(std::move(alloc))
+                : Impl(alloc_type(std::move(alloc)))
+            {
+            }
+
+            Vector_base(allocator_type const &alloc)
+                : Impl(alloc_type(alloc))
             {
             }
 
             Vector_base(size_type n, allocator_type &&alloc)
-                : Impl(std::move(alloc))
+                : Impl(alloc_type(std::move(alloc)))
             {
                 _Create_storage(n);
             }
 
             Vector_base(size_type n, allocator_type const &alloc)
-                : Impl(std::move(alloc))
+                : Impl(alloc_type(alloc))
             {
                 _Create_storage(n);
             }
 
+            Vector_base(Vector_base &&v) noexcept
+                : Impl(std::move(v.Impl))
+            {
+            }
+
             Vector_base(Vector_base &&v, allocator_type const &alloc)
-                : Impl(std::move(alloc))
+                : Impl(alloc_type(alloc))
             {
                 if (alloc == v.get_allocator())
-                    this->Impl._swap(v);
+                    this->Impl._swap(v.Impl);
                 else
                 {
                     size_type n = v.Impl._End_storage - v.Impl._Start;
@@ -153,21 +171,26 @@ namespace collections
         protected:
             Vector_impl Impl;
 
-            [[nodiscard]] pointer _Allocate(size_type n) noexcept
+            [[nodiscard]] pointer _Allocate(size_type n)
             {
-                return n ? std::allocator_traits<alloc_type>::allocate(Impl, n) : pointer();
+                if (!n)
+                    return pointer();
+                pointer ptr = std::allocator_traits<alloc_type>::allocate(Impl, n);
+                _Policy::on_allocate(n * sizeof(_Ty));
+                return ptr;
             }
 
             void _Deallocate(pointer ptr, size_type n) noexcept
             {
                 if (ptr)
+                {
+                    _Policy::on_deallocate(n * sizeof(_Ty));
                     std::allocator_traits<alloc_type>::deallocate(Impl, ptr, n);
+                }
             }
 
-            size_type n;
-
         protected:
-            void _Create_storage(size_type n) noexcept
+            void _Create_storage(size_type n)
             {
                 Impl._Start = _Allocate(n);
                 Impl._Last = Impl._Start;
@@ -179,28 +202,37 @@ namespace collections
         class Vector_const_iterator
         {
         public:
-            using value_type = _Ty;
-            using reference = value_type &;
-            using pointer = value_type *;
-            using diference_type = ptrdiff_t;
-            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = std::remove_const_t<_Ty>;
+            using reference = const value_type &;
+            using pointer = const value_type *;
+            using difference_type = ptrdiff_t;
+            using diference_type = difference_type;
+            using iterator_category = std::random_access_iterator_tag;
 
             using Self = Vector_const_iterator<_Ty>;
 
-            Vector_const_iterator()
+            Vector_const_iterator() noexcept
+                : _Current()
             {
             }
 
-            Vector_const_iterator(pointer ptr)
+            Vector_const_iterator(value_type *ptr) noexcept
                 : _Current(ptr)
             {
             }
 
-            Vector_const_iterator(Self const &cit)
+            Vector_const_iterator(const value_type *ptr) noexcept
+                : _Current(const_cast<value_type *>(ptr))
+            {
+            }
+
+            Vector_const_iterator(Self const &cit) noexcept
                 : _Current(cit._Current)
             {
             }
 
+            Self &operator=(Self const &cit) noexcept = default;
+
             reference operator*() const noexcept
             {
                 return *operator->();
@@ -211,45 +243,99 @@ namespace collections
                 return _Current;
             }
 
-            reference operator[](diference_type const &offset) noexcept
+            reference operator[](difference_type const &offset) const noexcept
             {
                 return _Current[offset];
             }
 
-            Self operator++() noexcept
+            Self &operator++() noexcept
             {
-                return Self(_Current++);
+                ++_Current;
+                return *this;
             }
 
             Self operator++(int) noexcept
             {
-                _Current++;
+                Self temp{*this};
+                ++_Current;
+                return temp;
+            }
+
+            Self &operator--() noexcept
+            {
+                --_Current;
                 return *this;
             }
 
-            Self operator+(diference_type const &offset) const noexcept
+            Self operator--(int) noexcept
+            {
+                Self temp{*this};
+                --_Current;
+                return temp;
+            }
+
+            Self operator+(difference_type const &offset) const noexcept
             {
                 return Self(_Current + offset);
             }
 
-            Self operator+=(diference_type const &offset) noexcept
+            Self &operator+=(difference_type const &offset) noexcept
             {
                 _Current += offset;
                 return *this;
             }
 
-            Self operator-(diference_type const &offset) const noexcept
+            Self operator-(difference_type const &offset) const noexcept
             {
-                return this + -offset;
+                return Self(_Current - offset);
             }
 
-            Self operator-=(diference_type const &offset) noexcept
+            Self &operator-=(difference_type const &offset) noexcept
             {
                 return operator+=(-offset);
             }
 
-        private:
-            pointer _Current;
+            friend difference_type operator-(Self const &x, Self const &y) noexcept
+            {
+                return x._Current - y._Current;
+            }
+
+            friend Self operator+(difference_type const &offset, Self const &x) noexcept
+            {
+                return x + offset;
+            }
+
+            friend bool operator==(Self const &x, Self const &y) noexcept
+            {
+                return x._Current == y._Current;
+            }
+
+            friend bool operator!=(Self const &x, Self const &y) noexcept
+            {
+                return x._Current != y._Current;
+            }
+
+            friend bool operator<(Self const &x, Self const &y) noexcept
+            {
+                return x._Current < y._Current;
+            }
+
+            friend bool operator>(Self const &x, Self const &y) noexcept
+            {
+                return y < x;
+            }
+
+            friend bool operator<=(Self const &x, Self const &y) noexcept
+            {
+                return !(y < x);
+            }
+
+            friend bool operator>=(Self const &x, Self const &y) noexcept
+            {
+                return !(x < y);
+            }
+
+            value_type *_Current;
         };
 
         template <typename _Ty>
@@ -258,11 +344,13 @@ namespace collections
         {
             using _Base = Vector_const_iterator<_Ty>;
 
-            using value_type = _Base::value_type;
-            using reference = _Base::reference;
-            using pointer = _Base::pointer;
-            using diference_type = _Base::diference_type;
-            using iterator_category = _Base::iterator_category;
+        public:
+            using value_type = typename _Base::value_type;
+            using reference = value_type &;
+            using pointer = value_type *;
+            using difference_type = typename _Base::difference_type;
+            using diference_type = difference_type;
+            using iterator_category = typename _Base::iterator_category;
 
             using Self = Vector_iterator<_Ty>;
 
@@ -275,7 +363,7 @@ namespace collections
             {
             }
 
-            Vector_iterator(_Base const &cit) noexcept
+            explicit Vector_iterator(_Base const &cit) noexcept
                 : _Base(cit)
             {
             }
@@ -285,86 +373,115 @@ namespace collections
             {
             }
 
-            reference operator*() noexcept
+            Self &operator=(Self const &it) noexcept = default;
+
+            reference operator*() const noexcept
             {
-                return _Base::operator*();
+                return *this->_Current;
             }
 
-            pointer operator->() noexcept
+            pointer operator->() const noexcept
             {
-                return _Base::operator->();
+                return this->_Current;
             }
 
-            reference operator[](diference_type const &offset) noexcept
+            reference operator[](difference_type const &offset) const noexcept
             {
-                return _Base::operator[](offset);
+                return this->_Current[offset];
             }
 
-            Self operator++() noexcept
+            Self &operator++() noexcept
             {
-                return _Base::operator++();
+                _Base::operator++();
+                return *this;
             }
 
             Self operator++(int) noexcept
             {
+                Self temp{*this};
                 _Base::operator++();
-                return *this;
+                return temp;
             }
 
-            Self operator--() noexcept
+            Self &operator--() noexcept
             {
-                return _Base::operator--();
+                _Base::operator--();
+                return *this;
             }
 
             Self operator--(int) noexcept
             {
+                Self temp{*this};
                 _Base::operator--();
-                return *this;
+                return temp;
             }
 
-            Self operator+(diference_type const &offset) noexcept
+            Self operator+(difference_type const &offset) const noexcept
             {
-                return Self(_Base::operator+(offset));
+                return Self(this->_Current + offset);
             }
 
-            Self operator-(diference_type const &offset) noexcept
+            Self operator-(difference_type const &offset) const noexcept
             {
-                return operator+(-offset);
+                return Self(this->_Current - offset);
             }
 
-            Self operator+=(diference_type const &offset) noexcept
+            Self &operator+=(difference_type const &offset) noexcept
             {
-                return Self(_Base::operator+=(offset));
+                _Base::operator+=(offset);
+                return *this;
             }
 
-            Self operator-=(diference_type const &offset) noexcept
+            Self &operator-=(difference_type const &offset) noexcept
             {
                 return operator+=(-offset);
             }
 
-            _Base _Get_base() noexcept
+            friend difference_type operator-(Self const &x, Self const &y) noexcept
             {
-                return this;
+                return x._Current - y._Current;
+            }
+
+            friend Self operator+(difference_type const &offset, Self const &x) noexcept
+            {
+                return x + offset;
+            }
+
+            _Base _Get_base() const noexcept
+            {
+                return *this;
             }
         };
     }
 
-    template <typename _Ty, typename _Alloc = std::allocator<_Ty>>
-    class vector : public __base::Vector_base<_Ty, _Alloc>
+    /**
+     * @brief Contiguous growable array.
+     *
+     * @tparam _Ty
+     * @tparam _Alloc
+     * @tparam _Policy Instrumentation hooks, see instrumentation.h
+     */
+    template <typename _Ty, typename _Alloc = std::allocator<_Ty>, typename _Policy = no_instrumentation>
+    class vector : public __base::Vector_base<_Ty, _Alloc, _Policy>
     {
-        using _Base = __base::Vector_base<_Ty, _Alloc>;
-        using allocator_type = _Base::allocator_type;
-        using alloc_traits = std::allocator_traits<allocator_type>;
+        using _Base = __base::Vector_base<_Ty, _Alloc, _Policy>;
+        using alloc_type = typename _Base::alloc_type;
+        using alloc_traits = std::allocator_traits<alloc_type>;
 
     public:
+        using allocator_type = typename _Base::allocator_type;
         using value_type = _Ty;
-        using pointer = _Base::pointer;
+        using pointer = typename _Base::pointer;
+        using const_pointer = typename alloc_traits::const_pointer;
         using reference = value_type &;
-        using const_reference = const reference;
+        using const_reference = const value_type &;
         using size_type = size_t;
         using difference_type = ptrdiff_t;
         using const_iterator = __base::Vector_const_iterator<_Ty>;
         using iterator = __base::Vector_iterator<_Ty>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using instrumentation_type = _Policy;
 
     protected:
         using _Base::_Allocate;
@@ -372,19 +489,50 @@ namespace collections
         using _Base::_Get_allocator;
         using _Base::Impl;
 
-        static size_type _S_check_size_init(size_type n, allocator_type const &alloc)
+        static size_type _S_max_size(alloc_type const &alloc) noexcept
         {
             const size_type diffmax = std::numeric_limits<ptrdiff_t>::max() / sizeof(_Ty);
             const size_type allocmax = alloc_traits::max_size(alloc);
-            const size_type small = std::min(diffmax, allocmax);
+            return std::min(diffmax, allocmax);
+        }
 
-            if (n > small)
-            std:
-                __throw_length_error("cannot create collections::vector larger than max_size()");
+        static size_type _S_check_size_init(size_type n, allocator_type const &alloc)
+        {
+            if (n > _S_max_size(alloc_type(alloc)))
+                std::__throw_length_error("cannot create collections::vector larger than max_size()");
 
             return n;
         }
 
+        /**
+         * @brief Capacity to grow to when @a n more elements are needed:
+         *        doubles the current size so appends stay amortized O(1).
+         */
+        size_type _Check_len(size_type n, const char *msg) const
+        {
+            if (max_size() - size() < n)
+                std::__throw_length_error(msg);
+
+            const size_type len = size() + std::max(size(), n);
+            return (len < size() || len > max_size()) ? max_size() : len;
+        }
+
+        /**
+         * @brief Reports a move to new storage; the elements count as moves or
+         *        copies the same way __uninitialized_move_if_noexcept_a picks.
+         *        The first allocation of an empty vector is not a reallocation.
+         */
+        void _Note_reallocate() const noexcept
+        {
+            if (!capacity())
+                return;
+            _Policy::on_reallocate();
+            if constexpr (std::__move_if_noexcept_cond<_Ty>::value)
+                _Policy::on_copy(size());
+            else
+                _Policy::on_move(size());
+        }
+
     public:
         vector() = default;
 
@@ -392,9 +540,10 @@ namespace collections
         {
             std::_Destroy(this->Impl._Start, this->Impl._Last, _Get_allocator());
         }
+
         /**
          * @brief Construct a new vector no elements
-         * 
+         *
          * @param alloc An allocator to vector
          */
         explicit vector(allocator_type const &alloc) noexcept
@@ -403,50 +552,138 @@ namespace collections
         }
 
         /**
-         * @brief Construct a new vector of @a n size with the value of @a value 
-         * 
+         * @brief Construct a new vector of @a n size with the value of @a value
+         *
          * @param n The Number of elementy to initially create.
          * @param value An element to copy
          * @param alloc An allocator
          */
-        explicit vector(size_type n, value_type const &value = value_type(), allocator_type const &alloc = allocator_type()) noexcept
+        explicit vector(size_type n, value_type const &value = value_type(), allocator_type const &alloc = allocator_type())
             : _Base(_S_check_size_init(n, alloc), alloc)
         {
             _Fill_initialize(n, value);
         }
 
-        vector(vector const &vec) noexcept
+        /**
+         * @brief Construct a new vector of @a n copies of @a value, written
+         *        by the workers of @a pool. Under first-touch placement (the
+         *        kernel default, or numa_allocator with numa_policy::local)
+         *        each page then lands on the node of a thread that wrote it
+         *        instead of all on the caller's node.
+         *
+         * @tparam _Pool Anything with parallel_for_blocks(first, last, fn),
+         *         e.g. collections::thread_pool
+         * @param n The Number of elementy to initially create.
+         * @param value An element to copy
+         * @param pool
+         * @param alloc An allocator
+         */
+        template <class _Pool, typename = decltype(std::declval<_Pool &>().parallel_for_blocks(
+                                   size_t(), size_t(), std::declval<void (*)(size_t, size_t)>()))>
+        vector(size_type n, value_type const &value, _Pool &pool, allocator_type const &alloc = allocator_type())
+            : _Base(_S_check_size_init(n, alloc), alloc)
         {
-            this->Impl._Last = std::__uninitialized_fill_n_a(
-                vec.begin(), vec.end(), this->Impl._Start, _Get_allocator());
+            _Parallel_fill_initialize(n, value, pool);
         }
 
-        iterator begin() noexcept
+        /**
+         * @brief Construct a new vector with copies of range [first, last)
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         * @param alloc
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        vector(Input first, Input last, allocator_type const &alloc = allocator_type())
+            : _Base(alloc)
         {
-            return iterator(this->Impl._Start);
+            _Range_initialize(first, last, typename std::iterator_traits<Input>::iterator_category());
         }
 
-        iterator end() noexcept
+        vector(std::initializer_list<value_type> l, allocator_type const &alloc = allocator_type())
+            : _Base(alloc)
         {
-            return iterator(this->Impl._Last);
+            _Range_initialize(l.begin(), l.end(), std::random_access_iterator_tag());
+        }
+
+        vector(vector const &vec)
+            : _Base(vec.size(), alloc_traits::select_on_container_copy_construction(vec._Get_allocator()))
+        {
+            this->Impl._Last = std::__uninitialized_copy_a(
+                vec.Impl._Start, vec.Impl._Last, this->Impl._Start, _Get_allocator());
+            _Policy::on_copy(vec.size());
+        }
+
+        vector(vector &&vec) noexcept
+            : _Base(std::move(vec))
+        {
+        }
+
+        vector &operator=(vector const &vec)
+        {
+            if (this != std::addressof(vec))
+                assign(vec.Impl._Start, vec.Impl._Last);
+            return *this;
+        }
+
+        vector &operator=(vector &&vec) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                                 alloc_traits::is_always_equal::value)
+        {
+            if (this != std::addressof(vec))
+                _Move_assign(std::move(vec), std::bool_constant<alloc_traits::propagate_on_container_move_assignment::value ||
+                                                                alloc_traits::is_always_equal::value>());
+            return *this;
+        }
+
+        vector &operator=(std::initializer_list<value_type> l)
+        {
+            assign(l.begin(), l.end());
+            return *this;
+        }
+
+        /**
+         * @brief Replaces the contents with copies of range [first, last)
+         *
+         * @tparam Input
+         * @param first
+         * @param last
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        void assign(Input first, Input last)
+        {
+            clear();
+            insert(cend(), first, last);
+        }
+
+        /**
+         * @brief Replaces the contents with @a n copies of @a value
+         *
+         * @param n
+         * @param value
+         */
+        void assign(size_type n, value_type const &value)
+        {
+            clear();
+            insert(cend(), n, value);
         }
 
-        iterator begin() const noexcept
+        iterator begin() noexcept
         {
             return iterator(this->Impl._Start);
         }
 
-        iterator end() const noexcept
+        iterator end() noexcept
         {
             return iterator(this->Impl._Last);
         }
 
-        const_iterator cbegin() noexcept
+        const_iterator begin() const noexcept
         {
             return const_iterator(this->Impl._Start);
         }
 
-        const_iterator cend() noexcept
+        const_iterator end() const noexcept
         {
             return const_iterator(this->Impl._Last);
         }
@@ -461,11 +698,607 @@ namespace collections
             return const_iterator(this->Impl._Last);
         }
 
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return const_reverse_iterator(cend());
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return const_reverse_iterator(cbegin());
+        }
+
+        /**
+         * @brief Gets the number of elements
+         *
+         * @return size_type
+         */
+        size_type size() const noexcept
+        {
+            return size_type(this->Impl._Last - this->Impl._Start);
+        }
+
+        /**
+         * @brief Gets the number of elements that fit the allocated storage
+         *
+         * @return size_type
+         */
+        size_type capacity() const noexcept
+        {
+            return size_type(this->Impl._End_storage - this->Impl._Start);
+        }
+
+        size_type max_size() const noexcept
+        {
+            return _S_max_size(_Get_allocator());
+        }
+
+        bool empty() const noexcept
+        {
+            return this->Impl._Start == this->Impl._Last;
+        }
+
+        pointer data() noexcept
+        {
+            return this->Impl._Start;
+        }
+
+        const_pointer data() const noexcept
+        {
+            return this->Impl._Start;
+        }
+
+        reference operator[](size_type n) noexcept
+        {
+            return this->Impl._Start[n];
+        }
+
+        const_reference operator[](size_type n) const noexcept
+        {
+            return this->Impl._Start[n];
+        }
+
+        /**
+         * @brief Gets a reference to the element at @a n, checking bounds
+         *
+         * @param n
+         * @return reference
+         */
+        reference at(size_type n)
+        {
+            if (n >= size())
+                std::__throw_out_of_range("collections::vector::at");
+            return this->Impl._Start[n];
+        }
+
+        const_reference at(size_type n) const
+        {
+            if (n >= size())
+                std::__throw_out_of_range("collections::vector::at");
+            return this->Impl._Start[n];
+        }
+
+        reference front() noexcept
+        {
+            return *this->Impl._Start;
+        }
+
+        const_reference front() const noexcept
+        {
+            return *this->Impl._Start;
+        }
+
+        reference back() noexcept
+        {
+            return *(this->Impl._Last - 1);
+        }
+
+        const_reference back() const noexcept
+        {
+            return *(this->Impl._Last - 1);
+        }
+
+        /**
+         * @brief Grows the storage to hold at least @a n elements
+         *
+         * @param n
+         */
+        void reserve(size_type n)
+        {
+            if (n > max_size())
+                std::__throw_length_error("collections::vector::reserve");
+            if (capacity() < n)
+                _Reallocate(n);
+        }
+
+        /**
+         * @brief Releases the storage not used by elements
+         *
+         */
+        void shrink_to_fit()
+        {
+            if (capacity() != size())
+                _Reallocate(size());
+        }
+
+        /**
+         * @brief Inserts a new object in the end of vector
+         *
+         * @tparam Args
+         * @param args
+         * @return reference
+         */
+        template <typename... Args>
+        reference emplace_back(Args &&...args)
+        {
+            if (this->Impl._Last != this->Impl._End_storage)
+            {
+                alloc_traits::construct(this->Impl, this->Impl._Last, std::forward<Args>(args)...);
+                ++this->Impl._Last;
+            }
+            else
+                _Realloc_insert(end(), std::forward<Args>(args)...);
+            return back();
+        }
+
+        void push_back(value_type const &value)
+        {
+            _Policy::on_copy(1);
+            emplace_back(value);
+        }
+
+        void push_back(value_type &&value)
+        {
+            _Policy::on_move(1);
+            emplace_back(std::move(value));
+        }
+
+        /**
+         * @brief Removes last element.
+         *
+         */
+        void pop_back() noexcept
+        {
+            --this->Impl._Last;
+            alloc_traits::destroy(this->Impl, this->Impl._Last);
+        }
+
+        /**
+         * @brief Inserts a new object before @a position
+         *
+         * @return iterator Pointing to the new element
+         */
+        template <typename... Args>
+        iterator emplace(const_iterator position, Args &&...args)
+        {
+            const difference_type offset = position - cbegin();
+            if (this->Impl._Last == this->Impl._End_storage)
+                _Realloc_insert(begin() + offset, std::forward<Args>(args)...);
+            else if (position == cend())
+            {
+                alloc_traits::construct(this->Impl, this->Impl._Last, std::forward<Args>(args)...);
+                ++this->Impl._Last;
+            }
+            else
+            {
+                value_type temp(std::forward<Args>(args)...);
+                _Policy::on_move(size_type(this->Impl._Last - this->Impl._Start - offset) + 1);
+                alloc_traits::construct(this->Impl, this->Impl._Last, std::move(*(this->Impl._Last - 1)));
+                ++this->Impl._Last;
+                std::move_backward(this->Impl._Start + offset, this->Impl._Last - 2, this->Impl._Last - 1);
+                this->Impl._Start[offset] = std::move(temp);
+            }
+            return begin() + offset;
+        }
+
+        iterator insert(const_iterator position, value_type const &value)
+        {
+            _Policy::on_copy(1);
+            return emplace(position, value);
+        }
+
+        iterator insert(const_iterator position, value_type &&value)
+        {
+            _Policy::on_move(1);
+            return emplace(position, std::move(value));
+        }
+
+        /**
+         * @brief Inserts @a n copies of @a value before @a position
+         *
+         * @return iterator Pointing to the first element inserted
+         */
+        iterator insert(const_iterator position, size_type n, value_type const &value)
+        {
+            const difference_type offset = position - cbegin();
+            if (n)
+            {
+                value_type copy(value);
+                _Insert_n(
+                    offset, n, [this, &copy](pointer dst, size_type, size_type k)
+                    { std::__uninitialized_fill_n_a(dst, k, copy, _Get_allocator()); },
+                    [&copy](pointer dst, size_type, size_type k)
+                    { std::fill_n(dst, k, copy); });
+                _Policy::on_copy(n);
+            }
+            return begin() + offset;
+        }
+
+        /**
+         * @brief Inserts copies of the range [first, last) before @a position
+         *
+         * @return iterator Pointing to the first element inserted
+         */
+        template <typename Input, typename = std::_RequireInputIter<Input>>
+        iterator insert(const_iterator position, Input first, Input last)
+        {
+            const difference_type offset = position - cbegin();
+            if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                            typename std::iterator_traits<Input>::iterator_category>)
+            {
+                const size_type n = std::distance(first, last);
+                if (n)
+                {
+                    _Insert_n(
+                        offset, n, [this, &first](pointer dst, size_type i, size_type k)
+                        { std::__uninitialized_copy_a(std::next(first, i), std::next(first, i + k), dst, _Get_allocator()); },
+                        [&first](pointer dst, size_type i, size_type k)
+                        { std::copy(std::next(first, i), std::next(first, i + k), dst); });
+                    _Policy::on_copy(n);
+                }
+            }
+            else
+            {
+                for (difference_type i = offset; first != last; ++first, ++i)
+                    emplace(cbegin() + i, *first);
+            }
+            return begin() + offset;
+        }
+
+        iterator insert(const_iterator position, std::initializer_list<value_type> l)
+        {
+            return insert(position, l.begin(), l.end());
+        }
+
+        /**
+         * @brief Remove element at given position.
+         *
+         * @param position
+         * @return iterator
+         */
+        iterator erase(const_iterator position)
+        {
+            pointer pos = position._Current;
+            _Policy::on_move(size_type(this->Impl._Last - pos) - 1);
+            std::move(pos + 1, this->Impl._Last, pos);
+            pop_back();
+            return iterator(pos);
+        }
+
+        /**
+         * @brief Remove a range of elements.
+         *
+         * @param first
+         * @param last
+         * @return iterator
+         */
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            pointer pfirst = first._Current;
+            pointer plast = last._Current;
+            if (pfirst != plast)
+            {
+                _Policy::on_move(size_type(this->Impl._Last - plast));
+                _Erase_at_end(std::move(plast, this->Impl._Last, pfirst));
+            }
+            return iterator(pfirst);
+        }
+
+        void clear() noexcept
+        {
+            _Erase_at_end(this->Impl._Start);
+        }
+
+        /**
+         * @brief Resizes the vector to @a n elements, value-initializing new ones
+         *
+         * @param n
+         */
+        void resize(size_type n)
+        {
+            if (n > size())
+            {
+                const size_type k = n - size();
+                if (size_type(this->Impl._End_storage - this->Impl._Last) < k)
+                    _Reallocate(_Check_len(k, "collections::vector::resize"));
+                this->Impl._Last = std::__uninitialized_default_n_a(this->Impl._Last, k, _Get_allocator());
+            }
+            else
+                _Erase_at_end(this->Impl._Start + n);
+        }
+
+        void resize(size_type n, value_type const &value)
+        {
+            if (n > size())
+                insert(cend(), n - size(), value);
+            else
+                _Erase_at_end(this->Impl._Start + n);
+        }
+
+        void swap(vector &vec) noexcept
+        {
+            this->Impl._swap(vec.Impl);
+            std::__alloc_on_swap(_Get_allocator(), vec._Get_allocator());
+        }
+
+    protected:
+        /**
+         * @brief Takes the storage of @a vec; our old storage is released with
+         *        the allocator that made it before @a vec's is propagated.
+         */
+        void _Move_assign(vector &&vec, std::true_type) noexcept
+        {
+            vector old(this->get_allocator());
+            this->Impl._swap(vec.Impl);
+            old.Impl._swap(vec.Impl);
+            std::__alloc_on_move(_Get_allocator(), vec._Get_allocator());
+        }
+
+        /**
+         * @brief The allocator stays; storage can only be taken when it equals
+         *        @a vec's, otherwise the elements are moved one by one.
+         */
+        void _Move_assign(vector &&vec, std::false_type)
+        {
+            if (_Get_allocator() == vec._Get_allocator())
+                _Move_assign(std::move(vec), std::true_type());
+            else
+            {
+                assign(std::make_move_iterator(vec.begin()), std::make_move_iterator(vec.end()));
+                vec.clear();
+            }
+        }
+
+        void _Erase_at_end(pointer pos) noexcept
+        {
+            std::_Destroy(pos, this->Impl._Last, _Get_allocator());
+            this->Impl._Last = pos;
+        }
+
+        /**
+         * @brief Moves the elements into a new storage of @a n elements
+         *
+         * @param n
+         */
+        void _Reallocate(size_type n)
+        {
+            pointer start = this->_Allocate(n);
+            pointer last;
+            try
+            {
+                last = std::__uninitialized_move_if_noexcept_a(
+                    this->Impl._Start, this->Impl._Last, start, _Get_allocator());
+            }
+            catch (...)
+            {
+                this->_Deallocate(start, n);
+                throw;
+            }
+            _Note_reallocate();
+            std::_Destroy(this->Impl._Start, this->Impl._Last, _Get_allocator());
+            this->_Deallocate(this->Impl._Start, capacity());
+            this->Impl._Start = start;
+            this->Impl._Last = last;
+            this->Impl._End_storage = start + n;
+        }
+
+        template <typename... Args>
+        void _Realloc_insert(iterator position, Args &&...args)
+        {
+            const size_type len = _Check_len(1, "collections::vector::_Realloc_insert");
+            const size_type offset = position._Current - this->Impl._Start;
+            pointer start = this->_Allocate(len);
+            try
+            {
+                alloc_traits::construct(this->Impl, start + offset, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                this->_Deallocate(start, len);
+                throw;
+            }
+            pointer last = start;
+            try
+            {
+                last = std::__uninitialized_move_if_noexcept_a(
+                    this->Impl._Start, position._Current, start, _Get_allocator());
+                ++last;
+                last = std::__uninitialized_move_if_noexcept_a(
+                    position._Current, this->Impl._Last, last, _Get_allocator());
+            }
+            catch (...)
+            {
+                if (last == start)
+                    alloc_traits::destroy(this->Impl, start + offset);
+                else
+                    std::_Destroy(start, last, _Get_allocator());
+                this->_Deallocate(start, len);
+                throw;
+            }
+            _Note_reallocate();
+            std::_Destroy(this->Impl._Start, this->Impl._Last, _Get_allocator());
+            this->_Deallocate(this->Impl._Start, capacity());
+            this->Impl._Start = start;
+            this->Impl._Last = last;
+            this->Impl._End_storage = start + len;
+        }
+
+        /**
+         * @brief Inserts @a n elements at @a offset, laid out like
+         *        std::vector::_M_range_insert so that a throwing copy or move
+         *        leaves every slot either live once or raw. @a make(dst, i, k)
+         *        constructs source elements [i, i + k) in raw slots at @a dst
+         *        and cleans up after itself if it throws; @a assign(dst, i, k)
+         *        assigns them over live slots.
+         */
+        template <class _Make, class _Assign>
+        void _Insert_n(difference_type offset, size_type n, _Make make, _Assign assign)
+        {
+            if (size_type(this->Impl._End_storage - this->Impl._Last) < n)
+            {
+                const size_type len = _Check_len(n, "collections::vector::_Insert_n");
+                pointer start = this->_Allocate(len);
+                pointer mid = start + offset;
+                pointer last = mid + n;
+                try
+                {
+                    make(mid, 0, n);
+                }
+                catch (...)
+                {
+                    this->_Deallocate(start, len);
+                    throw;
+                }
+                try
+                {
+                    std::__uninitialized_move_if_noexcept_a(
+                        this->Impl._Start, this->Impl._Start + offset, start, _Get_allocator());
+                }
+                catch (...)
+                {
+                    std::_Destroy(mid, last, _Get_allocator());
+                    this->_Deallocate(start, len);
+                    throw;
+                }
+                try
+                {
+                    last = std::__uninitialized_move_if_noexcept_a(
+                        this->Impl._Start + offset, this->Impl._Last, last, _Get_allocator());
+                }
+                catch (...)
+                {
+                    std::_Destroy(start, last, _Get_allocator());
+                    this->_Deallocate(start, len);
+                    throw;
+                }
+                _Note_reallocate();
+                std::_Destroy(this->Impl._Start, this->Impl._Last, _Get_allocator());
+                this->_Deallocate(this->Impl._Start, capacity());
+                this->Impl._Start = start;
+                this->Impl._Last = last;
+                this->Impl._End_storage = start + len;
+                return;
+            }
+
+            pointer pos = this->Impl._Start + offset;
+            pointer old_last = this->Impl._Last;
+            const size_type after = size_type(old_last - pos);
+            _Policy::on_move(after);
+            if (after > n)
+            {
+                // the last n elements move to raw memory, the rest of the
+                // tail shifts over live slots and the gap is assigned
+                std::__uninitialized_move_a(old_last - n, old_last, old_last, _Get_allocator());
+                this->Impl._Last += n;
+                std::move_backward(pos, old_last - n, old_last);
+                assign(pos, 0, n);
+            }
+            else
+            {
+                // the source overhangs _Last: its tail is built in raw
+                // memory first, then the old tail moves past it
+                make(old_last, after, n - after);
+                this->Impl._Last += n - after;
+                try
+                {
+                    std::__uninitialized_move_a(pos, old_last, this->Impl._Last, _Get_allocator());
+                }
+                catch (...)
+                {
+                    std::_Destroy(old_last, this->Impl._Last, _Get_allocator());
+                    this->Impl._Last = old_last;
+                    throw;
+                }
+                this->Impl._Last += after;
+                assign(pos, 0, after);
+            }
+        }
+
     private:
-        void _Fill_initialize(size_type n, value_type const &value) noexcept
+        void _Fill_initialize(size_type n, value_type const &value)
         {
             this->Impl._Last = std::__uninitialized_fill_n_a(this->Impl._Start,
                                                              n, value, _Get_allocator());
+            _Policy::on_copy(n);
+        }
+
+        /**
+         * @brief _Fill_initialize() split into page sized blocks run on
+         *        @a pool. A copy that may throw would leave holes between
+         *        the finished blocks, so such types are filled serially.
+         */
+        template <class _Pool>
+        void _Parallel_fill_initialize(size_type n, value_type const &value, _Pool &pool)
+        {
+            if constexpr (!std::is_nothrow_copy_constructible_v<_Ty>)
+                _Fill_initialize(n, value);
+            else
+            {
+                constexpr size_type per_page = sizeof(_Ty) < 4096 ? 4096 / sizeof(_Ty) : 1;
+                const pointer start = this->Impl._Start;
+                pool.parallel_for_blocks(
+                    0, (n + per_page - 1) / per_page, [this, start, n, &value](size_t lo, size_t hi)
+                    {
+                        const size_type first = lo * per_page;
+                        const size_type last = std::min(hi * per_page, n);
+                        std::__uninitialized_fill_n_a(start + first, last - first, value, _Get_allocator()); });
+                this->Impl._Last = start + n;
+                _Policy::on_copy(n);
+            }
+        }
+
+        template <typename Input>
+        void _Range_initialize(Input first, Input last, std::input_iterator_tag)
+        {
+            for (; first != last; ++first)
+                emplace_back(*first);
+        }
+
+        template <typename Input>
+        void _Range_initialize(Input first, Input last, std::forward_iterator_tag)
+        {
+            const size_type n = std::distance(first, last);
+            this->_Create_storage(_S_check_size_init(n, _Get_allocator()));
+            this->Impl._Last = std::__uninitialized_copy_a(first, last, this->Impl._Start, _Get_allocator());
+            _Policy::on_copy(n);
         }
     };
-}
\ No newline at end of file
+
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator==(const vector<_Ty, _Alloc, _Policy> &x, const vector<_Ty, _Alloc, _Policy> &y)
+    {
+        return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin());
+    }
+
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator!=(const vector<_Ty, _Alloc, _Policy> &x, const vector<_Ty, _Alloc, _Policy> &y)
+    {
+        return !(x == y);
+    }
+
+    template <typename _Ty, typename _Alloc, typename _Policy>
+    inline bool operator<(const vector<_Ty, _Alloc, _Policy> &x, const vector<_Ty, _Alloc, _Policy> &y)
+    {
+        return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+    }
+}
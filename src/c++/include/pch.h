@@ -1,7 +1,19 @@
+#pragma once
+
 #include <iostream>
 #include <stddef.h>
 #include <functional>
 #include <stdexcept>
 #include <assert.h> 
-#include <crtdbg.h>
-#include <utility>
\ No newline at end of file
+#include <utility>
+
+// Debug assertions go through assert() under the _DEBUG switch on every
+// platform. Leak checking, formerly <crtdbg.h>, is done by
+// collections::tracking_allocator (tracking_allocator.h).
+#ifndef _ASSERT_EXPR
+#ifdef _DEBUG
+#define _ASSERT_EXPR(expr, msg) assert((expr) && (msg))
+#else
+#define _ASSERT_EXPR(expr, msg) ((void)0)
+#endif
+#endif